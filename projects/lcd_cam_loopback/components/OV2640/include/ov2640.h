@@ -98,7 +98,25 @@ extern "C" {
 #define OV2640_SENSOR_HISTO_LOW  0x61
 #define OV2640_SENSOR_HISTO_HIGH 0x62
 
+//OV2640_Mode_Switch的输出格式
+#define OV2640_FORMAT_NONE      0   //只有初始化寄存器表
+#define OV2640_FORMAT_YUV422    1
+#define OV2640_FORMAT_JPEG      2
+#define OV2640_FORMAT_RGB565    3
+
+typedef struct {
+    uint8_t size;           //初始化寄存器表, 0: SVGA, 1: UXGA, 同OV2640_Init的mode
+    uint8_t fre_double_en;  //CLKRC倍频, 同OV2640_Init
+    uint8_t format;         //OV2640_FORMAT_xxx
+    uint8_t byte_swap_en;   //RGB565字节交换, 同OV2640_RGB565_Mode
+    uint8_t clk_div;        //CLKRC分频, 同OV2640_Clock_Set
+} ov2640_mode_t;
+
 uint8_t OV2640_Init(uint8_t mode, uint8_t fre_double_en);
+//最近一次OV2640_Init中软复位到传感器响应的时间, 单位us
+uint32_t OV2640_Ready_Time(void);
+//设置CLKRC倍频和分频, 应在OV2640_Init之后调用
+uint8_t OV2640_Clock_Set(uint8_t fre_double_en, uint8_t div);
 void OV2640_JPEG_Mode(void);
 void OV2640_RGB565_Mode(uint8_t byte_swap_en);
 void OV2640_Auto_Exposure(uint8_t level);
@@ -111,7 +129,12 @@ void OV2640_Color_Bar(uint8_t sw);
 void OV2640_Window_Set(uint16_t sx, uint16_t sy, uint16_t width, uint16_t height);
 uint8_t OV2640_OutSize_Set(uint16_t width, uint16_t height);
 uint8_t OV2640_ImageWin_Set(uint16_t offx, uint16_t offy, uint16_t width, uint16_t height);
+//暂存开窗设置, 由OV2640_ImageWin_Commit在帧间隔(VSYNC之后)一次写入, 避免帧中途改变窗口
+uint8_t OV2640_ImageWin_Stage(uint16_t offx, uint16_t offy, uint16_t width, uint16_t height);
+uint8_t OV2640_ImageWin_Commit(void);
 uint8_t OV2640_ImageSize_Set(uint16_t width, uint16_t height);
+//切换到mode, 只写入与当前模式不同的寄存器
+uint8_t OV2640_Mode_Switch(const ov2640_mode_t *mode);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//后台SCCB任务: 运行时调节放入有界队列, 由后台任务依次写入, 调用者不等待I2C
+//同一设置在执行前多次提交时只写入最后的值, 被替代的请求以OV2640_ASYNC_REPLACED回调
+//后台任务运行期间, 其他任务不要直接调用OV2640_*/SCCB_*函数, 需要时使用OV2640_Async_Call
+
+//可合并的设置, 参数同对应的OV2640_*函数
+typedef enum {
+    OV2640_ASYNC_AUTO_EXPOSURE = 0,     //OV2640_Auto_Exposure
+    OV2640_ASYNC_LIGHT_MODE,            //OV2640_Light_Mode
+    OV2640_ASYNC_COLOR_SATURATION,      //OV2640_Color_Saturation
+    OV2640_ASYNC_BRIGHTNESS,            //OV2640_Brightness
+    OV2640_ASYNC_CONTRAST,              //OV2640_Contrast
+    OV2640_ASYNC_SPECIAL_EFFECTS,       //OV2640_Special_Effects
+    OV2640_ASYNC_COLOR_BAR,             //OV2640_Color_Bar
+    OV2640_ASYNC_SETTING_MAX,
+} ov2640_async_setting_t;
+
+//回调的result
+#define OV2640_ASYNC_OK         0   //已写入
+#define OV2640_ASYNC_REPLACED   1   //执行前被同一设置的新值替代, 未写入
+#define OV2640_ASYNC_BUS_ERROR  2   //有寄存器写失败
+
+//在后台任务中调用(OV2640_ASYNC_REPLACED在提交新值的任务中调用), 不能阻塞太久
+typedef void (*ov2640_async_cb_t)(uint8_t result, void *arg);
+
+typedef struct {
+    uint8_t queue_size;     //请求队列长度, 0: 默认8
+    uint32_t task_stack;    //0: 默认2048
+    uint8_t task_pri;
+} ov2640_async_config_t;
+
+//启动后台任务, 应在OV2640_Init之后调用
+//返回值:0,成功;1,失败
+uint8_t OV2640_Async_Init(const ov2640_async_config_t *config);
+
+//提交设置, 不阻塞; 同一设置已在队列中时只更新其值, 不占用队列
+//cb:可为NULL
+//返回值:0,成功;1,队列已满
+uint8_t OV2640_Async_Set(ov2640_async_setting_t setting, uint8_t value, ov2640_async_cb_t cb, void *arg);
+
+//在后台任务中执行func(func_arg), 用于不可合并的操作(例如OV2640_OutSize_Set), 按提交顺序执行
+//返回值:0,成功;1,队列已满
+uint8_t OV2640_Async_Call(void (*func)(void *func_arg), void *func_arg, ov2640_async_cb_t cb, void *arg, TickType_t ticks_to_wait);
+
+//等待之前提交的请求全部完成
+//返回值:0,成功;1,超时或队列已满
+uint8_t OV2640_Async_Flush(TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//寄存器表的压缩格式, 每条记录以一个字节开头, 高2位为类型, 低6位为个数(1~63):
+//  0x00:               结束
+//  0x01~0x3F N:        N个连续地址的寄存器, 之后为起始地址和N个值
+//  0x40~0x7F 0x40|N:   N个任意的{地址, 值}
+//  0x80~0xBF 0x80|N:   同一寄存器连续写N次(例如0x7D间接寄存器), 之后为地址和N个值
+//  0xC0~0xFF 0xC0|B:   选择寄存器组, 即写0xFF=B
+//解码后的写入顺序与原表完全相同
+//OV2640的SCCB每次只能写一个寄存器(没有地址自增), 连续地址只用于压缩, 写入时仍然逐个发送
+#define OV2640_PACK_END     (0x00)
+#define OV2640_PACK_RUN     (0x00)
+#define OV2640_PACK_PAIRS   (0x40)
+#define OV2640_PACK_SAME    (0x80)
+#define OV2640_PACK_BANK    (0xC0)
+#define OV2640_PACK_MAX_CNT (0x3F)
+
+typedef struct {
+    const uint8_t *p;
+    uint8_t type;
+    uint8_t left;           //当前记录剩余的寄存器个数
+    uint8_t reg;
+} ov2640_pack_iter_t;
+
+void ov2640_pack_begin(ov2640_pack_iter_t *it, const uint8_t *pack);
+
+//解码最多max个寄存器到table, 返回解码的个数, 0表示结束
+uint16_t ov2640_pack_read(ov2640_pack_iter_t *it, uint8_t (*table)[2], uint16_t max);
+
+//压缩len个寄存器到out, 包括结束标记
+//返回值:压缩后的长度, 0表示out空间不足
+uint32_t ov2640_pack_encode(const uint8_t (*table)[2], uint16_t len, uint8_t *out, uint32_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+//由host/ov2640_table_gen根据ov2640cfg.h生成, 不要手动修改
+//格式见ov2640_pack.h
+
+#include <stdint.h>
+
+//ov2640_uxga_init_reg_tbl: 178个寄存器, 356字节 -> 318字节
+static const uint8_t ov2640_uxga_init_reg_pack[] = {
+    0xC0, 0x42, 0x2C, 0xFF, 0x2E, 0xDF, 0xC1, 0x5E, 0x3C, 0x32, 0x11, 0x00, 0x09, 0x02, 0x04, 0xD8,
+    0x13, 0xE5, 0x14, 0x48, 0x2C, 0x0C, 0x33, 0x78, 0x3A, 0x33, 0x3B, 0xFB, 0x3E, 0x00, 0x43, 0x11,
+    0x16, 0x10, 0x39, 0x92, 0x35, 0xDA, 0x22, 0x1A, 0x37, 0xC3, 0x23, 0x00, 0x34, 0xC0, 0x36, 0x1A,
+    0x06, 0x88, 0x07, 0xC0, 0x0D, 0x87, 0x0E, 0x41, 0x4C, 0x00, 0x48, 0x00, 0x5B, 0x00, 0x42, 0x03,
+    0x4A, 0x81, 0x21, 0x99, 0x03, 0x24, 0x40, 0x38, 0x82, 0x49, 0x5C, 0x00, 0x63, 0x00, 0x46, 0x00,
+    0x0C, 0x3C, 0x61, 0x70, 0x62, 0x80, 0x7C, 0x05, 0x20, 0x80, 0x28, 0x30, 0x03, 0x6C, 0x00, 0x80,
+    0x00, 0x46, 0x70, 0x02, 0x71, 0x94, 0x73, 0xC1, 0x3D, 0x34, 0x5A, 0x57, 0x12, 0x00, 0x04, 0x17,
+    0x11, 0x75, 0x01, 0x97, 0x48, 0x32, 0x36, 0x03, 0x0F, 0x37, 0x40, 0x4F, 0xCA, 0x50, 0xA8, 0x5A,
+    0x23, 0x6D, 0x00, 0x6D, 0x38, 0xC0, 0x56, 0xE5, 0x7F, 0xF9, 0xC0, 0x41, 0x24, 0xE0, 0x14, 0x76,
+    0xFF, 0x33, 0xA0, 0x42, 0x20, 0x43, 0x18, 0x4C, 0x00, 0x87, 0xD5, 0x88, 0x3F, 0xD7, 0x03, 0xD9,
+    0x10, 0xD3, 0x82, 0xC8, 0x08, 0xC9, 0x80, 0x7C, 0x00, 0x7D, 0x00, 0x7C, 0x03, 0x7D, 0x48, 0x7D,
+    0x48, 0x7C, 0x08, 0x83, 0x7D, 0x20, 0x10, 0x0E, 0x41, 0x90, 0x00, 0x90, 0x91, 0x0E, 0x1A, 0x31,
+    0x5A, 0x69, 0x75, 0x7E, 0x88, 0x8F, 0x96, 0xA3, 0xAF, 0xC4, 0xD7, 0xE8, 0x20, 0x41, 0x92, 0x00,
+    0x8D, 0x93, 0x06, 0xE3, 0x05, 0x05, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41,
+    0x96, 0x00, 0x8D, 0x97, 0x08, 0x19, 0x02, 0x0C, 0x24, 0x30, 0x28, 0x26, 0x02, 0x98, 0x80, 0x00,
+    0x00, 0x4B, 0xC3, 0xEF, 0xA4, 0x00, 0xA8, 0x00, 0xC5, 0x11, 0xC6, 0x51, 0xBF, 0x80, 0xC7, 0x10,
+    0xB6, 0x66, 0xB8, 0xA5, 0xB7, 0x64, 0xB9, 0x7C, 0x03, 0xB3, 0xAF, 0x97, 0xFF, 0x03, 0xB0, 0xC5,
+    0x94, 0x0F, 0x45, 0xC4, 0x5C, 0xC0, 0xC8, 0xC1, 0x96, 0x8C, 0x00, 0x86, 0x3D, 0x06, 0x50, 0x00,
+    0x90, 0x2C, 0x00, 0x00, 0x88, 0x03, 0x5A, 0x90, 0x2C, 0x05, 0x49, 0xD3, 0x02, 0xC3, 0xED, 0x7F,
+    0x00, 0xDA, 0x09, 0xE5, 0x1F, 0xE1, 0x67, 0xE0, 0x00, 0xDD, 0x7F, 0x05, 0x00, 0x00,
+};
+
+//ov2640_svga_init_reg_tbl: 177个寄存器, 354字节 -> 316字节
+static const uint8_t ov2640_svga_init_reg_pack[] = {
+    0xC0, 0x42, 0x2C, 0xFF, 0x2E, 0xDF, 0xC1, 0x5E, 0x3C, 0x32, 0x11, 0x00, 0x09, 0x02, 0x04, 0xD8,
+    0x13, 0xE5, 0x14, 0x48, 0x2C, 0x0C, 0x33, 0x78, 0x3A, 0x33, 0x3B, 0xFB, 0x3E, 0x00, 0x43, 0x11,
+    0x16, 0x10, 0x39, 0x92, 0x35, 0xDA, 0x22, 0x1A, 0x37, 0xC3, 0x23, 0x00, 0x34, 0xC0, 0x36, 0x1A,
+    0x06, 0x88, 0x07, 0xC0, 0x0D, 0x87, 0x0E, 0x41, 0x4C, 0x00, 0x48, 0x00, 0x5B, 0x00, 0x42, 0x03,
+    0x4A, 0x81, 0x21, 0x99, 0x03, 0x24, 0x40, 0x38, 0x82, 0x49, 0x5C, 0x00, 0x63, 0x00, 0x46, 0x22,
+    0x0C, 0x3C, 0x61, 0x70, 0x62, 0x80, 0x7C, 0x05, 0x20, 0x80, 0x28, 0x30, 0x03, 0x6C, 0x00, 0x80,
+    0x00, 0x46, 0x70, 0x02, 0x71, 0x94, 0x73, 0xC1, 0x3D, 0x34, 0x5A, 0x57, 0x12, 0x40, 0x04, 0x17,
+    0x11, 0x43, 0x00, 0x4B, 0x47, 0x32, 0x09, 0x37, 0xC0, 0x4F, 0xCA, 0x50, 0xA8, 0x5A, 0x23, 0x6D,
+    0x00, 0x3D, 0x38, 0xC0, 0x56, 0xE5, 0x7F, 0xF9, 0xC0, 0x41, 0x24, 0xE0, 0x14, 0x76, 0xFF, 0x33,
+    0xA0, 0x42, 0x20, 0x43, 0x18, 0x4C, 0x00, 0x87, 0xD5, 0x88, 0x3F, 0xD7, 0x03, 0xD9, 0x10, 0xD3,
+    0x82, 0xC8, 0x08, 0xC9, 0x80, 0x7C, 0x00, 0x7D, 0x00, 0x7C, 0x03, 0x7D, 0x48, 0x7D, 0x48, 0x7C,
+    0x08, 0x83, 0x7D, 0x20, 0x10, 0x0E, 0x41, 0x90, 0x00, 0x90, 0x91, 0x0E, 0x1A, 0x31, 0x5A, 0x69,
+    0x75, 0x7E, 0x88, 0x8F, 0x96, 0xA3, 0xAF, 0xC4, 0xD7, 0xE8, 0x20, 0x41, 0x92, 0x00, 0x8D, 0x93,
+    0x06, 0xE3, 0x05, 0x05, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x96, 0x00,
+    0x8D, 0x97, 0x08, 0x19, 0x02, 0x0C, 0x24, 0x30, 0x28, 0x26, 0x02, 0x98, 0x80, 0x00, 0x00, 0x4B,
+    0xC3, 0xED, 0xA4, 0x00, 0xA8, 0x00, 0xC5, 0x11, 0xC6, 0x51, 0xBF, 0x80, 0xC7, 0x10, 0xB6, 0x66,
+    0xB8, 0xA5, 0xB7, 0x64, 0xB9, 0x7C, 0x03, 0xB3, 0xAF, 0x97, 0xFF, 0x03, 0xB0, 0xC5, 0x94, 0x0F,
+    0x45, 0xC4, 0x5C, 0xC0, 0x64, 0xC1, 0x4B, 0x8C, 0x00, 0x86, 0x3D, 0x06, 0x50, 0x00, 0xC8, 0x96,
+    0x00, 0x00, 0x00, 0x03, 0x5A, 0xC8, 0x96, 0x00, 0x49, 0xD3, 0x02, 0xC3, 0xED, 0x7F, 0x00, 0xDA,
+    0x09, 0xE5, 0x1F, 0xE1, 0x67, 0xE0, 0x00, 0xDD, 0x7F, 0x05, 0x00, 0x00,
+};
+
+//ov2640_yuv422_reg_tbl: 8个寄存器, 16字节 -> 17字节
+static const uint8_t ov2640_yuv422_reg_pack[] = {
+    0xC0, 0x47, 0xDA, 0x10, 0xD7, 0x03, 0xDF, 0x00, 0x33, 0x80, 0x3C, 0x40, 0xE1, 0x77, 0x00, 0x00,
+    0x00,
+};
+
+//ov2640_jpeg_reg_tbl: 7个寄存器, 14字节 -> 15字节
+static const uint8_t ov2640_jpeg_reg_pack[] = {
+    0xC1, 0x46, 0xE0, 0x14, 0xE1, 0x77, 0xE5, 0x1F, 0xD7, 0x03, 0xDA, 0x10, 0xE0, 0x00, 0x00,
+};
+
+//ov2640_rgb565_reg_tbl: 14个寄存器, 28字节 -> 29字节
+static const uint8_t ov2640_rgb565_reg_pack[] = {
+    0xC0, 0x46, 0xDA, 0x08, 0xD7, 0x03, 0xDF, 0x02, 0x33, 0xA0, 0x3C, 0x00, 0xE1, 0x67, 0xC1, 0x46,
+    0xE0, 0x00, 0xE1, 0x00, 0xE5, 0x00, 0xD7, 0x00, 0xDA, 0x00, 0xE0, 0x00, 0x00,
+};
+
+//合计: 768字节 -> 695字节
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -9,11 +10,33 @@ extern "C" {
 
 #define SCCB_ID   			0X60  			//OV2640的ID
 
+typedef struct {
+    uint32_t wr;        // 总线写次数
+    uint32_t wr_skip;   // 与影子寄存器相同而跳过的写次数
+    uint32_t wr_err;    // 写失败次数(批量写入失败后逐个重写的结果)
+    uint32_t rd;        // 总线读次数
+    uint32_t rd_hit;    // 由影子寄存器返回的读次数
+} sccb_stats_t;
+
 void SCCB_Init(void);
 uint8_t SCCB_WR_Byte(uint8_t dat);
 uint8_t SCCB_RD_Byte(void);
+//写寄存器, 与影子寄存器相同时跳过(包括0xFF寄存器组选择)
 uint8_t SCCB_WR_Reg(uint8_t reg, uint8_t data);
+//读寄存器, 影子寄存器有效时不访问总线
 uint8_t SCCB_RD_Reg(uint8_t reg);
+//读寄存器, 失败时不打印, 用于轮询传感器是否响应
+//返回值:0,成功;1,失败
+uint8_t SCCB_Try_RD_Reg(uint8_t reg, uint8_t *val);
+//批量写寄存器(应用寄存器差异), table[i][0]为寄存器地址, table[i][1]为数据, 只发送改变状态的项
+//err:可为NULL, 返回每个寄存器的写结果, 0,成功(包括跳过);1,失败
+//返回值:写失败的寄存器个数
+uint16_t SCCB_WR_Regs(const uint8_t (*table)[2], uint16_t len, uint8_t *err);
+//使影子寄存器全部失效, 例如传感器被硬件复位或掉电之后
+void SCCB_Cache_Invalidate(void);
+//影子寄存器中bank组(0: DSP, 1: sensor)的reg寄存器是否已知且等于data
+bool SCCB_Cache_Match(uint8_t bank, uint8_t reg, uint8_t data);
+void SCCB_Get_Stats(sccb_stats_t *stats);
 
 #ifdef __cplusplus
 }
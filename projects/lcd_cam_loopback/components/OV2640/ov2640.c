@@ -1,14 +1,102 @@
+#include <string.h>
 #include "ov2640.h"
-#include "ov2640cfg.h"
+#include "ov2640_pack.h"
+#include "ov2640cfg_pack.h"
 #include "sccb.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp32s2/rom/ets_sys.h"
 
 static const char *TAG = "OV2640";
 
 #define delay_ms(a) vTaskDelay(a / portTICK_RATE_MS);
 
+#define OV2640_SDE_MAX      (16)    // 初始化表中0x7C/0x7D间接寄存器写序列的最大长度
+#define OV2640_RESET_BITS   (0x14)  // 切换模式时复位DVP和JPEG, 同初始化表
+#define OV2640_PACK_CHUNK   (64)    // 压缩寄存器表每次解码的寄存器个数
+#define OV2640_READY_TIMEOUT_US     (100 * 1000)    // 软复位后等待传感器响应的最长时间
+#define OV2640_READY_POLL_US        (200)           // 轮询间隔, 每次加倍
+#define OV2640_READY_POLL_MAX_US    (5 * 1000)      // 轮询间隔上限, 不小于一个tick
+#define OV2640_TICK_US              (1000 * portTICK_PERIOD_MS)
+
+//每个模式最终产生的寄存器状态
+typedef struct {
+    uint8_t value[2][256];
+    uint8_t valid[2][256 / 8];
+    uint8_t sde[OV2640_SDE_MAX][2];
+    uint8_t sde_cnt;
+} ov2640_state_t;
+
+static uint32_t ov2640_ready_us = 0;   // 最近一次软复位到传感器响应的时间
+static ov2640_mode_t ov2640_cur;        // 当前模式
+static uint8_t ov2640_cur_valid = 0;    // 当前模式是否已知
+static ov2640_state_t ov2640_state[2];  // 0: 当前模式, 1: 目标模式
+static uint8_t ov2640_delta[2 * 256 + OV2640_SDE_MAX + 4][2];
+
+#define OV2640_WIN_TABLE_LEN    (9)     // 开窗寄存器表的长度
+
+static uint8_t ov2640_win_table[OV2640_WIN_TABLE_LEN][2];   // 暂存的开窗设置
+static uint16_t ov2640_win_len = 0;                         // 0: 没有暂存的设置
+static portMUX_TYPE ov2640_win_lock = portMUX_INITIALIZER_UNLOCKED;
+
+//流式解码压缩寄存器表, 交给SCCB_WR_Regs批量写入
+//返回值:写失败的寄存器个数
+static uint16_t ov2640_write_pack(const uint8_t *pack)
+{
+    uint8_t chunk[OV2640_PACK_CHUNK][2];
+    ov2640_pack_iter_t it;
+    uint16_t n = 0, fail = 0;
+
+    ov2640_pack_begin(&it, pack);
+    while ((n = ov2640_pack_read(&it, chunk, OV2640_PACK_CHUNK)) > 0) {
+        fail += SCCB_WR_Regs((const uint8_t (*)[2])chunk, n, NULL);
+    }
+    return fail;
+}
+
+//软复位后轮询厂家ID, 直到传感器响应或超时
+//返回值:0,成功;1,超时或ID错误
+static uint8_t ov2640_wait_ready(int64_t reset_time)
+{
+    uint32_t poll_us = OV2640_READY_POLL_US, busy_us = 0;
+    uint32_t poll_max_us = OV2640_READY_POLL_MAX_US > OV2640_TICK_US ? OV2640_READY_POLL_MAX_US : OV2640_TICK_US;
+    uint8_t midh = 0, midl = 0;
+    int64_t now = 0;
+
+    while (1) {
+        //复位期间可能NACK, 寄存器组选择写失败时影子寄存器保持未知, 下次重写
+        if (SCCB_WR_Reg(OV2640_DSP_RA_DLMT, 0x01) == 0 &&
+            SCCB_Try_RD_Reg(OV2640_SENSOR_MIDH, &midh) == 0 &&
+            SCCB_Try_RD_Reg(OV2640_SENSOR_MIDL, &midl) == 0 &&
+            ((midh << 8) | midl) == OV2640_MID) {
+            ov2640_ready_us = esp_timer_get_time() - reset_time;
+            return 0;
+        }
+        SCCB_Cache_Invalidate();    //ID不对时不缓存读到的值
+        now = esp_timer_get_time();
+        if (now - reset_time >= OV2640_READY_TIMEOUT_US) {
+            ESP_LOGE(TAG, "MID:%d, not ready after %d us\r\n", (midh << 8) | midl, (int)(now - reset_time));
+            return 1;
+        }
+        //忙等合计不超过一个tick, 之后按tick延时, 让出CPU给并行初始化的其他阶段
+        if (busy_us + poll_us <= OV2640_TICK_US) {
+            ets_delay_us(poll_us);
+            busy_us += poll_us;
+        } else {
+            vTaskDelay(poll_us < OV2640_TICK_US ? 1 : poll_us / OV2640_TICK_US);
+        }
+        poll_us = poll_us * 2 > poll_max_us ? poll_max_us : poll_us * 2;
+    }
+}
+
+//最近一次OV2640_Init中软复位到传感器响应的时间, 单位us
+uint32_t OV2640_Ready_Time(void)
+{
+    return ov2640_ready_us;
+}
+
 //初始化OV2640，XCLK输入12MHz时钟
 //配置完以后,默认输出是1600*1200尺寸的图片!!
 //返回值:0,成功
@@ -16,40 +104,28 @@ static const char *TAG = "OV2640";
 uint8_t OV2640_Init(uint8_t mode, uint8_t fre_double_en)
 {
     uint16_t i = 0;
-    uint16_t reg;
 
     SCCB_Init();        		//初始化SCCB 的IO口	 
     SCCB_WR_Reg(OV2640_DSP_RA_DLMT, 0x01);	//操作sensor寄存器
     SCCB_WR_Reg(OV2640_SENSOR_COM7, 0x80);	//软复位OV2640
-    delay_ms(50);
-    reg = SCCB_RD_Reg(OV2640_SENSOR_MIDH);	//读取厂家ID 高八位
-    reg <<= 8;
-    reg |= SCCB_RD_Reg(OV2640_SENSOR_MIDL);	//读取厂家ID 低八位
-
-    if (reg != OV2640_MID) {
-        ESP_LOGI(TAG, "MID:%d\r\n", reg);
+    ov2640_cur_valid = 0;
+    //轮询厂家ID代替固定的50ms延时
+    if (ov2640_wait_ready(esp_timer_get_time())) {
         return 1;
     }
-
-    reg = SCCB_RD_Reg(OV2640_SENSOR_PIDH);	//读取厂家ID 高八位
-    reg <<= 8;
-    reg |= SCCB_RD_Reg(OV2640_SENSOR_PIDL);	//读取厂家ID 低八位
-
-    if (reg != OV2640_PID) {
-        ESP_LOGI(TAG, "HID:%d\r\n", reg);
-        //return 2;
-    }
+    ESP_LOGD(TAG, "ready %d us after reset\r\n", ov2640_ready_us);
 
     if (mode == 0) {
         //初始化 OV2640,采用SVGA分辨率(800*600)
-        for (i = 0; i < sizeof(ov2640_svga_init_reg_tbl) / 2; i++) {
-            SCCB_WR_Reg(ov2640_svga_init_reg_tbl[i][0], ov2640_svga_init_reg_tbl[i][1]);
-        }
+        i = ov2640_write_pack(ov2640_svga_init_reg_pack);
     } else {
         //初始化 OV2640,采用UXGA分辨率(1600*1200)
-        for (i = 0; i < sizeof(ov2640_uxga_init_reg_tbl) / 2; i++) {
-            SCCB_WR_Reg(ov2640_uxga_init_reg_tbl[i][0], ov2640_uxga_init_reg_tbl[i][1]);
-        }
+        i = ov2640_write_pack(ov2640_uxga_init_reg_pack);
+    }
+
+    if (i) {
+        ESP_LOGE(TAG, "init table: %d writes failed\r\n", i);
+        return 3;
     }
 
     if (fre_double_en) {
@@ -58,50 +134,67 @@ uint8_t OV2640_Init(uint8_t mode, uint8_t fre_double_en)
         SCCB_WR_Reg(OV2640_SENSOR_CLKRC, temp | 0x80);
     }
 
+    ov2640_cur.size = mode;
+    ov2640_cur.fre_double_en = fre_double_en;
+    ov2640_cur.clk_div = 0;
+    ov2640_cur.format = OV2640_FORMAT_NONE;
+    ov2640_cur.byte_swap_en = 0;
+    ov2640_cur_valid = 1;
+
     return 0x00; 	//ok
 }
 
+//设置传感器内部时钟(CLKRC): XCLK * (fre_double_en ? 2 : 1) / (div + 1), 帧率与之成正比
+//div:0~63
+//返回值:0,成功;1,参数错误;2,写失败
+uint8_t OV2640_Clock_Set(uint8_t fre_double_en, uint8_t div)
+{
+    if (div > 0x3F) {
+        return 1;
+    }
+    SCCB_WR_Reg(0xFF, 0x01);
+    if (SCCB_WR_Reg(OV2640_SENSOR_CLKRC, (fre_double_en ? 0x80 : 0x00) | div)) {
+        return 2;
+    }
+    ov2640_cur.fre_double_en = fre_double_en;
+    ov2640_cur.clk_div = div;
+    return 0;
+}
+
 //OV2640切换为YUV模式
 void OV2640_YUV_Mode(void)
 {
-    uint16_t i = 0;
-
     //设置:YUV422格式
-    for (i = 0; i < (sizeof(ov2640_yuv422_reg_tbl) / 2); i++) {
-        SCCB_WR_Reg(ov2640_yuv422_reg_tbl[i][0], ov2640_yuv422_reg_tbl[i][1]);
-    }
-
+    ov2640_write_pack(ov2640_yuv422_reg_pack);
+    ov2640_cur.format = OV2640_FORMAT_YUV422;
+    ov2640_cur.byte_swap_en = 0;
 }
 
 //OV2640切换为JPEG模式
 void OV2640_JPEG_Mode(void)
 {
-    uint16_t i = 0;
     OV2640_YUV_Mode();
     SCCB_WR_Reg(0xFF, 0x00);
     uint8_t temp = SCCB_RD_Reg(OV2640_DSP_IMAGE_MODE);	
     SCCB_WR_Reg(OV2640_DSP_IMAGE_MODE, temp | 0x10);
     //设置:输出JPEG数据
-    for (i = 0; i < (sizeof(ov2640_jpeg_reg_tbl) / 2); i++) {
-        SCCB_WR_Reg(ov2640_jpeg_reg_tbl[i][0], ov2640_jpeg_reg_tbl[i][1]);
-    }
+    ov2640_write_pack(ov2640_jpeg_reg_pack);
+    ov2640_cur.format = OV2640_FORMAT_JPEG;
 }
 
 //OV2640切换为RGB565模式
 void OV2640_RGB565_Mode(uint8_t byte_swap_en)
 {
-    uint16_t i = 0;
-
     //设置:RGB565输出
-    for (i = 0; i < (sizeof(ov2640_rgb565_reg_tbl) / 2); i++) {
-        SCCB_WR_Reg(ov2640_rgb565_reg_tbl[i][0], ov2640_rgb565_reg_tbl[i][1]);
-    }
+    ov2640_write_pack(ov2640_rgb565_reg_pack);
 
     if (byte_swap_en) {
         SCCB_WR_Reg(0xFF, 0x00);
         uint8_t temp = SCCB_RD_Reg(OV2640_DSP_IMAGE_MODE);	
         SCCB_WR_Reg(OV2640_DSP_IMAGE_MODE, temp | 0x01);
     }
+    ov2640_cur.format = OV2640_FORMAT_RGB565;
+    ov2640_cur.byte_swap_en = byte_swap_en;
 }
 //自动曝光设置参数表,支持5个等级
 const static uint8_t OV2640_AUTOEXPOSURE_LEVEL[5][8] = {
@@ -140,12 +233,7 @@ const static uint8_t OV2640_AUTOEXPOSURE_LEVEL[5][8] = {
 //level:0~4
 void OV2640_Auto_Exposure(uint8_t level)
 {
-    uint8_t i;
-    uint8_t *p = (uint8_t *)OV2640_AUTOEXPOSURE_LEVEL[level];
-
-    for (i = 0; i < 4; i++) {
-        SCCB_WR_Reg(p[i * 2], p[i * 2 + 1]);
-    }
+    SCCB_WR_Regs((const uint8_t (*)[2])OV2640_AUTOEXPOSURE_LEVEL[level], 4, NULL);
 }
 //白平衡设置
 //0:自动
@@ -391,6 +479,29 @@ uint8_t OV2640_OutSize_Set(uint16_t width, uint16_t height)
     SCCB_WR_Reg(0XE0, 0X00);
     return 0;
 }
+//开窗寄存器表, 写在一条命令链中
+static uint16_t ov2640_imagewin_table(uint8_t (*table)[2], uint16_t offx, uint16_t offy, uint16_t width, uint16_t height)
+{
+    uint16_t hsize = width / 4;
+    uint16_t vsize = height / 4;
+    uint8_t temp;
+    uint16_t len = 0;
+
+    table[len][0] = 0XFF; table[len++][1] = 0X00;
+    table[len][0] = 0XE0; table[len++][1] = 0X04;
+    table[len][0] = 0X51; table[len++][1] = hsize & 0XFF;		//设置H_SIZE的低八位
+    table[len][0] = 0X52; table[len++][1] = vsize & 0XFF;		//设置V_SIZE的低八位
+    table[len][0] = 0X53; table[len++][1] = offx & 0XFF;		//设置offx的低八位
+    table[len][0] = 0X54; table[len++][1] = offy & 0XFF;		//设置offy的低八位
+    temp = (vsize >> 1) & 0X80;
+    temp |= (offy >> 4) & 0X70;
+    temp |= (hsize >> 5) & 0X08;
+    temp |= (offx >> 8) & 0X07;
+    table[len][0] = 0X55; table[len++][1] = temp;				//设置H_SIZE/V_SIZE/OFFX,OFFY的高位
+    table[len][0] = 0X57; table[len++][1] = (hsize >> 2) & 0X80;	//设置H_SIZE/V_SIZE/OFFX,OFFY的高位
+    table[len][0] = 0XE0; table[len++][1] = 0X00;
+    return len;
+}
 //设置图像开窗大小
 //由:OV2640_ImageSize_Set确定传感器输出分辨率从大小.
 //该函数则在这个范围上面进行开窗,用于OV2640_OutSize_Set的输出
@@ -402,9 +513,8 @@ uint8_t OV2640_OutSize_Set(uint16_t width, uint16_t height)
 //    其他,设置失败
 uint8_t OV2640_ImageWin_Set(uint16_t offx, uint16_t offy, uint16_t width, uint16_t height)
 {
-    uint16_t hsize;
-    uint16_t vsize;
-    uint8_t temp;
+    uint8_t table[OV2640_WIN_TABLE_LEN][2];
+    uint16_t len;
 
     if (width % 4) {
         return 1;
@@ -414,23 +524,47 @@ uint8_t OV2640_ImageWin_Set(uint16_t offx, uint16_t offy, uint16_t width, uint16
         return 2;
     }
 
-    hsize = width / 4;
-    vsize = height / 4;
-    SCCB_WR_Reg(0XFF, 0X00);
-    SCCB_WR_Reg(0XE0, 0X04);
-    SCCB_WR_Reg(0X51, hsize & 0XFF);		//设置H_SIZE的低八位
-    SCCB_WR_Reg(0X52, vsize & 0XFF);		//设置V_SIZE的低八位
-    SCCB_WR_Reg(0X53, offx & 0XFF);		//设置offx的低八位
-    SCCB_WR_Reg(0X54, offy & 0XFF);		//设置offy的低八位
-    temp = (vsize >> 1) & 0X80;
-    temp |= (offy >> 4) & 0X70;
-    temp |= (hsize >> 5) & 0X08;
-    temp |= (offx >> 8) & 0X07;
-    SCCB_WR_Reg(0X55, temp);				//设置H_SIZE/V_SIZE/OFFX,OFFY的高位
-    SCCB_WR_Reg(0X57, (hsize >> 2) & 0X80);	//设置H_SIZE/V_SIZE/OFFX,OFFY的高位
-    SCCB_WR_Reg(0XE0, 0X00);
+    len = ov2640_imagewin_table(table, offx, offy, width, height);
+    SCCB_WR_Regs((const uint8_t (*)[2])table, len, NULL);
     return 0;
 }
+//暂存开窗设置, 不访问总线, 由OV2640_ImageWin_Commit在帧间隔中一次写入
+//多次暂存时只保留最后一次, 用于平滑的缩放/平移
+//参数和返回值同OV2640_ImageWin_Set
+uint8_t OV2640_ImageWin_Stage(uint16_t offx, uint16_t offy, uint16_t width, uint16_t height)
+{
+    if (width % 4) {
+        return 1;
+    }
+
+    if (height % 4) {
+        return 2;
+    }
+
+    portENTER_CRITICAL(&ov2640_win_lock);
+    ov2640_win_len = ov2640_imagewin_table(ov2640_win_table, offx, offy, width, height);
+    portEXIT_CRITICAL(&ov2640_win_lock);
+    return 0;
+}
+//写入暂存的开窗设置, 应在VSYNC之后的帧间隔中调用, 不能在中断中调用
+//返回值:0,没有暂存的设置
+//       1,已写入
+//       2,写寄存器失败
+uint8_t OV2640_ImageWin_Commit(void)
+{
+    uint8_t table[OV2640_WIN_TABLE_LEN][2];
+    uint16_t len;
+
+    portENTER_CRITICAL(&ov2640_win_lock);
+    len = ov2640_win_len;
+    memcpy(table, ov2640_win_table, len * 2);
+    ov2640_win_len = 0;
+    portEXIT_CRITICAL(&ov2640_win_lock);
+    if (len == 0) {
+        return 0;
+    }
+    return SCCB_WR_Regs((const uint8_t (*)[2])table, len, NULL) ? 2 : 1;
+}
 //该函数设置图像尺寸大小,也就是所选格式的输出分辨率
 //UXGA:1600*1200,SVGA:800*600,CIF:352*288
 //width,height:图像宽度和图像高度
@@ -449,4 +583,195 @@ uint8_t OV2640_ImageSize_Set(uint16_t width, uint16_t height)
     SCCB_WR_Reg(0X8C, temp);
     SCCB_WR_Reg(0XE0, 0X00);
     return 0;
+}
+
+//将寄存器表叠加到state上, bank为当前寄存器组
+static void ov2640_state_apply(ov2640_state_t *state, int *bank, const uint8_t (*table)[2], uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t reg = table[i][0];
+        if (reg == OV2640_DSP_RA_DLMT) {
+            *bank = table[i][1] & 0x01;
+            continue;
+        }
+        if (*bank < 0) {
+            continue;
+        }
+        if (*bank == 0 && (reg == OV2640_DSP_BPADDR || reg == OV2640_DSP_BPDATA)) {
+            //间接寄存器地址自增, 只能按原顺序重放
+            if (state->sde_cnt < OV2640_SDE_MAX) {
+                state->sde[state->sde_cnt][0] = reg;
+                state->sde[state->sde_cnt][1] = table[i][1];
+                state->sde_cnt++;
+            }
+            continue;
+        }
+        if (*bank == 0 && reg == OV2640_DSP_RESET) {
+            //复位由切换序列统一处理
+            continue;
+        }
+        state->value[*bank][reg] = table[i][1];
+        state->valid[*bank][reg / 8] |= 1 << (reg % 8);
+    }
+}
+
+//将压缩寄存器表叠加到state上
+static void ov2640_state_apply_pack(ov2640_state_t *state, int *bank, const uint8_t *pack)
+{
+    uint8_t chunk[OV2640_PACK_CHUNK][2];
+    ov2640_pack_iter_t it;
+    uint16_t n = 0;
+
+    ov2640_pack_begin(&it, pack);
+    while ((n = ov2640_pack_read(&it, chunk, OV2640_PACK_CHUNK)) > 0) {
+        ov2640_state_apply(state, bank, (const uint8_t (*)[2])chunk, n);
+    }
+}
+
+//对应OV2640_xxx_Mode中的读-改-写
+static void ov2640_state_or(ov2640_state_t *state, int bank, uint8_t reg, uint8_t bits)
+{
+    if (state->valid[bank][reg / 8] & (1 << (reg % 8))) {
+        state->value[bank][reg] |= bits;
+    }
+}
+
+//计算mode最终产生的寄存器状态, 与OV2640_Init + OV2640_xxx_Mode写入的结果相同
+static void ov2640_state_build(ov2640_state_t *state, const ov2640_mode_t *mode)
+{
+    int bank = -1;
+    memset(state, 0, sizeof(ov2640_state_t));
+    if (mode->size == 0) {
+        ov2640_state_apply_pack(state, &bank, ov2640_svga_init_reg_pack);
+    } else {
+        ov2640_state_apply_pack(state, &bank, ov2640_uxga_init_reg_pack);
+    }
+    //初始化表中CLKRC为0x00
+    ov2640_state_or(state, 1, OV2640_SENSOR_CLKRC, (mode->fre_double_en ? 0x80 : 0x00) | mode->clk_div);
+    switch (mode->format) {
+        case OV2640_FORMAT_YUV422:
+            ov2640_state_apply_pack(state, &bank, ov2640_yuv422_reg_pack);
+            break;
+
+        case OV2640_FORMAT_JPEG:
+            ov2640_state_apply_pack(state, &bank, ov2640_yuv422_reg_pack);
+            ov2640_state_or(state, 0, OV2640_DSP_IMAGE_MODE, 0x10);
+            ov2640_state_apply_pack(state, &bank, ov2640_jpeg_reg_pack);
+            break;
+
+        case OV2640_FORMAT_RGB565:
+            ov2640_state_apply_pack(state, &bank, ov2640_rgb565_reg_pack);
+            if (mode->byte_swap_en) {
+                ov2640_state_or(state, 0, OV2640_DSP_IMAGE_MODE, 0x01);
+            }
+            break;
+    }
+}
+
+static void ov2640_format_set(const ov2640_mode_t *mode)
+{
+    switch (mode->format) {
+        case OV2640_FORMAT_YUV422:
+            OV2640_YUV_Mode();
+            break;
+
+        case OV2640_FORMAT_JPEG:
+            OV2640_JPEG_Mode();
+            break;
+
+        case OV2640_FORMAT_RGB565:
+            OV2640_RGB565_Mode(mode->byte_swap_en);
+            break;
+    }
+}
+
+//切换到mode, 只写入当前模式与目标模式之间不同的寄存器, 按寄存器组分组, 每组只切换一次0xFF
+//两个模式设置相同的寄存器保持不变, 因此OV2640_OutSize_Set等运行时设置在切换后仍然有效
+//当前模式未知, 或者当前模式设置过而目标模式没有设置的寄存器(无法恢复默认值)时, 复位后完整初始化
+//返回值:0,成功
+//    其他,错误代码
+uint8_t OV2640_Mode_Switch(const ov2640_mode_t *mode)
+{
+    ov2640_state_t *cur = &ov2640_state[0];
+    ov2640_state_t *target = &ov2640_state[1];
+    uint8_t full = !ov2640_cur_valid;
+    uint8_t init_change = 0;
+    uint16_t cnt = 0, start = 0, fail = 0;
+
+    if (!full) {
+        init_change = ov2640_cur.size != mode->size || ov2640_cur.fre_double_en != mode->fre_double_en;
+    }
+    if (init_change) {
+        // 只检查初始化表, 格式表之间的差异与直接调用OV2640_xxx_Mode的结果相同
+        ov2640_mode_t init_mode = *mode;
+        init_mode.format = OV2640_FORMAT_NONE;
+        ov2640_state_build(target, &init_mode);
+        init_mode = ov2640_cur;
+        init_mode.format = OV2640_FORMAT_NONE;
+        ov2640_state_build(cur, &init_mode);
+        for (int x = 0; x < sizeof(cur->valid); x++) {
+            if (((uint8_t *)cur->valid)[x] & ~((uint8_t *)target->valid)[x]) {
+                full = 1;
+                break;
+            }
+        }
+    }
+    if (full) {
+        fail = OV2640_Init(mode->size, mode->fre_double_en);
+        if (fail) {
+            return fail;
+        }
+        if (mode->clk_div && OV2640_Clock_Set(mode->fre_double_en, mode->clk_div)) {
+            return 3;
+        }
+        ov2640_format_set(mode);
+        return 0;
+    }
+
+    ov2640_state_build(cur, &ov2640_cur);
+    ov2640_state_build(target, mode);
+    // 先sensor组再DSP组, DSP组的修改在复位期间进行
+    for (int bank = 1; bank >= 0; bank--) {
+        start = cnt;
+        ov2640_delta[cnt][0] = OV2640_DSP_RA_DLMT;
+        ov2640_delta[cnt++][1] = bank;
+        if (bank == 0) {
+            ov2640_delta[cnt][0] = OV2640_DSP_RESET;
+            ov2640_delta[cnt++][1] = OV2640_RESET_BITS;
+        }
+        for (int reg = 0; reg < 256; reg++) {
+            uint8_t value = target->value[bank][reg];
+            if (!(target->valid[bank][reg / 8] & (1 << (reg % 8)))) {
+                continue;
+            }
+            // 初始化表改变时按完整重放处理, 否则只比较两个模式之间的差异
+            if (!init_change && (cur->valid[bank][reg / 8] & (1 << (reg % 8))) && cur->value[bank][reg] == value) {
+                continue;
+            }
+            if (SCCB_Cache_Match(bank, reg, value)) {
+                continue;
+            }
+            ov2640_delta[cnt][0] = reg;
+            ov2640_delta[cnt++][1] = value;
+        }
+        if (bank == 0 && init_change) {
+            memcpy(&ov2640_delta[cnt], target->sde, target->sde_cnt * 2);
+            cnt += target->sde_cnt;
+        }
+        if (cnt == start + (bank == 0 ? 2 : 1)) {
+            cnt = start;        // 该组没有需要写入的寄存器
+        } else if (bank == 0) {
+            ov2640_delta[cnt][0] = OV2640_DSP_RESET;
+            ov2640_delta[cnt++][1] = 0x00;
+        }
+    }
+
+    fail = SCCB_WR_Regs(ov2640_delta, cnt, NULL);
+    ESP_LOGI(TAG, "mode switch: %d writes, %d failed\r\n", cnt, fail);
+    if (fail) {
+        ov2640_cur_valid = 0;
+        return 3;
+    }
+    ov2640_cur = *mode;
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ov2640.h"
+#include "ov2640_async.h"
+#include "sccb.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "mem_budget.h"
+
+static const char *TAG = "OV2640_ASYNC";
+
+#define OV2640_ASYNC_QUEUE_SIZE (8)
+#define OV2640_ASYNC_TASK_STACK (2048)
+#define OV2640_ASYNC_CALL       (0xFE)  //请求类型: OV2640_Async_Call
+#define OV2640_ASYNC_FLUSH      (0xFF)  //请求类型: OV2640_Async_Flush
+
+typedef struct {
+    uint8_t type;                   //ov2640_async_setting_t, OV2640_ASYNC_CALL, OV2640_ASYNC_FLUSH
+    void (*func)(void *func_arg);
+    void *func_arg;
+    ov2640_async_cb_t cb;
+    void *arg;
+    uint32_t seq;                   //flush序号
+} ov2640_async_req_t;
+
+//每个设置最多只有一个请求在队列中, 值和回调在执行时才取出
+typedef struct {
+    uint8_t pending;
+    uint8_t value;
+    ov2640_async_cb_t cb;
+    void *arg;
+} ov2640_async_slot_t;
+
+typedef struct {
+    QueueHandle_t queue;
+    SemaphoreHandle_t lock;         //保护slot
+    SemaphoreHandle_t flush_lock;   //同一时间只有一个任务等待flush
+    SemaphoreHandle_t flush_done;
+    uint32_t flush_seq;
+    volatile uint32_t flush_done_seq;
+    ov2640_async_slot_t slot[OV2640_ASYNC_SETTING_MAX];
+} ov2640_async_t;
+
+static ov2640_async_t *ov2640_async = NULL;
+
+static void (*const ov2640_async_func[OV2640_ASYNC_SETTING_MAX])(uint8_t) = {
+    OV2640_Auto_Exposure,
+    OV2640_Light_Mode,
+    OV2640_Color_Saturation,
+    OV2640_Brightness,
+    OV2640_Contrast,
+    OV2640_Special_Effects,
+    OV2640_Color_Bar,
+};
+
+static void ov2640_async_task(void *arg)
+{
+    ov2640_async_req_t req;
+    ov2640_async_slot_t *slot = NULL;
+    sccb_stats_t before, after;
+    uint8_t value;
+
+    while (1) {
+        xQueueReceive(ov2640_async->queue, (void *)&req, portMAX_DELAY);
+        if (req.type == OV2640_ASYNC_FLUSH) {
+            ov2640_async->flush_done_seq = req.seq;
+            xSemaphoreGive(ov2640_async->flush_done);
+            continue;
+        }
+        SCCB_Get_Stats(&before);
+        if (req.type == OV2640_ASYNC_CALL) {
+            req.func(req.func_arg);
+        } else {
+            //取出最新的值, 此后提交的同一设置重新排队
+            xSemaphoreTake(ov2640_async->lock, portMAX_DELAY);
+            slot = &ov2640_async->slot[req.type];
+            value = slot->value;
+            req.cb = slot->cb;
+            req.arg = slot->arg;
+            slot->pending = 0;
+            xSemaphoreGive(ov2640_async->lock);
+            ov2640_async_func[req.type](value);
+        }
+        SCCB_Get_Stats(&after);
+        if (req.cb) {
+            req.cb(after.wr_err != before.wr_err ? OV2640_ASYNC_BUS_ERROR : OV2640_ASYNC_OK, req.arg);
+        }
+    }
+}
+
+uint8_t OV2640_Async_Init(const ov2640_async_config_t *config)
+{
+    if (ov2640_async) {
+        return 0;
+    }
+    ov2640_async = (ov2640_async_t *)MEM_CALLOC("ov2640", 1, sizeof(ov2640_async_t), MALLOC_CAP_DEFAULT);
+    if (!ov2640_async) {
+        ESP_LOGE(TAG, "malloc error\r\n");
+        return 1;
+    }
+    ov2640_async->queue = xQueueCreate(config->queue_size ? config->queue_size : OV2640_ASYNC_QUEUE_SIZE, sizeof(ov2640_async_req_t));
+    ov2640_async->lock = xSemaphoreCreateMutex();
+    ov2640_async->flush_lock = xSemaphoreCreateMutex();
+    ov2640_async->flush_done = xSemaphoreCreateBinary();
+    if (!ov2640_async->queue || !ov2640_async->lock || !ov2640_async->flush_lock || !ov2640_async->flush_done) {
+        ESP_LOGE(TAG, "queue create error\r\n");
+        return 1;
+    }
+    if (MEM_TASK_CREATE("ov2640", ov2640_async_task, "ov2640_async", config->task_stack ? config->task_stack : OV2640_ASYNC_TASK_STACK,
+                    NULL, config->task_pri, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "task create error\r\n");
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t OV2640_Async_Set(ov2640_async_setting_t setting, uint8_t value, ov2640_async_cb_t cb, void *arg)
+{
+    ov2640_async_req_t req = {.type = setting};
+    ov2640_async_slot_t *slot = NULL;
+    ov2640_async_cb_t replaced_cb = NULL;
+    void *replaced_arg = NULL;
+    uint8_t ret = 0;
+
+    if (setting >= OV2640_ASYNC_SETTING_MAX) {
+        return 1;
+    }
+    slot = &ov2640_async->slot[setting];
+    xSemaphoreTake(ov2640_async->lock, portMAX_DELAY);
+    if (slot->pending) {
+        replaced_cb = slot->cb;
+        replaced_arg = slot->arg;
+    } else if (xQueueSend(ov2640_async->queue, (void *)&req, 0) == pdTRUE) {
+        slot->pending = 1;
+    } else {
+        ret = 1;
+    }
+    if (ret == 0) {
+        slot->value = value;
+        slot->cb = cb;
+        slot->arg = arg;
+    }
+    xSemaphoreGive(ov2640_async->lock);
+    //被替代的请求在提交新值的任务中回调
+    if (replaced_cb) {
+        replaced_cb(OV2640_ASYNC_REPLACED, replaced_arg);
+    }
+    return ret;
+}
+
+uint8_t OV2640_Async_Call(void (*func)(void *func_arg), void *func_arg, ov2640_async_cb_t cb, void *arg, TickType_t ticks_to_wait)
+{
+    ov2640_async_req_t req = {
+        .type = OV2640_ASYNC_CALL,
+        .func = func,
+        .func_arg = func_arg,
+        .cb = cb,
+        .arg = arg,
+    };
+    return xQueueSend(ov2640_async->queue, (void *)&req, ticks_to_wait) == pdTRUE ? 0 : 1;
+}
+
+uint8_t OV2640_Async_Flush(TickType_t ticks_to_wait)
+{
+    ov2640_async_req_t req = {.type = OV2640_ASYNC_FLUSH};
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed = 0;
+    uint8_t ret = 1;
+
+    if (xSemaphoreTake(ov2640_async->flush_lock, ticks_to_wait) != pdTRUE) {
+        return 1;
+    }
+    req.seq = ++ov2640_async->flush_seq;
+    if (xQueueSend(ov2640_async->queue, (void *)&req, ticks_to_wait) == pdTRUE) {
+        //之前超时的flush完成时也会释放flush_done, 按序号判断
+        while (1) {
+            if ((int32_t)(ov2640_async->flush_done_seq - req.seq) >= 0) {
+                ret = 0;
+                break;
+            }
+            elapsed = xTaskGetTickCount() - start;
+            if (ticks_to_wait != portMAX_DELAY && elapsed >= ticks_to_wait) {
+                break;
+            }
+            xSemaphoreTake(ov2640_async->flush_done, ticks_to_wait == portMAX_DELAY ? portMAX_DELAY : ticks_to_wait - elapsed);
+        }
+    }
+    xSemaphoreGive(ov2640_async->flush_lock);
+    return ret;
+}
@@ -0,0 +1,120 @@
+#include <string.h>
+#include "ov2640_pack.h"
+
+#define OV2640_PACK_BANK_REG    (0xFF)
+#define OV2640_PACK_MIN_RUN     (3)     //连续地址或同一寄存器达到3个时单独成一条记录才更短
+
+void ov2640_pack_begin(ov2640_pack_iter_t *it, const uint8_t *pack)
+{
+    memset(it, 0, sizeof(ov2640_pack_iter_t));
+    it->p = pack;
+}
+
+uint16_t ov2640_pack_read(ov2640_pack_iter_t *it, uint8_t (*table)[2], uint16_t max)
+{
+    uint16_t n = 0;
+    uint8_t head;
+
+    while (n < max) {
+        if (it->left == 0) {
+            head = *it->p;
+            if (head == OV2640_PACK_END) {
+                break;
+            }
+            it->p++;
+            it->type = head & 0xC0;
+            if (it->type == OV2640_PACK_BANK) {
+                table[n][0] = OV2640_PACK_BANK_REG;
+                table[n][1] = head & OV2640_PACK_MAX_CNT;
+                n++;
+                continue;
+            }
+            it->left = head & OV2640_PACK_MAX_CNT;
+            if (it->type != OV2640_PACK_PAIRS) {
+                it->reg = *it->p++;
+            }
+        }
+        switch (it->type) {
+            case OV2640_PACK_RUN:
+                table[n][0] = it->reg++;
+                table[n][1] = *it->p++;
+                break;
+
+            case OV2640_PACK_SAME:
+                table[n][0] = it->reg;
+                table[n][1] = *it->p++;
+                break;
+
+            default:
+                table[n][0] = it->p[0];
+                table[n][1] = it->p[1];
+                it->p += 2;
+                break;
+        }
+        it->left--;
+        n++;
+    }
+    return n;
+}
+
+//从i开始连续地址/同一寄存器的个数
+static uint16_t ov2640_pack_run(const uint8_t (*table)[2], uint16_t i, uint16_t len, int step)
+{
+    uint16_t n = 1;
+    while (i + n < len && n < OV2640_PACK_MAX_CNT && table[i + n][0] == table[i][0] + n * step) {
+        n++;
+    }
+    return n;
+}
+
+uint32_t ov2640_pack_encode(const uint8_t (*table)[2], uint16_t len, uint8_t *out, uint32_t out_size)
+{
+    uint32_t size = 0;
+    uint32_t pairs = 0;    //当前PAIRS记录头的位置
+    uint8_t pairs_cnt = 0;
+    uint16_t run, same;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+//预留结束标记
+#define OV2640_PACK_NEED(n) do { if (size + (n) + 1 > out_size) { return 0; } } while (0)
+
+    for (uint16_t i = 0; i < len;) {
+        if (table[i][0] == OV2640_PACK_BANK_REG && table[i][1] <= OV2640_PACK_MAX_CNT) {
+            OV2640_PACK_NEED(1);
+            out[size++] = OV2640_PACK_BANK | table[i][1];
+            pairs_cnt = 0;
+            i++;
+            continue;
+        }
+        run = ov2640_pack_run(table, i, len, 1);
+        same = ov2640_pack_run(table, i, len, 0);
+        if (run >= OV2640_PACK_MIN_RUN || same >= OV2640_PACK_MIN_RUN) {
+            uint16_t n = run >= same ? run : same;
+            OV2640_PACK_NEED(2 + n);
+            out[size++] = (run >= same ? OV2640_PACK_RUN : OV2640_PACK_SAME) | n;
+            out[size++] = table[i][0];
+            for (uint16_t x = 0; x < n; x++) {
+                out[size++] = table[i + x][1];
+            }
+            pairs_cnt = 0;
+            i += n;
+            continue;
+        }
+        if (pairs_cnt == 0 || pairs_cnt == OV2640_PACK_MAX_CNT) {
+            OV2640_PACK_NEED(1);
+            pairs = size++;
+            pairs_cnt = 0;
+        }
+        OV2640_PACK_NEED(2);
+        out[size++] = table[i][0];
+        out[size++] = table[i][1];
+        out[pairs] = OV2640_PACK_PAIRS | ++pairs_cnt;
+        i++;
+    }
+#undef OV2640_PACK_NEED
+    out[size++] = OV2640_PACK_END;
+    return size;
+}
@@ -1,3 +1,5 @@
+#include <string.h>
+#include <stdbool.h>
 #include "sccb.h"
 #include "driver/i2c.h"
 
@@ -13,6 +15,22 @@ int i2c_master_port = 1;
 #define ACK_VAL                            0x0              /*!< I2C ack value */
 #define NACK_VAL                           0x1              /*!< I2C nack value */
 
+#define SCCB_BATCH_SIZE                    32               /*!< 每个命令链最多写入的寄存器个数 */
+#define SCCB_BATCH_TIMEOUT_MS              1000             /*!< 每个命令链的超时时间 */
+#define SCCB_BANK_SEL                      0xFF             /*!< 寄存器组选择 */
+#define SCCB_BANK_CNT                      2                /*!< 0: DSP, 1: sensor */
+#define SCCB_SENSOR_COM7                   0x12             /*!< sensor组COM7, bit7为软复位 */
+
+//影子寄存器: 记录每个寄存器组中已知的寄存器值, 跳过不改变状态的写, 读操作直接返回缓存值
+typedef struct {
+    int bank;                               // 当前寄存器组, -1: 未知
+    uint8_t value[SCCB_BANK_CNT][256];
+    uint8_t valid[SCCB_BANK_CNT][256 / 8];
+    sccb_stats_t stats;
+} sccb_shadow_t;
+
+static sccb_shadow_t sccb_shadow = {.bank = -1};
+
 //初始化SCCB接口 
 void SCCB_Init(void)
 {											      	 
@@ -25,11 +43,10 @@ void SCCB_Init(void)
   conf.master.clk_speed = 200000;
   i2c_param_config(i2c_master_port, &conf);
   i2c_driver_install(i2c_master_port, conf.mode, 0, 0, 0);
+  SCCB_Cache_Invalidate();
 }			 
 
-//写寄存器
-//返回值:0,成功;1,失败.
-uint8_t SCCB_WR_Reg(uint8_t reg, uint8_t data)
+static esp_err_t sccb_write_raw(uint8_t reg, uint8_t data)
 {
     esp_err_t ret = ESP_FAIL;
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
@@ -40,13 +57,11 @@ uint8_t SCCB_WR_Reg(uint8_t reg, uint8_t data)
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(i2c_master_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
-    return ret == ESP_OK ? 0 : 1;
+    return ret;
 }
-//读寄存器
-//返回值:读到的寄存器值
-uint8_t SCCB_RD_Reg(uint8_t reg)
+
+static esp_err_t sccb_read_raw(uint8_t reg, uint8_t *val)
 {
-    uint8_t val = 0;
     esp_err_t ret = ESP_FAIL;
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
@@ -55,22 +70,202 @@ uint8_t SCCB_RD_Reg(uint8_t reg)
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(i2c_master_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
-    if (ret != ESP_OK) return -1;
+    if (ret != ESP_OK) {
+        *val = 0xFF;
+        return ret;
+    }
     cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, SCCB_ID | READ_BIT, ACK_CHECK_EN);
-    i2c_master_read_byte(cmd, &val, NACK_VAL);
+    i2c_master_read_byte(cmd, val, NACK_VAL);
     i2c_master_stop(cmd);
     ret = i2c_master_cmd_begin(i2c_master_port, cmd, 1000 / portTICK_RATE_MS);
     i2c_cmd_link_delete(cmd);
+    return ret;
+}
 
+//不能缓存的寄存器: 由硬件更新的状态/自动曝光寄存器, 自增的间接访问寄存器, 复位寄存器
+static bool sccb_reg_volatile(int bank, uint8_t reg)
+{
+    if (bank == 0) {
+        // 0x7C/0x7D: BPADDR/BPDATA, 每写一次BPDATA地址自增; 0xE0: DSP复位; 0xF0~0xFE: 内部MCU
+        return reg == 0x7C || reg == 0x7D || reg == 0xE0 || reg >= 0xF0;
+    }
+    // GAIN, REG04(AEC[1:0]), AEC, COM7(软复位), YAVG, REG45(AEC[15:10])
+    return reg == 0x00 || reg == 0x04 || reg == 0x10 || reg == 0x12 || reg == 0x2F || reg == 0x45;
+}
+
+static bool sccb_cache_get(uint8_t reg, uint8_t *val)
+{
+    int bank = sccb_shadow.bank;
+    if (bank < 0 || sccb_reg_volatile(bank, reg) || !(sccb_shadow.valid[bank][reg / 8] & (1 << (reg % 8)))) {
+        return false;
+    }
+    *val = sccb_shadow.value[bank][reg];
+    return true;
+}
+
+//寄存器写入成功(ok)或失败之后更新影子寄存器
+static void sccb_cache_update(uint8_t reg, uint8_t data, bool ok)
+{
+    int bank = sccb_shadow.bank;
+    if (reg == SCCB_BANK_SEL) {
+        sccb_shadow.bank = ok ? (data & 0x01) : -1;
+        return;
+    }
+    if (bank < 0) {
+        return;
+    }
+    if (bank == 1 && reg == SCCB_SENSOR_COM7 && (data & 0x80)) {
+        //软复位, 所有寄存器恢复默认值
+        SCCB_Cache_Invalidate();
+        return;
+    }
+    if (ok && !sccb_reg_volatile(bank, reg)) {
+        sccb_shadow.value[bank][reg] = data;
+        sccb_shadow.valid[bank][reg / 8] |= 1 << (reg % 8);
+    } else {
+        sccb_shadow.valid[bank][reg / 8] &= ~(1 << (reg % 8));
+    }
+}
+
+//写操作是否可以跳过
+static bool sccb_cache_same(uint8_t reg, uint8_t data)
+{
+    uint8_t val = 0;
+    if (reg == SCCB_BANK_SEL) {
+        return sccb_shadow.bank >= 0 && sccb_shadow.bank == (data & 0x01);
+    }
+    return sccb_cache_get(reg, &val) && val == data;
+}
+
+//使所有影子寄存器失效, 下一次访问从传感器读取
+void SCCB_Cache_Invalidate(void)
+{
+    sccb_shadow.bank = -1;
+    memset(sccb_shadow.valid, 0, sizeof(sccb_shadow.valid));
+}
+
+//影子寄存器中bank组的reg寄存器是否已知且等于data
+bool SCCB_Cache_Match(uint8_t bank, uint8_t reg, uint8_t data)
+{
+    if (bank >= SCCB_BANK_CNT || sccb_reg_volatile(bank, reg) || !(sccb_shadow.valid[bank][reg / 8] & (1 << (reg % 8)))) {
+        return false;
+    }
+    return sccb_shadow.value[bank][reg] == data;
+}
+
+void SCCB_Get_Stats(sccb_stats_t *stats)
+{
+    *stats = sccb_shadow.stats;
+}
+
+//写寄存器, 值未改变时不访问总线
+//返回值:0,成功;1,失败.
+uint8_t SCCB_WR_Reg(uint8_t reg, uint8_t data)
+{
+    esp_err_t ret = ESP_FAIL;
+    if (sccb_cache_same(reg, data)) {
+        sccb_shadow.stats.wr_skip++;
+        return 0;
+    }
+    ret = sccb_write_raw(reg, data);
+    sccb_shadow.stats.wr++;
+    if (ret != ESP_OK) {
+        sccb_shadow.stats.wr_err++;
+    }
+    sccb_cache_update(reg, data, ret == ESP_OK);
+    return ret == ESP_OK ? 0 : 1;
+}
+//读寄存器, 优先返回影子寄存器中的值, 失败时不打印(用于轮询传感器是否响应)
+//返回值:0,成功;1,失败
+uint8_t SCCB_Try_RD_Reg(uint8_t reg, uint8_t *val)
+{
+    esp_err_t ret = ESP_FAIL;
+    if (sccb_cache_get(reg, val)) {
+        sccb_shadow.stats.rd_hit++;
+        return 0;
+    }
+    ret = sccb_read_raw(reg, val);
+    sccb_shadow.stats.rd++;
     if (ret != ESP_OK) {
+        return 1;
+    }
+    if (sccb_shadow.bank >= 0 && reg != SCCB_BANK_SEL && !sccb_reg_volatile(sccb_shadow.bank, reg)) {
+        sccb_shadow.value[sccb_shadow.bank][reg] = *val;
+        sccb_shadow.valid[sccb_shadow.bank][reg / 8] |= 1 << (reg % 8);
+    }
+    return 0;
+}
+//读寄存器, 优先返回影子寄存器中的值
+//返回值:读到的寄存器值
+uint8_t SCCB_RD_Reg(uint8_t reg)
+{
+    uint8_t val = 0;
+    if (SCCB_Try_RD_Reg(reg, &val)) {
         printf("SCCB_RD_Reg error\n");
     }
-
     return val;
 }
 
+//批量写寄存器(应用寄存器差异), 跳过与影子寄存器相同的项, 其余每SCCB_BATCH_SIZE个合并为一个I2C命令链
+//寄存器之间使用重复起始位而不是停止位, 驱动遇到停止位即认为命令链结束
+//某个命令链失败时, 逐个重写该段寄存器以确定具体失败的项
+//table:寄存器表, table[i][0]为寄存器地址, table[i][1]为数据
+//err:可为NULL, 返回每个寄存器的写结果, 0,成功;1,失败
+//返回值:写失败的寄存器个数
+uint16_t SCCB_WR_Regs(const uint8_t (*table)[2], uint16_t len, uint8_t *err)
+{
+    esp_err_t ret = ESP_FAIL;
+    uint16_t fail = 0;
+    for (uint16_t i = 0; i < len;) {
+        int bank = sccb_shadow.bank;
+        uint16_t start = i, cnt = 0;
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        for (; i < len && cnt < SCCB_BATCH_SIZE; i++) {
+            if (err) {
+                err[i] = 0;
+            }
+            if (sccb_cache_same(table[i][0], table[i][1])) {
+                sccb_shadow.stats.wr_skip++;
+                continue;
+            }
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, SCCB_ID | WRITE_BIT, ACK_CHECK_EN);
+            i2c_master_write_byte(cmd, table[i][0], ACK_CHECK_EN);
+            i2c_master_write_byte(cmd, table[i][1], ACK_CHECK_EN);
+            //假定写入成功, 以便后续项的跳过判断使用新的寄存器组和值
+            sccb_cache_update(table[i][0], table[i][1], true);
+            cnt++;
+        }
+        if (cnt == 0) {
+            i2c_cmd_link_delete(cmd);
+            continue;
+        }
+        i2c_master_stop(cmd);
+        ret = i2c_master_cmd_begin(i2c_master_port, cmd, SCCB_BATCH_TIMEOUT_MS / portTICK_RATE_MS);
+        i2c_cmd_link_delete(cmd);
+        sccb_shadow.stats.wr += cnt;
+        if (ret == ESP_OK) {
+            continue;
+        }
+        //失败前可能已经切换了寄存器组, 恢复该段开始时的寄存器组之后逐个重写
+        SCCB_Cache_Invalidate();
+        if (bank >= 0) {
+            SCCB_WR_Reg(SCCB_BANK_SEL, bank);
+        }
+        for (uint16_t x = start; x < i; x++) {
+            uint8_t res = SCCB_WR_Reg(table[x][0], table[x][1]);
+            fail += res;
+            if (err) {
+                err[x] = res;
+            }
+        }
+    }
+    return fail;
+}
+
+
 
 
 
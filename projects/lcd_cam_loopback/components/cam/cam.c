@@ -2,6 +2,7 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/i2s.h"
 #include "esp_system.h"
 #include "esp_log.h"
@@ -13,6 +14,8 @@
 #include "soc/dport_reg.h"
 #include "driver/ledc.h"
 #include "cam.h"
+#include "trace.h"
+#include "mem_budget.h"
 
 static const char *TAG = "cam";
 
@@ -20,7 +23,8 @@ static const char *TAG = "cam";
 
 typedef enum {
     CAM_IN_SUC_EOF_EVENT = 0,
-    CAM_VSYNC_EVENT
+    CAM_VSYNC_EVENT,
+    CAM_RECONFIG_EVENT
 } cam_event_t;
 
 typedef struct {
@@ -28,6 +32,18 @@ typedef struct {
     size_t len;
 } frame_buffer_event_t;
 
+// DMA乒乓buffer的划分
+typedef struct {
+    uint32_t buffer_size;
+    uint32_t half_buffer_size;
+    uint32_t node_cnt;
+    uint32_t half_node_cnt;
+    uint32_t dma_size;
+    uint32_t total_cnt;
+    lldesc_t *dma;
+    uint8_t *buffer;
+} cam_dma_plan_t;
+
 typedef struct {
     uint32_t buffer_size;
     uint32_t half_buffer_size;
@@ -42,15 +58,24 @@ typedef struct {
     uint8_t *buffer;
     uint8_t *frame1_buffer;
     uint8_t *frame2_buffer;
+    uint32_t frame_buffer_size;
+    uint32_t max_buffer_size;
     uint8_t frame1_buffer_en;
     uint8_t frame2_buffer_en;
     uint8_t jpeg_mode;
     uint8_t vsync_pin;
     QueueHandle_t event_queue;
     QueueHandle_t frame_buffer_queue;
+    SemaphoreHandle_t reconfig_lock;
+    SemaphoreHandle_t reconfig_stop;    // cam_task已停止采集
+    SemaphoreHandle_t reconfig_resume;  // 重新配置完成, cam_task继续
 } cam_obj_t;
 
 static cam_obj_t *cam_obj = NULL;
+static uint8_t cam_xclk_en = 0;
+static cam_vsync_cb_t cam_vsync_cb = NULL;
+static void *cam_vsync_cb_arg = NULL;
+static portMUX_TYPE cam_vsync_lock = portMUX_INITIALIZER_UNLOCKED;
 
 void IRAM_ATTR cam_isr(void *arg)
 {
@@ -59,6 +84,7 @@ void IRAM_ATTR cam_isr(void *arg)
     typeof(I2S0.int_st) int_st = I2S0.int_st;
     I2S0.int_clr.val = int_st.val;
     if (int_st.in_suc_eof) {
+        TRACE_INSTANT(TRACE_ID_CAM_DMA, 0);
         cam_event = CAM_IN_SUC_EOF_EVENT;
         xQueueSendFromISR(cam_obj->event_queue, (void *)&cam_event, &HPTaskAwoken);
     }
@@ -72,6 +98,15 @@ void IRAM_ATTR cam_vsync_isr(void *arg)
 {
     cam_event_t cam_event = {0};
     BaseType_t HPTaskAwoken = pdFALSE;
+    TRACE_INSTANT(TRACE_ID_CAM_VSYNC, 0);
+    portENTER_CRITICAL_ISR(&cam_vsync_lock);
+    cam_vsync_cb_t cb = cam_vsync_cb;
+    void *cb_arg = cam_vsync_cb_arg;
+    portEXIT_CRITICAL_ISR(&cam_vsync_lock);
+    // 帧间隔开始, 在cam_task之前通知
+    if (cb && cb(cb_arg)) {
+        HPTaskAwoken = pdTRUE;
+    }
     cam_event = CAM_VSYNC_EVENT;
     xQueueSendFromISR(cam_obj->event_queue, (void *)&cam_event, &HPTaskAwoken);
 
@@ -80,7 +115,43 @@ void IRAM_ATTR cam_vsync_isr(void *arg)
     }
 }
 
-static void cam_config(cam_config_t *config)
+void cam_set_vsync_cb(cam_vsync_cb_t cb, void *arg)
+{
+    portENTER_CRITICAL(&cam_vsync_lock);
+    cam_vsync_cb = cb;
+    cam_vsync_cb_arg = arg;
+    portEXIT_CRITICAL(&cam_vsync_lock);
+}
+
+int cam_xclk_init(const cam_config_t *config)
+{
+    if (cam_xclk_en) {
+        return 0;
+    }
+    ledc_timer_config_t ledc_timer = {
+        .duty_resolution = LEDC_TIMER_1_BIT,
+        .freq_hz = config->xclk_fre,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_num = LEDC_TIMER_1
+    };
+    ledc_channel_config_t ledc_channel = {
+        .channel    = LEDC_CHANNEL_2,
+        .duty       = 1,
+        .gpio_num   = config->pin.xclk,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_sel  = LEDC_TIMER_1,
+        .hpoint     = 0
+    };
+    if (ledc_timer_config(&ledc_timer) != ESP_OK || ledc_channel_config(&ledc_channel) != ESP_OK) {
+        ESP_LOGE(TAG, "cam xclk config error\n");
+        return -1;
+    }
+    cam_xclk_en = 1;
+    ESP_LOGI(TAG, "cam_xclk_pin setup\n");
+    return 0;
+}
+
+static void cam_config(const cam_config_t *config)
 {
     //Enable I2S periph
     periph_module_enable(PERIPH_I2S0_MODULE);
@@ -150,7 +221,7 @@ static void cam_config(cam_config_t *config)
     esp_intr_alloc(ETS_I2S0_INTR_SOURCE, 0, cam_isr, NULL, NULL);
 }
 
-static void cam_set_pin(cam_config_t *config)
+static void cam_set_pin(const cam_config_t *config)
 {
     gpio_config_t io_conf;
     io_conf.intr_type = GPIO_PIN_INTR_NEGEDGE;
@@ -186,25 +257,9 @@ static void cam_set_pin(cam_config_t *config)
         gpio_matrix_in(config->pin_data[i], I2S0I_DATA_IN0_IDX + (16 - config->bit_width) + i, false);
     }
 
-    ledc_timer_config_t ledc_timer = {
-        .duty_resolution = LEDC_TIMER_1_BIT,
-        .freq_hz = config->xclk_fre,
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .timer_num = LEDC_TIMER_1
-    };
-    ledc_timer_config(&ledc_timer);
-    ledc_channel_config_t ledc_channel = {
-        .channel    = LEDC_CHANNEL_2,
-        .duty       = 1,
-        .gpio_num   = config->pin.xclk,
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .timer_sel  = LEDC_TIMER_1,
-        .hpoint     = 0
-    };
-    ledc_channel_config(&ledc_channel);
+    cam_xclk_init(config);
 
     gpio_matrix_in(0x38, I2S0I_H_ENABLE_IDX, false);
-    ESP_LOGI(TAG, "cam_xclk_pin setup\n");
 }
 
 static void cam_stop(void)
@@ -256,6 +311,28 @@ static void cam_task(void *arg)
     }
     while (1) {
         xQueueReceive(cam_obj->event_queue, (void *)&cam_event, portMAX_DELAY);
+        if (cam_event == CAM_RECONFIG_EVENT) {
+            // 放弃正在接收的帧, 队列中未取走的帧也是旧格式, 全部归还
+            cam_stop();
+            gpio_intr_disable(cam_obj->vsync_pin);
+            if (state == CAM_STATE_READ_BUF1) {
+                cam_obj->frame1_buffer_en = 1;
+            } else if (state == CAM_STATE_READ_BUF2) {
+                cam_obj->frame2_buffer_en = 1;
+            }
+            state = CAM_STATE_IDLE;
+            while (xQueueReceive(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, 0) == pdTRUE) {
+                cam_give(frame_buffer_event.frame_buffer);
+            }
+            xSemaphoreGive(cam_obj->reconfig_stop);
+            xSemaphoreTake(cam_obj->reconfig_resume, portMAX_DELAY);
+            xQueueReset(cam_obj->event_queue);
+            gpio_intr_enable(cam_obj->vsync_pin);
+            if (cam_obj->jpeg_mode == 0) {
+                cam_start();
+            }
+            continue;
+        }
         if (cam_obj->jpeg_mode) {
             switch (state) {
                 case CAM_STATE_IDLE: {
@@ -278,11 +355,20 @@ static void cam_task(void *arg)
                         if (cam_obj->cnt == 0) {
                             gpio_intr_enable(cam_obj->vsync_pin); // 需要cam真正start接收到第一个buf数据再打开vsync中断
                         }
+                        if ((cam_obj->cnt + 1) * cam_obj->half_buffer_size > cam_obj->frame_buffer_size) {
+                            // JPEG数据超出帧buffer, 丢弃这一帧
+                            ESP_LOGE(TAG, "jpeg frame larger than %d\n", cam_obj->frame_buffer_size);
+                            cam_stop();
+                            cam_obj->frame1_buffer_en = 1;
+                            state = 0;
+                            break;
+                        }
                         memcpy(&cam_obj->frame1_buffer[cam_obj->cnt * cam_obj->half_buffer_size], &cam_obj->buffer[(cam_obj->cnt % 2) * cam_obj->half_buffer_size], cam_obj->half_buffer_size);
                         if (cam_obj->frame1_buffer_en == 0) {
                             cam_stop();
                             frame_buffer_event.frame_buffer = cam_obj->frame1_buffer;
                             frame_buffer_event.len = (cam_obj->cnt + 1) * cam_obj->half_buffer_size;
+                            TRACE_INSTANT(TRACE_ID_CAM_FRAME, frame_buffer_event.len);
                             xQueueSend(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, portMAX_DELAY);
                             state = 0;
                         } else {
@@ -299,11 +385,20 @@ static void cam_task(void *arg)
                         if (cam_obj->cnt == 0) {
                             gpio_intr_enable(cam_obj->vsync_pin); // 需要cam真正start接收到第一个buf数据再打开vsync中断
                         }
+                        if ((cam_obj->cnt + 1) * cam_obj->half_buffer_size > cam_obj->frame_buffer_size) {
+                            // JPEG数据超出帧buffer, 丢弃这一帧
+                            ESP_LOGE(TAG, "jpeg frame larger than %d\n", cam_obj->frame_buffer_size);
+                            cam_stop();
+                            cam_obj->frame2_buffer_en = 1;
+                            state = 0;
+                            break;
+                        }
                         memcpy(&cam_obj->frame2_buffer[cam_obj->cnt * cam_obj->half_buffer_size], &cam_obj->buffer[(cam_obj->cnt % 2) * cam_obj->half_buffer_size], cam_obj->half_buffer_size);
                         if (cam_obj->frame2_buffer_en == 0) {
                             cam_stop();
                             frame_buffer_event.frame_buffer = cam_obj->frame2_buffer;
                             frame_buffer_event.len = (cam_obj->cnt + 1) * cam_obj->half_buffer_size;
+                            TRACE_INSTANT(TRACE_ID_CAM_FRAME, frame_buffer_event.len);
                             xQueueSend(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, portMAX_DELAY);
                             state = 0;
                         } else {
@@ -335,6 +430,7 @@ static void cam_task(void *arg)
                         cam_obj->frame1_buffer_en = 0;
                         frame_buffer_event.frame_buffer = cam_obj->frame1_buffer;
                         frame_buffer_event.len = (cam_obj->cnt + 1) * cam_obj->half_buffer_size;
+                        TRACE_INSTANT(TRACE_ID_CAM_FRAME, frame_buffer_event.len);
                         xQueueSend(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, portMAX_DELAY);
                         state = 0;
                     } else {
@@ -349,6 +445,7 @@ static void cam_task(void *arg)
                         cam_obj->frame2_buffer_en = 0;
                         frame_buffer_event.frame_buffer = cam_obj->frame2_buffer;
                         frame_buffer_event.len = (cam_obj->cnt + 1) * cam_obj->half_buffer_size;
+                        TRACE_INSTANT(TRACE_ID_CAM_FRAME, frame_buffer_event.len);
                         xQueueSend(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, portMAX_DELAY);
                         state = 0;
                     } else {
@@ -364,69 +461,167 @@ static void cam_task(void *arg)
 size_t cam_take(uint8_t **buffer_p)
 {
     frame_buffer_event_t frame_buffer_event;
+    TRACE_BEGIN(TRACE_ID_CAM_TAKE, 0);
     xQueueReceive(cam_obj->frame_buffer_queue, (void *)&frame_buffer_event, portMAX_DELAY);
+    TRACE_END(TRACE_ID_CAM_TAKE, frame_buffer_event.len);
     *buffer_p = frame_buffer_event.frame_buffer;
     return frame_buffer_event.len;
 }
 
-void cam_give(uint8_t *buffer)
+int cam_give(uint8_t *buffer)
 {
+    TRACE_INSTANT(TRACE_ID_CAM_GIVE, 0);
+    if (buffer == NULL) {
+        return 0;
+    }
     if (buffer == cam_obj->frame1_buffer) {
         cam_obj->frame1_buffer_en = 1;
     } else if (buffer == cam_obj->frame2_buffer){
         cam_obj->frame2_buffer_en = 1;
+    } else {
+        // cam_reconfig换用新帧buffer之前取走的帧, 不能再交给DMA
+        ESP_LOGW(TAG, "cam_give: %p is not a current frame buffer (stale after cam_reconfig?)\n", buffer);
+        return -1;
     }
+    return 0;
 }
 
-void cam_dma_config(cam_config_t *config) 
+// 按config计算DMA buffer的划分并分配, 失败时不影响当前的配置
+static int cam_dma_plan(const cam_config_t *config, cam_dma_plan_t *plan)
 {
     int cnt = 0;
+    memset(plan, 0, sizeof(cam_dma_plan_t));
     if (config->mode.jpeg) {
-        cam_obj->buffer_size = 2048;
-        cam_obj->half_buffer_size = cam_obj->buffer_size / 2;
-        cam_obj->dma_size = 1024;
+        plan->buffer_size = 2048;
+        plan->half_buffer_size = plan->buffer_size / 2;
+        plan->dma_size = 1024;
     } else {
         for (cnt = 0;;cnt++) { // 寻找可以整除的buffer大小
             if ((config->size.width * config->size.high * 2) % (config->max_buffer_size - cnt) == 0) {
                 break;
             }
         }
-        cam_obj->buffer_size = config->max_buffer_size - cnt;
+        plan->buffer_size = config->max_buffer_size - cnt;
 
-        cam_obj->half_buffer_size = cam_obj->buffer_size / 2;
+        plan->half_buffer_size = plan->buffer_size / 2;
         for (cnt = 0;;cnt++) { // 寻找可以整除的dma大小
-            if ((cam_obj->half_buffer_size) % (CAM_DMA_MAX_SIZE - cnt) == 0) {
+            if ((plan->half_buffer_size) % (CAM_DMA_MAX_SIZE - cnt) == 0) {
                 break;
             }
         }
-        cam_obj->dma_size = CAM_DMA_MAX_SIZE - cnt;
+        plan->dma_size = CAM_DMA_MAX_SIZE - cnt;
     }
 
-    cam_obj->node_cnt = (cam_obj->buffer_size) / cam_obj->dma_size; // DMA节点个数
-    cam_obj->half_node_cnt = cam_obj->node_cnt / 2;
-    cam_obj->total_cnt = (config->size.width * config->size.high * 2) / cam_obj->half_buffer_size; // 产生中断拷贝的次数, 乒乓拷贝
+    plan->node_cnt = (plan->buffer_size) / plan->dma_size; // DMA节点个数
+    plan->half_node_cnt = plan->node_cnt / 2;
+    plan->total_cnt = (config->size.width * config->size.high * 2) / plan->half_buffer_size; // 产生中断拷贝的次数, 乒乓拷贝
 
-    ESP_LOGI(TAG, "cam_buffer_size: %d, cam_dma_size: %d, cam_dma_node_cnt: %d, cam_total_cnt: %d\n", cam_obj->buffer_size, cam_obj->dma_size, cam_obj->node_cnt, cam_obj->total_cnt);
+    ESP_LOGI(TAG, "cam_buffer_size: %d, cam_dma_size: %d, cam_dma_node_cnt: %d, cam_total_cnt: %d\n", plan->buffer_size, plan->dma_size, plan->node_cnt, plan->total_cnt);
 
-    cam_obj->dma    = (lldesc_t *)heap_caps_malloc(cam_obj->node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    cam_obj->buffer = (uint8_t *)heap_caps_malloc(cam_obj->buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA);
+    plan->dma    = (lldesc_t *)MEM_MALLOC("cam", plan->node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA);
+    plan->buffer = (uint8_t *)MEM_MALLOC("cam", plan->buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA);
+    if (!plan->dma || !plan->buffer) {
+        ESP_LOGE(TAG, "cam dma buffer malloc error\n");
+        MEM_FREE(plan->dma);
+        MEM_FREE(plan->buffer);
+        return -1;
+    }
 
-    for (int x = 0; x < cam_obj->node_cnt; x++) {
-        cam_obj->dma[x].size = cam_obj->dma_size;
-        cam_obj->dma[x].length = cam_obj->dma_size;
-        cam_obj->dma[x].eof = 0;
-        cam_obj->dma[x].owner = 1;
-        cam_obj->dma[x].buf = (cam_obj->buffer + cam_obj->dma_size * x);
-        cam_obj->dma[x].empty = &cam_obj->dma[(x + 1) % cam_obj->node_cnt];
+    for (int x = 0; x < plan->node_cnt; x++) {
+        plan->dma[x].size = plan->dma_size;
+        plan->dma[x].length = plan->dma_size;
+        plan->dma[x].eof = 0;
+        plan->dma[x].owner = 1;
+        plan->dma[x].buf = (plan->buffer + plan->dma_size * x);
+        plan->dma[x].empty = &plan->dma[(x + 1) % plan->node_cnt];
     }
+    return 0;
+}
+
+// 释放旧的DMA buffer并切换到plan, 调用时采集必须处于停止状态
+static void cam_dma_apply(const cam_dma_plan_t *plan)
+{
+    MEM_FREE(cam_obj->dma);
+    MEM_FREE(cam_obj->buffer);
+    cam_obj->buffer_size = plan->buffer_size;
+    cam_obj->half_buffer_size = plan->half_buffer_size;
+    cam_obj->node_cnt = plan->node_cnt;
+    cam_obj->half_node_cnt = plan->half_node_cnt;
+    cam_obj->dma_size = plan->dma_size;
+    cam_obj->total_cnt = plan->total_cnt;
+    cam_obj->dma = plan->dma;
+    cam_obj->buffer = plan->buffer;
 
     I2S0.in_link.addr = ((uint32_t)&cam_obj->dma[0]) & 0xfffff;
     I2S0.rx_eof_num = cam_obj->half_buffer_size; // 乒乓操作
 }
 
+int cam_dma_config(const cam_config_t *config)
+{
+    cam_dma_plan_t plan;
+    if (cam_dma_plan(config, &plan) != 0) {
+        return -1;
+    }
+    cam_dma_apply(&plan);
+    return 0;
+}
+
+int cam_reconfig(const cam_reconfig_t *config)
+{
+    cam_event_t cam_event = CAM_RECONFIG_EVENT;
+    cam_dma_plan_t plan;
+    uint8_t new_buffer = config->frame1_buffer != NULL || config->frame2_buffer != NULL;
+    uint32_t frame_buffer_size = new_buffer ? config->frame_buffer_size : cam_obj->frame_buffer_size;
+    cam_config_t dma_config = {
+        .size = {
+            .width = config->width,
+            .high = config->high,
+        },
+        .max_buffer_size = cam_obj->max_buffer_size,
+        .mode.jpeg = config->jpeg,
+    };
+    int ret = 0;
+
+    // RGB565帧必须能放进帧buffer, JPEG帧大小不定, 超出时丢弃该帧
+    if (!config->jpeg && config->width * config->high * 2 > frame_buffer_size) {
+        ESP_LOGE(TAG, "frame %dx%d larger than frame buffer %d\n", config->width, config->high, frame_buffer_size);
+        return -1;
+    }
+
+    xSemaphoreTake(cam_obj->reconfig_lock, portMAX_DELAY);
+    xQueueSend(cam_obj->event_queue, (void *)&cam_event, portMAX_DELAY);
+    xSemaphoreTake(cam_obj->reconfig_stop, portMAX_DELAY);
+
+    // 先分配新的DMA buffer再配置传感器, 任何一步失败都按原来的配置继续采集
+    if (cam_dma_plan(&dma_config, &plan) != 0) {
+        ret = -1;
+    } else if (config->sensor_cb && config->sensor_cb(config->sensor_arg) != 0) {
+        ESP_LOGE(TAG, "sensor reconfig error\n");
+        MEM_FREE(plan.dma);
+        MEM_FREE(plan.buffer);
+        ret = -1;
+    } else {
+        cam_dma_apply(&plan);
+        cam_obj->width = config->width;
+        cam_obj->high = config->high;
+        cam_obj->jpeg_mode = config->jpeg;
+        if (new_buffer) {
+            cam_obj->frame1_buffer = config->frame1_buffer;
+            cam_obj->frame2_buffer = config->frame2_buffer;
+            cam_obj->frame1_buffer_en = config->frame1_buffer != NULL;
+            cam_obj->frame2_buffer_en = config->frame2_buffer != NULL;
+            cam_obj->frame_buffer_size = config->frame_buffer_size;
+        }
+    }
+
+    xSemaphoreGive(cam_obj->reconfig_resume);
+    xSemaphoreGive(cam_obj->reconfig_lock);
+    return ret;
+}
+
 int cam_init(const cam_config_t *config)
 {
-    cam_obj = (cam_obj_t *)heap_caps_calloc(1, sizeof(cam_obj_t), MALLOC_CAP_DMA);
+    cam_obj = (cam_obj_t *)MEM_CALLOC("cam", 1, sizeof(cam_obj_t), MALLOC_CAP_DMA);
     if (!cam_obj) {
         ESP_LOGI(TAG, "camera object malloc error\n");
         return -1;
@@ -435,14 +630,21 @@ int cam_init(const cam_config_t *config)
     cam_obj->high = config->size.high;
     cam_obj->frame1_buffer = config->frame1_buffer;
     cam_obj->frame2_buffer = config->frame2_buffer;
+    cam_obj->frame_buffer_size = config->frame_buffer_size ? config->frame_buffer_size : config->size.width * config->size.high * 2;
+    cam_obj->max_buffer_size = config->max_buffer_size;
     cam_obj->jpeg_mode = config->mode.jpeg;
     cam_obj->vsync_pin = config->pin.vsync;
     cam_set_pin(config);
     cam_config(config);
-    cam_dma_config(config);
+    if (cam_dma_config(config) != 0) {
+        return -1;
+    }
 
     cam_obj->event_queue = xQueueCreate(2, sizeof(cam_event_t));
     cam_obj->frame_buffer_queue = xQueueCreate(2, sizeof(frame_buffer_event_t));
+    cam_obj->reconfig_lock = xSemaphoreCreateMutex();
+    cam_obj->reconfig_stop = xSemaphoreCreateBinary();
+    cam_obj->reconfig_resume = xSemaphoreCreateBinary();
 
     if (cam_obj->frame1_buffer != NULL) {
         ESP_LOGI(TAG, "frame1_buffer_en\n");
@@ -457,6 +659,6 @@ int cam_init(const cam_config_t *config)
     } else {
         cam_obj->frame2_buffer_en = 0;
     }
-    xTaskCreate(cam_task, "cam_task", config->task_stack, NULL, config->task_pri, NULL);
+    MEM_TASK_CREATE("cam", cam_task, "cam_task", config->task_stack, NULL, config->task_pri, NULL);
     return 0;
 }
\ No newline at end of file
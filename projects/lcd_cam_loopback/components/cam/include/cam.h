@@ -35,12 +35,46 @@ typedef struct {
     } mode;
     uint8_t *frame1_buffer;
     uint8_t *frame2_buffer;
+    uint32_t frame_buffer_size; // 每个帧buffer的大小, 0: width * high * 2
 } cam_config_t;
 
+// 在VSYNC中断中调用, 返回1表示唤醒了更高优先级的任务
+typedef int (*cam_vsync_cb_t)(void *arg);
+
+// 运行时切换分辨率和格式
+typedef struct {
+    uint16_t width;
+    uint16_t high;
+    uint8_t jpeg;
+    uint8_t *frame1_buffer;         // 都为NULL时继续使用当前的帧buffer
+    uint8_t *frame2_buffer;
+    uint32_t frame_buffer_size;     // 新帧buffer的大小
+    int (*sensor_cb)(void *arg);    // 采集停止期间调用, 重新配置传感器, 返回0表示成功
+    void *sensor_arg;
+} cam_reconfig_t;
+
+// 启动XCLK, 传感器需要XCLK才能响应SCCB
+// 可以在cam_init之前单独调用, 使传感器配置与摄像头DMA初始化并行进行; cam_init不会重复配置
+// 返回值:0,成功;-1,失败
+int cam_xclk_init(const cam_config_t *config);
+
 size_t cam_take(uint8_t **buffer_p);
-void cam_give(uint8_t *buffer);
+// 归还cam_take得到的帧buffer; buffer为NULL时忽略
+// 返回值:0,成功;-1,不是当前的帧buffer(例如cam_reconfig换用新帧buffer之前取走的帧), 已输出警告, buffer由调用者处理
+int cam_give(uint8_t *buffer);
 int cam_init(const cam_config_t *config);
 
+// 停止采集(丢弃正在接收的帧和队列中未取走的帧), 调用sensor_cb重新配置传感器,
+// 重新划分DMA buffer后继续采集, 不重建任务和队列
+// 返回之后cam_take得到的都是新格式的帧; 继续使用当前帧buffer时, 之前已经取走的帧仍然需要cam_give,
+// 换用新帧buffer时旧的帧buffer不再属于摄像头, 对其cam_give返回-1
+// 返回值:0,成功;-1,失败, 此时按原来的配置继续采集
+int cam_reconfig(const cam_reconfig_t *config);
+
+// 注册VSYNC回调, 在帧间隔开始时调用, 例如通知任务写入暂存的传感器寄存器; cb为NULL时取消
+// JPEG模式下开始接收一帧时会短暂关闭VSYNC中断, 可能错过该帧的回调
+void cam_set_vsync_cb(cam_vsync_cb_t cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "cam_rec.h"
+#include "mem_budget.h"
+
+static const char *TAG = "cam_rec";
+
+#define CAM_REC_TASK_STACK  (3072)
+#define CAM_REC_STOP        (0xFF) // 写文件任务收到后回写帧数并退出
+
+typedef struct {
+    uint8_t index;          // buffer序号, CAM_REC_STOP: 停止
+    cam_rec_frame_t frame;
+} cam_rec_item_t;
+
+struct cam_rec_s {
+    FILE *fp;
+    uint8_t **buf;
+    uint8_t buf_cnt;
+    uint32_t buf_size;
+    uint32_t max_frames;
+    QueueHandle_t free;     // 空闲buffer的序号
+    QueueHandle_t write;    // 等待写入的帧
+    SemaphoreHandle_t done;
+    cam_rec_header_t header;
+    uint32_t seq;
+    uint32_t queued;        // 已复制的帧数, 用于max_frames
+    cam_rec_stats_t stats;
+};
+
+static portMUX_TYPE cam_rec_lock = portMUX_INITIALIZER_UNLOCKED; // 保护统计
+
+uint32_t cam_rec_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t x = 0; x < len; x++) {
+        crc ^= data[x];
+        for (int y = 0; y < 8; y++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void cam_rec_free(cam_rec_handle_t rec)
+{
+    if (rec->buf) {
+        for (int x = 0; x < rec->buf_cnt; x++) {
+            MEM_FREE(rec->buf[x]);
+        }
+        MEM_FREE(rec->buf);
+    }
+    if (rec->free) {
+        vQueueDelete(rec->free);
+    }
+    if (rec->write) {
+        vQueueDelete(rec->write);
+    }
+    if (rec->done) {
+        vSemaphoreDelete(rec->done);
+    }
+    MEM_FREE(rec);
+}
+
+// CRC在这里计算, 不占用采集任务的时间
+static void cam_rec_task(void *arg)
+{
+    cam_rec_handle_t rec = (cam_rec_handle_t)arg;
+    cam_rec_item_t item;
+    static const uint8_t pad[4] = {0};
+
+    while (1) {
+        xQueueReceive(rec->write, (void *)&item, portMAX_DELAY);
+        if (item.index == CAM_REC_STOP) {
+            break;
+        }
+        uint8_t *data = rec->buf[item.index];
+        size_t pad_len = (4 - item.frame.len % 4) % 4;
+        int ok = !rec->stats.error;
+        item.frame.crc = cam_rec_crc32(0, data, item.frame.len);
+        ok = ok && fwrite(&item.frame, sizeof(cam_rec_frame_t), 1, rec->fp) == 1;
+        ok = ok && fwrite(data, 1, item.frame.len, rec->fp) == item.frame.len;
+        ok = ok && fwrite(pad, 1, pad_len, rec->fp) == pad_len;
+        if (!ok && !rec->stats.error) {
+            ESP_LOGE(TAG, "write error, recording stopped after %d frames\n", rec->stats.frames);
+        }
+        portENTER_CRITICAL(&cam_rec_lock);
+        if (ok) {
+            rec->stats.frames++;
+            rec->stats.bytes += sizeof(cam_rec_frame_t) + item.frame.len + pad_len;
+        } else {
+            rec->stats.error = 1;
+        }
+        portEXIT_CRITICAL(&cam_rec_lock);
+        xQueueSend(rec->free, (void *)&item.index, portMAX_DELAY);
+    }
+    // 回写帧数, 文件不能seek时保持CAM_REC_FRAME_CNT_NONE, 读到文件结束为止
+    if (!rec->stats.error && fflush(rec->fp) == 0) {
+        long end = ftell(rec->fp);
+        if (end >= 0 && fseek(rec->fp, 0, SEEK_SET) == 0) {
+            rec->header.frame_cnt = rec->stats.frames;
+            if (fwrite(&rec->header, sizeof(cam_rec_header_t), 1, rec->fp) != 1) {
+                rec->stats.error = 1;
+            }
+            fseek(rec->fp, end, SEEK_SET);
+        }
+        fflush(rec->fp);
+    }
+    xSemaphoreGive(rec->done);
+    MEM_TASK_DELETE();
+}
+
+int cam_rec_start(const cam_rec_config_t *config, cam_rec_handle_t *handle)
+{
+    cam_rec_handle_t rec = NULL;
+    uint8_t buf_cnt = config->buf_cnt ? config->buf_cnt : 2;
+
+    if (!config->fp || config->buf_size == 0 || buf_cnt >= CAM_REC_STOP) {
+        ESP_LOGE(TAG, "config invalid\n");
+        return -1;
+    }
+    rec = (cam_rec_handle_t)MEM_CALLOC("cam_rec", 1, sizeof(struct cam_rec_s), MALLOC_CAP_DEFAULT);
+    if (!rec) {
+        ESP_LOGE(TAG, "rec malloc error\n");
+        return -1;
+    }
+    rec->fp = config->fp;
+    rec->buf_cnt = buf_cnt;
+    rec->buf_size = config->buf_size;
+    rec->max_frames = config->max_frames;
+    rec->buf = (uint8_t **)MEM_CALLOC("cam_rec", buf_cnt, sizeof(uint8_t *), MALLOC_CAP_DEFAULT);
+    rec->free = xQueueCreate(buf_cnt, sizeof(uint8_t));
+    // 多一个位置给CAM_REC_STOP
+    rec->write = xQueueCreate(buf_cnt + 1, sizeof(cam_rec_item_t));
+    rec->done = xSemaphoreCreateBinary();
+    if (!rec->buf || !rec->free || !rec->write || !rec->done) {
+        ESP_LOGE(TAG, "rec malloc error\n");
+        cam_rec_free(rec);
+        return -1;
+    }
+    for (uint8_t x = 0; x < buf_cnt; x++) {
+        rec->buf[x] = (uint8_t *)MEM_MALLOC("cam_rec", config->buf_size, config->buf_caps ? config->buf_caps : MALLOC_CAP_SPIRAM);
+        if (!rec->buf[x]) {
+            ESP_LOGE(TAG, "frame buffer malloc error\n");
+            cam_rec_free(rec);
+            return -1;
+        }
+        xQueueSend(rec->free, (void *)&x, 0);
+    }
+
+    rec->header.magic = CAM_REC_MAGIC;
+    rec->header.version = CAM_REC_VERSION;
+    rec->header.header_size = sizeof(cam_rec_header_t);
+    rec->header.frame_header_size = sizeof(cam_rec_frame_t);
+    rec->header.frame_cnt = CAM_REC_FRAME_CNT_NONE;
+    rec->header.start_time = esp_timer_get_time();
+    if (fwrite(&rec->header, sizeof(cam_rec_header_t), 1, rec->fp) != 1) {
+        ESP_LOGE(TAG, "header write error\n");
+        cam_rec_free(rec);
+        return -1;
+    }
+    if (MEM_TASK_CREATE("cam_rec", cam_rec_task, "cam_rec", config->task_stack ? config->task_stack : CAM_REC_TASK_STACK, rec, config->task_pri, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "task create error\n");
+        cam_rec_free(rec);
+        return -1;
+    }
+    *handle = rec;
+    return 0;
+}
+
+int cam_rec_add(cam_rec_handle_t handle, const uint8_t *data, size_t len, uint16_t width, uint16_t high, uint8_t format)
+{
+    cam_rec_handle_t rec = handle;
+    cam_rec_item_t item = {0};
+    uint32_t seq = rec->seq++;
+
+    if (rec->stats.error || (rec->max_frames && rec->queued >= rec->max_frames)) {
+        return -1;
+    }
+    if (len > rec->buf_size || xQueueReceive(rec->free, (void *)&item.index, 0) != pdTRUE) {
+        portENTER_CRITICAL(&cam_rec_lock);
+        rec->stats.dropped++;
+        portEXIT_CRITICAL(&cam_rec_lock);
+        return -1;
+    }
+    memcpy(rec->buf[item.index], data, len);
+    item.frame.magic = CAM_REC_FRAME_MAGIC;
+    item.frame.seq = seq;
+    item.frame.time = esp_timer_get_time();
+    item.frame.len = len;
+    item.frame.width = width;
+    item.frame.high = high;
+    item.frame.format = format;
+    rec->queued++;
+    xQueueSend(rec->write, (void *)&item, portMAX_DELAY);
+    return 0;
+}
+
+int cam_rec_stop(cam_rec_handle_t handle, cam_rec_stats_t *stats)
+{
+    cam_rec_handle_t rec = handle;
+    cam_rec_item_t item = {.index = CAM_REC_STOP};
+    int ret;
+
+    xQueueSend(rec->write, (void *)&item, portMAX_DELAY);
+    xSemaphoreTake(rec->done, portMAX_DELAY);
+    ret = rec->stats.error ? -1 : 0;
+    if (stats) {
+        *stats = rec->stats;
+    }
+    cam_rec_free(rec);
+    return ret;
+}
+
+int cam_rec_read_header(FILE *fp, cam_rec_header_t *header)
+{
+    if (fread(header, sizeof(cam_rec_header_t), 1, fp) != 1 || header->magic != CAM_REC_MAGIC) {
+        return -1;
+    }
+    if (header->version != CAM_REC_VERSION || header->header_size < sizeof(cam_rec_header_t) || header->frame_header_size != sizeof(cam_rec_frame_t)) {
+        return -1;
+    }
+    // 以后的版本在结构体后面增加的字段跳过
+    return fseek(fp, header->header_size - sizeof(cam_rec_header_t), SEEK_CUR) == 0 ? 0 : -1;
+}
+
+int cam_rec_read_frame(FILE *fp, cam_rec_frame_t *frame, uint8_t *buf, size_t size)
+{
+    size_t n = fread(frame, 1, sizeof(cam_rec_frame_t), fp);
+    uint8_t pad[4];
+
+    if (n == 0 && feof(fp)) {
+        return 0;
+    }
+    if (n != sizeof(cam_rec_frame_t) || frame->magic != CAM_REC_FRAME_MAGIC || frame->len > size) {
+        return -1;
+    }
+    size_t pad_len = (4 - frame->len % 4) % 4;
+    if (fread(buf, 1, frame->len, fp) != frame->len || fread(pad, 1, pad_len, fp) != pad_len) {
+        return -1;
+    }
+    return cam_rec_crc32(0, buf, frame->len) == frame->crc ? 1 : -1;
+}
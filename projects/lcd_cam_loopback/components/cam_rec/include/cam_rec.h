@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 录制cam_take得到的帧: 文件头之后是连续的帧记录(帧头 + 数据, 数据补齐到4字节)
+// 小端, 结构体直接写入文件(没有填充, ESP32-S2和主机都是小端)
+// 在主机上由cam_replay(host/cam_replay.c)按相同的cam_take/cam_give接口回放
+
+#define CAM_REC_MAGIC           (0x43455243) // "CREC"
+#define CAM_REC_FRAME_MAGIC     (0x4D415246) // "FRAM"
+#define CAM_REC_VERSION         (1)
+#define CAM_REC_FRAME_CNT_NONE  (0xFFFFFFFF) // 录制没有正常结束(或文件不能seek), 读到文件结束为止
+
+#define CAM_REC_FORMAT_RGB565   (0)
+#define CAM_REC_FORMAT_JPEG     (1)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // sizeof(cam_rec_header_t)
+    uint16_t frame_header_size; // sizeof(cam_rec_frame_t)
+    uint16_t reserved0;
+    uint32_t frame_cnt;         // cam_rec_stop时回写
+    int64_t start_time;         // 开始录制时的esp_timer_get_time()
+    uint32_t reserved[2];
+} cam_rec_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // cam_rec_add的调用序号, 没有录下的帧留下空缺
+    int64_t time;               // cam_rec_add时的esp_timer_get_time()
+    uint32_t len;               // 数据长度, 不包括补齐
+    uint32_t crc;               // 数据的CRC32
+    uint16_t width;
+    uint16_t high;
+    uint8_t format;             // CAM_REC_FORMAT_*
+    uint8_t reserved[3];
+} cam_rec_frame_t;
+
+typedef struct {
+    FILE *fp;               // 已打开的文件(二进制写), cam_rec_stop之后由调用者关闭
+    uint8_t buf_cnt;        // 等待写入的帧buffer个数, 0: 默认2
+    uint32_t buf_size;      // 每个buffer的大小, 超过的帧不录制
+    uint32_t buf_caps;      // buffer的heap_caps, 0: MALLOC_CAP_SPIRAM
+    uint32_t max_frames;    // 录制的帧数, 0: 不限
+    uint32_t task_stack;    // 写文件任务, 0: 默认3072
+    uint8_t task_pri;       // 应低于采集和显示
+} cam_rec_config_t;
+
+typedef struct {
+    uint32_t frames;        // 写入的帧数
+    uint32_t dropped;       // buffer都在等待写入或帧太大, 没有录制的帧数
+    uint64_t bytes;         // 写入的字节数
+    int error;              // 写文件失败, 之后不再录制
+} cam_rec_stats_t;
+
+typedef struct cam_rec_s *cam_rec_handle_t;
+
+uint32_t cam_rec_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+// 写入文件头, 分配buffer, 创建写文件任务
+// 返回值:0,成功;-1,失败
+int cam_rec_start(const cam_rec_config_t *config, cam_rec_handle_t *handle);
+
+// 复制一帧到空闲buffer, 由写文件任务写入, 不等待; 在cam_take之后, cam_give之前调用
+// 返回值:0,已复制;-1,没有录制(没有空闲buffer, 帧太大, 写文件失败或已达到max_frames)
+int cam_rec_add(cam_rec_handle_t handle, const uint8_t *data, size_t len, uint16_t width, uint16_t high, uint8_t format);
+
+// 写完已复制的帧, 回写帧数, 释放buffer和任务; stats可以为NULL
+// 返回值:0,成功;-1,写文件失败
+int cam_rec_stop(cam_rec_handle_t handle, cam_rec_stats_t *stats);
+
+// 读取并检查文件头
+// 返回值:0,成功;-1,不是录制文件或版本不支持
+int cam_rec_read_header(FILE *fp, cam_rec_header_t *header);
+
+// 读取下一帧到buf(不超过size)并检查CRC
+// 返回值:1,成功;0,文件结束;-1,格式错误, CRC错误, 文件被截断或buf不够
+int cam_rec_read_frame(FILE *fp, cam_rec_frame_t *frame, uint8_t *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,174 @@
+#include <string.h>
+#include <stdint.h>
+#include "fps_plan.h"
+
+#define FPS_PLAN_APB_CLK        (80 * 1000 * 1000)  // LEDC和GPSPI3的时钟源
+#define FPS_PLAN_XCLK_STEP      (1000 * 1000)       // XCLK按1MHz步进选择
+#define FPS_PLAN_CLKRC_DIV_MAX  (0x3F)
+#define FPS_PLAN_LCD_DIV_MAX    (64)
+#define FPS_PLAN_LCD_CMD_BYTES  (14)                // CASET + RASET + RAMWR 命令及参数字节数, 同lcd_dirty_bench
+
+#define FPS_PLAN_MHZ            (1000 * 1000)
+#define FPS_PLAN_XCLK_MIN       (6 * FPS_PLAN_MHZ)
+#define FPS_PLAN_XCLK_MAX       (24 * FPS_PLAN_MHZ)
+#define FPS_PLAN_SENSOR_CLK_MAX (36 * FPS_PLAN_MHZ)
+#define FPS_PLAN_PCLK_MAX       (32 * FPS_PLAN_MHZ)
+#define FPS_PLAN_MEM_BW         (20 * FPS_PLAN_MHZ)
+#define FPS_PLAN_LCD_CLK_MAX    (80 * FPS_PLAN_MHZ)
+#define FPS_PLAN_JPEG_RATIO     (10)
+#define FPS_PLAN_SENSOR_MARGIN  (10)                // %
+
+// 一帧的传感器时钟数(行长 x 帧长, 包括消隐), 数据手册: SVGA 1190x672, 30fps@24MHz; UXGA 1922x1248, 15fps@36MHz
+static const uint32_t fps_plan_frame_clk[2] = {1190 * 672, 1922 * 1248};
+
+static const char *fps_plan_limit_str[] = {"none", "sensor", "pclk", "memory", "lcd", "cpu"};
+
+typedef struct {
+    uint32_t xclk;
+    uint8_t dbl;
+    uint8_t div;
+    uint32_t clk;
+} fps_plan_sensor_t;
+
+// a比b更合适: 时钟更接近目标(need不为0时更低, 否则更高), 其次XCLK为APB的整数分频(LEDC输出没有抖动), 其次XCLK更低
+static int fps_plan_sensor_better(const fps_plan_sensor_t *a, const fps_plan_sensor_t *b, uint32_t need)
+{
+    if (a->clk != b->clk) {
+        return need ? a->clk < b->clk : a->clk > b->clk;
+    }
+    int a_exact = (FPS_PLAN_APB_CLK / 2) % a->xclk == 0;
+    int b_exact = (FPS_PLAN_APB_CLK / 2) % b->xclk == 0;
+    if (a_exact != b_exact) {
+        return a_exact;
+    }
+    return a->xclk < b->xclk;
+}
+
+// need不为0: 选择不低于need且不超过max的最低传感器时钟; need为0: 选择不超过max的最高时钟
+// 返回值:0,成功;-1,没有可用的时钟
+static int fps_plan_sensor_clk(const fps_plan_config_t *config, uint32_t need, uint32_t max, fps_plan_sensor_t *best)
+{
+    fps_plan_sensor_t cur;
+    int found = 0;
+    uint32_t xclk = (config->xclk_min + FPS_PLAN_XCLK_STEP - 1) / FPS_PLAN_XCLK_STEP * FPS_PLAN_XCLK_STEP;
+
+    for (; xclk <= config->xclk_max; xclk += FPS_PLAN_XCLK_STEP) {
+        for (int dbl = 0; dbl < 2; dbl++) {
+            for (int div = 0; div <= FPS_PLAN_CLKRC_DIV_MAX; div++) {
+                cur.xclk = xclk;
+                cur.dbl = dbl;
+                cur.div = div;
+                cur.clk = xclk * (dbl + 1) / (div + 1);
+                if (cur.clk > max) {
+                    continue;
+                }
+                if (cur.clk < need) {
+                    break; // 分频越大时钟越低
+                }
+                if (!found || fps_plan_sensor_better(&cur, best, need)) {
+                    *best = cur;
+                    found = 1;
+                }
+            }
+        }
+    }
+    return found ? 0 : -1;
+}
+
+// lcd_init只支持80MHz和80MHz的整数(>=2)分频, 选择不超过max的最高时钟; 返回0表示没有可用的时钟
+static uint32_t fps_plan_lcd_clk(uint32_t max)
+{
+    for (int div = 1; div <= FPS_PLAN_LCD_DIV_MAX; div++) {
+        if (FPS_PLAN_APB_CLK / div <= max) {
+            return FPS_PLAN_APB_CLK / div;
+        }
+    }
+    return 0;
+}
+
+// 按每帧cost个单位, 每秒rate个单位计算帧率 x100
+static uint32_t fps_plan_fps(uint64_t rate, uint64_t cost)
+{
+    return rate * 100 / cost;
+}
+
+int fps_plan(const fps_plan_config_t *config, fps_plan_t *plan)
+{
+    fps_plan_config_t c = *config;
+    fps_plan_sensor_t sensor;
+    uint32_t stage_fps[FPS_PLAN_LIMIT_CPU + 1];
+    uint32_t sensor_top = 0, pixels = 0, mem_frame = 0, fps = 0;
+    fps_plan_limit_t limit = FPS_PLAN_LIMIT_NONE;
+
+    if (c.sensor_size > 1 || c.width == 0 || c.high == 0 || c.fps == 0) {
+        return -1;
+    }
+    c.jpeg_ratio = c.jpeg_ratio ? c.jpeg_ratio : FPS_PLAN_JPEG_RATIO;
+    c.sensor_margin_pct = c.sensor_margin_pct ? c.sensor_margin_pct : FPS_PLAN_SENSOR_MARGIN;
+    c.lcd_pixel_bits = c.lcd_pixel_bits ? c.lcd_pixel_bits : 16;
+    c.xclk_min = c.xclk_min ? c.xclk_min : FPS_PLAN_XCLK_MIN;
+    c.xclk_max = c.xclk_max ? c.xclk_max : FPS_PLAN_XCLK_MAX;
+    c.sensor_clk_max = c.sensor_clk_max ? c.sensor_clk_max : FPS_PLAN_SENSOR_CLK_MAX;
+    c.pclk_max = c.pclk_max ? c.pclk_max : FPS_PLAN_PCLK_MAX;
+    c.mem_bw = c.mem_bw ? c.mem_bw : FPS_PLAN_MEM_BW;
+    c.lcd_clk_max = c.lcd_clk_max ? c.lcd_clk_max : FPS_PLAN_LCD_CLK_MAX;
+
+    memset(plan, 0, sizeof(fps_plan_t));
+    pixels = c.width * c.high;
+    plan->cam_frame_bytes = c.jpeg ? pixels * 2 / c.jpeg_ratio : pixels * 2;
+    plan->lcd_frame_bytes = (pixels * c.lcd_pixel_bits + 7) / 8 + FPS_PLAN_LCD_CMD_BYTES;
+    // 摄像头写入帧buffer; LCD直接读取PSRAM时加上读出, JPEG模式还要加上解码结果的写入
+    mem_frame = plan->cam_frame_bytes;
+    if (c.lcd_psram) {
+        mem_frame += c.jpeg ? pixels * 2 * 2 : pixels * 2;
+    }
+
+    // 各环节能达到的最高帧率
+    for (int x = 0; x <= FPS_PLAN_LIMIT_CPU; x++) {
+        stage_fps[x] = UINT32_MAX;
+    }
+    sensor_top = c.pclk_max < c.sensor_clk_max ? c.pclk_max : c.sensor_clk_max;
+    if (fps_plan_sensor_clk(&c, 0, sensor_top, &sensor) != 0) {
+        return -1;
+    }
+    uint32_t lcd_clk = fps_plan_lcd_clk(c.lcd_clk_max);
+    if (lcd_clk == 0) {
+        return -1;
+    }
+    stage_fps[c.pclk_max < c.sensor_clk_max ? FPS_PLAN_LIMIT_PCLK : FPS_PLAN_LIMIT_SENSOR] = fps_plan_fps(sensor.clk, fps_plan_frame_clk[c.sensor_size]);
+    stage_fps[FPS_PLAN_LIMIT_MEMORY] = fps_plan_fps(c.mem_bw, mem_frame);
+    stage_fps[FPS_PLAN_LIMIT_LCD] = fps_plan_fps(lcd_clk, plan->lcd_frame_bytes * 8);
+    stage_fps[FPS_PLAN_LIMIT_CPU] = c.frame_cost_us ? fps_plan_fps(1000 * 1000, c.frame_cost_us) : UINT32_MAX;
+    fps = c.fps * 100;
+    for (int x = FPS_PLAN_LIMIT_SENSOR; x <= FPS_PLAN_LIMIT_CPU; x++) {
+        if (stage_fps[x] < fps) {
+            fps = stage_fps[x];
+            limit = (fps_plan_limit_t)x;
+        }
+    }
+
+    // 传感器选择满足该帧率加上余量的最低时钟, 没有时保持最高时钟(已经满足该帧率)
+    // LCD保持最高时钟: 降低时钟不节省带宽, 只会增加每帧的发送时间和延迟
+    fps_plan_sensor_clk(&c, (uint32_t)(((uint64_t)fps * (100 + c.sensor_margin_pct) * fps_plan_frame_clk[c.sensor_size] + 9999) / 10000), sensor_top, &sensor);
+
+    plan->xclk_fre = sensor.xclk;
+    plan->clkrc_double = sensor.dbl;
+    plan->clkrc_div = sensor.div;
+    plan->sensor_clk = sensor.clk;
+    plan->sensor_fps_x100 = fps_plan_fps(sensor.clk, fps_plan_frame_clk[c.sensor_size]);
+    plan->cam_bw = (uint64_t)plan->cam_frame_bytes * fps / 100;
+    plan->mem_bw = (uint64_t)mem_frame * fps / 100;
+    plan->lcd_clk_fre = lcd_clk;
+    plan->lcd_frame_us = (uint64_t)plan->lcd_frame_bytes * 8 * 1000 * 1000 / lcd_clk;
+    plan->fps_x100 = fps;
+    plan->limit = limit;
+    return limit == FPS_PLAN_LIMIT_NONE ? 0 : 1;
+}
+
+const char *fps_plan_limit_name(fps_plan_limit_t limit)
+{
+    if (limit > FPS_PLAN_LIMIT_CPU) {
+        return "unknown";
+    }
+    return fps_plan_limit_str[limit];
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 帧率规划: 根据分辨率, 像素格式和目标帧率计算XCLK, CLKRC和LCD SPI时钟, 并给出限制帧率的环节
+// 传感器 -> 摄像头DMA(PSRAM) -> LCD SPI 各环节并行工作, 帧率取决于最慢的一个
+// 只做整数运算, 不访问硬件, 可以在主机上验证(host/fps_planner)
+
+typedef enum {
+    FPS_PLAN_LIMIT_NONE = 0,    // 达到目标帧率
+    FPS_PLAN_LIMIT_SENSOR,      // 传感器内部时钟上限
+    FPS_PLAN_LIMIT_PCLK,        // 摄像头接口PCLK上限
+    FPS_PLAN_LIMIT_MEMORY,      // PSRAM带宽(摄像头写入 + LCD读出)
+    FPS_PLAN_LIMIT_LCD,         // LCD SPI时钟上限
+    FPS_PLAN_LIMIT_CPU,         // 每帧处理时间(例如JPEG解码)
+} fps_plan_limit_t;
+
+typedef struct {
+    uint8_t sensor_size;        // 0: SVGA, 1: UXGA, 同OV2640_Init的mode
+    uint16_t width;             // 输出分辨率, 也是LCD窗口大小
+    uint16_t high;
+    uint8_t jpeg;
+    uint8_t jpeg_ratio;         // JPEG压缩比估计, 0: 默认10
+    uint8_t lcd_pixel_bits;     // LCD接口每像素位数, RGB565: 16, RGB444: 12, RGB666: 24; 0: 默认16
+    uint8_t lcd_psram;          // 1: LCD直接从PSRAM读取帧数据(psram_dma), 计入PSRAM带宽
+    uint16_t fps;               // 目标帧率
+    uint32_t frame_cost_us;     // 每帧的CPU处理时间(例如JPEG解码), 0: 不计入
+    uint8_t sensor_margin_pct;  // 传感器帧率高于规划帧率的余量(%), 吸收帧长估计和XCLK的误差, 0: 默认10
+    // 以下限制为0时使用默认值
+    uint32_t xclk_min;          // 默认6MHz
+    uint32_t xclk_max;          // 默认24MHz
+    uint32_t sensor_clk_max;    // 默认36MHz
+    uint32_t pclk_max;          // 默认32MHz, 本工程实测可用的值
+    uint32_t mem_bw;            // PSRAM可用带宽, 字节/秒, 默认20MB/s
+    uint32_t lcd_clk_max;       // 默认80MHz
+} fps_plan_config_t;
+
+typedef struct {
+    uint32_t xclk_fre;          // cam_config_t.xclk_fre
+    uint8_t clkrc_double;       // OV2640_Clock_Set的fre_double_en
+    uint8_t clkrc_div;          // OV2640_Clock_Set的div
+    uint32_t sensor_clk;        // 传感器内部时钟 = XCLK * (倍频 ? 2 : 1) / (div + 1), 按DVP PCLK与之相同估算
+    uint32_t sensor_fps_x100;   // 传感器输出帧率 x100
+    uint32_t cam_frame_bytes;   // 每帧DMA接收的字节数, JPEG为估计值
+    uint32_t cam_bw;            // 摄像头写入PSRAM的带宽, 字节/秒
+    uint32_t mem_bw;            // PSRAM总带宽, 字节/秒
+    uint32_t lcd_clk_fre;       // lcd_config_t.clk_fre
+    uint32_t lcd_frame_bytes;   // 每帧SPI发送的字节数, 包括设置窗口的命令
+    uint32_t lcd_frame_us;      // 每帧SPI发送时间
+    uint32_t fps_x100;          // 可以达到的帧率 x100, 不超过目标帧率
+    fps_plan_limit_t limit;
+} fps_plan_t;
+
+// 计算config->fps(或可以达到的最高帧率)下各环节的配置
+// 传感器时钟取满足该帧率加上余量的最低值(达不到时取最高值); LCD SPI时钟取不超过lcd_clk_max的最高值, 发送时间越短延迟越小
+// 返回值:0,达到目标帧率;1,未达到, plan->limit为限制帧率的环节;-1,参数错误
+int fps_plan(const fps_plan_config_t *config, fps_plan_t *plan);
+
+const char *fps_plan_limit_name(fps_plan_limit_t limit);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,23 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "tjpgd.h"
 
 #define JPEG_WORK_BUF_SIZE 3100
 
-uint8_t *jpeg_decode(uint8_t *jpeg, int *w, int* h);
\ No newline at end of file
+//Allocate the tjpgd work buffer once (PSRAM, counted by mem_budget under "jpeg"); it is reused by every decode and never freed.
+//Decoding calls it on first use and it is safe to call from several tasks at once; decodes are serialized on the shared buffer.
+//Returns 0 on success, -1 if the allocation fails.
+int jpeg_init(void);
+
+//Decode len bytes of JPEG to big-endian RGB565 in a newly allocated PSRAM buffer (counted by mem_budget under "jpeg"), free it with jpeg_free.
+//Reads never go past len; truncated input fails instead of reading beyond the buffer.
+uint8_t *jpeg_decode(uint8_t *jpeg, size_t len, int *w, int* h);
+
+//Free an image returned by jpeg_decode. NULL is ignored.
+void jpeg_free(uint8_t *img);
+
+//Decode to big-endian RGB565 in a caller-provided buffer, no allocation for the output (used with pipeline buffer pools).
+//Returns 0 on success, -1 if decoding fails or the image is larger than out_size.
+int jpeg_decode_to(uint8_t *jpeg, size_t len, uint8_t *out, size_t out_size, int *w, int* h);
\ No newline at end of file
@@ -10,9 +10,14 @@
 #define JD_FORMAT		1	/* Output pixel format 0:RGB888 (3 BYTE/pix), 1:RGB565 (1 WORD/pix) */
 #define	JD_USE_SCALE	1	/* Use descaling feature for output */
 #define JD_TBLCLIP		1	/* Use table for saturation (might be a bit faster but increases 1K bytes of code size) */
+#ifndef JD_PROFILE
+#define JD_PROFILE		0	/* Accumulate time per decoding stage in JDEC.prof (needs jd_prof_time() from the application) */
+#endif
 
 /*---------------------------------------------------------------------------*/
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,10 +37,10 @@ typedef unsigned short	USHORT;
 typedef unsigned short	WORD;
 typedef unsigned short	WCHAR;
 
-/* These types must be 32-bit integer */
-typedef long			LONG;
-typedef unsigned long	ULONG;
-typedef unsigned long	DWORD;
+/* These types must be 32-bit integer (long is 64-bit on LP64 hosts) */
+typedef int32_t			LONG;
+typedef uint32_t		ULONG;
+typedef uint32_t		DWORD;
 
 
 /* Error code */
@@ -53,6 +58,17 @@ typedef enum {
 
 
 
+/* Decoding stages timed with JD_PROFILE */
+enum {
+	JD_PROF_HUFF = 0,	/* Huffman decoding and de-quantization */
+	JD_PROF_IDCT,		/* IDCT */
+	JD_PROF_COLOR,		/* YCbCr to RGB, descaling and RGB565 packing */
+	JD_PROF_OUTPUT,		/* Output function */
+	JD_PROF_NUM
+};
+
+
+
 /* Rectangular structure */
 typedef struct {
 	WORD left, right, top, bottom;
@@ -83,6 +99,9 @@ struct JDEC {
 	UINT sz_pool;			/* Size of momory pool (bytes available) */
 	UINT (*infunc)(JDEC*, BYTE*, UINT);/* Pointer to jpeg stream input function */
 	void* device;			/* Pointer to I/O device identifiler for the session */
+#if JD_PROFILE
+	DWORD* prof;			/* Time per stage [JD_PROF_NUM], accumulated when not NULL (set after jd_prepare) */
+#endif
 };
 
 
@@ -90,6 +109,9 @@ struct JDEC {
 /* TJpgDec API functions */
 JRESULT jd_prepare (JDEC*, UINT(*)(JDEC*,BYTE*,UINT), void*, UINT, void*);
 JRESULT jd_decomp (JDEC*, UINT(*)(JDEC*,void*,JRECT*), BYTE);
+#if JD_PROFILE
+DWORD jd_prof_time (void);	/* Free running timer of any unit, provided by the application */
+#endif
 
 
 #ifdef __cplusplus
@@ -2,8 +2,11 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "jpeg.h"
+#include "mem_budget.h"
 
 
 const char *TAG="jpeg";
@@ -11,16 +14,26 @@ const char *TAG="jpeg";
 typedef struct {	
     uint8_t *in;   //Pointer to jpeg data
     int in_pos;    //Current position in jpeg data
+    int in_size;   //Length of jpeg data, reads stop here
     uint8_t *out;
     int out_pos;
 } jpeg_decode_obj_t;
 
+//tjpgd work buffer, allocated once by jpeg_init instead of on every frame
+static char *jpeg_work_buf = NULL;
+static SemaphoreHandle_t jpeg_work_lock = NULL;
+static portMUX_TYPE jpeg_init_lock = portMUX_INITIALIZER_UNLOCKED;   //Protects the first jpeg_init
+
 //Input function for jpeg decoder. Just returns bytes from the inData field of the JpegDev structure.
 static UINT jpeg_decode_in_callback(JDEC *decoder, BYTE *buf, UINT len) 
 {
     //Read bytes from input file
     jpeg_decode_obj_t *jpeg_decode_obj = (jpeg_decode_obj_t *)decoder->device;
 
+    //Returns 0 at the end of the input, tjpgd then fails with JDR_INP
+    if (len > jpeg_decode_obj->in_size - jpeg_decode_obj->in_pos) {
+        len = jpeg_decode_obj->in_size - jpeg_decode_obj->in_pos;
+    }
     if (buf != NULL) {
         memcpy(buf, &jpeg_decode_obj->in[jpeg_decode_obj->in_pos], len);
     }
@@ -47,7 +60,46 @@ static UINT jpeg_decode_out_callback(JDEC *decoder, void *bitmap, JRECT *rect)
     return 1;
 }
 
-uint8_t *jpeg_decode(uint8_t *jpeg, int *w, int* h)
+int jpeg_init(void)
+{
+    SemaphoreHandle_t lock = NULL;
+    char *buf = NULL;
+
+    portENTER_CRITICAL(&jpeg_init_lock);
+    lock = jpeg_work_lock;
+    portEXIT_CRITICAL(&jpeg_init_lock);
+    if (lock) {
+        return 0;
+    }
+    //Allocate outside the critical section, publish under it; a task that loses the race frees its copy
+    lock = xSemaphoreCreateMutex();
+    buf = (char *)MEM_CALLOC("jpeg", JPEG_WORK_BUF_SIZE, sizeof(uint8_t), MALLOC_CAP_SPIRAM);
+    if (!lock || !buf) {
+        ESP_LOGE(TAG, "Image decoder: work buffer malloc failed");
+        if (lock) {
+            vSemaphoreDelete(lock);
+        }
+        MEM_FREE(buf);
+        return -1;
+    }
+    portENTER_CRITICAL(&jpeg_init_lock);
+    if (!jpeg_work_lock) {
+        jpeg_work_buf = buf;
+        jpeg_work_lock = lock;
+        buf = NULL;
+        lock = NULL;
+    }
+    portEXIT_CRITICAL(&jpeg_init_lock);
+    if (lock) {
+        vSemaphoreDelete(lock);
+        MEM_FREE(buf);
+    }
+    return 0;
+}
+
+//Decode into out, or into a newly allocated buffer when out is NULL. Fails if the image does not fit in out_size.
+//Called with jpeg_work_lock held.
+static uint8_t *jpeg_decode_locked(uint8_t *jpeg, size_t len, uint8_t *out, size_t out_size, int *w, int* h)
 {
     jpeg_decode_obj_t jpeg_decode_obj = {0};
     JDEC decoder = {0};
@@ -55,26 +107,63 @@ uint8_t *jpeg_decode(uint8_t *jpeg, int *w, int* h)
 
     jpeg_decode_obj.in = jpeg;
     jpeg_decode_obj.in_pos = 0;
+    jpeg_decode_obj.in_size = len;
     jpeg_decode_obj.out_pos = 0;
-    char *work_buf = (char *)heap_caps_calloc(JPEG_WORK_BUF_SIZE, sizeof(uint8_t), MALLOC_CAP_SPIRAM);
     //Prepare and decode the jpeg.
-    ret = jd_prepare(&decoder, jpeg_decode_in_callback, work_buf, JPEG_WORK_BUF_SIZE, (void*)&jpeg_decode_obj);
+    ret = jd_prepare(&decoder, jpeg_decode_in_callback, jpeg_work_buf, JPEG_WORK_BUF_SIZE, (void*)&jpeg_decode_obj);
     if (ret != JDR_OK) {
         ESP_LOGE(TAG, "Image decoder: jd_prepare failed (%d)", ret);
-        free(work_buf);
         return NULL;
     }
     *w = decoder.width;
     *h = decoder.height;
-    jpeg_decode_obj.out = (uint8_t *)heap_caps_calloc(decoder.width * decoder.height, sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (out) {
+        if (decoder.width * decoder.height * sizeof(uint16_t) > out_size) {
+            ESP_LOGE(TAG, "Image decoder: %dx%d larger than output buffer", decoder.width, decoder.height);
+            return NULL;
+        }
+        jpeg_decode_obj.out = out;
+    } else {
+        //Returned to the caller, who frees it with jpeg_free.
+        jpeg_decode_obj.out = (uint8_t *)MEM_MALLOC("jpeg", decoder.width * decoder.height * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+        if (!jpeg_decode_obj.out) {
+            ESP_LOGE(TAG, "Image decoder: %dx%d output malloc failed", decoder.width, decoder.height);
+            return NULL;
+        }
+    }
     ret = jd_decomp(&decoder, jpeg_decode_out_callback, 0);
     if (ret != JDR_OK) {
         ESP_LOGE(TAG, "Image decoder: jd_decode failed (%d)", ret);
-        free(jpeg_decode_obj.out);
-        free(work_buf);
+        if (!out) {
+            MEM_FREE(jpeg_decode_obj.out);
+        }
         return NULL;
     }
-
-    free(work_buf);
     return jpeg_decode_obj.out;
+}
+
+static uint8_t *jpeg_decode_run(uint8_t *jpeg, size_t len, uint8_t *out, size_t out_size, int *w, int* h)
+{
+    if (jpeg_init() != 0) {
+        return NULL;
+    }
+    xSemaphoreTake(jpeg_work_lock, portMAX_DELAY);
+    uint8_t *img = jpeg_decode_locked(jpeg, len, out, out_size, w, h);
+    xSemaphoreGive(jpeg_work_lock);
+    return img;
+}
+
+uint8_t *jpeg_decode(uint8_t *jpeg, size_t len, int *w, int* h)
+{
+    return jpeg_decode_run(jpeg, len, NULL, 0, w, h);
+}
+
+void jpeg_free(uint8_t *img)
+{
+    MEM_FREE(img);
+}
+
+int jpeg_decode_to(uint8_t *jpeg, size_t len, uint8_t *out, size_t out_size, int *w, int* h)
+{
+    return jpeg_decode_run(jpeg, len, out, out_size, w, h) ? 0 : -1;
 }
\ No newline at end of file
@@ -23,6 +23,17 @@
 #define SUPPORT_JPEG 1
 
 #ifdef SUPPORT_JPEG
+
+/* Stage timing (JD_PROFILE): read the timer only while JDEC.prof is set */
+#if JD_PROFILE
+#define PROF_TIME(jd)			((jd)->prof ? jd_prof_time() : 0)
+#define PROF_ADD(jd,n,t0,t1)	do { if ((jd)->prof) (jd)->prof[n] += (t1) - (t0); } while (0)
+#else
+#define PROF_TIME(jd)			0
+#define PROF_ADD(jd,n,t0,t1)	do { (void)(t0); (void)(t1); } while (0)
+#endif
+
+
 /*-----------------------------------------------*/
 /* Zigzag-order to raster-order conversion table */
 /*-----------------------------------------------*/
@@ -489,12 +500,14 @@ JRESULT mcu_load (
 	const BYTE *hb, *hd;
 	const WORD *hc;
 	const LONG *dqf;
+	DWORD t0, t1;
 
 
 	nby = jd->msx * jd->msy;	/* Number of Y blocks (1, 2 or 4) */
 	nbc = 2;					/* Number of C blocks (2) */
 	bp = jd->mcubuf;			/* Pointer to the first block */
 
+	t0 = PROF_TIME(jd);
 	for (blk = 0; blk < nby + nbc; blk++) {
 		cmp = (blk < nby) ? 0 : blk - nby + 1;	/* Component number 0:Y, 1:Cb, 2:Cr */
 		id = cmp ? 1 : 0;						/* Huffman table ID of the component */
@@ -542,10 +555,14 @@ JRESULT mcu_load (
 			}
 		} while (++i < 64);		/* Next AC element */
 
+		t1 = PROF_TIME(jd);
+		PROF_ADD(jd, JD_PROF_HUFF, t0, t1);
 		if (JD_USE_SCALE && jd->scale == 3)
 			*bp = (*tmp / 256) + 128;	/* If scale ratio is 1/8, IDCT can be ommited and only DC element is used */
 		else
 			block_idct(tmp, bp);		/* Apply IDCT and store the block to the MCU buffer */
+		t0 = PROF_TIME(jd);
+		PROF_ADD(jd, JD_PROF_IDCT, t1, t0);
 
 		bp += 64;				/* Next block */
 	}
@@ -573,8 +590,11 @@ JRESULT mcu_output (
 	INT yy, cb, cr;
 	BYTE *py, *pc, *rgb24;
 	JRECT rect;
+	DWORD t0, t1;
+	JRESULT rc;
 
 
+	t0 = PROF_TIME(jd);
 	mx = jd->msx * 8; my = jd->msy * 8;					/* MCU size (pixel) */
 	rx = (x + mx <= jd->width) ? mx : jd->width - x;	/* Output rectangular size (it may be clipped at right/bottom end) */
 	ry = (y + my <= jd->height) ? my : jd->height - y;
@@ -701,7 +721,12 @@ JRESULT mcu_output (
 	}
 
 	/* Output the RGB rectangular */
-	return outfunc(jd, jd->workbuf, &rect) ? JDR_OK : JDR_INTR; 
+	t1 = PROF_TIME(jd);
+	PROF_ADD(jd, JD_PROF_COLOR, t0, t1);
+	rc = outfunc(jd, jd->workbuf, &rect) ? JDR_OK : JDR_INTR;
+	t0 = PROF_TIME(jd);
+	PROF_ADD(jd, JD_PROF_OUTPUT, t1, t0);
+	return rc;
 }
 
 
@@ -779,6 +804,9 @@ JRESULT jd_prepare (
 	jd->sz_pool = sz_pool;	/* Size of given work memory */
 	jd->infunc = infunc;	/* Stream input function */
 	jd->device = dev;		/* I/O device identifier */
+#if JD_PROFILE
+	jd->prof = 0;			/* Stage timing off until the caller sets it */
+#endif
 	jd->nrst = 0;			/* No restart interval (default) */
 
 	for (i = 0; i < 2; i++) {	/* Nulls pointers */
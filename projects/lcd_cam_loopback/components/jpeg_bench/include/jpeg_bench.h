@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tjpgd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JPEG_BENCH_SCALE_NUM    (4) // jd_decomp的缩放比例: 1/1, 1/2, 1/4, 1/8
+
+// 语料中的一张图像(corpus/<name>.jpg), 表由jpeg_bench -g生成(jpeg_bench_corpus.h)
+typedef struct {
+    const char *name;
+    const uint8_t *start;   // 嵌入固件的文件, 主机上为NULL, 由调用者从corpus目录读入
+    const uint8_t *end;
+    uint32_t size;          // 文件长度
+    uint32_t crc;           // 文件的CRC32
+    uint32_t golden[JPEG_BENCH_SCALE_NUM]; // 各缩放比例解码输出(大端RGB565)的CRC32
+} jpeg_bench_image_t;
+
+typedef struct {
+    int width;              // 缩放后的输出尺寸
+    int high;
+    uint32_t mcus;          // 每帧解码的MCU数(与缩放无关)
+    uint32_t runs;
+    uint64_t prepare_us;    // runs次jd_prepare的总时间
+    uint64_t decomp_us;     // runs次jd_decomp的总时间
+    uint32_t stage[JD_PROF_NUM]; // 另外一次带阶段计时的解码, jd_prof_time的单位, JD_PROFILE为0时全0
+    uint32_t crc;           // 输出的CRC32
+} jpeg_bench_result_t;
+
+uint32_t jpeg_bench_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+// 用jd_prepare/jd_decomp解码runs次并计时, 再解码一次记录各阶段时间, 输出为大端RGB565(同jpeg_decode)
+// jpeg读取不超过len, scale 0~3: 输出缩小为1/(2^scale)
+// 返回值:0,成功;-1,解码失败或内存不够
+int jpeg_bench_run(const uint8_t *jpeg, size_t len, int scale, int runs, jpeg_bench_result_t *result);
+
+// 打印表头
+void jpeg_bench_print_header(void);
+
+// 对一张图像按各缩放比例运行jpeg_bench_run, 每个比例打印一行, golden为NULL时不检查输出
+// 返回值:解码失败或输出与golden不同的缩放比例数
+int jpeg_bench_image(const char *name, const uint8_t *jpeg, size_t len, const uint32_t *golden, int runs);
+
+// 运行嵌入固件的语料(仅ESP_PLATFORM), 文件的CRC32也必须与表中相同
+// 返回值:失败的数量
+int jpeg_bench_corpus(int runs);
+
+// 估计解码一帧width x high的JPEG的时间(微秒), 用于fps_plan的frame_cost_us
+// 在嵌入的语料中选择像素数最接近的图像(同一尺寸有多个质量时取文件最大的, 即质量最高, 解码最慢), 解码runs次, 按像素数换算
+// 返回值:微秒;0,没有嵌入的语料(主机上)或解码失败
+uint32_t jpeg_bench_frame_us(int width, int high, int runs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+//由host/jpeg_bench -g根据corpus/*.jpg生成, 不要手动修改
+//golden: 各缩放比例解码输出(大端RGB565)的CRC32
+
+#include <stddef.h>
+#include "jpeg_bench.h"
+
+#ifdef ESP_PLATFORM
+extern const uint8_t qqvga_q50_jpg_start[] asm("_binary_qqvga_q50_jpg_start");
+extern const uint8_t qqvga_q50_jpg_end[] asm("_binary_qqvga_q50_jpg_end");
+extern const uint8_t qvga_q20_jpg_start[] asm("_binary_qvga_q20_jpg_start");
+extern const uint8_t qvga_q20_jpg_end[] asm("_binary_qvga_q20_jpg_end");
+extern const uint8_t qvga_q50_jpg_start[] asm("_binary_qvga_q50_jpg_start");
+extern const uint8_t qvga_q50_jpg_end[] asm("_binary_qvga_q50_jpg_end");
+extern const uint8_t qvga_q80_jpg_start[] asm("_binary_qvga_q80_jpg_start");
+extern const uint8_t qvga_q80_jpg_end[] asm("_binary_qvga_q80_jpg_end");
+extern const uint8_t svga_q50_jpg_start[] asm("_binary_svga_q50_jpg_start");
+extern const uint8_t svga_q50_jpg_end[] asm("_binary_svga_q50_jpg_end");
+extern const uint8_t vga_q50_jpg_start[] asm("_binary_vga_q50_jpg_start");
+extern const uint8_t vga_q50_jpg_end[] asm("_binary_vga_q50_jpg_end");
+#define JPEG_BENCH_FILE(name) name##_jpg_start, name##_jpg_end
+#else
+#define JPEG_BENCH_FILE(name) NULL, NULL
+#endif
+
+static const jpeg_bench_image_t jpeg_bench_corpus_table[] = {
+    {"qqvga_q50", JPEG_BENCH_FILE(qqvga_q50), 3497, 0x3f616986, {0x2e0b8e23, 0x44c84475, 0xdb8c7aef, 0x10fe2381}},
+    {"qvga_q20", JPEG_BENCH_FILE(qvga_q20), 6228, 0x02f8e065, {0x9d9df179, 0xecec2acd, 0xebc47458, 0x6aebc4e2}},
+    {"qvga_q50", JPEG_BENCH_FILE(qvga_q50), 9591, 0x0bfcabeb, {0xbbe0bfd9, 0x0404662b, 0x1967f79c, 0x461f4e39}},
+    {"qvga_q80", JPEG_BENCH_FILE(qvga_q80), 15226, 0x41451e76, {0xa65eb6c2, 0x59d3381a, 0xc127455e, 0xf3a6cc12}},
+    {"svga_q50", JPEG_BENCH_FILE(svga_q50), 47099, 0x6f50d7d1, {0xc76626bc, 0x67eee165, 0x33998edf, 0x632e7eed}},
+    {"vga_q50", JPEG_BENCH_FILE(vga_q50), 31355, 0x9f1b23a9, {0x221f314d, 0x37d91bb8, 0x6e7ece83, 0x3bc1e53b}},
+};
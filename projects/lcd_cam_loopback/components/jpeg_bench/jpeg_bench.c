@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "xtensa/hal.h"
+#include "jpeg.h"
+#include "jpeg_bench.h"
+#include "jpeg_bench_corpus.h"
+#include "mem_budget.h"
+
+// JPEG解码基准: 直接调用jd_prepare/jd_decomp, 输入输出与jpeg.c相同(PSRAM中的JPEG, 大端RGB565写入帧buffer),
+// 报告吞吐率和各阶段的时间比例, 输出的CRC32与golden比较, 优化解码器时像素不能改变
+
+typedef struct {
+    const uint8_t *in;
+    size_t len;
+    size_t pos;
+    uint8_t *out;
+    int width;      // 缩放后的输出宽度
+} bench_io_t;
+
+#if JD_PROFILE
+// tjpgd的阶段计时: CPU周期数(主机上为纳秒), 只用于比例
+DWORD jd_prof_time(void)
+{
+    return xthal_get_ccount();
+}
+#endif
+
+uint32_t jpeg_bench_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t x = 0; x < len; x++) {
+        crc ^= data[x];
+        for (int y = 0; y < 8; y++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// 与jpeg.c不同, 不会读出len
+static UINT bench_in_callback(JDEC *decoder, BYTE *buf, UINT len)
+{
+    bench_io_t *io = (bench_io_t *)decoder->device;
+
+    if (len > io->len - io->pos) {
+        len = io->len - io->pos;
+    }
+    if (buf != NULL) {
+        memcpy(buf, &io->in[io->pos], len);
+    }
+    io->pos += len;
+    return len;
+}
+
+// 同jpeg.c: 按大端RGB565写入帧buffer
+static UINT bench_out_callback(JDEC *decoder, void *bitmap, JRECT *rect)
+{
+    bench_io_t *io = (bench_io_t *)decoder->device;
+    uint8_t *in = (uint8_t *)bitmap;
+
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        for (int x = rect->left; x <= rect->right; x++) {
+            io->out[2 * (y * io->width + x)] = in[1];
+            io->out[2 * (y * io->width + x) + 1] = in[0];
+            in += 2;
+        }
+    }
+    return 1;
+}
+
+static int bench_decode(JDEC *decoder, bench_io_t *io, char *work_buf, int scale, uint32_t *prof, int64_t *prepare_us, int64_t *decomp_us)
+{
+    int64_t t0, t1, t2;
+
+    io->pos = 0;
+    t0 = esp_timer_get_time();
+    if (jd_prepare(decoder, bench_in_callback, work_buf, JPEG_WORK_BUF_SIZE, (void *)io) != JDR_OK) {
+        return -1;
+    }
+#if JD_PROFILE
+    decoder->prof = prof;
+#endif
+    t1 = esp_timer_get_time();
+    if (jd_decomp(decoder, bench_out_callback, scale) != JDR_OK) {
+        return -1;
+    }
+    t2 = esp_timer_get_time();
+    *prepare_us += t1 - t0;
+    *decomp_us += t2 - t1;
+    return 0;
+}
+
+int jpeg_bench_run(const uint8_t *jpeg, size_t len, int scale, int runs, jpeg_bench_result_t *result)
+{
+    bench_io_t io = {.in = jpeg, .len = len};
+    JDEC decoder = {0};
+    int64_t prepare_us = 0, decomp_us = 0, unused = 0;
+    int ret = -1;
+
+    memset(result, 0, sizeof(jpeg_bench_result_t));
+    if (scale < 0 || scale >= JPEG_BENCH_SCALE_NUM || runs < 1) {
+        return -1;
+    }
+    // 工作区和帧buffer在PSRAM中, 同jpeg.c
+    char *work_buf = (char *)MEM_MALLOC("jpeg_bench", JPEG_WORK_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (!work_buf) {
+        return -1;
+    }
+    io.pos = 0;
+    if (jd_prepare(&decoder, bench_in_callback, work_buf, JPEG_WORK_BUF_SIZE, (void *)&io) == JDR_OK) {
+        // 每个MCU的输出宽度右移scale, 被截断的MCU也一样, 所以输出尺寸为原尺寸右移scale
+        uint32_t mx = decoder.msx * 8, my = decoder.msy * 8;
+        result->width = decoder.width >> scale;
+        result->high = decoder.height >> scale;
+        result->mcus = ((decoder.width + mx - 1) / mx) * ((decoder.height + my - 1) / my);
+        io.width = result->width;
+        io.out = (uint8_t *)MEM_CALLOC("jpeg_bench", result->width * result->high + 1, sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    }
+    if (io.out) {
+        ret = 0;
+        for (int x = 0; x < runs && ret == 0; x++) {
+            ret = bench_decode(&decoder, &io, work_buf, scale, NULL, &prepare_us, &decomp_us);
+        }
+        // 读计时器本身有开销, 阶段时间另外解码一次得到, 只用于各阶段的比例
+        if (ret == 0) {
+            ret = bench_decode(&decoder, &io, work_buf, scale, result->stage, &unused, &unused);
+        }
+    }
+    if (ret == 0) {
+        result->runs = runs;
+        result->prepare_us = prepare_us;
+        result->decomp_us = decomp_us;
+        result->crc = jpeg_bench_crc32(0, io.out, result->width * result->high * sizeof(uint16_t));
+    }
+    MEM_FREE(io.out);
+    MEM_FREE(work_buf);
+    return ret;
+}
+
+void jpeg_bench_print_header(void)
+{
+    printf("%-14s %-5s %-9s %7s %6s %9s %7s %8s %6s %6s %6s %6s  %-8s\n",
+           "image", "scale", "output", "bytes", "MCUs", "ms/frame", "MB/s", "kMCU/s", "huff%", "idct%", "color%", "out%", "crc32");
+}
+
+int jpeg_bench_image(const char *name, const uint8_t *jpeg, size_t len, const uint32_t *golden, int runs)
+{
+    jpeg_bench_result_t r;
+    char output[16], status[32];
+    int failed = 0;
+
+    for (int scale = 0; scale < JPEG_BENCH_SCALE_NUM; scale++) {
+        if (jpeg_bench_run(jpeg, len, scale, runs, &r) != 0) {
+            printf("%-14s 1/%-3d decode failed\n", name, 1 << scale);
+            failed++;
+            continue;
+        }
+        double us = (double)(r.prepare_us + r.decomp_us) / r.runs;
+        uint32_t prof_sum = r.stage[JD_PROF_HUFF] + r.stage[JD_PROF_IDCT] + r.stage[JD_PROF_COLOR] + r.stage[JD_PROF_OUTPUT];
+        double pct[JD_PROF_NUM] = {0};
+        for (int x = 0; x < JD_PROF_NUM && prof_sum; x++) {
+            pct[x] = 100.0 * r.stage[x] / prof_sum;
+        }
+        status[0] = '\0';
+        if (golden && golden[scale] != r.crc) {
+            sprintf(status, "FAIL (golden %08x)", golden[scale]);
+            failed++;
+        } else if (golden) {
+            sprintf(status, "OK");
+        }
+        sprintf(output, "%dx%d", r.width, r.high);
+        printf("%-14s 1/%-3d %-9s %7u %6u %9.2f %7.2f %8.1f %6.1f %6.1f %6.1f %6.1f  %08x %s\n",
+               name, 1 << scale, output, (uint32_t)len, r.mcus, us / 1000, us > 0 ? len / us : 0, us > 0 ? r.mcus / us * 1000 : 0,
+               pct[JD_PROF_HUFF], pct[JD_PROF_IDCT], pct[JD_PROF_COLOR], pct[JD_PROF_OUTPUT], r.crc, status);
+    }
+    return failed;
+}
+
+int jpeg_bench_corpus(int runs)
+{
+    int cnt = sizeof(jpeg_bench_corpus_table) / sizeof(jpeg_bench_corpus_table[0]);
+    int failed = 0;
+
+    jpeg_bench_print_header();
+    for (int x = 0; x < cnt; x++) {
+        const jpeg_bench_image_t *img = &jpeg_bench_corpus_table[x];
+        size_t len = img->start ? img->end - img->start : 0;
+        if (len != img->size || jpeg_bench_crc32(0, img->start, len) != img->crc) {
+            printf("%-14s not embedded or changed, rerun jpeg_bench -g\n", img->name);
+            failed++;
+            continue;
+        }
+        // 摄像头的帧在PSRAM中, 复制过去再解码, 不从flash读
+        uint8_t *jpeg = (uint8_t *)MEM_MALLOC("jpeg_bench", len, MALLOC_CAP_SPIRAM);
+        if (!jpeg) {
+            printf("%-14s no memory\n", img->name);
+            failed++;
+            continue;
+        }
+        memcpy(jpeg, img->start, len);
+        failed += jpeg_bench_image(img->name, jpeg, len, img->golden, runs);
+        MEM_FREE(jpeg);
+    }
+    printf("jpeg_bench: %d images, %s\n", cnt, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+// 只解析文件头, 得到图像尺寸
+static int bench_size(const uint8_t *jpeg, size_t len, char *work_buf, uint32_t *pixels)
+{
+    bench_io_t io = {.in = jpeg, .len = len};
+    JDEC decoder = {0};
+
+    if (jd_prepare(&decoder, bench_in_callback, work_buf, JPEG_WORK_BUF_SIZE, (void *)&io) != JDR_OK) {
+        return -1;
+    }
+    *pixels = decoder.width * decoder.height;
+    return 0;
+}
+
+uint32_t jpeg_bench_frame_us(int width, int high, int runs)
+{
+    int cnt = sizeof(jpeg_bench_corpus_table) / sizeof(jpeg_bench_corpus_table[0]);
+    uint32_t target = width * high, pixels = 0, best_pixels = 0, best_diff = 0;
+    const jpeg_bench_image_t *best = NULL;
+    jpeg_bench_result_t r;
+
+    char *work_buf = (char *)MEM_MALLOC("jpeg_bench", JPEG_WORK_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (!work_buf) {
+        return 0;
+    }
+    for (int x = 0; x < cnt; x++) {
+        const jpeg_bench_image_t *img = &jpeg_bench_corpus_table[x];
+        if (!img->start || bench_size(img->start, img->end - img->start, work_buf, &pixels) != 0) {
+            continue;
+        }
+        uint32_t diff = pixels > target ? pixels - target : target - pixels;
+        if (!best || diff < best_diff || (diff == best_diff && img->size > best->size)) {
+            best = img;
+            best_pixels = pixels;
+            best_diff = diff;
+        }
+    }
+    MEM_FREE(work_buf);
+    if (!best) {
+        return 0;
+    }
+
+    // 同jpeg_bench_corpus, 复制到PSRAM再解码
+    size_t len = best->end - best->start;
+    uint8_t *jpeg = (uint8_t *)MEM_MALLOC("jpeg_bench", len, MALLOC_CAP_SPIRAM);
+    if (!jpeg) {
+        return 0;
+    }
+    memcpy(jpeg, best->start, len);
+    int ret = jpeg_bench_run(jpeg, len, 0, runs, &r);
+    MEM_FREE(jpeg);
+    if (ret != 0) {
+        return 0;
+    }
+    return (uint32_t)((r.prepare_us + r.decomp_us) / r.runs * target / best_pixels);
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
+#include "lcd_pack.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,9 +19,32 @@ typedef struct {
     uint8_t pin_rst;
     uint8_t pin_bk;
     uint8_t horizontal;
-    uint32_t max_buffer_size; // DMA used
+    uint32_t max_buffer_size; // DMA used, 中转buffer总大小
+    uint8_t dma_seg_cnt; // 中转buffer分段数, 发送方最多领先DMA dma_seg_cnt - 1段, 0: 默认2(乒乓)
+    uint8_t psram_dma; // 1: PSRAM中的数据也由DMA直接发送(零拷贝), 需要16字节对齐
+    lcd_pixel_format_t pixel_format; // LCD接口像素格式, 输入数据始终为RGB565, 非RGB565时发送前打包转换
+    uint32_t trans_queue_size; // 异步传输队列深度, 0: 默认4
+    uint32_t task_stack; // 0: 默认2048
+    uint8_t task_pri;
 } lcd_config_t;
 
+typedef void (*lcd_trans_cb_t)(void *arg);
+
+typedef struct {
+    uint8_t set_index; // 1: 发送数据前先设置窗口
+    uint16_t x_start;
+    uint16_t y_start;
+    uint16_t x_end;
+    uint16_t y_end;
+    uint8_t *data; // RGB565, NULL: 只设置窗口; 传输完成前必须保持有效
+    size_t len;
+    size_t stride; // 源数据每行的字节数, 0: 数据连续; 否则按窗口宽度逐行发送(例如发送帧中的一块区域)
+    lcd_trans_cb_t cb; // 传输完成后在lcd任务中调用, 不能在其中等待其他传输
+    void *arg;
+} lcd_trans_t;
+
+typedef struct lcd_trans_obj_s *lcd_trans_handle_t;
+
 void lcd_rst();
 
 void lcd_write_data(uint8_t *data, size_t len);
@@ -27,6 +53,21 @@ void lcd_set_index(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t
 
 int lcd_init(lcd_config_t *config);
 
+// 异步提交一个传输, 按提交顺序发送
+// handle为NULL时完成后自动回收; 否则必须调用lcd_trans_wait回收
+// 返回值:0,成功;-1,队列满且等待超时
+int lcd_trans_submit(const lcd_trans_t *trans, lcd_trans_handle_t *handle, TickType_t ticks_to_wait);
+
+// 等待传输完成并回收handle
+// 返回值:0,成功;-1,超时, handle仍然有效
+int lcd_trans_wait(lcd_trans_handle_t handle, TickType_t ticks_to_wait);
+
+// 查询传输是否完成, 不阻塞
+bool lcd_trans_done(lcd_trans_handle_t handle);
+
+// 等待之前提交的所有传输完成
+int lcd_fence(TickType_t ticks_to_wait);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
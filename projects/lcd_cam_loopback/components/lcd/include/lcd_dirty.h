@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 脏块检测: 将RGB565帧按tile分块计算hash, 与上一帧比较, 只输出发生变化的区域
+// 相邻的脏块会合并成尽可能大的矩形窗口, 以减少lcd_set_index的次数
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} lcd_rect_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t high;
+    uint16_t tile;          // tile边长(像素), 必须为偶数, 0: 默认16
+    uint16_t max_rect;      // 每帧最多输出的矩形个数, 超出时输出包围盒, 0: 默认16
+    uint8_t merge_gap;      // 同一行中间隔不超过merge_gap个干净tile的脏块合并为一个窗口
+    uint8_t full_percent;   // 脏块面积超过该百分比时直接全屏刷新, 0: 默认75
+    uint8_t noise_bits;     // 计算hash时忽略每个颜色分量的低noise_bits位(0~2), 抑制传感器噪声
+    uint32_t full_refresh;  // 每隔full_refresh帧强制全屏刷新一次, 防止hash碰撞导致的残留, 0: 不强制
+} lcd_dirty_config_t;
+
+typedef struct {
+    lcd_dirty_config_t config;
+    uint16_t tile_cols;
+    uint16_t tile_rows;
+    uint32_t mask;          // 按帧内存字节序的像素屏蔽字
+    uint32_t *hash;         // 每个tile上一次发送时的hash
+    uint8_t *dirty;         // 本帧每个tile是否变化
+    uint16_t *run;          // 合并时使用的临时空间
+    uint8_t valid;          // hash表是否有效, 无效时下一帧全屏刷新
+    uint32_t frame_cnt;
+    uint32_t dirty_cnt;     // 最近一帧变化的tile个数
+} lcd_dirty_t;
+
+// 返回值:0,成功;-1,参数错误或内存不足
+int lcd_dirty_init(lcd_dirty_t *dirty, const lcd_dirty_config_t *config);
+
+void lcd_dirty_deinit(lcd_dirty_t *dirty);
+
+// 使hash表失效, 下一帧全屏刷新(例如LCD被其他内容覆盖之后)
+void lcd_dirty_invalidate(lcd_dirty_t *dirty);
+
+// 比较frame与上一帧, 将需要发送的窗口写入rect(至少max_rect个), 返回窗口个数
+// frame为big-endian RGB565, 每行width个像素, 需要4字节对齐
+int lcd_dirty_scan(lcd_dirty_t *dirty, const uint8_t *frame, lcd_rect_t *rect);
+
+#ifdef __cplusplus
+}
+#endif
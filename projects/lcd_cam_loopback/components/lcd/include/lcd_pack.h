@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// LCD接口像素格式, 对应ST7789 COLMOD(3Ah)的控制接口格式
+typedef enum {
+    LCD_PIXEL_FORMAT_RGB565 = 0, // 16bit/pixel, COLMOD 0x05
+    LCD_PIXEL_FORMAT_RGB444,     // 12bit/pixel, 两个像素打包为3字节, COLMOD 0x03
+    LCD_PIXEL_FORMAT_RGB666,     // 18bit/pixel, 每个分量占一个字节的高6位, COLMOD 0x06
+} lcd_pixel_format_t;
+
+// 打包pixels个像素需要的字节数, RGB444奇数个像素时最后半个字节补0
+size_t lcd_pack_size(lcd_pixel_format_t format, size_t pixels);
+
+// 将big-endian RGB565像素转换为LCD接口格式, 返回写入dst的字节数
+// RGB444: {R0G0, B0R1, G1B1}; RGB666: {R0<<2, G0<<2, B0<<2}
+size_t lcd_pack(lcd_pixel_format_t format, const uint8_t *src, uint8_t *dst, size_t pixels);
+
+size_t lcd_pack_rgb444(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+size_t lcd_pack_rgb666(const uint8_t *src, uint8_t *dst, size_t pixels);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,4 +1,3 @@
-
 #include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -6,32 +5,70 @@
 #include "freertos/semphr.h"
 #include "esp_heap_caps.h"
 #include "esp32s2/rom/lldesc.h"
+#include "esp32s2/rom/cache.h"
+#include "soc/soc_memory_layout.h"
 #include "soc/system_reg.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "lcd.h"
+#include "trace.h"
+#include "mem_budget.h"
 
 static const char *TAG = "lcd";
 
 #define LCD_DMA_MAX_SIZE     (4095)
+#define LCD_CPU_BUF_SIZE     (64) // W0~W15
+#define LCD_ZC_NODE_SIZE     (4080) // 零拷贝DMA节点大小, 为PSRAM DMA块大小(16字节)的整数倍
+#define LCD_ZC_NODE_CNT      (16)   // 每段零拷贝传输最多的DMA节点个数
+#define LCD_DMA_SEG_CNT      (2)    // dma_seg_cnt为0时的默认值, 即乒乓
+#define LCD_EXT_MEM_ALIGN    (16)
+#define LCD_TRANS_QUEUE_SIZE (4)    // trans_queue_size为0时的默认值
+#define LCD_TASK_STACK       (2048) // task_stack为0时的默认值
+#define LCD_RST_PULSE_US     (10)   // ST7789 RESX最短低电平
+#define LCD_RST_WAIT_MS      (5)    // 复位释放到第一个命令, 复位前处于休眠
+#define LCD_RST_WAIT_AWAKE_MS (120) // 复位前已退出休眠
+#define LCD_RST_SLPOUT_MS    (120)  // 复位释放到SLPOUT, 期间可以发送其他命令
+#define LCD_SLPOUT_WAIT_MS   (5)    // SLPOUT之后到下一个命令
+
+typedef struct lcd_trans_obj_s {
+    lcd_trans_t trans;
+    SemaphoreHandle_t done_sem;
+    volatile uint8_t done;
+    uint8_t wait;   // 1: 由lcd_trans_wait回收, 0: 完成后自动回收
+} lcd_trans_obj_t;
 
 typedef struct {
-    uint32_t buffer_size;
-    uint32_t half_buffer_size;
-    uint32_t node_cnt;
-    uint32_t half_node_cnt;
     uint32_t dma_size;
+    uint32_t seg_cnt;       // 环形缓冲的段数
+    uint32_t seg_size;      // 每段中转buffer的大小
+    uint32_t seg_node_cnt;  // 每段DMA节点个数
+    uint32_t seg_fill;      // 下一个填充的段, 只由发送方访问
+    volatile uint32_t seg_send;  // 正在发送或下一个发送的段
+    volatile uint32_t seg_ready; // 已填充但未开始发送的段数
+    volatile uint8_t busy;       // DMA正在发送
+    uint32_t *seg_len;
     uint8_t horizontal;
     uint8_t dc_state;
     uint8_t pin_dc;
     uint8_t pin_cs;
     uint8_t pin_rst;
     uint8_t pin_bk;
+    uint8_t psram_dma;
+    int64_t rst_time;       // 复位释放的时间
+    lcd_pixel_format_t pixel_format;
     lldesc_t *dma;
     uint8_t *buffer;
-    QueueHandle_t event_queue;
+    SemaphoreHandle_t seg_free; // 空闲段计数
+    QueueHandle_t trans_queue;  // 待发送的传输
+    QueueHandle_t free_queue;   // 空闲的传输对象
+    lcd_trans_obj_t *trans_pool;
+    uint32_t trans_pool_size;
+    TaskHandle_t task;
 } lcd_obj_t;
 
 static lcd_obj_t *lcd_obj = NULL;
+static portMUX_TYPE lcd_spinlock = portMUX_INITIALIZER_UNLOCKED;
 
 void inline lcd_set_rst(uint8_t state)
 {
@@ -53,16 +90,38 @@ void inline lcd_set_blk(uint8_t state)
     gpio_set_level(lcd_obj->pin_bk, state);
 }
 
+// 启动一次DMA传输, 结束时产生out_eof中断
+static void IRAM_ATTR lcd_dma_start(lldesc_t *dma, size_t len)
+{
+    GPSPI3.mosi_dlen.usr_mosi_bit_len = len * 8 - 1;
+    GPSPI3.dma_out_link.addr = ((uint32_t)dma) & 0xfffff;
+    GPSPI3.dma_out_link.start = 1;
+    ets_delay_us(1);
+    GPSPI3.cmd.usr = 1;
+}
+
+// 一段发送结束: 在中断中直接启动下一个已填充的段, 总线不必等待发送任务被调度
 static void IRAM_ATTR lcd_isr(void *arg)
 {
-    int event;
+    uint32_t seg = 0;
     BaseType_t HPTaskAwoken = pdFALSE;
     typeof(GPSPI3.dma_int_st) int_st = GPSPI3.dma_int_st;
     GPSPI3.dma_int_clr.val = int_st.val;
     // ets_printf("intr: 0x%x\n", int_st);
 
     if (int_st.out_eof) {
-        xQueueSendFromISR(lcd_obj->event_queue, &int_st.val, &HPTaskAwoken);
+        TRACE_INSTANT(TRACE_ID_LCD_EOF, lcd_obj->seg_send);
+        portENTER_CRITICAL_ISR(&lcd_spinlock);
+        seg = (lcd_obj->seg_send + 1) % lcd_obj->seg_cnt;
+        lcd_obj->seg_send = seg;
+        if (lcd_obj->seg_ready) {
+            lcd_obj->seg_ready--;
+            lcd_dma_start(&lcd_obj->dma[seg * lcd_obj->seg_node_cnt], lcd_obj->seg_len[seg]);
+        } else {
+            lcd_obj->busy = 0;
+        }
+        portEXIT_CRITICAL_ISR(&lcd_spinlock);
+        xSemaphoreGiveFromISR(lcd_obj->seg_free, &HPTaskAwoken);
     }
 
     if (HPTaskAwoken == pdTRUE) {
@@ -70,202 +129,355 @@ static void IRAM_ATTR lcd_isr(void *arg)
     }
 }
 
-static void spi_write_data(uint8_t *data, size_t len)
+// 取得下一个空闲段, 返回其DMA节点
+static lldesc_t *lcd_seg_acquire(void)
+{
+    xSemaphoreTake(lcd_obj->seg_free, portMAX_DELAY);
+    return &lcd_obj->dma[lcd_obj->seg_fill * lcd_obj->seg_node_cnt];
+}
+
+// 提交已填充的段: 总线空闲则立即发送, 否则排在正在发送的段之后由中断启动
+static void lcd_seg_submit(int node_cnt, size_t len)
+{
+    uint32_t seg = lcd_obj->seg_fill;
+    lldesc_t *dma = &lcd_obj->dma[seg * lcd_obj->seg_node_cnt];
+    dma[node_cnt - 1].eof = 1;
+    dma[node_cnt - 1].empty = NULL;
+    lcd_obj->seg_len[seg] = len;
+    lcd_obj->seg_fill = (seg + 1) % lcd_obj->seg_cnt;
+    portENTER_CRITICAL(&lcd_spinlock);
+    if (lcd_obj->busy) {
+        lcd_obj->seg_ready++;
+    } else {
+        lcd_obj->busy = 1;
+        lcd_dma_start(dma, len);
+    }
+    portEXIT_CRITICAL(&lcd_spinlock);
+}
+
+// 等待所有段发送完成
+static void lcd_seg_flush(void)
+{
+    for (int x = 0; x < lcd_obj->seg_cnt; x++) {
+        xSemaphoreTake(lcd_obj->seg_free, portMAX_DELAY);
+    }
+    for (int x = 0; x < lcd_obj->seg_cnt; x++) {
+        xSemaphoreGive(lcd_obj->seg_free);
+    }
+}
+
+static void lcd_dma_node_set(lldesc_t *dma, const uint8_t *buf, size_t size)
+{
+    dma->size = size;
+    dma->length = size;
+    dma->buf = (uint8_t *)buf;
+    dma->eof = 0;
+    dma->empty = dma + 1;
+}
+
+// 经过中转buffer发送, 数据为rows行, 每行row_len字节, 行首间隔stride字节
+// 复制到中转buffer的同时转换为LCD接口像素格式
+// 发送方可以领先DMA最多seg_cnt - 1段
+static void spi_write_data(const uint8_t *data, size_t row_len, size_t stride, size_t rows)
 {
-    int event  = 0;
-    int x = 0, cnt = 0, size = 0;
-    int end_pos = 0;
+    int x = 0;
+    size_t size = 0, fill = 0, row = 0, offset = 0;
+    // RGB444以两个像素(3字节)为单位打包
+    size_t group = lcd_obj->pixel_format == LCD_PIXEL_FORMAT_RGB444 ? 2 : 1;
+    size_t group_size = lcd_pack_size(lcd_obj->pixel_format, group);
+    uint8_t *buf = NULL;
+    lldesc_t *dma = NULL;
     lcd_set_dc(lcd_obj->dc_state);
-    // 生成一段数据DMA链表
-    for (x = 0; x < lcd_obj->node_cnt; x++) {
-        lcd_obj->dma[x].size = lcd_obj->dma_size;
-        lcd_obj->dma[x].length = lcd_obj->dma_size;
-        lcd_obj->dma[x].buf = (lcd_obj->buffer + lcd_obj->dma_size * x);
-        lcd_obj->dma[x].eof = !((x + 1) % lcd_obj->half_node_cnt);
-        lcd_obj->dma[x].empty = &lcd_obj->dma[(x + 1) % lcd_obj->node_cnt];
-    }
-    lcd_obj->dma[lcd_obj->half_node_cnt - 1].empty = NULL;
-    lcd_obj->dma[lcd_obj->node_cnt - 1].empty = NULL;
-    cnt = len / lcd_obj->half_buffer_size;
-    // 启动信号
-    xQueueSend(lcd_obj->event_queue, &event, 0);
-    // 处理完整一段数据， 乒乓操作
-    for (x = 0; x < cnt; x++) {
-        memcpy(lcd_obj->dma[(x % 2) * lcd_obj->half_node_cnt].buf, data, lcd_obj->half_buffer_size);
-        data += lcd_obj->half_buffer_size;
-        xQueueReceive(lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
-        GPSPI3.mosi_dlen.usr_mosi_bit_len = lcd_obj->half_buffer_size * 8 - 1;
-        GPSPI3.dma_out_link.addr = ((uint32_t)&lcd_obj->dma[(x % 2) * lcd_obj->half_node_cnt]) & 0xfffff;
-        GPSPI3.dma_out_link.start = 1;
-        ets_delay_us(1);
-        GPSPI3.cmd.usr = 1;
+    while (row < rows) {
+        dma = lcd_seg_acquire();
+        buf = lcd_obj->buffer + lcd_obj->seg_fill * lcd_obj->seg_size;
+        fill = 0;
+        while (row < rows) {
+            if (lcd_obj->pixel_format == LCD_PIXEL_FORMAT_RGB565) {
+                // 不需要转换, 按字节复制
+                size = row_len - offset;
+                size = size > lcd_obj->seg_size - fill ? lcd_obj->seg_size - fill : size;
+                if (size == 0) {
+                    break;
+                }
+                memcpy(buf + fill, data + row * stride + offset, size);
+                fill += size;
+                offset += size;
+            } else {
+                // 本段剩余空间能容纳的像素数
+                size = (lcd_obj->seg_size - fill) / group_size * group;
+                if (size == 0) {
+                    break;
+                }
+                size = (row_len - offset) / 2 > size ? size : (row_len - offset) / 2;
+                fill += lcd_pack(lcd_obj->pixel_format, data + row * stride + offset, buf + fill, size);
+                // 不足一个像素的尾部字节丢弃
+                offset = size ? offset + size * 2 : row_len;
+            }
+            if (offset == row_len) {
+                offset = 0;
+                row++;
+            }
+        }
+        // 没有可发送的数据(不足一个像素), 归还该段, 不能启动长度为0的DMA
+        if (fill == 0) {
+            xSemaphoreGive(lcd_obj->seg_free);
+            break;
+        }
+        for (x = 0; x * lcd_obj->dma_size < fill; x++) {
+            size = fill - x * lcd_obj->dma_size;
+            lcd_dma_node_set(&dma[x], buf + x * lcd_obj->dma_size, size > lcd_obj->dma_size ? lcd_obj->dma_size : size);
+        }
+        lcd_seg_submit(x, fill);
     }
-    cnt = len % lcd_obj->half_buffer_size;
-    // 处理剩余非完整段数据
-    if (cnt) {
-        memcpy(lcd_obj->dma[(x % 2) * lcd_obj->half_node_cnt].buf, data, cnt);
-        // 处理数据长度为 lcd_obj->dma_size 的整数倍情况
-        if (cnt % lcd_obj->dma_size) {
-            end_pos = (x % 2) * lcd_obj->half_node_cnt + cnt / lcd_obj->dma_size;
-            size = cnt % lcd_obj->dma_size;
-        } else {
-            end_pos = (x % 2) * lcd_obj->half_node_cnt + cnt / lcd_obj->dma_size - 1;
-            size = lcd_obj->dma_size;
+    lcd_seg_flush();
+}
+
+// 判断数据能否直接由SPI DMA读取
+// 内部RAM需要4字节对齐; PSRAM需要开启psram_dma, 且地址和长度按DMA块大小对齐
+static bool lcd_dma_capable(const uint8_t *data, size_t row_len, size_t stride, size_t rows)
+{
+    if (rows > 1 && (stride % 4) != 0) {
+        return false;
+    }
+    if (esp_ptr_dma_capable(data)) {
+        return ((uint32_t)data % 4) == 0;
+    }
+    if (lcd_obj->psram_dma && esp_ptr_external_ram(data)) {
+        return ((uint32_t)data % LCD_EXT_MEM_ALIGN) == 0 && (row_len % LCD_EXT_MEM_ALIGN) == 0 && (rows == 1 || (stride % LCD_EXT_MEM_ALIGN) == 0);
+    }
+    return false;
+}
+
+// 零拷贝发送: DMA节点直接指向调用者的buffer, 不经过中转buffer
+// 数据可以是不连续的多行(窗口), 每行由独立的DMA节点描述
+static void spi_write_zero_copy(const uint8_t *data, size_t row_len, size_t stride, size_t rows)
+{
+    int x = 0;
+    size_t size = 0, trans_len = 0, row = 0, offset = 0;
+    lldesc_t *dma = NULL;
+    lcd_set_dc(lcd_obj->dc_state);
+    if (esp_ptr_external_ram(data)) {
+        // PSRAM经过cache访问, DMA读取前需要将cache中的数据写回
+        Cache_WriteBack_Addr((uint32_t)data, (rows - 1) * stride + row_len);
+    }
+    while (row < rows) {
+        dma = lcd_seg_acquire();
+        trans_len = 0;
+        for (x = 0; x < lcd_obj->seg_node_cnt && row < rows; x++) {
+            size = row_len - offset > LCD_ZC_NODE_SIZE ? LCD_ZC_NODE_SIZE : row_len - offset;
+            lcd_dma_node_set(&dma[x], data + row * stride + offset, size);
+            trans_len += size;
+            offset += size;
+            if (offset == row_len) {
+                offset = 0;
+                row++;
+            }
+        }
+        lcd_seg_submit(x, trans_len);
+    }
+    lcd_seg_flush();
+}
+
+// 不经过DMA, 直接通过SPI数据寄存器(W0~W15)发送少量数据, 轮询等待结束, 不产生中断
+// 用于命令及其参数, 避免每个字节都重建DMA链表并等待一次EOF中断
+static void spi_write_cpu(const uint8_t *data, size_t len)
+{
+    uint32_t word[LCD_CPU_BUF_SIZE / 4];
+    int x = 0, size = 0;
+    lcd_set_dc(lcd_obj->dc_state);
+    GPSPI3.dma_out_link.dma_tx_ena = 0;
+    while (len > 0) {
+        size = len > LCD_CPU_BUF_SIZE ? LCD_CPU_BUF_SIZE : len;
+        memcpy(word, data, size);
+        for (x = 0; x < (size + 3) / 4; x++) {
+            GPSPI3.data_buf[x] = word[x];
         }
-        // 处理尾节点，使其成为 DMA 尾
-        lcd_obj->dma[end_pos].size = size;
-        lcd_obj->dma[end_pos].length = size;
-        lcd_obj->dma[end_pos].eof = 1;
-        lcd_obj->dma[end_pos].empty = NULL;
-        xQueueReceive(lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
-        GPSPI3.mosi_dlen.usr_mosi_bit_len = cnt * 8 - 1;
-        GPSPI3.dma_out_link.addr = ((uint32_t)&lcd_obj->dma[(x % 2) * lcd_obj->half_node_cnt]) & 0xfffff;
-        GPSPI3.dma_out_link.start = 1;
-        ets_delay_us(1);
+        GPSPI3.mosi_dlen.usr_mosi_bit_len = size * 8 - 1;
         GPSPI3.cmd.usr = 1;
+        while (GPSPI3.cmd.usr);
+        data += size;
+        len -= size;
     }
-    xQueueReceive(lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+    GPSPI3.dma_out_link.dma_tx_ena = 1;
 }
 
-static void lcd_delay_ms(uint32_t time)
+// 命令序列: {cmd, nargs, args[nargs]}, {cmd, nargs, args[nargs]} ...
+// 整个序列通过SPI数据寄存器连续发送, 不经过DMA, 不等待中断
+// 直接操作SPI寄存器, 只能在lcd_task启动之前(初始化)或在lcd_task中(lcd_trans_exec)调用, 不能与DMA传输同时进行
+static void lcd_write_cmd_seq(const uint8_t *seq, size_t len)
 {
-    vTaskDelay(time / portTICK_RATE_MS);
+    size_t pos = 0;
+    uint8_t nargs = 0;
+    while (pos + 2 <= len) {
+        nargs = seq[pos + 1];
+        if (pos + 2 + nargs > len) {
+            ESP_LOGE(TAG, "cmd seq truncated at 0x%02x\n", seq[pos]);
+            return;
+        }
+        lcd_obj->dc_state = 0;
+        spi_write_cpu(&seq[pos], 1);
+        if (nargs) {
+            lcd_obj->dc_state = 1;
+            spi_write_cpu(&seq[pos + 2], nargs);
+        }
+        pos += 2 + nargs;
+    }
 }
 
-static void lcd_write_cmd(uint8_t data)
+static void lcd_write_index(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end)
 {
-    lcd_obj->dc_state = 0;
-    spi_write_data(&data, 1);
+    uint16_t start_pos, end_pos;
+    // CASET, RASET, RAMWR 打包为一个命令序列发送
+    uint8_t seq[] = {
+        0x2a, 4, 0, 0, 0, 0,    // CASET (2Ah): Column Address Set
+        0x2b, 4, 0, 0, 0, 0,    // RASET (2Bh): Row Address Set
+        0x2c, 0                 // RAMWR (2Ch): Memory Write
+    };
+    if (lcd_obj->horizontal == 3) {
+        start_pos = x_start + 80;
+        end_pos = x_end + 80;
+    } else {
+        start_pos = x_start;
+        end_pos = x_end;
+    }
+    seq[2] = start_pos >> 8;
+    seq[3] = start_pos & 0xFF;
+    seq[4] = end_pos >> 8;
+    seq[5] = end_pos & 0xFF;
+
+    if (lcd_obj->horizontal == 1) {
+        start_pos = x_start + 80;
+        end_pos = x_end + 80;
+    } else {
+        start_pos = y_start;
+        end_pos = y_end;
+    }
+    seq[8] = start_pos >> 8;
+    seq[9] = start_pos & 0xFF;
+    seq[10] = end_pos >> 8;
+    seq[11] = end_pos & 0xFF;
+    lcd_write_cmd_seq(seq, sizeof(seq));
 }
 
-static void lcd_write_byte(uint8_t data)
+// 保证最小延时: vTaskDelay(n)的实际延时在n-1到n个tick之间, 需要多等一个tick; 不足一个tick时忙等
+static void lcd_delay_ms(uint32_t time)
 {
-    lcd_obj->dc_state = 1;
-    spi_write_data(&data, 1);
+    if (time < portTICK_RATE_MS) {
+        ets_delay_us(time * 1000);
+    } else {
+        vTaskDelay((time + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1);
+    }
 }
 
-void lcd_write_data(uint8_t *data, size_t len)
+// stride为0或等于row_len时数据连续; 否则按行发送窗口数据
+static void lcd_write_pixel(const uint8_t *data, size_t len, size_t row_len, size_t stride)
 {
+    size_t rows = 0;
     if (len <= 0) {
         return;
     }
+    // 输入为RGB565, 长度必须是整数个像素
+    if (len % 2 || row_len % 2) {
+        ESP_LOGE(TAG, "len %d is not a whole number of rgb565 pixels\n", len);
+        return;
+    }
     lcd_obj->dc_state = 1;
-    spi_write_data(data, len);
+    if (stride == 0 || stride == row_len) {
+        row_len = len;
+        stride = len;
+    }
+    rows = len / row_len;
+    // RGB444两个像素共用一个字节, 奇数宽度的多行窗口无法逐行打包
+    if (lcd_obj->pixel_format == LCD_PIXEL_FORMAT_RGB444 && rows > 1 && (row_len / 2) % 2) {
+        ESP_LOGE(TAG, "rgb444 window width must be even\n");
+        return;
+    }
+    // 其他格式需要转换, 只能经过中转buffer
+    if (lcd_obj->pixel_format == LCD_PIXEL_FORMAT_RGB565 && lcd_dma_capable(data, row_len, stride, rows)) {
+        spi_write_zero_copy(data, row_len, stride, rows);
+    } else {
+        spi_write_data(data, row_len, stride, rows);
+    }
 }
 
+// RESX低电平至少10us; 释放后5ms才能发送命令, 若复位前已退出休眠则需要120ms
+// 上电复位时面板与芯片同时上电, 处于休眠状态; 软件复位时面板可能仍在工作
+// 释放后120ms才能SLPOUT, 由lcd_write_cmd_table在SLPOUT之前等待剩余的时间
 void lcd_rst()
 {
     lcd_set_rst(0);
-    lcd_delay_ms(100);
+    ets_delay_us(LCD_RST_PULSE_US);
     lcd_set_rst(1);
-    lcd_delay_ms(100);
+    lcd_obj->rst_time = esp_timer_get_time();
+    lcd_delay_ms(esp_reset_reason() == ESP_RST_POWERON ? LCD_RST_WAIT_MS : LCD_RST_WAIT_AWAKE_MS);
 }
 
-static void lcd_st7789_config(lcd_config_t *config)
+// 初始化命令表: {cmd, nargs, args[nargs], delay_ms} ...
+// 延时为数据手册规定的最小值: SLPOUT之后5ms才能发送下一个命令
+// SLPOUT之前的命令在复位后的120ms等待期间发送
+static const uint8_t lcd_st7789_init_table[] = {
+    0xB2, 5, 0x0C, 0x0C, 0x00, 0x33, 0x33, 0,   // PORCTRL (B2h): Porch Setting
+    0xB7, 1, 0x35, 0,                           // GCTRL (B7h): Gate Control
+    0xBB, 1, 0x19, 0,                           // VCOMS (BBh): VCOM Setting
+    0xC0, 1, 0x2C, 0,                           // LCMCTRL (C0h): LCM Control
+    0xC2, 1, 0x01, 0,                           // VDVVRHEN (C2h): VDV and VRH Command Enable
+    0xC3, 1, 0x12, 0,                           // VRHS (C3h): VRH Set
+    0xC4, 1, 0x20, 0,                           // VDVS (C4h): VDV Set
+    0xC6, 1, 0x0F, 0,                           // FRCTRL2 (C6h): Frame Rate Control in Normal Mode
+    0xD0, 2, 0xA4, 0xA1, 0,                     // PWCTRL1 (D0h): Power Control 1
+    0xE0, 14, 0xD0, 0x04, 0x0D, 0x11, 0x13, 0x2B, 0x3F, 0x54, 0x4C, 0x18, 0x0D, 0x0B, 0x1F, 0x23, 0, // PVGAMCTRL (E0h): Positive Voltage Gamma Control
+    0xE1, 14, 0xD0, 0x04, 0x0C, 0x11, 0x13, 0x2C, 0x3F, 0x44, 0x51, 0x2F, 0x1F, 0x1F, 0x20, 0x23, 0, // NVGAMCTRL (E1h): Negative Voltage Gamma Control
+    0x20, 0, 0,                                 // INVOFF (20h): Display Inversion Off
+    0x11, 0, LCD_SLPOUT_WAIT_MS,                // SLPOUT (11h): Sleep Out
+    0x29, 0, 0,                                 // DISPON (29h): Display On
+};
+
+// 逐条发送命令表, 每条命令的参数一次发送
+static void lcd_write_cmd_table(const uint8_t *table, size_t len)
 {
-    lcd_set_cs(0);
-
-    lcd_write_cmd(0x36); // MADCTL (36h): Memory Data Access Control
-
-    switch (config->horizontal) {
-        case 0: {
-            lcd_write_byte(0x00);
+    size_t pos = 0, size = 0;
+    while (pos + 3 <= len) {
+        size = 2 + table[pos + 1];
+        if (pos + size + 1 > len) {
+            ESP_LOGE(TAG, "cmd table truncated at 0x%02x\n", table[pos]);
+            return;
         }
-        break;
-
-        case 1: {
-            lcd_write_byte(0xC0);
+        if (table[pos] == 0x11) {
+            // SLPOUT: 复位释放后120ms, 只等待剩余的时间
+            int64_t wait = lcd_obj->rst_time + LCD_RST_SLPOUT_MS * 1000 - esp_timer_get_time();
+            if (wait > 0) {
+                lcd_delay_ms((wait + 999) / 1000);
+            }
         }
-        break;
-
-        case 2: {
-            lcd_write_byte(0x70);
+        lcd_write_cmd_seq(&table[pos], size);
+        if (table[pos + size]) {
+            lcd_delay_ms(table[pos + size]);
         }
-        break;
+        pos += size + 1;
+    }
+}
 
-        case 3: {
-            lcd_write_byte(0xA0);
-        }
-        break;
+static void lcd_st7789_config(lcd_config_t *config)
+{
+    // MADCTL (36h): Memory Data Access Control, 对应horizontal 0~3
+    static const uint8_t madctl[] = {0x00, 0xC0, 0x70, 0xA0};
+    uint8_t seq[] = {
+        0x36, 1, 0x00,  // MADCTL (36h): Memory Data Access Control
+        0x3A, 1, 0x05,  // COLMOD (3Ah): Interface Pixel Format
+    };
+    if (config->horizontal < sizeof(madctl)) {
+        seq[2] = madctl[config->horizontal];
+    }
+    if (config->pixel_format == LCD_PIXEL_FORMAT_RGB444) {
+        seq[5] = 0x03;
+    } else if (config->pixel_format == LCD_PIXEL_FORMAT_RGB666) {
+        seq[5] = 0x06;
+    }
 
-        default: {
-            lcd_write_byte(0x00);
-        }
-        break;
-    }
-
-    lcd_write_cmd(0x3A);  // COLMOD (3Ah): Interface Pixel Format 
-    lcd_write_byte(0x05);
-
-    lcd_write_cmd(0xB2); // PORCTRL (B2h): Porch Setting 
-    lcd_write_byte(0x0C);
-    lcd_write_byte(0x0C);
-    lcd_write_byte(0x00);
-    lcd_write_byte(0x33);
-    lcd_write_byte(0x33); 
-
-    lcd_write_cmd(0xB7); // GCTRL (B7h): Gate Control 
-    lcd_write_byte(0x35);  
-
-    lcd_write_cmd(0xBB); // VCOMS (BBh): VCOM Setting 
-    lcd_write_byte(0x19);
-
-    lcd_write_cmd(0xC0); // LCMCTRL (C0h): LCM Control 
-    lcd_write_byte(0x2C);
-
-    lcd_write_cmd(0xC2); // VDVVRHEN (C2h): VDV and VRH Command Enable
-    lcd_write_byte(0x01);
-
-    lcd_write_cmd(0xC3); // VRHS (C3h): VRH Set
-    lcd_write_byte(0x12);   
-
-    lcd_write_cmd(0xC4); // VDVS (C4h): VDV Set 
-    lcd_write_byte(0x20);  
-
-    lcd_write_cmd(0xC6); // FRCTRL2 (C6h): Frame Rate Control in Normal Mode 
-    lcd_write_byte(0x0F);    
-
-    lcd_write_cmd(0xD0); // PWCTRL1 (D0h): Power Control 1 
-    lcd_write_byte(0xA4);
-    lcd_write_byte(0xA1);
-
-    lcd_write_cmd(0xE0); // PVGAMCTRL (E0h): Positive Voltage Gamma Control
-    lcd_write_byte(0xD0);
-    lcd_write_byte(0x04);
-    lcd_write_byte(0x0D);
-    lcd_write_byte(0x11);
-    lcd_write_byte(0x13);
-    lcd_write_byte(0x2B);
-    lcd_write_byte(0x3F);
-    lcd_write_byte(0x54);
-    lcd_write_byte(0x4C);
-    lcd_write_byte(0x18);
-    lcd_write_byte(0x0D);
-    lcd_write_byte(0x0B);
-    lcd_write_byte(0x1F);
-    lcd_write_byte(0x23);
-
-    lcd_write_cmd(0xE1); // NVGAMCTRL (E1h): Negative Voltage Gamma Control
-    lcd_write_byte(0xD0);
-    lcd_write_byte(0x04);
-    lcd_write_byte(0x0C);
-    lcd_write_byte(0x11);
-    lcd_write_byte(0x13);
-    lcd_write_byte(0x2C);
-    lcd_write_byte(0x3F);
-    lcd_write_byte(0x44);
-    lcd_write_byte(0x51);
-    lcd_write_byte(0x2F);
-    lcd_write_byte(0x1F);
-    lcd_write_byte(0x1F);
-    lcd_write_byte(0x20);
-    lcd_write_byte(0x23);
-
-    lcd_write_cmd(0x20); // INVON (21h): Display Inversion On
-
-    lcd_write_cmd(0x11); // SLPOUT (11h): Sleep Out 
-
-    lcd_write_cmd(0x29); // DISPON (29h): Display On
+    lcd_set_cs(0);
+    lcd_write_cmd_seq(seq, sizeof(seq));
+    lcd_write_cmd_table(lcd_st7789_init_table, sizeof(lcd_st7789_init_table));
 }
 
 static void lcd_config(lcd_config_t *config)
@@ -348,93 +560,188 @@ static void lcd_set_pin(lcd_config_t *config)
     gpio_config(&io_conf);
 }
 
-void lcd_dma_config(lcd_config_t *config) 
+// 中转buffer分为seg_cnt段, 每段一条以eof结尾的独立DMA链表
+// 每段的节点个数同时满足中转和零拷贝两种发送方式
+int lcd_dma_config(lcd_config_t *config)
 {
-    int cnt = 0;
-    if (config->max_buffer_size >= LCD_DMA_MAX_SIZE * 2) {
-        lcd_obj->dma_size = LCD_DMA_MAX_SIZE;
-        for (cnt = 0;;cnt++) { // 寻找可以整除dma_size的buffer大小
-            if ((config->max_buffer_size - cnt) % lcd_obj->dma_size == 0) {
-                break;
-            }
-        }
-        lcd_obj->buffer_size = config->max_buffer_size - cnt;
-    } else {
-        lcd_obj->dma_size = config->max_buffer_size / 2;
-        lcd_obj->buffer_size = lcd_obj->dma_size * 2;
+    lcd_obj->seg_cnt = config->dma_seg_cnt ? config->dma_seg_cnt : LCD_DMA_SEG_CNT;
+    lcd_obj->seg_size = (config->max_buffer_size / lcd_obj->seg_cnt) & ~0x3;
+    lcd_obj->dma_size = lcd_obj->seg_size > (LCD_DMA_MAX_SIZE & ~0x3) ? (LCD_DMA_MAX_SIZE & ~0x3) : lcd_obj->seg_size;
+    lcd_obj->seg_node_cnt = (lcd_obj->seg_size + lcd_obj->dma_size - 1) / lcd_obj->dma_size; // DMA节点个数
+    if (lcd_obj->seg_node_cnt < LCD_ZC_NODE_CNT) {
+        lcd_obj->seg_node_cnt = LCD_ZC_NODE_CNT;
     }
-    
-    lcd_obj->half_buffer_size = lcd_obj->buffer_size / 2;
 
-    lcd_obj->node_cnt = (lcd_obj->buffer_size) / lcd_obj->dma_size; // DMA节点个数
-    lcd_obj->half_node_cnt = lcd_obj->node_cnt / 2;
+    ESP_LOGI(TAG, "lcd_seg_cnt: %d, lcd_seg_size: %d, lcd_dma_size: %d, lcd_seg_node_cnt: %d\n", lcd_obj->seg_cnt, lcd_obj->seg_size, lcd_obj->dma_size, lcd_obj->seg_node_cnt);
 
-    ESP_LOGI(TAG, "lcd_buffer_size: %d, lcd_dma_size: %d, lcd_dma_node_cnt: %d\n", lcd_obj->buffer_size, lcd_obj->dma_size, lcd_obj->node_cnt);
+    lcd_obj->dma    = (lldesc_t *)MEM_CALLOC("lcd", lcd_obj->seg_cnt * lcd_obj->seg_node_cnt, sizeof(lldesc_t), MALLOC_CAP_DMA);
+    lcd_obj->buffer = (uint8_t *)MEM_MALLOC("lcd", lcd_obj->seg_cnt * lcd_obj->seg_size * sizeof(uint8_t), MALLOC_CAP_DMA);
+    lcd_obj->seg_len = (uint32_t *)MEM_CALLOC("lcd", lcd_obj->seg_cnt, sizeof(uint32_t), MALLOC_CAP_DEFAULT);
+    lcd_obj->seg_free = xSemaphoreCreateCounting(lcd_obj->seg_cnt, lcd_obj->seg_cnt);
+    if (lcd_obj->seg_size == 0 || !lcd_obj->dma || !lcd_obj->buffer || !lcd_obj->seg_len || !lcd_obj->seg_free) {
+        ESP_LOGE(TAG, "lcd dma malloc error\n");
+        return -1;
+    }
+    return 0;
+}
 
-    lcd_obj->dma    = (lldesc_t *)heap_caps_malloc(lcd_obj->node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    lcd_obj->buffer = (uint8_t *)heap_caps_malloc(lcd_obj->buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA);
+static void lcd_trans_exec(const lcd_trans_t *trans)
+{
+    if (trans->set_index) {
+        lcd_write_index(trans->x_start, trans->y_start, trans->x_end, trans->y_end);
+    }
+    if (trans->data) {
+        // 按行发送需要窗口宽度
+        lcd_write_pixel(trans->data, trans->len, (trans->x_end - trans->x_start + 1) * 2, trans->set_index ? trans->stride : 0);
+    }
+}
+
+// 按提交顺序依次执行传输, 完成后调用回调并通知等待者
+static void lcd_task(void *arg)
+{
+    lcd_trans_obj_t *trans_obj = NULL;
+    while (1) {
+        xQueueReceive(lcd_obj->trans_queue, (void *)&trans_obj, portMAX_DELAY);
+        TRACE_BEGIN(TRACE_ID_LCD_TRANS, trans_obj->trans.len);
+        lcd_trans_exec(&trans_obj->trans);
+        TRACE_END(TRACE_ID_LCD_TRANS, trans_obj->trans.len);
+        if (trans_obj->trans.cb) {
+            trans_obj->trans.cb(trans_obj->trans.arg);
+        }
+        trans_obj->done = 1;
+        if (trans_obj->wait) {
+            xSemaphoreGive(trans_obj->done_sem);
+        } else {
+            xQueueSend(lcd_obj->free_queue, (void *)&trans_obj, portMAX_DELAY);
+        }
+    }
+}
+
+static int lcd_trans_config(lcd_config_t *config)
+{
+    lcd_obj->trans_pool_size = config->trans_queue_size ? config->trans_queue_size : LCD_TRANS_QUEUE_SIZE;
+    lcd_obj->trans_pool = (lcd_trans_obj_t *)MEM_CALLOC("lcd", lcd_obj->trans_pool_size, sizeof(lcd_trans_obj_t), MALLOC_CAP_DEFAULT);
+    lcd_obj->trans_queue = xQueueCreate(lcd_obj->trans_pool_size, sizeof(lcd_trans_obj_t *));
+    lcd_obj->free_queue = xQueueCreate(lcd_obj->trans_pool_size, sizeof(lcd_trans_obj_t *));
+    if (!lcd_obj->trans_pool || !lcd_obj->trans_queue || !lcd_obj->free_queue) {
+        ESP_LOGE(TAG, "lcd trans malloc error\n");
+        return -1;
+    }
+    for (int x = 0; x < lcd_obj->trans_pool_size; x++) {
+        lcd_trans_obj_t *trans_obj = &lcd_obj->trans_pool[x];
+        trans_obj->done_sem = xSemaphoreCreateBinary();
+        xQueueSend(lcd_obj->free_queue, (void *)&trans_obj, 0);
+    }
+    if (MEM_TASK_CREATE("lcd", lcd_task, "lcd_task", config->task_stack ? config->task_stack : LCD_TASK_STACK, NULL, config->task_pri, &lcd_obj->task) != pdPASS) {
+        ESP_LOGE(TAG, "lcd task create error\n");
+        return -1;
+    }
+    return 0;
 }
 
 int lcd_init(lcd_config_t *config)
 {
-    lcd_obj = (lcd_obj_t *)heap_caps_calloc(1, sizeof(lcd_obj_t), MALLOC_CAP_DMA);
+    lcd_obj = (lcd_obj_t *)MEM_CALLOC("lcd", 1, sizeof(lcd_obj_t), MALLOC_CAP_DMA);
     if (!lcd_obj) {
         ESP_LOGI(TAG, "lcd object malloc error\n");
         return -1;
     }
 
+    if (lcd_dma_config(config) != 0) {
+        return -1;
+    }
     lcd_set_pin(config);
     lcd_config(config);
-    lcd_dma_config(config);
-
-    lcd_obj->event_queue = xQueueCreate(1, sizeof(int));
-    
-    lcd_obj->buffer_size = config->max_buffer_size;
 
     lcd_obj->pin_dc = config->pin_dc;
     lcd_obj->pin_cs = config->pin_cs;
     lcd_obj->pin_rst = config->pin_rst;
     lcd_obj->pin_bk = config->pin_bk;
+    lcd_obj->psram_dma = config->psram_dma;
+    lcd_obj->pixel_format = config->pixel_format;
     lcd_set_cs(1);
 
     lcd_rst();//lcd_rst before LCD Init.
-    lcd_delay_ms(100);
     lcd_st7789_config(config);
 
     lcd_set_blk(0);
+    if (lcd_trans_config(config) != 0) {
+        return -1;
+    }
     ESP_LOGI(TAG, "lcd init ok\n");
 
     return 0;
 }
 
-void lcd_set_index(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end)
+int lcd_trans_submit(const lcd_trans_t *trans, lcd_trans_handle_t *handle, TickType_t ticks_to_wait)
 {
-    uint16_t start_pos, end_pos;
-    lcd_write_cmd(0x2a);    // CASET (2Ah): Column Address Set 
-    // Must write byte than byte
-    if (lcd_obj->horizontal == 3) {
-        start_pos = x_start + 80;
-        end_pos = x_end + 80;
-    } else {
-        start_pos = x_start;
-        end_pos = x_end;
+    lcd_trans_obj_t *trans_obj = NULL;
+    if (xQueueReceive(lcd_obj->free_queue, (void *)&trans_obj, ticks_to_wait) != pdTRUE) {
+        return -1;
     }
-    lcd_write_byte(start_pos >> 8);
-    lcd_write_byte(start_pos & 0xFF);
-    lcd_write_byte(end_pos >> 8);
-    lcd_write_byte(end_pos & 0xFF);
+    trans_obj->trans = *trans;
+    trans_obj->done = 0;
+    trans_obj->wait = (handle != NULL);
+    if (handle) {
+        *handle = trans_obj;
+    }
+    xQueueSend(lcd_obj->trans_queue, (void *)&trans_obj, portMAX_DELAY);
+    return 0;
+}
 
-    lcd_write_cmd(0x2b);    // RASET (2Bh): Row Address Set
-    if (lcd_obj->horizontal == 1) {
-        start_pos = x_start + 80;
-        end_pos = x_end + 80;
-    } else {
-        start_pos = y_start;
-        end_pos = y_end;
+int lcd_trans_wait(lcd_trans_handle_t handle, TickType_t ticks_to_wait)
+{
+    if (xSemaphoreTake(handle->done_sem, ticks_to_wait) != pdTRUE) {
+        return -1;
     }
-    lcd_write_byte(start_pos >> 8);
-    lcd_write_byte(start_pos & 0xFF);
-    lcd_write_byte(end_pos >> 8);
-    lcd_write_byte(end_pos & 0xFF); 
-    lcd_write_cmd(0x2c);    // RAMWR (2Ch): Memory Write 
-}
\ No newline at end of file
+    xQueueSend(lcd_obj->free_queue, (void *)&handle, portMAX_DELAY);
+    return 0;
+}
+
+bool lcd_trans_done(lcd_trans_handle_t handle)
+{
+    return handle->done;
+}
+
+int lcd_fence(TickType_t ticks_to_wait)
+{
+    lcd_trans_t trans = {0};
+    lcd_trans_handle_t handle = NULL;
+    if (lcd_trans_submit(&trans, &handle, ticks_to_wait) != 0) {
+        return -1;
+    }
+    return lcd_trans_wait(handle, portMAX_DELAY);
+}
+
+// 同步接口: 与异步传输共用队列以保证顺序, 在lcd任务(回调)中调用时直接执行
+static void lcd_trans_sync(const lcd_trans_t *trans)
+{
+    lcd_trans_handle_t handle = NULL;
+    if (lcd_obj->task == NULL || xTaskGetCurrentTaskHandle() == lcd_obj->task) {
+        lcd_trans_exec(trans);
+        return;
+    }
+    lcd_trans_submit(trans, &handle, portMAX_DELAY);
+    lcd_trans_wait(handle, portMAX_DELAY);
+}
+
+void lcd_write_data(uint8_t *data, size_t len)
+{
+    lcd_trans_t trans = {
+        .data = data,
+        .len = len,
+    };
+    lcd_trans_sync(&trans);
+}
+
+void lcd_set_index(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end)
+{
+    lcd_trans_t trans = {
+        .set_index = 1,
+        .x_start = x_start,
+        .y_start = y_start,
+        .x_end = x_end,
+        .y_end = y_end,
+    };
+    lcd_trans_sync(&trans);
+}
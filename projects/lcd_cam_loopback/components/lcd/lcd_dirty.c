@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lcd_dirty.h"
+#include "mem_budget.h"
+
+#define LCD_DIRTY_TILE          (16)
+#define LCD_DIRTY_MAX_RECT      (16)
+#define LCD_DIRTY_FULL_PERCENT  (75)
+
+#define FNV_OFFSET              (2166136261u)
+#define FNV_PRIME               (16777619u)
+
+int lcd_dirty_init(lcd_dirty_t *dirty, const lcd_dirty_config_t *config)
+{
+    uint16_t value = 0;
+    uint8_t mask[4];
+    memset(dirty, 0, sizeof(lcd_dirty_t));
+    dirty->config = *config;
+    if (dirty->config.tile == 0) {
+        dirty->config.tile = LCD_DIRTY_TILE;
+    }
+    if (dirty->config.max_rect == 0) {
+        dirty->config.max_rect = LCD_DIRTY_MAX_RECT;
+    }
+    if (dirty->config.full_percent == 0) {
+        dirty->config.full_percent = LCD_DIRTY_FULL_PERCENT;
+    }
+    // 按32位读取像素, 行首和tile首地址都需要4字节对齐
+    if (config->width == 0 || config->high == 0 || (config->width % 2) || (dirty->config.tile % 2) || config->noise_bits > 2) {
+        return -1;
+    }
+    dirty->tile_cols = (config->width + dirty->config.tile - 1) / dirty->config.tile;
+    dirty->tile_rows = (config->high + dirty->config.tile - 1) / dirty->config.tile;
+
+    // RGB565各分量去掉低noise_bits位, 转换为big-endian内存字节序
+    value = (0x1F >> config->noise_bits) << config->noise_bits << 11;
+    value |= (0x3F >> config->noise_bits) << config->noise_bits << 5;
+    value |= (0x1F >> config->noise_bits) << config->noise_bits;
+    mask[0] = mask[2] = value >> 8;
+    mask[1] = mask[3] = value & 0xFF;
+    memcpy(&dirty->mask, mask, sizeof(dirty->mask));
+
+    dirty->hash = (uint32_t *)MEM_CALLOC("lcd", dirty->tile_cols * dirty->tile_rows, sizeof(uint32_t), MALLOC_CAP_DEFAULT);
+    dirty->dirty = (uint8_t *)MEM_CALLOC("lcd", dirty->tile_cols * dirty->tile_rows, sizeof(uint8_t), MALLOC_CAP_DEFAULT);
+    dirty->run = (uint16_t *)MEM_CALLOC("lcd", dirty->tile_cols * 2, sizeof(uint16_t), MALLOC_CAP_DEFAULT);
+    if (!dirty->hash || !dirty->dirty || !dirty->run) {
+        lcd_dirty_deinit(dirty);
+        return -1;
+    }
+    return 0;
+}
+
+void lcd_dirty_deinit(lcd_dirty_t *dirty)
+{
+    MEM_FREE(dirty->hash);
+    MEM_FREE(dirty->dirty);
+    MEM_FREE(dirty->run);
+    dirty->hash = NULL;
+    dirty->dirty = NULL;
+    dirty->run = NULL;
+    dirty->valid = 0;
+}
+
+void lcd_dirty_invalidate(lcd_dirty_t *dirty)
+{
+    dirty->valid = 0;
+}
+
+// FNV-1a, 每次处理两个像素
+static uint32_t lcd_dirty_tile_hash(const lcd_dirty_t *dirty, const uint8_t *frame, int col, int row)
+{
+    uint32_t hash = FNV_OFFSET;
+    uint16_t value = 0;
+    int x0 = col * dirty->config.tile;
+    int y0 = row * dirty->config.tile;
+    int w = dirty->config.width - x0 < dirty->config.tile ? dirty->config.width - x0 : dirty->config.tile;
+    int h = dirty->config.high - y0 < dirty->config.tile ? dirty->config.high - y0 : dirty->config.tile;
+    int words = w / 2;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *line = frame + ((y0 + y) * dirty->config.width + x0) * 2;
+        const uint32_t *p = (const uint32_t *)line;
+        for (int x = 0; x < words; x++) {
+            hash = (hash ^ (p[x] & dirty->mask)) * FNV_PRIME;
+        }
+        if (w & 1) {
+            memcpy(&value, line + words * 4, sizeof(value));
+            hash = (hash ^ (value & (uint16_t)dirty->mask)) * FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
+static void lcd_dirty_tile_rect(const lcd_dirty_t *dirty, int col_start, int col_end, int row, lcd_rect_t *rect)
+{
+    int x_end = (col_end + 1) * dirty->config.tile;
+    int y_end = (row + 1) * dirty->config.tile;
+    rect->x = col_start * dirty->config.tile;
+    rect->y = row * dirty->config.tile;
+    rect->w = (x_end > dirty->config.width ? dirty->config.width : x_end) - rect->x;
+    rect->h = (y_end > dirty->config.high ? dirty->config.high : y_end) - rect->y;
+}
+
+// 所有脏块的包围盒
+static void lcd_dirty_bound(const lcd_dirty_t *dirty, lcd_rect_t *rect)
+{
+    int col_start = dirty->tile_cols, col_end = 0, row_start = dirty->tile_rows, row_end = 0;
+    lcd_rect_t last;
+    for (int row = 0; row < dirty->tile_rows; row++) {
+        for (int col = 0; col < dirty->tile_cols; col++) {
+            if (dirty->dirty[row * dirty->tile_cols + col]) {
+                col_start = col < col_start ? col : col_start;
+                col_end = col > col_end ? col : col_end;
+                row_start = row < row_start ? row : row_start;
+                row_end = row > row_end ? row : row_end;
+            }
+        }
+    }
+    lcd_dirty_tile_rect(dirty, col_start, col_end, row_start, rect);
+    lcd_dirty_tile_rect(dirty, col_start, col_end, row_end, &last);
+    rect->h = last.y + last.h - rect->y;
+}
+
+int lcd_dirty_scan(lcd_dirty_t *dirty, const uint8_t *frame, lcd_rect_t *rect)
+{
+    uint32_t total = dirty->tile_cols * dirty->tile_rows;
+    int full = !dirty->valid || (dirty->config.full_refresh && (dirty->frame_cnt % dirty->config.full_refresh) == 0);
+    int rect_cnt = 0;
+    uint32_t hash = 0;
+    // run前半部分为上一行涉及的矩形序号, 后半部分为当前行
+    uint16_t *prev = dirty->run, *cur = dirty->run + dirty->tile_cols, *temp = NULL;
+    int prev_cnt = 0, cur_cnt = 0;
+
+    dirty->dirty_cnt = 0;
+    for (int row = 0; row < dirty->tile_rows; row++) {
+        for (int col = 0; col < dirty->tile_cols; col++) {
+            int index = row * dirty->tile_cols + col;
+            hash = lcd_dirty_tile_hash(dirty, frame, col, row);
+            dirty->dirty[index] = full || hash != dirty->hash[index];
+            dirty->hash[index] = hash;
+            dirty->dirty_cnt += dirty->dirty[index];
+        }
+    }
+    dirty->valid = 1;
+    dirty->frame_cnt++;
+
+    if (dirty->dirty_cnt == 0) {
+        return 0;
+    }
+    if (full || dirty->dirty_cnt * 100 >= total * dirty->config.full_percent) {
+        rect[0].x = 0;
+        rect[0].y = 0;
+        rect[0].w = dirty->config.width;
+        rect[0].h = dirty->config.high;
+        return 1;
+    }
+
+    for (int row = 0; row < dirty->tile_rows; row++) {
+        const uint8_t *line = &dirty->dirty[row * dirty->tile_cols];
+        cur_cnt = 0;
+        for (int col = 0; col < dirty->tile_cols; col++) {
+            if (!line[col]) {
+                continue;
+            }
+            // 找出一段连续的脏块, 允许中间有不超过merge_gap个干净块
+            int col_start = col, col_end = col;
+            for (col = col + 1; col < dirty->tile_cols; col++) {
+                if (line[col]) {
+                    col_end = col;
+                } else if (col - col_end > dirty->config.merge_gap) {
+                    break;
+                }
+            }
+            lcd_rect_t run;
+            lcd_dirty_tile_rect(dirty, col_start, col_end, row, &run);
+            // 与上一行宽度相同的矩形向下延伸
+            int merged = -1;
+            for (int x = 0; x < prev_cnt; x++) {
+                lcd_rect_t *r = &rect[prev[x]];
+                if (r->x == run.x && r->w == run.w && r->y + r->h == run.y) {
+                    r->h += run.h;
+                    merged = prev[x];
+                    break;
+                }
+            }
+            if (merged < 0) {
+                if (rect_cnt >= dirty->config.max_rect) {
+                    lcd_dirty_bound(dirty, &rect[0]);
+                    return 1;
+                }
+                rect[rect_cnt] = run;
+                merged = rect_cnt++;
+            }
+            cur[cur_cnt++] = merged;
+        }
+        temp = prev;
+        prev = cur;
+        cur = temp;
+        prev_cnt = cur_cnt;
+    }
+    return rect_cnt;
+}
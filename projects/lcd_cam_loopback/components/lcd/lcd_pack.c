@@ -0,0 +1,68 @@
+#include <string.h>
+#include "lcd_pack.h"
+
+size_t lcd_pack_size(lcd_pixel_format_t format, size_t pixels)
+{
+    switch (format) {
+        case LCD_PIXEL_FORMAT_RGB444:
+            return (pixels * 3 + 1) / 2;
+        case LCD_PIXEL_FORMAT_RGB666:
+            return pixels * 3;
+        default:
+            return pixels * 2;
+    }
+}
+
+// RGB565 (RRRRRGGG GGGBBBBB) 取每个分量的高4位, 每次处理两个像素
+size_t lcd_pack_rgb444(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint32_t p0, p1;
+    uint8_t *out = dst;
+    for (size_t x = 0; x + 1 < pixels; x += 2) {
+        p0 = (src[0] << 8) | src[1];
+        p1 = (src[2] << 8) | src[3];
+        out[0] = ((p0 >> 8) & 0xF0) | ((p0 >> 7) & 0x0F);
+        out[1] = ((p0 << 3) & 0xF0) | (p1 >> 12);
+        out[2] = ((p1 >> 3) & 0xF0) | ((p1 >> 1) & 0x0F);
+        src += 4;
+        out += 3;
+    }
+    if (pixels & 1) {
+        p0 = (src[0] << 8) | src[1];
+        out[0] = ((p0 >> 8) & 0xF0) | ((p0 >> 7) & 0x0F);
+        out[1] = (p0 << 3) & 0xF0;
+        out += 2;
+    }
+    return out - dst;
+}
+
+// 5/6位分量扩展到6位并左对齐到字节高位, 低位复制高位使白色保持满幅
+size_t lcd_pack_rgb666(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    uint32_t p, r, b;
+    uint8_t *out = dst;
+    for (size_t x = 0; x < pixels; x++) {
+        p = (src[0] << 8) | src[1];
+        r = p >> 11;
+        b = p & 0x1F;
+        out[0] = ((r << 1) | (r >> 4)) << 2;
+        out[1] = ((p >> 5) & 0x3F) << 2;
+        out[2] = ((b << 1) | (b >> 4)) << 2;
+        src += 2;
+        out += 3;
+    }
+    return out - dst;
+}
+
+size_t lcd_pack(lcd_pixel_format_t format, const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    switch (format) {
+        case LCD_PIXEL_FORMAT_RGB444:
+            return lcd_pack_rgb444(src, dst, pixels);
+        case LCD_PIXEL_FORMAT_RGB666:
+            return lcd_pack_rgb666(src, dst, pixels);
+        default:
+            memcpy(dst, src, pixels * 2);
+            return pixels * 2;
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 内存预算统计: 组件通过MEM_宏分配内存和创建任务, 按组件名(tag)和内存类型(内部RAM/DMA/PSRAM)统计当前用量和峰值,
+// 并记录每个任务的栈大小和最大用量(高水位), 用于按实际用量缩小buffer和栈
+// 分配记录在固定大小的表中(不在内存块前加头, 不改变对齐, 用heap_caps_free释放也不会出错, 只是不再统计)
+//
+// MEM_BUDGET_ENABLE为0时MEM_宏直接调用heap_caps_*/xTaskCreate/vTaskDelete, 没有额外开销
+
+#ifndef MEM_BUDGET_ENABLE
+#define MEM_BUDGET_ENABLE       (0)
+#endif
+
+#define MEM_BUDGET_MAX_TAG      (16) // 组件个数
+#define MEM_BUDGET_MAX_ALLOC    (96) // 同时存在的分配个数, 表满时仍然分配, 计入untracked
+#define MEM_BUDGET_MAX_TASK     (24)
+
+// 内存类型: 分配到PSRAM的为PSRAM(包括MALLOC_CAP_DEFAULT分配到PSRAM的), 其余按caps是否有MALLOC_CAP_DMA
+typedef enum {
+    MEM_BUDGET_INTERNAL = 0,
+    MEM_BUDGET_DMA,
+    MEM_BUDGET_PSRAM,
+    MEM_BUDGET_TYPE_NUM,
+} mem_budget_type_t;
+
+typedef struct {
+    uint32_t cur;           // 当前用量(字节)
+    uint32_t peak;          // 最大用量
+    uint32_t count;         // 当前的分配个数
+    uint32_t allocs;        // 累计的分配次数, 每帧分配的组件会持续增加
+    uint32_t fails;         // 分配失败的次数
+} mem_budget_usage_t;
+
+typedef struct {
+    const char *tag;
+    mem_budget_usage_t usage[MEM_BUDGET_TYPE_NUM];
+    uint32_t stack;         // 运行中任务的栈大小之和
+} mem_budget_tag_stats_t;
+
+typedef struct {
+    const char *tag;
+    char name[16];
+    uint32_t stack_size;    // 创建时的栈大小(字节)
+    uint32_t stack_peak;    // 最大用量(字节), 即stack_size减去高水位
+    uint8_t running;        // 0: 已通过MEM_TASK_DELETE退出, stack_peak为退出时的值
+} mem_budget_task_stats_t;
+
+typedef struct {
+    uint32_t tag_cnt;
+    mem_budget_tag_stats_t tag[MEM_BUDGET_MAX_TAG];
+    mem_budget_usage_t total[MEM_BUDGET_TYPE_NUM];
+    uint32_t task_cnt;
+    mem_budget_task_stats_t task[MEM_BUDGET_MAX_TASK];
+    uint32_t untracked;     // 表满(分配或任务)没有记录的次数
+    uint32_t heap_free[MEM_BUDGET_TYPE_NUM];     // heap_caps_get_free_size
+    uint32_t heap_min_free[MEM_BUDGET_TYPE_NUM]; // heap_caps_get_minimum_free_size
+} mem_budget_stats_t;
+
+#if MEM_BUDGET_ENABLE
+#define MEM_MALLOC(tag, size, caps)         mem_budget_malloc((tag), (size), (caps))
+#define MEM_CALLOC(tag, n, size, caps)      mem_budget_calloc((tag), (n), (size), (caps))
+#define MEM_FREE(ptr)                       mem_budget_free(ptr)
+#define MEM_TASK_CREATE(tag, func, name, stack, arg, pri, handle) mem_budget_task_create((tag), (func), (name), (stack), (arg), (pri), (handle))
+#define MEM_TASK_DELETE()                   mem_budget_task_delete()
+#else
+#define MEM_MALLOC(tag, size, caps)         heap_caps_malloc((size), (caps))
+#define MEM_CALLOC(tag, n, size, caps)      heap_caps_calloc((n), (size), (caps))
+#define MEM_FREE(ptr)                       heap_caps_free(ptr)
+#define MEM_TASK_CREATE(tag, func, name, stack, arg, pri, handle) xTaskCreate((func), (name), (stack), (arg), (pri), (handle))
+#define MEM_TASK_DELETE()                   vTaskDelete(NULL)
+#endif
+
+// tag为组件名, 必须是常量字符串(只保存指针); 不能在中断中调用
+void *mem_budget_malloc(const char *tag, size_t size, uint32_t caps);
+void *mem_budget_calloc(const char *tag, size_t n, size_t size, uint32_t caps);
+
+// 没有记录的指针(表满或不是mem_budget分配的)直接释放
+void mem_budget_free(void *ptr);
+
+// 同xTaskCreate, 记录任务的栈大小, 之后可以查询栈的高水位
+BaseType_t mem_budget_task_create(const char *tag, TaskFunction_t func, const char *name, uint32_t stack, void *arg, UBaseType_t pri, TaskHandle_t *handle);
+
+// 记录最终的栈用量并删除当前任务, 代替任务函数末尾的vTaskDelete(NULL)
+// (删除之后不能再查询该任务的高水位, 不经过这里删除的任务之后的统计无效)
+void mem_budget_task_delete(void);
+
+// 复制统计, 同时更新运行中任务的栈高水位
+void mem_budget_get_stats(mem_budget_stats_t *stats);
+
+// 清除各组件的峰值和累计次数(峰值设为当前用量), 例如初始化完成后只统计运行中的峰值
+void mem_budget_reset_peak(void);
+
+// 输出各组件各内存类型的当前用量/峰值, 堆的剩余空间, 各任务的栈用量; 栈用量超过90%的任务标记"!"
+void mem_budget_print(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "soc/soc_memory_layout.h"
+#include "mem_budget.h"
+
+static const char *TAG = "mem_budget";
+
+typedef struct {
+    void *ptr;              // NULL: 空
+    uint32_t size;          // 请求的大小, 不包括堆的管理开销
+    uint8_t tag;
+    uint8_t type;
+} mem_budget_alloc_t;
+
+typedef struct {
+    uint8_t used;
+    TaskHandle_t handle;    // 任务开始运行时设置, 退出后为NULL
+    TaskFunction_t func;
+    void *arg;
+    uint32_t hw;            // 最近一次查询的高水位(字节)
+} mem_budget_task_t;
+
+static mem_budget_stats_t mem_stats;
+static mem_budget_alloc_t mem_alloc[MEM_BUDGET_MAX_ALLOC];
+static mem_budget_task_t mem_task[MEM_BUDGET_MAX_TASK];
+static portMUX_TYPE mem_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *type_str[MEM_BUDGET_TYPE_NUM] = {"internal", "dma", "psram"};
+
+// 在mem_lock中调用
+// 返回值:tag序号;-1,tag表已满
+static int tag_find(const char *tag)
+{
+    for (int x = 0; x < mem_stats.tag_cnt; x++) {
+        if (mem_stats.tag[x].tag == tag || strcmp(mem_stats.tag[x].tag, tag) == 0) {
+            return x;
+        }
+    }
+    if (mem_stats.tag_cnt == MEM_BUDGET_MAX_TAG) {
+        return -1;
+    }
+    mem_stats.tag[mem_stats.tag_cnt].tag = tag;
+    return mem_stats.tag_cnt++;
+}
+
+static void usage_add(mem_budget_usage_t *usage, uint32_t size)
+{
+    usage->cur += size;
+    usage->count++;
+    usage->allocs++;
+    if (usage->cur > usage->peak) {
+        usage->peak = usage->cur;
+    }
+}
+
+static void usage_sub(mem_budget_usage_t *usage, uint32_t size)
+{
+    usage->cur -= size;
+    usage->count--;
+}
+
+static void mem_budget_add(const char *tag, void *ptr, size_t size, uint32_t caps)
+{
+    uint8_t type = MEM_BUDGET_INTERNAL;
+    int index = 0;
+
+    if (ptr ? esp_ptr_external_ram(ptr) : (caps & MALLOC_CAP_SPIRAM)) {
+        type = MEM_BUDGET_PSRAM;
+    } else if (caps & MALLOC_CAP_DMA) {
+        type = MEM_BUDGET_DMA;
+    }
+    portENTER_CRITICAL(&mem_lock);
+    index = tag_find(tag);
+    if (index < 0) {
+        mem_stats.untracked++;
+    } else if (!ptr) {
+        mem_stats.tag[index].usage[type].fails++;
+        mem_stats.total[type].fails++;
+    } else {
+        for (int x = 0; x < MEM_BUDGET_MAX_ALLOC; x++) {
+            if (mem_alloc[x].ptr == NULL) {
+                mem_alloc[x] = (mem_budget_alloc_t) {.ptr = ptr, .size = size, .tag = index, .type = type};
+                usage_add(&mem_stats.tag[index].usage[type], size);
+                usage_add(&mem_stats.total[type], size);
+                index = -1;
+                break;
+            }
+        }
+        if (index >= 0) {
+            mem_stats.untracked++;
+        }
+    }
+    portEXIT_CRITICAL(&mem_lock);
+}
+
+void *mem_budget_malloc(const char *tag, size_t size, uint32_t caps)
+{
+    void *ptr = heap_caps_malloc(size, caps);
+    mem_budget_add(tag, ptr, size, caps);
+    return ptr;
+}
+
+void *mem_budget_calloc(const char *tag, size_t n, size_t size, uint32_t caps)
+{
+    void *ptr = heap_caps_calloc(n, size, caps);
+    mem_budget_add(tag, ptr, n * size, caps);
+    return ptr;
+}
+
+void mem_budget_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    portENTER_CRITICAL(&mem_lock);
+    for (int x = 0; x < MEM_BUDGET_MAX_ALLOC; x++) {
+        if (mem_alloc[x].ptr == ptr) {
+            usage_sub(&mem_stats.tag[mem_alloc[x].tag].usage[mem_alloc[x].type], mem_alloc[x].size);
+            usage_sub(&mem_stats.total[mem_alloc[x].type], mem_alloc[x].size);
+            mem_alloc[x].ptr = NULL;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mem_lock);
+    heap_caps_free(ptr);
+}
+
+// 任务开始运行时记录自己的handle, 不会在创建者记录之前就退出
+static void mem_budget_task_entry(void *arg)
+{
+    mem_budget_task_t *task = (mem_budget_task_t *)arg;
+
+    portENTER_CRITICAL(&mem_lock);
+    task->handle = xTaskGetCurrentTaskHandle();
+    portEXIT_CRITICAL(&mem_lock);
+    task->func(task->arg);
+    // 任务函数不应返回
+    mem_budget_task_delete();
+}
+
+BaseType_t mem_budget_task_create(const char *tag, TaskFunction_t func, const char *name, uint32_t stack, void *arg, UBaseType_t pri, TaskHandle_t *handle)
+{
+    mem_budget_task_t *task = NULL;
+    int index = -1;
+
+    portENTER_CRITICAL(&mem_lock);
+    // 表满时覆盖已退出任务的记录
+    for (int x = 0; x < MEM_BUDGET_MAX_TASK && index < 0; x++) {
+        index = mem_task[x].used ? -1 : x;
+    }
+    for (int x = 0; x < MEM_BUDGET_MAX_TASK && index < 0; x++) {
+        index = mem_stats.task[x].running ? -1 : x;
+    }
+    // 栈计入tag的统计
+    if (index < 0 || tag_find(tag) < 0) {
+        mem_stats.untracked++;
+    } else {
+        task = &mem_task[index];
+        *task = (mem_budget_task_t) {.used = 1, .func = func, .arg = arg, .hw = stack};
+        mem_stats.task[index] = (mem_budget_task_stats_t) {.tag = tag, .stack_size = stack, .running = 1};
+        snprintf(mem_stats.task[index].name, sizeof(mem_stats.task[index].name), "%s", name ? name : "");
+        if (index >= mem_stats.task_cnt) {
+            mem_stats.task_cnt = index + 1;
+        }
+    }
+    portEXIT_CRITICAL(&mem_lock);
+    if (!task) {
+        return xTaskCreate(func, name, stack, arg, pri, handle);
+    }
+    BaseType_t ret = xTaskCreate(mem_budget_task_entry, name, stack, task, pri, handle);
+    if (ret != pdPASS) {
+        portENTER_CRITICAL(&mem_lock);
+        task->used = 0;
+        mem_stats.task[index].running = 0;
+        portEXIT_CRITICAL(&mem_lock);
+    }
+    return ret;
+}
+
+// 在mem_lock中调用
+static void task_update(int index, uint32_t hw)
+{
+    mem_task[index].hw = hw;
+    mem_stats.task[index].stack_peak = mem_stats.task[index].stack_size > hw ? mem_stats.task[index].stack_size - hw : 0;
+}
+
+void mem_budget_task_delete(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    // 查询自己的栈, 不需要暂停调度; 扫描栈较慢, 在临界区外进行
+    uint32_t hw = uxTaskGetStackHighWaterMark(self);
+
+    portENTER_CRITICAL(&mem_lock);
+    for (int x = 0; x < MEM_BUDGET_MAX_TASK; x++) {
+        if (mem_task[x].used && mem_task[x].handle == self) {
+            task_update(x, hw);
+            mem_task[x].handle = NULL;
+            mem_stats.task[x].running = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mem_lock);
+    vTaskDelete(NULL);
+}
+
+void mem_budget_get_stats(mem_budget_stats_t *stats)
+{
+    // 扫描栈较慢, 不能在临界区中进行(会屏蔽中断): 临界区中只复制handle, 扫描时暂停调度
+    // ESP32-S2为单核, 暂停调度期间被查询的任务不会运行到vTaskDelete, idle任务也不会释放它的TCB和栈, handle一直有效
+    // handle不为NULL说明任务还没有经过mem_budget_task_delete, 每个任务单独暂停, 暂停的时间不累加
+    for (int x = 0; x < MEM_BUDGET_MAX_TASK; x++) {
+        vTaskSuspendAll();
+        portENTER_CRITICAL(&mem_lock);
+        TaskHandle_t handle = mem_task[x].used ? mem_task[x].handle : NULL;
+        portEXIT_CRITICAL(&mem_lock);
+        if (handle) {
+            uint32_t hw = uxTaskGetStackHighWaterMark(handle);
+            portENTER_CRITICAL(&mem_lock);
+            if (mem_task[x].handle == handle) {
+                task_update(x, hw);
+            }
+            portEXIT_CRITICAL(&mem_lock);
+        }
+        xTaskResumeAll();
+    }
+    portENTER_CRITICAL(&mem_lock);
+    *stats = mem_stats;
+    portEXIT_CRITICAL(&mem_lock);
+    for (int x = 0; x < stats->task_cnt; x++) {
+        for (int y = 0; y < stats->tag_cnt && stats->task[x].running; y++) {
+            if (stats->tag[y].tag == stats->task[x].tag || strcmp(stats->tag[y].tag, stats->task[x].tag) == 0) {
+                stats->tag[y].stack += stats->task[x].stack_size;
+                break;
+            }
+        }
+    }
+    stats->heap_free[MEM_BUDGET_INTERNAL] = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    stats->heap_free[MEM_BUDGET_DMA] = heap_caps_get_free_size(MALLOC_CAP_DMA);
+    stats->heap_free[MEM_BUDGET_PSRAM] = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    stats->heap_min_free[MEM_BUDGET_INTERNAL] = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    stats->heap_min_free[MEM_BUDGET_DMA] = heap_caps_get_minimum_free_size(MALLOC_CAP_DMA);
+    stats->heap_min_free[MEM_BUDGET_PSRAM] = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void mem_budget_reset_peak(void)
+{
+    portENTER_CRITICAL(&mem_lock);
+    for (int y = 0; y < MEM_BUDGET_TYPE_NUM; y++) {
+        for (int x = 0; x < mem_stats.tag_cnt; x++) {
+            mem_stats.tag[x].usage[y].peak = mem_stats.tag[x].usage[y].cur;
+            mem_stats.tag[x].usage[y].allocs = 0;
+            mem_stats.tag[x].usage[y].fails = 0;
+        }
+        mem_stats.total[y].peak = mem_stats.total[y].cur;
+        mem_stats.total[y].allocs = 0;
+        mem_stats.total[y].fails = 0;
+    }
+    portEXIT_CRITICAL(&mem_lock);
+}
+
+static void print_usage(const char *name, const mem_budget_usage_t *usage, uint32_t stack)
+{
+    uint32_t allocs = 0, fails = 0;
+    for (int x = 0; x < MEM_BUDGET_TYPE_NUM; x++) {
+        allocs += usage[x].allocs;
+        fails += usage[x].fails;
+    }
+    ESP_LOGI(TAG, "%-10s %7d/%7d %7d/%7d %8d/%8d %7d %5d %6d\n", name,
+             usage[MEM_BUDGET_INTERNAL].cur, usage[MEM_BUDGET_INTERNAL].peak,
+             usage[MEM_BUDGET_DMA].cur, usage[MEM_BUDGET_DMA].peak,
+             usage[MEM_BUDGET_PSRAM].cur, usage[MEM_BUDGET_PSRAM].peak, allocs, fails, stack);
+}
+
+void mem_budget_print(void)
+{
+    // 统计约2KB, 不放在调用者的栈上
+    mem_budget_stats_t *stats = (mem_budget_stats_t *)heap_caps_malloc(sizeof(mem_budget_stats_t), MALLOC_CAP_DEFAULT);
+    uint32_t stack = 0;
+
+    if (!stats) {
+        ESP_LOGE(TAG, "stats malloc error\n");
+        return;
+    }
+    mem_budget_get_stats(stats);
+    ESP_LOGI(TAG, "%-10s %15s %15s %17s %7s %5s %6s\n", "cur/peak", "internal", "dma", "psram", "allocs", "fails", "stack");
+    for (int x = 0; x < stats->tag_cnt; x++) {
+        print_usage(stats->tag[x].tag, stats->tag[x].usage, stats->tag[x].stack);
+        stack += stats->tag[x].stack;
+    }
+    print_usage("total", stats->total, stack);
+    for (int x = 0; x < MEM_BUDGET_TYPE_NUM; x++) {
+        ESP_LOGI(TAG, "heap %-8s free %7d, min free %7d\n", type_str[x], stats->heap_free[x], stats->heap_min_free[x]);
+    }
+    for (int x = 0; x < stats->task_cnt; x++) {
+        const mem_budget_task_stats_t *task = &stats->task[x];
+        if (!task->tag) {
+            continue;
+        }
+        ESP_LOGI(TAG, "task %-16s %-10s stack %5d, used %5d (%3d%%)%s%s\n", task->name, task->tag, task->stack_size, task->stack_peak,
+                 task->stack_size ? task->stack_peak * 100 / task->stack_size : 0, task->running ? "" : ", exited",
+                 task->stack_peak * 10 > task->stack_size * 9 ? " !" : "");
+    }
+    if (stats->untracked) {
+        ESP_LOGW(TAG, "%d allocations or tasks not tracked, table full\n", stats->untracked);
+    }
+    heap_caps_free(stats);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 流水线: 每个阶段一个任务, 阶段之间用有界队列连接, 例如 采集 -> 解码 -> 显示
+// 每个阶段的输出buffer来自固定个数的buffer池, 运行中不分配内存; 池用完时该阶段等待下游归还, 形成背压
+// 各阶段同时处理不同的帧(显示N, 解码N+1, 采集N+2), 帧率取决于最慢的阶段
+
+#define PIPELINE_MAX_STAGE  (8)
+
+// 阶段函数的返回值
+#define PIPELINE_PASS   0   // out传给下一阶段(最后一个阶段丢弃out), 归还in
+#define PIPELINE_DROP   1   // 丢弃out, 归还in
+#define PIPELINE_HOLD   2   // 同PIPELINE_PASS, 但in由阶段继续持有, 之后调用pipeline_buf_release归还(例如异步传输完成时)
+
+typedef struct pipeline_pool_s pipeline_pool_t;
+
+typedef struct {
+    uint8_t *data;          // buf_size不为0时指向池中分配的内存, 否则由阶段函数设置(例如cam_take得到的帧)
+    size_t size;            // data的大小
+    size_t len;             // 有效数据长度
+    uint16_t width;
+    uint16_t high;
+    uint32_t seq;           // 帧序号, 由第一个阶段分配, 之后的阶段继承
+    int64_t time;           // 第一个阶段开始处理该帧的时间(us), 用于统计延迟
+    void *user;             // 阶段函数自定义
+    pipeline_pool_t *pool;
+    void *holder;           // 返回PIPELINE_HOLD持有该buffer的阶段, 内部使用
+} pipeline_buf_t;
+
+// in: 上一阶段输出的buffer, 第一个阶段为NULL
+// out: 从本阶段的池中取出的buffer, 本阶段没有池时为NULL, 此时返回PIPELINE_PASS把in原样传给下一阶段
+// 返回值:PIPELINE_PASS, PIPELINE_DROP, PIPELINE_HOLD
+typedef int (*pipeline_stage_func_t)(pipeline_buf_t *in, pipeline_buf_t *out, void *arg);
+
+// buffer归还到池时调用, 例如data来自cam_take时调用cam_give
+typedef void (*pipeline_release_cb_t)(pipeline_buf_t *buf, void *arg);
+
+typedef struct {
+    const char *name;
+    pipeline_stage_func_t func;
+    void *arg;
+    uint8_t pool_size;              // 输出buffer个数, 也是到下一阶段的队列深度; 0: 没有输出, 原地处理in
+    size_t buf_size;                // 每个输出buffer的大小, 0: 只分配描述符
+    uint32_t buf_caps;              // 输出buffer的heap_caps, 0: MALLOC_CAP_DEFAULT
+    pipeline_release_cb_t release;
+    void *release_arg;
+    uint32_t task_stack;            // 0: 默认2048
+    uint8_t task_pri;
+} pipeline_stage_t;
+
+typedef struct {
+    uint32_t frames;        // 处理的帧数
+    uint32_t drops;         // 返回PIPELINE_DROP的次数
+    uint64_t busy_us;       // 阶段函数执行时间
+    uint64_t wait_in_us;    // 等待上一阶段的时间(上游慢)
+    uint64_t wait_out_us;   // 等待输出buffer和下一阶段队列的时间(下游慢)
+    uint32_t max_us;        // 阶段函数单次最长执行时间
+    uint64_t hold_us;       // 至少持有一个in的时间: 阶段函数执行中, 或PIPELINE_HOLD之后异步传输未完成
+} pipeline_stage_stats_t;
+
+typedef struct {
+    uint32_t stage_cnt;
+    pipeline_stage_stats_t stage[PIPELINE_MAX_STAGE];
+    uint32_t frames;        // 最后一个阶段完成的帧数
+    uint64_t latency_us;    // 帧从第一个阶段开始到最后一个阶段完成的时间之和
+    uint32_t latency_max_us;
+    int64_t elapsed_us;     // 统计开始以来的时间
+} pipeline_stats_t;
+
+typedef struct pipeline_obj_s *pipeline_handle_t;
+
+// 创建buffer池, 队列和阶段任务并开始运行, stages在运行期间必须保持有效
+// 返回值:0,成功;-1,失败
+int pipeline_create(const pipeline_stage_t *stages, int stage_cnt, pipeline_handle_t *handle);
+
+// 把buffer归还到所属的池, 可以在任意任务中调用(不能在中断中调用)
+void pipeline_buf_release(pipeline_buf_t *buf);
+
+// 读取统计, reset为true时清零并重新开始计时
+void pipeline_get_stats(pipeline_handle_t handle, pipeline_stats_t *stats, bool reset);
+
+// 打印每个阶段的帧率, 平均执行/等待时间, 以及执行或持有时间最长(限制吞吐)的阶段
+void pipeline_print_stats(pipeline_handle_t handle, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "mem_budget.h"
+
+static const char *TAG = "pipeline";
+
+#define PIPELINE_TASK_STACK (2048)
+
+struct pipeline_pool_s {
+    QueueHandle_t free;             // 空闲的buffer
+    pipeline_buf_t *bufs;
+    uint8_t cnt;
+    pipeline_release_cb_t release;
+    void *release_arg;
+};
+
+typedef struct pipeline_obj_s pipeline_obj_t;
+
+typedef struct {
+    const pipeline_stage_t *stage;
+    pipeline_obj_t *pipeline;
+    pipeline_pool_t pool;
+    QueueHandle_t in;               // 上一阶段的输出, 第一个阶段为NULL
+    QueueHandle_t out;              // 到下一阶段, 最后一个阶段为NULL
+    pipeline_stage_stats_t stats;
+    uint32_t hold_cnt;              // 持有的buffer个数
+    int64_t hold_start;
+    uint16_t trace_id;              // 阶段函数的执行区间, arg为帧序号
+} pipeline_stage_obj_t;
+
+struct pipeline_obj_s {
+    uint32_t stage_cnt;
+    pipeline_stage_obj_t stage[PIPELINE_MAX_STAGE];
+    uint32_t seq;
+    uint32_t frames;
+    uint64_t latency_us;
+    uint32_t latency_max_us;
+    int64_t start;
+};
+
+static portMUX_TYPE pipeline_lock = portMUX_INITIALIZER_UNLOCKED; // 保护统计
+
+// 统计持有时间: 从阶段开始处理in到归还(PIPELINE_HOLD时为异步完成), 多个buffer重叠的时间只算一次
+static void pipeline_hold(pipeline_stage_obj_t *obj, pipeline_buf_t *buf, int64_t now)
+{
+    portENTER_CRITICAL(&pipeline_lock);
+    buf->holder = obj;
+    if (obj->hold_cnt++ == 0) {
+        obj->hold_start = now;
+    }
+    portEXIT_CRITICAL(&pipeline_lock);
+}
+
+static void pipeline_unhold(pipeline_buf_t *buf, int64_t now)
+{
+    pipeline_stage_obj_t *obj = (pipeline_stage_obj_t *)buf->holder;
+
+    portENTER_CRITICAL(&pipeline_lock);
+    buf->holder = NULL;
+    if (--obj->hold_cnt == 0) {
+        obj->stats.hold_us += now - obj->hold_start;
+    }
+    portEXIT_CRITICAL(&pipeline_lock);
+}
+
+void pipeline_buf_release(pipeline_buf_t *buf)
+{
+    pipeline_pool_t *pool = buf->pool;
+    if (buf->holder) {
+        pipeline_unhold(buf, esp_timer_get_time());
+    }
+    if (pool->release) {
+        pool->release(buf, pool->release_arg);
+    }
+    // 队列长度等于buffer个数, 不会满
+    xQueueSend(pool->free, (void *)&buf, portMAX_DELAY);
+}
+
+static void pipeline_task(void *arg)
+{
+    pipeline_stage_obj_t *obj = (pipeline_stage_obj_t *)arg;
+    const pipeline_stage_t *stage = obj->stage;
+    pipeline_obj_t *pipeline = obj->pipeline;
+    pipeline_buf_t *in = NULL, *out = NULL, *next = NULL;
+    int64_t t0, t1, t2, t3, t4;
+    int ret;
+
+    while (1) {
+        t0 = esp_timer_get_time();
+        if (obj->in) {
+            xQueueReceive(obj->in, (void *)&in, portMAX_DELAY);
+        }
+        t1 = esp_timer_get_time();
+        out = NULL;
+        if (obj->pool.cnt) {
+            xQueueReceive(obj->pool.free, (void *)&out, portMAX_DELAY);
+            out->len = 0;
+            out->user = NULL;
+            if (in) {
+                out->width = in->width;
+                out->high = in->high;
+                out->seq = in->seq;
+                out->time = in->time;
+            } else {
+                out->width = 0;
+                out->high = 0;
+                out->seq = pipeline->seq++;
+            }
+        }
+        t2 = esp_timer_get_time();
+        if (out && !in) {
+            out->time = t2;
+        }
+        // 调用前标记持有, 异步传输可能在阶段函数返回之前就归还了in
+        if (in) {
+            pipeline_hold(obj, in, t2);
+        }
+        TRACE_BEGIN(obj->trace_id, in ? in->seq : out ? out->seq : 0);
+        ret = stage->func(in, out, stage->arg);
+        TRACE_END(obj->trace_id, in ? in->seq : out ? out->seq : 0);
+        t3 = esp_timer_get_time();
+        if (in && ret != PIPELINE_HOLD) {
+            pipeline_unhold(in, t3);
+        }
+
+        // 有池时传出out, 否则原样传出in
+        next = obj->pool.cnt ? out : in;
+        if (ret == PIPELINE_DROP) {
+            if (out) {
+                pipeline_buf_release(out);
+            }
+            next = NULL;
+        }
+        if (next && obj->out) {
+            xQueueSend(obj->out, (void *)&next, portMAX_DELAY);
+        }
+        t4 = esp_timer_get_time();
+        if (next && !obj->out) {
+            // 最后一个阶段: 异步完成(PIPELINE_HOLD)的帧按提交的时间统计
+            uint32_t latency = t3 - next->time;
+            portENTER_CRITICAL(&pipeline_lock);
+            pipeline->frames++;
+            pipeline->latency_us += latency;
+            if (latency > pipeline->latency_max_us) {
+                pipeline->latency_max_us = latency;
+            }
+            portEXIT_CRITICAL(&pipeline_lock);
+            if (out) {
+                pipeline_buf_release(out);
+            }
+        }
+        if (in && ret != PIPELINE_HOLD && !(next == in && obj->out)) {
+            pipeline_buf_release(in);
+        }
+
+        portENTER_CRITICAL(&pipeline_lock);
+        obj->stats.frames++;
+        obj->stats.drops += ret == PIPELINE_DROP;
+        obj->stats.busy_us += t3 - t2;
+        obj->stats.wait_in_us += t1 - t0;
+        obj->stats.wait_out_us += (t2 - t1) + (t4 - t3);
+        if (t3 - t2 > obj->stats.max_us) {
+            obj->stats.max_us = t3 - t2;
+        }
+        portEXIT_CRITICAL(&pipeline_lock);
+    }
+}
+
+static void pipeline_free(pipeline_obj_t *pipeline)
+{
+    for (int x = 0; x < pipeline->stage_cnt; x++) {
+        pipeline_stage_obj_t *obj = &pipeline->stage[x];
+        if (obj->pool.bufs) {
+            for (int i = 0; i < obj->pool.cnt; i++) {
+                if (obj->stage->buf_size) {
+                    MEM_FREE(obj->pool.bufs[i].data);
+                }
+            }
+            MEM_FREE(obj->pool.bufs);
+        }
+        if (obj->pool.free) {
+            vQueueDelete(obj->pool.free);
+        }
+        if (obj->out) {
+            vQueueDelete(obj->out);
+        }
+    }
+    MEM_FREE(pipeline);
+}
+
+// 分配第x个阶段的buffer池和到下一阶段的队列
+static int pipeline_stage_init(pipeline_obj_t *pipeline, int x, uint8_t depth)
+{
+    pipeline_stage_obj_t *obj = &pipeline->stage[x];
+    const pipeline_stage_t *stage = obj->stage;
+    pipeline_pool_t *pool = &obj->pool;
+
+    obj->pipeline = pipeline;
+    obj->trace_id = TRACE_REGISTER(stage->name);
+    pool->release = stage->release;
+    pool->release_arg = stage->release_arg;
+    if (stage->pool_size) {
+        pool->free = xQueueCreate(stage->pool_size, sizeof(pipeline_buf_t *));
+        pool->bufs = (pipeline_buf_t *)MEM_CALLOC("pipeline", stage->pool_size, sizeof(pipeline_buf_t), MALLOC_CAP_DEFAULT);
+        if (!pool->free || !pool->bufs) {
+            return -1;
+        }
+        for (int i = 0; i < stage->pool_size; i++) {
+            pipeline_buf_t *buf = &pool->bufs[i];
+            buf->pool = pool;
+            if (stage->buf_size) {
+                buf->data = (uint8_t *)MEM_MALLOC("pipeline", stage->buf_size, stage->buf_caps ? stage->buf_caps : MALLOC_CAP_DEFAULT);
+                if (!buf->data) {
+                    return -1;
+                }
+                buf->size = stage->buf_size;
+            }
+            pool->cnt++;
+            xQueueSend(pool->free, (void *)&buf, 0);
+        }
+    }
+    if (x + 1 < pipeline->stage_cnt) {
+        obj->out = xQueueCreate(depth, sizeof(pipeline_buf_t *));
+        if (!obj->out) {
+            return -1;
+        }
+        pipeline->stage[x + 1].in = obj->out;
+    }
+    return 0;
+}
+
+int pipeline_create(const pipeline_stage_t *stages, int stage_cnt, pipeline_handle_t *handle)
+{
+    pipeline_obj_t *pipeline = NULL;
+    uint8_t depth = 0;
+
+    if (stage_cnt <= 0 || stage_cnt > PIPELINE_MAX_STAGE || (stage_cnt > 1 && stages[0].pool_size == 0)) {
+        ESP_LOGE(TAG, "stage count %d or first stage pool invalid\n", stage_cnt);
+        return -1;
+    }
+    for (int x = 0; x < stage_cnt; x++) {
+        if (stages[x].func == NULL) {
+            ESP_LOGE(TAG, "stage %d (%s) invalid\n", x, stages[x].name);
+            return -1;
+        }
+    }
+    pipeline = (pipeline_obj_t *)MEM_CALLOC("pipeline", 1, sizeof(pipeline_obj_t), MALLOC_CAP_DEFAULT);
+    if (!pipeline) {
+        ESP_LOGE(TAG, "pipeline malloc error\n");
+        return -1;
+    }
+    pipeline->stage_cnt = stage_cnt;
+    for (int x = 0; x < stage_cnt; x++) {
+        pipeline->stage[x].stage = &stages[x];
+    }
+    for (int x = 0; x < stage_cnt; x++) {
+        // 原地处理的阶段传出的是上游的buffer, 队列深度与上游相同
+        depth = stages[x].pool_size ? stages[x].pool_size : depth;
+        if (pipeline_stage_init(pipeline, x, depth) != 0) {
+            ESP_LOGE(TAG, "stage %s malloc error\n", stages[x].name);
+            pipeline_free(pipeline);
+            return -1;
+        }
+    }
+
+    pipeline->start = esp_timer_get_time();
+    for (int x = 0; x < stage_cnt; x++) {
+        if (MEM_TASK_CREATE("pipeline", pipeline_task, stages[x].name, stages[x].task_stack ? stages[x].task_stack : PIPELINE_TASK_STACK,
+                        &pipeline->stage[x], stages[x].task_pri, NULL) != pdPASS) {
+            // 已经创建的任务仍在运行, 不能释放
+            ESP_LOGE(TAG, "stage %s task create error\n", stages[x].name);
+            return -1;
+        }
+    }
+    *handle = pipeline;
+    return 0;
+}
+
+void pipeline_get_stats(pipeline_handle_t handle, pipeline_stats_t *stats, bool reset)
+{
+    pipeline_obj_t *pipeline = handle;
+    int64_t now = esp_timer_get_time();
+
+    memset(stats, 0, sizeof(pipeline_stats_t));
+    portENTER_CRITICAL(&pipeline_lock);
+    stats->stage_cnt = pipeline->stage_cnt;
+    for (int x = 0; x < pipeline->stage_cnt; x++) {
+        pipeline_stage_obj_t *obj = &pipeline->stage[x];
+        stats->stage[x] = obj->stats;
+        if (obj->hold_cnt) {
+            stats->stage[x].hold_us += now - obj->hold_start;
+        }
+        if (reset) {
+            memset(&obj->stats, 0, sizeof(pipeline_stage_stats_t));
+            obj->hold_start = now;
+        }
+    }
+    stats->frames = pipeline->frames;
+    stats->latency_us = pipeline->latency_us;
+    stats->latency_max_us = pipeline->latency_max_us;
+    stats->elapsed_us = now - pipeline->start;
+    if (reset) {
+        pipeline->frames = 0;
+        pipeline->latency_us = 0;
+        pipeline->latency_max_us = 0;
+        pipeline->start = now;
+    }
+    portEXIT_CRITICAL(&pipeline_lock);
+}
+
+void pipeline_print_stats(pipeline_handle_t handle, bool reset)
+{
+    pipeline_obj_t *pipeline = handle;
+    pipeline_stats_t stats;
+    int bottleneck = 0;
+    uint64_t busy_max = 0, busy = 0;
+
+    pipeline_get_stats(handle, &stats, reset);
+    if (stats.elapsed_us <= 0) {
+        return;
+    }
+    for (int x = 0; x < stats.stage_cnt; x++) {
+        pipeline_stage_stats_t *s = &stats.stage[x];
+        uint32_t n = s->frames ? s->frames : 1;
+        // 执行(或异步传输占用)时间占比最高的阶段限制了吞吐
+        busy = s->busy_us > s->hold_us ? s->busy_us : s->hold_us;
+        if (busy >= busy_max) {
+            busy_max = busy;
+            bottleneck = x;
+        }
+        ESP_LOGI(TAG, "%-8s %3d.%02d fps, busy %6d us (%3d%%), hold %3d%%, wait in %6d us, wait out %6d us, max %6d us, drops %d\n",
+                 pipeline->stage[x].stage->name, (int)(s->frames * 100000000ULL / stats.elapsed_us / 100), (int)(s->frames * 100000000ULL / stats.elapsed_us % 100),
+                 (int)(s->busy_us / n), (int)(s->busy_us * 100 / stats.elapsed_us), (int)(s->hold_us * 100 / stats.elapsed_us),
+                 (int)(s->wait_in_us / n), (int)(s->wait_out_us / n), s->max_us, s->drops);
+    }
+    ESP_LOGI(TAG, "output %d frames, latency avg %d us, max %d us, bottleneck: %s\n", stats.frames,
+             (int)(stats.frames ? stats.latency_us / stats.frames : 0), stats.latency_max_us, pipeline->stage[bottleneck].stage->name);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 并行初始化: 每个阶段在独立的任务中执行, 依赖的阶段全部成功后才开始
+// 没有依赖关系的阶段(例如LCD和摄像头)同时进行, 总时间取决于最长的依赖链
+
+#define STARTUP_MAX_STAGE   (12)
+#define STARTUP_DEP(n)      (1UL << (n)) // 依赖stages[n]
+
+typedef int (*startup_func_t)(void *arg); // 返回值:0,成功;其他,失败
+
+typedef struct {
+    const char *name;
+    startup_func_t func;
+    void *arg;
+    uint32_t depends;       // STARTUP_DEP(n)的组合, 只能依赖前面的阶段
+    uint32_t task_stack;    // 0: 默认2048
+    uint8_t task_pri;
+} startup_stage_t;
+
+// 执行所有阶段并等待结束, 结束后打印每个阶段的开始时间, 结束时间和耗时
+// 依赖失败的阶段不执行, 同样视为失败
+// 每个阶段任务结束时向调用者发送任务通知(xTaskNotifyGive), 调用者在startup_run期间不能使用任务通知;
+// 超时时仍在运行的阶段之后会通知调用者, 其对象和事件组不释放
+// 返回值:0,全部成功;-1,参数错误, 有阶段失败或超时
+int startup_run(const startup_stage_t *stages, int stage_cnt, TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "startup.h"
+#include "mem_budget.h"
+
+static const char *TAG = "startup";
+
+#define STARTUP_TASK_STACK  (2048)
+#define STARTUP_FAIL_SHIFT  (STARTUP_MAX_STAGE) // 事件组低12位: 阶段结束, 高12位: 阶段失败
+
+typedef enum {
+    STARTUP_STATE_WAIT = 0,
+    STARTUP_STATE_OK,
+    STARTUP_STATE_FAIL,
+    STARTUP_STATE_SKIP,
+} startup_state_t;
+
+typedef struct {
+    const startup_stage_t *stage;
+    uint32_t index;
+    EventGroupHandle_t event_group;
+    TaskHandle_t waiter;    // 调用startup_run的任务
+    int64_t base;           // startup_run开始的时间
+    int64_t wait_end;       // 依赖满足的时间
+    int64_t end;
+    volatile startup_state_t state;
+} startup_obj_t;
+
+static void startup_task(void *arg)
+{
+    startup_obj_t *obj = (startup_obj_t *)arg;
+    const startup_stage_t *stage = obj->stage;
+    EventBits_t bits = 0;
+    // 失败的阶段同时置位结束和失败, 等待所有依赖结束即可
+    if (stage->depends) {
+        bits = xEventGroupWaitBits(obj->event_group, stage->depends, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    obj->wait_end = esp_timer_get_time();
+    if (bits & (stage->depends << STARTUP_FAIL_SHIFT)) {
+        obj->state = STARTUP_STATE_SKIP;
+    } else {
+        obj->state = stage->func(stage->arg) == 0 ? STARTUP_STATE_OK : STARTUP_STATE_FAIL;
+    }
+    obj->end = esp_timer_get_time();
+    // xEventGroupSetBits返回前还会访问事件组, 之后才能通知startup_run释放; 通知之后不再访问obj和事件组
+    TaskHandle_t waiter = obj->waiter;
+    bits = 1UL << obj->index;
+    if (obj->state != STARTUP_STATE_OK) {
+        bits |= 1UL << (obj->index + STARTUP_FAIL_SHIFT);
+    }
+    xEventGroupSetBits(obj->event_group, bits);
+    xTaskNotifyGive(waiter);
+    MEM_TASK_DELETE();
+}
+
+int startup_run(const startup_stage_t *stages, int stage_cnt, TickType_t ticks_to_wait)
+{
+    static const char *state_str[] = {"timeout", "ok", "failed", "skipped"};
+    EventGroupHandle_t event_group = NULL;
+    startup_obj_t *obj = NULL;
+    EventBits_t all = 0, bits = 0;
+    int64_t base = 0, end = 0;
+    int ret = 0, created = 0;
+
+    if (stage_cnt <= 0 || stage_cnt > STARTUP_MAX_STAGE) {
+        ESP_LOGE(TAG, "stage count %d out of range\n", stage_cnt);
+        return -1;
+    }
+    for (int x = 0; x < stage_cnt; x++) {
+        // 只允许依赖前面的阶段, 保证没有环
+        if (stages[x].func == NULL || (stages[x].depends & ~(STARTUP_DEP(x) - 1))) {
+            ESP_LOGE(TAG, "stage %d (%s) invalid\n", x, stages[x].name);
+            return -1;
+        }
+    }
+    event_group = xEventGroupCreate();
+    obj = (startup_obj_t *)MEM_CALLOC("startup", stage_cnt, sizeof(startup_obj_t), MALLOC_CAP_DEFAULT);
+    if (!event_group || !obj) {
+        ESP_LOGE(TAG, "startup malloc error\n");
+        if (event_group) {
+            vEventGroupDelete(event_group);
+        }
+        MEM_FREE(obj);
+        return -1;
+    }
+
+    base = esp_timer_get_time();
+    for (int x = 0; x < stage_cnt; x++) {
+        obj[x].stage = &stages[x];
+        obj[x].index = x;
+        obj[x].event_group = event_group;
+        obj[x].waiter = xTaskGetCurrentTaskHandle();
+        obj[x].base = base;
+        all |= 1UL << x;
+        if (MEM_TASK_CREATE("startup", startup_task, stages[x].name, stages[x].task_stack ? stages[x].task_stack : STARTUP_TASK_STACK, &obj[x], stages[x].task_pri, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "stage %s task create error\n", stages[x].name);
+            obj[x].state = STARTUP_STATE_FAIL;
+            xEventGroupSetBits(event_group, (1UL << x) | (1UL << (x + STARTUP_FAIL_SHIFT)));
+        } else {
+            created++;
+        }
+    }
+    bits = xEventGroupWaitBits(event_group, all, pdFALSE, pdTRUE, ticks_to_wait);
+    end = esp_timer_get_time();
+
+    for (int x = 0; x < stage_cnt; x++) {
+        if (obj[x].state == STARTUP_STATE_WAIT) {
+            ESP_LOGE(TAG, "%-8s %s\n", stages[x].name, state_str[obj[x].state]);
+        } else {
+            ESP_LOGI(TAG, "%-8s %-7s start: %4lld ms, end: %4lld ms, run: %4lld ms\n", stages[x].name, state_str[obj[x].state],
+                     (obj[x].wait_end - base) / 1000, (obj[x].end - base) / 1000, (obj[x].end - obj[x].wait_end) / 1000);
+        }
+        if (obj[x].state != STARTUP_STATE_OK) {
+            ret = -1;
+        }
+    }
+    ESP_LOGI(TAG, "total: %lld ms\n", (end - base) / 1000);
+
+    if ((bits & all) != all) {
+        // 超时的阶段仍在运行, 之后还会访问其对象和事件组, 有意不释放
+        ESP_LOGE(TAG, "timeout, %d bytes and the event group left allocated for running stages\n", (int)(stage_cnt * sizeof(startup_obj_t)));
+        return -1;
+    }
+    // 所有阶段都已结束, 还要等每个任务离开xEventGroupSetBits(以通知表示)才能删除事件组和对象
+    for (int x = 0; x < created; x++) {
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    }
+    vEventGroupDelete(event_group);
+    MEM_FREE(obj);
+    return ret;
+}
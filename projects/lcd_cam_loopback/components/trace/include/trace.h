@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 时间线追踪: 中断和任务中记录带时间戳的固定长度事件, 写入RAM中的环形缓冲, 满了覆盖最旧的事件
+// 写入不加锁: 原子递增取得槽位, 写完后设置事件序号, 读取时按序号丢弃未写完或已被覆盖的事件
+// trace_dump输出文本, 由host/trace2chrome转换为Chrome trace JSON(chrome://tracing, Perfetto)
+//
+// TRACE_ENABLE为0时所有TRACE_宏为空, 不产生任何代码, 参数也不求值
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE        (0)
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE     (512) // 事件个数, 必须是2的幂, 每个事件16字节
+#endif
+
+#define TRACE_MAX_NAME      (32)
+#define TRACE_SEQ_BUSY      (0xFFFFFFFF)
+
+// 事件类型
+#define TRACE_TYPE_BEGIN    'B' // 区间开始, 与同一id的TRACE_TYPE_END配对
+#define TRACE_TYPE_END      'E'
+#define TRACE_TYPE_INSTANT  'I'
+#define TRACE_TYPE_COUNTER  'C' // arg为计数值
+
+// 组件使用的固定事件id, trace_register分配的id从TRACE_ID_USER开始
+typedef enum {
+    TRACE_ID_NONE = 0,
+    TRACE_ID_CAM_VSYNC,     // cam_vsync_isr, 帧开始
+    TRACE_ID_CAM_DMA,       // cam_isr, DMA完成半个乒乓buffer
+    TRACE_ID_CAM_FRAME,     // cam_task把一帧放入队列, arg: 长度
+    TRACE_ID_CAM_TAKE,      // cam_take等待帧的区间, arg: 长度
+    TRACE_ID_CAM_GIVE,      // cam_give
+    TRACE_ID_LCD_EOF,       // lcd_isr, 一段DMA发送完成, arg: 段号
+    TRACE_ID_LCD_TRANS,     // lcd_task执行一次传输的区间, arg: 数据长度
+    TRACE_ID_USER,
+} trace_id_t;
+
+typedef struct {
+    uint32_t seq;           // 写完后为事件序号+1, 0: 空, TRACE_SEQ_BUSY: 正在写入
+    uint32_t time;          // esp_timer_get_time()的低32位(us)
+    uint16_t id;
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t arg;
+} trace_event_t;
+
+#if TRACE_ENABLE
+#define TRACE_BEGIN(id, arg)    trace_record((id), TRACE_TYPE_BEGIN, (arg))
+#define TRACE_END(id, arg)      trace_record((id), TRACE_TYPE_END, (arg))
+#define TRACE_INSTANT(id, arg)  trace_record((id), TRACE_TYPE_INSTANT, (arg))
+#define TRACE_COUNTER(id, val)  trace_record((id), TRACE_TYPE_COUNTER, (val))
+#define TRACE_REGISTER(name)    trace_register(name)
+#else
+#define TRACE_BEGIN(id, arg)    do {} while (0)
+#define TRACE_END(id, arg)      do {} while (0)
+#define TRACE_INSTANT(id, arg)  do {} while (0)
+#define TRACE_COUNTER(id, val)  do {} while (0)
+#define TRACE_REGISTER(name)    (TRACE_ID_NONE)
+#endif
+
+// 记录一个事件, 可以在中断中调用
+void trace_record(uint16_t id, uint8_t type, uint32_t arg);
+
+// 为名字分配事件id, 同名返回同一个id, 不能在中断中调用
+// 返回值:事件id;TRACE_ID_NONE,名字表已满
+uint16_t trace_register(const char *name);
+
+// 暂停/恢复记录, 例如出现异常帧后暂停, 保留之前的事件
+void trace_enable(bool en);
+
+// 按时间顺序复制环形缓冲中完整的事件, 可以在记录的同时调用
+// lost: 没有复制的旧事件个数(已被覆盖或超过max), 可以为NULL
+// 返回值:复制的事件个数
+int trace_read(trace_event_t *events, int max, uint32_t *lost);
+
+// 以文本输出名字表和所有事件, 每行以"trace: "开头, 可以直接从串口日志中提取
+void trace_dump(FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "trace.h"
+
+#if (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) != 0
+#error "TRACE_RING_SIZE must be a power of 2"
+#endif
+
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+// 中断中也会写入, 在内部RAM的.bss中(不要放到PSRAM)
+static trace_event_t trace_ring[TRACE_RING_SIZE];
+static volatile uint32_t trace_head = 0; // 下一个事件的序号
+static volatile uint8_t trace_on = 1;
+
+static const char *trace_names[TRACE_MAX_NAME] = {
+    [TRACE_ID_NONE]      = "none",
+    [TRACE_ID_CAM_VSYNC] = "cam_vsync",
+    [TRACE_ID_CAM_DMA]   = "cam_dma",
+    [TRACE_ID_CAM_FRAME] = "cam_frame",
+    [TRACE_ID_CAM_TAKE]  = "cam_take",
+    [TRACE_ID_CAM_GIVE]  = "cam_give",
+    [TRACE_ID_LCD_EOF]   = "lcd_eof",
+    [TRACE_ID_LCD_TRANS] = "lcd_trans",
+};
+static uint16_t trace_name_cnt = TRACE_ID_USER;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED; // 保护名字表
+
+void IRAM_ATTR trace_record(uint16_t id, uint8_t type, uint32_t arg)
+{
+    if (!trace_on) {
+        return;
+    }
+    uint32_t time = (uint32_t)esp_timer_get_time();
+    uint32_t seq = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    volatile trace_event_t *event = &trace_ring[seq & TRACE_RING_MASK];
+    // 先把槽位标记为正在写入, 读取方看到的序号不符时丢弃该事件
+    // 写入方被打断一整圈时, 同一槽位可能有两个写入方, 后到的一方放弃本次事件, 不会写出混合的内容
+    uint32_t old = __atomic_load_n(&event->seq, __ATOMIC_RELAXED);
+    if (old == TRACE_SEQ_BUSY || !__atomic_compare_exchange_n(&event->seq, &old, TRACE_SEQ_BUSY, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    event->time = time;
+    event->id = id;
+    event->type = type;
+    event->arg = arg;
+    __atomic_store_n(&event->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+// 读取序号为seq的事件, 未写完或读取期间被覆盖时返回false
+static bool trace_slot_read(uint32_t seq, trace_event_t *out)
+{
+    volatile trace_event_t *event = &trace_ring[seq & TRACE_RING_MASK];
+    if (__atomic_load_n(&event->seq, __ATOMIC_ACQUIRE) != seq + 1) {
+        return false;
+    }
+    out->seq = seq + 1;
+    out->time = event->time;
+    out->id = event->id;
+    out->type = event->type;
+    out->reserved = 0;
+    out->arg = event->arg;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&event->seq, __ATOMIC_RELAXED) == seq + 1;
+}
+
+uint16_t trace_register(const char *name)
+{
+    uint16_t id = TRACE_ID_NONE;
+    portENTER_CRITICAL(&trace_lock);
+    for (int x = TRACE_ID_NONE + 1; x < trace_name_cnt; x++) {
+        if (!strcmp(trace_names[x], name)) {
+            id = x;
+            break;
+        }
+    }
+    if (id == TRACE_ID_NONE && trace_name_cnt < TRACE_MAX_NAME) {
+        id = trace_name_cnt++;
+        trace_names[id] = name;
+    }
+    portEXIT_CRITICAL(&trace_lock);
+    return id;
+}
+
+void trace_enable(bool en)
+{
+    trace_on = en;
+}
+
+int trace_read(trace_event_t *events, int max, uint32_t *lost)
+{
+    uint32_t head = trace_head;
+    uint32_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    int cnt = 0;
+
+    // 最新的max个事件
+    if (head - start > (uint32_t)max) {
+        start = head - max;
+    }
+    for (uint32_t seq = start; seq != head; seq++) {
+        if (trace_slot_read(seq, &events[cnt])) {
+            cnt++;
+        }
+    }
+    if (lost) {
+        *lost = head - cnt;
+    }
+    return cnt;
+}
+
+void trace_dump(FILE *fp)
+{
+    uint32_t head = trace_head;
+    uint32_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    uint32_t cnt = 0;
+    trace_event_t event;
+
+    fprintf(fp, "trace: begin %u\n", (uint32_t)esp_timer_get_time());
+    for (int x = TRACE_ID_NONE + 1; x < trace_name_cnt; x++) {
+        fprintf(fp, "trace: name %d %s\n", x, trace_names[x]);
+    }
+    for (uint32_t seq = start; seq != head; seq++) {
+        if (trace_slot_read(seq, &event)) {
+            fprintf(fp, "trace: ev %u %u %c %u\n", event.time, event.id, event.type, event.arg);
+            cnt++;
+        }
+    }
+    // 事件个数, 被覆盖(或输出期间被覆盖)的事件个数
+    fprintf(fp, "trace: end %u %u\n", cnt, head - cnt);
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "cam.h"
+#include "cam_replay.h"
+
+static const char *TAG = "cam_replay";
+
+#define REPLAY_BUF_CNT  (2) // 同cam.c的frame1_buffer/frame2_buffer
+#define REPLAY_MAX_LEN  (16 * 1024 * 1024) // 超过时认为帧头损坏
+
+typedef struct {
+    cam_rec_frame_t frame;
+    uint8_t *data;
+} replay_frame_t;
+
+typedef struct {
+    uint8_t *buffer;
+    size_t len;
+} replay_event_t;
+
+typedef struct {
+    cam_replay_config_t config;
+    replay_frame_t *frames;
+    uint8_t *buffer[REPLAY_BUF_CNT];
+    uint8_t buffer_en[REPLAY_BUF_CNT];          // 1: 空闲, 同cam.c的frame_buffer_en
+    cam_rec_frame_t buffer_frame[REPLAY_BUF_CNT]; // 帧buffer中当前帧的录制信息
+    SemaphoreHandle_t free;                     // 空闲帧buffer个数
+    QueueHandle_t queue;                        // 等待cam_take的帧
+    SemaphoreHandle_t exit;
+    volatile int stop;
+    cam_replay_stats_t stats;
+} replay_obj_t;
+
+static replay_obj_t *replay_obj = NULL;
+static portMUX_TYPE replay_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void replay_task(void *arg)
+{
+    replay_obj_t *obj = (replay_obj_t *)arg;
+    uint32_t loops = obj->config.loops ? obj->config.loops : 1;
+    replay_event_t event = {0};
+
+    for (uint32_t loop = 0; loop < loops && !obj->stop; loop++) {
+        int64_t base = esp_timer_get_time();
+        for (uint32_t x = 0; x < obj->stats.frames && !obj->stop; x++) {
+            replay_frame_t *f = &obj->frames[x];
+            if (obj->config.realtime) {
+                int64_t delay = base + (f->frame.time - obj->frames[0].frame.time) - esp_timer_get_time();
+                if (delay > 0) {
+                    usleep(delay);
+                }
+                if (xSemaphoreTake(obj->free, 0) != pdTRUE) {
+                    obj->stats.dropped++;
+                    continue;
+                }
+            } else {
+                xSemaphoreTake(obj->free, portMAX_DELAY);
+            }
+            if (obj->stop) {
+                xSemaphoreGive(obj->free);
+                break;
+            }
+            int index = 0;
+            portENTER_CRITICAL(&replay_lock);
+            while (!obj->buffer_en[index]) {
+                index++;
+            }
+            obj->buffer_en[index] = 0;
+            obj->buffer_frame[index] = f->frame;
+            obj->stats.delivered++;
+            portEXIT_CRITICAL(&replay_lock);
+            memcpy(obj->buffer[index], f->data, f->frame.len);
+            event.buffer = obj->buffer[index];
+            event.len = f->frame.len;
+            xQueueSend(obj->queue, (void *)&event, portMAX_DELAY);
+        }
+    }
+    obj->stats.done = 1;
+    event.buffer = NULL;
+    event.len = 0;
+    xQueueSend(obj->queue, (void *)&event, portMAX_DELAY);
+    xSemaphoreGive(obj->exit);
+    vTaskDelete(NULL);
+}
+
+static void replay_free(replay_obj_t *obj)
+{
+    for (uint32_t x = 0; obj->frames && x < obj->stats.frames; x++) {
+        free(obj->frames[x].data);
+    }
+    free(obj->frames);
+    for (int x = 0; x < REPLAY_BUF_CNT; x++) {
+        heap_caps_free(obj->buffer[x]);
+    }
+    if (obj->free) {
+        vSemaphoreDelete(obj->free);
+    }
+    if (obj->queue) {
+        vQueueDelete(obj->queue);
+    }
+    if (obj->exit) {
+        vSemaphoreDelete(obj->exit);
+    }
+    free(obj);
+}
+
+// 读入全部帧; 末尾不完整或损坏的帧忽略(录制没有正常结束时最后一帧可能不完整)
+static int replay_load(replay_obj_t *obj, FILE *fp)
+{
+    cam_rec_header_t header;
+    cam_rec_frame_t frame;
+    uint32_t cap = 0;
+    long pos;
+    int ret;
+
+    if (cam_rec_read_header(fp, &header) != 0) {
+        ESP_LOGE(TAG, "%s: not a recording\n", obj->config.path);
+        return -1;
+    }
+    // 先读帧头得到长度, 再回到数据开始处读入并检查CRC
+    while (1) {
+        pos = ftell(fp);
+        if (fread(&frame, sizeof(cam_rec_frame_t), 1, fp) != 1) {
+            obj->stats.truncated = !feof(fp) || ftell(fp) != pos;
+            break;
+        }
+        if (frame.magic != CAM_REC_FRAME_MAGIC || frame.len > REPLAY_MAX_LEN) {
+            obj->stats.truncated = 1;
+            break;
+        }
+        uint8_t *data = (uint8_t *)malloc(frame.len ? frame.len : 1);
+        fseek(fp, pos, SEEK_SET);
+        ret = cam_rec_read_frame(fp, &frame, data, frame.len);
+        if (ret != 1) {
+            free(data);
+            obj->stats.truncated = ret < 0;
+            break;
+        }
+        if (obj->stats.frames == cap) {
+            cap = cap ? cap * 2 : 64;
+            obj->frames = (replay_frame_t *)realloc(obj->frames, cap * sizeof(replay_frame_t));
+        }
+        obj->frames[obj->stats.frames].frame = frame;
+        obj->frames[obj->stats.frames].data = data;
+        obj->stats.frames++;
+        obj->stats.max_len = frame.len > obj->stats.max_len ? frame.len : obj->stats.max_len;
+        if ((uint32_t)frame.width * frame.high > obj->stats.max_pixels) {
+            obj->stats.max_pixels = (uint32_t)frame.width * frame.high;
+        }
+    }
+    if (obj->stats.truncated) {
+        ESP_LOGW(TAG, "%s: incomplete frame after %d frames ignored\n", obj->config.path, obj->stats.frames);
+    }
+    if (header.frame_cnt != CAM_REC_FRAME_CNT_NONE && header.frame_cnt != obj->stats.frames) {
+        ESP_LOGW(TAG, "%s: header says %d frames, read %d\n", obj->config.path, header.frame_cnt, obj->stats.frames);
+    }
+    if (obj->stats.frames == 0) {
+        ESP_LOGE(TAG, "%s: no frames\n", obj->config.path);
+        return -1;
+    }
+    obj->stats.span_us = obj->frames[obj->stats.frames - 1].frame.time - obj->frames[0].frame.time;
+    return 0;
+}
+
+int cam_replay_init(const cam_replay_config_t *config)
+{
+    replay_obj_t *obj = NULL;
+    FILE *fp = NULL;
+
+    if (replay_obj || !config->path) {
+        return -1;
+    }
+    fp = fopen(config->path, "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "%s: open error\n", config->path);
+        return -1;
+    }
+    obj = (replay_obj_t *)calloc(1, sizeof(replay_obj_t));
+    obj->config = *config;
+    if (replay_load(obj, fp) != 0) {
+        fclose(fp);
+        replay_free(obj);
+        return -1;
+    }
+    fclose(fp);
+    // 帧buffer在PSRAM中, 同main.c给cam.c的frame1_buffer/frame2_buffer
+    for (int x = 0; x < REPLAY_BUF_CNT; x++) {
+        obj->buffer[x] = (uint8_t *)heap_caps_malloc(obj->stats.max_len, MALLOC_CAP_SPIRAM);
+        obj->buffer_en[x] = 1;
+    }
+    obj->free = xSemaphoreCreateCounting(REPLAY_BUF_CNT, REPLAY_BUF_CNT);
+    obj->queue = xQueueCreate(REPLAY_BUF_CNT + 1, sizeof(replay_event_t));
+    obj->exit = xSemaphoreCreateBinary();
+    if (!obj->buffer[0] || !obj->buffer[1]) {
+        ESP_LOGE(TAG, "frame buffer malloc error\n");
+        replay_free(obj);
+        return -1;
+    }
+    replay_obj = obj;
+    xTaskCreate(replay_task, "cam_replay", 2048, obj, config->task_pri, NULL);
+    return 0;
+}
+
+void cam_replay_deinit(void)
+{
+    replay_obj_t *obj = replay_obj;
+    replay_event_t event;
+
+    if (!obj) {
+        return;
+    }
+    // 取出队列中的帧并归还, 使等待空闲buffer的回放任务看到stop
+    obj->stop = 1;
+    while (xSemaphoreTake(obj->exit, 1) != pdTRUE) {
+        while (xQueueReceive(obj->queue, (void *)&event, 0) == pdTRUE) {
+            if (event.buffer) {
+                cam_give(event.buffer);
+            }
+        }
+    }
+    replay_obj = NULL;
+    replay_free(obj);
+}
+
+const cam_rec_frame_t *cam_replay_frame(const uint8_t *buffer)
+{
+    for (int x = 0; replay_obj && x < REPLAY_BUF_CNT; x++) {
+        if (buffer == replay_obj->buffer[x]) {
+            return &replay_obj->buffer_frame[x];
+        }
+    }
+    return NULL;
+}
+
+void cam_replay_get_stats(cam_replay_stats_t *stats)
+{
+    memset(stats, 0, sizeof(cam_replay_stats_t));
+    if (replay_obj) {
+        portENTER_CRITICAL(&replay_lock);
+        *stats = replay_obj->stats;
+        portEXIT_CRITICAL(&replay_lock);
+    }
+}
+
+size_t cam_take(uint8_t **buffer_p)
+{
+    replay_event_t event;
+
+    xQueueReceive(replay_obj->queue, (void *)&event, portMAX_DELAY);
+    if (event.buffer == NULL) {
+        // 播放结束, 放回去使之后的cam_take也立即返回
+        xQueueSend(replay_obj->queue, (void *)&event, portMAX_DELAY);
+    }
+    *buffer_p = event.buffer;
+    return event.len;
+}
+
+int cam_give(uint8_t *buffer)
+{
+    int given = 0, known = 0;
+
+    // 阶段丢弃帧时可能归还NULL
+    if (!buffer || !replay_obj) {
+        return 0;
+    }
+    portENTER_CRITICAL(&replay_lock);
+    for (int x = 0; x < REPLAY_BUF_CNT; x++) {
+        if (buffer == replay_obj->buffer[x]) {
+            known = 1;
+            if (!replay_obj->buffer_en[x]) {
+                replay_obj->buffer_en[x] = 1;
+                given = 1;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&replay_lock);
+    if (given) {
+        xSemaphoreGive(replay_obj->free);
+    }
+    if (!known) {
+        ESP_LOGW(TAG, "cam_give: %p is not a replay frame buffer\n", buffer);
+        return -1;
+    }
+    return 0;
+}
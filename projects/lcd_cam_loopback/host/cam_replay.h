@@ -0,0 +1,49 @@
+#pragma once
+
+// 回放cam_rec录制的文件: 在主机上代替cam.c, 按cam.h的cam_take/cam_give提供帧,
+// 使用cam_take/cam_give的代码(例如main.c的流水线阶段)不做修改就可以在主机上用录制的画面运行
+// 同一个文件每次得到完全相同的帧序列; 与cam.c相同只有两个帧buffer, 都被取走时等待cam_give
+// 与cam.c不同: 播放结束后cam_take返回0, *buffer_p为NULL
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cam_rec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *path;
+    uint8_t realtime;       // 按录制时的时间间隔提供帧, 没有空闲帧buffer时丢弃该帧(同摄像头);
+                            // 0: 尽快提供, 等待cam_give, 不丢帧, 用于确定性的回归和基准测试
+    uint32_t loops;         // 播放次数, 0: 1
+    uint8_t task_pri;
+} cam_replay_config_t;
+
+typedef struct {
+    uint32_t frames;        // 文件中的有效帧数
+    uint32_t delivered;     // 提供给cam_take的帧数
+    uint32_t dropped;       // realtime时没有空闲帧buffer而丢弃的帧数
+    uint32_t max_len;       // 最大帧长度, 即帧buffer的大小
+    uint32_t max_pixels;    // 最大的width * high
+    int64_t span_us;        // 第一帧到最后一帧的录制时间
+    uint8_t truncated;      // 文件末尾有不完整或损坏的帧(例如录制时断电), 已忽略
+    uint8_t done;           // 播放结束
+} cam_replay_stats_t;
+
+// 读入整个文件(帧保存在内存中, 回放时不读文件), 创建回放任务
+// 返回值:0,成功;-1,文件不能读, 不是录制文件或没有完整的帧
+int cam_replay_init(const cam_replay_config_t *config);
+
+// 停止回放任务, 释放内存, 之后可以重新cam_replay_init; 调用时不能有未归还的帧
+void cam_replay_deinit(void);
+
+// cam_take得到的帧buffer中当前帧的录制信息(尺寸, 格式, 序号, 时间)
+const cam_rec_frame_t *cam_replay_frame(const uint8_t *buffer);
+
+void cam_replay_get_stats(cam_replay_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
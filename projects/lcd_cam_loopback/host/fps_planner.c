@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fps_plan.h"
+
+// 帧率规划(components/fps_plan)的主机验证
+// 不带参数时执行固定场景和参数扫描, 检查每个规划: 时钟可以由LEDC/CLKRC/GPSPI3产生且不超过限制,
+// 满足规划的帧率, 传感器是满足该帧率加上余量的最低时钟(没有时为最高时钟), LCD是最高时钟(与穷举比较),
+// 未达到目标帧率时限制环节的上限正好等于规划的帧率
+// 带参数时只打印一个规划
+//
+//   fps_planner [-s sensor_size] [-w width] [-h high] [-j] [-b lcd_pixel_bits] [-p] [-r fps] [-c frame_cost_us] [-m sensor_margin_pct]
+
+#define APB_CLK         (80 * 1000 * 1000)
+#define MHZ             (1000 * 1000)
+#define LCD_CMD_BYTES   (14)
+
+// 数据手册中一帧的传感器时钟数(行长 x 帧长), 与fps_plan.c独立
+static const uint32_t frame_clk[2] = {1190 * 672, 1922 * 1248};
+
+typedef struct {
+    const char *name;
+    fps_plan_config_t config;
+    int ret;
+    fps_plan_limit_t limit;
+    uint32_t sensor_clk;    // 0: 不检查
+    uint32_t lcd_clk;       // 0: 不检查
+    uint32_t fps_x100;      // 0: 不检查
+} scenario_t;
+
+static int failed = 0;
+
+static void print_plan(const char *name, const fps_plan_t *plan, int ok)
+{
+    printf("%-28s %s  fps %3u.%02u (%-6s)  xclk %2u MHz x%d /%-2d sensor %6.3f MHz %3u.%02u fps  cam %6u B %6.3f MB/s  mem %6.3f MB/s  lcd %6.3f MHz %6u us\n",
+           name, ok ? "PASS" : "FAIL", plan->fps_x100 / 100, plan->fps_x100 % 100, fps_plan_limit_name(plan->limit),
+           plan->xclk_fre / MHZ, plan->clkrc_double + 1, plan->clkrc_div + 1, plan->sensor_clk / 1e6,
+           plan->sensor_fps_x100 / 100, plan->sensor_fps_x100 % 100, plan->cam_frame_bytes, plan->cam_bw / 1e6,
+           plan->mem_bw / 1e6, plan->lcd_clk_fre / 1e6, plan->lcd_frame_us);
+}
+
+// 检查规划, 出错时打印原因; config中的限制必须都已指定
+static int check_plan(const char *name, const fps_plan_config_t *c, const fps_plan_t *plan, int ret)
+{
+    uint64_t frame = frame_clk[c->sensor_size];
+    uint64_t pixels = c->width * c->high;
+    uint64_t lcd_bits = ((pixels * c->lcd_pixel_bits + 7) / 8 + LCD_CMD_BYTES) * 8;
+    uint64_t cam_bytes = c->jpeg ? pixels * 2 / c->jpeg_ratio : pixels * 2;
+    uint64_t mem_frame = cam_bytes + (c->lcd_psram ? (c->jpeg ? pixels * 4 : pixels * 2) : 0);
+    uint32_t top = c->pclk_max < c->sensor_clk_max ? c->pclk_max : c->sensor_clk_max;
+    uint32_t min_clk = UINT32_MAX, max_clk = 0, lcd_max = 0;
+    uint32_t fps = plan->fps_x100, bound = 0;
+    const char *err = NULL;
+
+    // 穷举所有可以产生的传感器时钟和LCD时钟
+    for (uint32_t xclk = c->xclk_min; xclk <= c->xclk_max; xclk += MHZ) {
+        for (int k = 1; k <= 2; k++) {
+            for (int d = 1; d <= 64; d++) {
+                uint32_t clk = xclk * k / d;
+                if (clk > top) {
+                    continue;
+                }
+                max_clk = clk > max_clk ? clk : max_clk;
+                if ((uint64_t)clk * 10000 >= fps * (100 + c->sensor_margin_pct) * frame && clk < min_clk) {
+                    min_clk = clk;
+                }
+            }
+        }
+    }
+    for (int d = 1; d <= 64; d++) {
+        uint32_t clk = APB_CLK / d;
+        if (clk > c->lcd_clk_max) {
+            continue;
+        }
+        lcd_max = lcd_max ? lcd_max : clk;
+    }
+
+    switch (plan->limit) {
+        case FPS_PLAN_LIMIT_NONE:   bound = c->fps * 100; break;
+        case FPS_PLAN_LIMIT_SENSOR:
+        case FPS_PLAN_LIMIT_PCLK:   bound = (uint64_t)max_clk * 100 / frame; break;
+        case FPS_PLAN_LIMIT_MEMORY: bound = (uint64_t)c->mem_bw * 100 / mem_frame; break;
+        case FPS_PLAN_LIMIT_LCD:    bound = (uint64_t)lcd_max * 100 / lcd_bits; break;
+        case FPS_PLAN_LIMIT_CPU:    bound = 100ULL * 1000 * 1000 / c->frame_cost_us; break;
+    }
+
+    if (ret != (plan->limit == FPS_PLAN_LIMIT_NONE ? 0 : 1) || fps > c->fps * 100) {
+        err = "return value";
+    } else if (fps != bound) {
+        err = "fps differs from the limiting stage";
+    } else if (plan->limit == FPS_PLAN_LIMIT_PCLK && c->pclk_max >= c->sensor_clk_max) {
+        err = "pclk limit without pclk_max below sensor_clk_max";
+    } else if (plan->xclk_fre < c->xclk_min || plan->xclk_fre > c->xclk_max || plan->xclk_fre % MHZ || plan->clkrc_div > 0x3F ||
+               plan->sensor_clk != plan->xclk_fre * (plan->clkrc_double + 1) / (plan->clkrc_div + 1)) {
+        err = "sensor clock not reachable";
+    } else if (plan->sensor_clk != (min_clk == UINT32_MAX ? max_clk : min_clk)) {
+        err = "sensor clock not the lowest one meeting fps with margin";
+    } else if (plan->sensor_fps_x100 < fps) {
+        err = "sensor fps below plan";
+    } else if (plan->lcd_clk_fre != lcd_max || (plan->lcd_clk_fre != APB_CLK && APB_CLK / plan->lcd_clk_fre < 2)) {
+        err = "lcd clock not the highest one";
+    } else if ((uint64_t)plan->lcd_frame_us * fps > 100ULL * 1000 * 1000) {
+        err = "lcd frame time above frame period";
+    } else if (plan->cam_frame_bytes != cam_bytes || plan->mem_bw > c->mem_bw) {
+        err = "bandwidth";
+    }
+    if (err) {
+        printf("  %s: %s\n", name, err);
+    }
+    return err == NULL;
+}
+
+static void run_scenario(const scenario_t *s)
+{
+    fps_plan_config_t c = s->config;
+    fps_plan_t plan;
+    int ret = fps_plan(&c, &plan);
+    // 补全默认值后检查, 与fps_plan.c的默认值相同
+    c.jpeg_ratio = c.jpeg_ratio ? c.jpeg_ratio : 10;
+    c.sensor_margin_pct = c.sensor_margin_pct ? c.sensor_margin_pct : 10;
+    c.lcd_pixel_bits = c.lcd_pixel_bits ? c.lcd_pixel_bits : 16;
+    c.xclk_min = c.xclk_min ? c.xclk_min : 6 * MHZ;
+    c.xclk_max = c.xclk_max ? c.xclk_max : 24 * MHZ;
+    c.sensor_clk_max = c.sensor_clk_max ? c.sensor_clk_max : 36 * MHZ;
+    c.pclk_max = c.pclk_max ? c.pclk_max : 32 * MHZ;
+    c.mem_bw = c.mem_bw ? c.mem_bw : 20 * MHZ;
+    c.lcd_clk_max = c.lcd_clk_max ? c.lcd_clk_max : 80 * MHZ;
+    int ok = ret == s->ret && plan.limit == s->limit && check_plan(s->name, &c, &plan, ret);
+    ok = ok && (!s->sensor_clk || plan.sensor_clk == s->sensor_clk);
+    ok = ok && (!s->lcd_clk || plan.lcd_clk_fre == s->lcd_clk);
+    ok = ok && (!s->fps_x100 || plan.fps_x100 == s->fps_x100);
+    failed += !ok;
+    print_plan(s->name, &plan, ok);
+}
+
+// 分辨率, 格式, 帧率和限制的组合, 每个规划都必须通过check_plan
+static void sweep(void)
+{
+    static const uint16_t size[][2] = {{160, 120}, {320, 240}, {240, 320}, {800, 600}};
+    static const uint8_t bits[] = {12, 16, 24};
+    static const uint16_t fps[] = {1, 5, 10, 15, 24, 30, 45, 60, 90, 120};
+    static const uint32_t cost[] = {0, 20000, 70000};
+    static const uint32_t pclk[] = {20 * MHZ, 32 * MHZ, 48 * MHZ};
+    static const uint32_t lcd[] = {40 * MHZ, 80 * MHZ};
+    static const uint8_t margin[] = {1, 10, 30};
+    uint32_t cnt = 0, bad = 0, limit_cnt[FPS_PLAN_LIMIT_CPU + 1] = {0};
+    fps_plan_t plan;
+    char name[128];
+
+    for (int s = 0; s < 2; s++)
+    for (int r = 0; r < sizeof(size) / sizeof(size[0]); r++)
+    for (int j = 0; j < 2; j++)
+    for (int b = 0; b < sizeof(bits); b++)
+    for (int p = 0; p < 2; p++)
+    for (int f = 0; f < sizeof(fps) / sizeof(fps[0]); f++)
+    for (int x = 0; x < sizeof(cost) / sizeof(cost[0]); x++)
+    for (int k = 0; k < sizeof(pclk) / sizeof(pclk[0]); k++)
+    for (int l = 0; l < sizeof(lcd) / sizeof(lcd[0]); l++)
+    for (int m = 0; m < sizeof(margin); m++) {
+        fps_plan_config_t c = {
+            .sensor_size = s,
+            .width = size[r][0],
+            .high = size[r][1],
+            .jpeg = j,
+            .jpeg_ratio = 8,
+            .lcd_pixel_bits = bits[b],
+            .lcd_psram = p,
+            .fps = fps[f],
+            .frame_cost_us = cost[x],
+            .sensor_margin_pct = margin[m],
+            .xclk_min = 6 * MHZ,
+            .xclk_max = 24 * MHZ,
+            .sensor_clk_max = 36 * MHZ,
+            .pclk_max = pclk[k],
+            .mem_bw = 20 * MHZ,
+            .lcd_clk_max = lcd[l],
+        };
+        int ret = fps_plan(&c, &plan);
+        snprintf(name, sizeof(name), "sweep %s %ux%u%s %u bit%s %u fps %u us pclk %u lcd %u margin %u",
+                 s ? "uxga" : "svga", c.width, c.high, j ? " jpeg" : "", c.lcd_pixel_bits, p ? " psram" : "",
+                 c.fps, c.frame_cost_us, c.pclk_max / MHZ, c.lcd_clk_max / MHZ, c.sensor_margin_pct);
+        cnt++;
+        if (!check_plan(name, &c, &plan, ret)) {
+            bad++;
+        }
+        limit_cnt[plan.limit]++;
+    }
+    failed += bad != 0;
+    printf("%-28s %s  %u plans, %u failed, limits:", "sweep", bad ? "FAIL" : "PASS", cnt, bad);
+    for (int x = 0; x <= FPS_PLAN_LIMIT_CPU; x++) {
+        printf(" %s %u", fps_plan_limit_name((fps_plan_limit_t)x), limit_cnt[x]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    // main.c的配置: SVGA传感器输出320x240, RGB565, LCD直接从PSRAM发送
+    static const scenario_t scenarios[] = {
+        {"svga_320x240_rgb_30",      {.width = 320, .high = 240, .lcd_psram = 1, .fps = 30}, 0, FPS_PLAN_LIMIT_NONE, 28 * MHZ, 80 * MHZ, 3000},
+        {"svga_320x240_rgb444_60",   {.width = 320, .high = 240, .lcd_psram = 1, .lcd_pixel_bits = 12, .fps = 60}, 1, FPS_PLAN_LIMIT_PCLK, 32 * MHZ, 0, 0},
+        {"svga_320x240_rgb_120",     {.width = 320, .high = 240, .lcd_psram = 1, .fps = 120}, 1, FPS_PLAN_LIMIT_PCLK, 32 * MHZ, 80 * MHZ, 0},
+        {"svga_320x240_rgb666_pclk48", {.width = 320, .high = 240, .lcd_psram = 1, .lcd_pixel_bits = 24, .fps = 60, .pclk_max = 48 * MHZ}, 1, FPS_PLAN_LIMIT_LCD, 0, 80 * MHZ, 0},
+        {"uxga_320x240_jpeg_30",     {.sensor_size = 1, .width = 320, .high = 240, .jpeg = 1, .fps = 30}, 1, FPS_PLAN_LIMIT_PCLK, 32 * MHZ, 0, 0},
+        {"uxga_320x240_jpeg_10",     {.sensor_size = 1, .width = 320, .high = 240, .jpeg = 1, .fps = 10}, 0, FPS_PLAN_LIMIT_NONE, 0, 0, 1000},
+        {"svga_320x240_jpeg_decode", {.width = 320, .high = 240, .jpeg = 1, .fps = 30, .frame_cost_us = 50000}, 1, FPS_PLAN_LIMIT_CPU, 0, 0, 2000},
+        {"svga_320x240_rgb_mem5",    {.width = 320, .high = 240, .lcd_psram = 1, .fps = 30, .mem_bw = 5 * MHZ}, 1, FPS_PLAN_LIMIT_MEMORY, 0, 0, 0},
+    };
+    fps_plan_config_t config = {.width = 320, .high = 240, .lcd_psram = 1, .fps = 30};
+    fps_plan_t plan;
+
+    if (argc > 1) {
+        for (int x = 1; x < argc; x++) {
+            if (!strcmp(argv[x], "-s") && x + 1 < argc) {
+                config.sensor_size = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-w") && x + 1 < argc) {
+                config.width = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-h") && x + 1 < argc) {
+                config.high = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-j")) {
+                config.jpeg = 1;
+            } else if (!strcmp(argv[x], "-b") && x + 1 < argc) {
+                config.lcd_pixel_bits = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-p")) {
+                config.lcd_psram = 1;
+            } else if (!strcmp(argv[x], "-r") && x + 1 < argc) {
+                config.fps = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-c") && x + 1 < argc) {
+                config.frame_cost_us = atoi(argv[++x]);
+            } else if (!strcmp(argv[x], "-m") && x + 1 < argc) {
+                config.sensor_margin_pct = atoi(argv[++x]);
+            } else {
+                fprintf(stderr, "usage: %s [-s sensor_size] [-w width] [-h high] [-j] [-b lcd_pixel_bits] [-p] [-r fps] [-c frame_cost_us] [-m sensor_margin_pct]\n", argv[0]);
+                return 2;
+            }
+        }
+        int ret = fps_plan(&config, &plan);
+        if (ret < 0) {
+            fprintf(stderr, "invalid config\n");
+            return 1;
+        }
+        print_plan("plan", &plan, 1);
+        return 0;
+    }
+
+    for (int x = 0; x < sizeof(scenarios) / sizeof(scenarios[0]); x++) {
+        run_scenario(&scenarios[x]);
+    }
+    sweep();
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <dirent.h>
+#include "jpeg_bench.h"
+#include "jpeg_bench_corpus.h"
+#include "jpeg_enc.h"
+
+// JPEG解码基准(components/jpeg_bench)的主机版本, 与设备上(main.c的JPEG_BENCH)输出相同的表格
+// 语料: components/jpeg_bench/corpus/*.jpg, 每张图像按1/1, 1/2, 1/4, 1/8解码,
+// 报告ms/帧, MB/s(JPEG字节), MCU/s, 各阶段(Huffman, IDCT, 颜色转换, 输出)的时间比例, 以及输出的CRC32,
+// 与jpeg_bench_corpus.h中的golden不同时失败: 优化解码器不能改变像素
+//
+// -c: 重新生成语料(OV2640的JPEG格式: 基线, 4:2:2, 标准Huffman表; 内容为带噪声和细节的合成场景), 然后同-g
+// -g: 根据corpus目录中的所有.jpg重新生成jpeg_bench_corpus.h(文件长度, CRC32和golden), 之后需要重新编译
+//     也可以把设备上拍的JPEG放进corpus目录再运行-g
+// 其他参数: 额外的JPEG文件, 只测速不检查
+//
+//   jpeg_bench [-n runs] [-c] [-g] [-d components/jpeg_bench] [file.jpg ...]
+
+#define MAX_CORPUS  (32)
+#define MAX_NAME    (64)
+
+// 语料: OV2640的常用分辨率和几个质量
+static const struct {
+    const char *name;
+    int width, high, quality;
+} corpus_gen[] = {
+    {"qqvga_q50", 160, 120, 50},
+    {"qvga_q20", 320, 240, 20},
+    {"qvga_q50", 320, 240, 50},
+    {"qvga_q80", 320, 240, 80},
+    {"vga_q50", 640, 480, 50},
+    {"svga_q50", 800, 600, 50},
+};
+
+static uint32_t rand_state = 1;
+
+static int noise(int amp)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    int a = (rand_state >> 16) & 0x7FFF;
+    rand_state = rand_state * 1103515245 + 12345;
+    int b = (rand_state >> 16) & 0x7FFF;
+    return (a + b - 0x7FFF) * amp / 0x7FFF;
+}
+
+static uint8_t clip(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// 合成场景: 天空渐变, 太阳, 带窗户的建筑, 有纹理的地面, 黑白条纹(类似文字), 加上传感器噪声
+// 位置按比例, 纹理按像素, 不同分辨率是同一个场景
+static void make_scene(uint8_t *rgb, int width, int high)
+{
+    rand_state = 1;
+    for (int y = 0; y < high; y++) {
+        for (int x = 0; x < width; x++) {
+            float fx = (float)x / width, fy = (float)y / high;
+            int r, g, b;
+            if (fy < 0.6f) {
+                r = 90 + 100 * fy;
+                g = 140 + 90 * fy;
+                b = 230 - 40 * fy;
+                float dx = fx - 0.8f, dy = fy - 0.15f;
+                if (dx * dx + dy * dy < 0.006f) {
+                    r = 255, g = 240, b = 180;
+                }
+            } else {
+                float t = sinf(x * 1.3f) * cosf(y * 0.9f) + sinf((x + y) * 0.45f);
+                r = 100 + 25 * t;
+                g = 120 + 30 * t + 60 * (fy - 0.6f);
+                b = 60 + 10 * t;
+            }
+            // 建筑和窗户
+            if (fx > 0.1f && fx < 0.35f && fy > 0.25f && fy < 0.75f) {
+                r = g = b = 150;
+                if (((int)(fx * 60) % 3) && ((int)(fy * 50) % 3)) {
+                    r = 60, g = 70, b = 90;
+                }
+            }
+            if (fx > 0.45f && fx < 0.6f && fy > 0.4f && fy < 0.7f) {
+                r = 180, g = 90, b = 70;
+            }
+            // 条纹: 宽度1~4像素交替
+            if (fy > 0.82f && fy < 0.9f && fx > 0.4f && fx < 0.95f) {
+                int p = x % 13;
+                r = g = b = (p < 1 || (p > 3 && p < 6) || p == 9) ? 20 : 235;
+            }
+            rgb[(y * width + x) * 3] = clip(r + noise(8));
+            rgb[(y * width + x) * 3 + 1] = clip(g + noise(8));
+            rgb[(y * width + x) * 3 + 2] = clip(b + noise(8));
+        }
+    }
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    *len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t *data = (uint8_t *)malloc(*len ? *len : 1);
+    if (fread(data, 1, *len, fp) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
+
+// dir/corpus/name.jpg, 路径超过PATH_MAX时返回-1
+static int corpus_path(char *path, const char *dir, const char *name)
+{
+    int n = snprintf(path, PATH_MAX, "%s/corpus/%s.jpg", dir, name);
+    if (n < 0 || n >= PATH_MAX) {
+        fprintf(stderr, "%s/corpus/%s.jpg: path too long\n", dir, name);
+        return -1;
+    }
+    return 0;
+}
+
+static int create_corpus(const char *dir)
+{
+    char path[PATH_MAX];
+    for (int x = 0; x < sizeof(corpus_gen) / sizeof(corpus_gen[0]); x++) {
+        int width = corpus_gen[x].width, high = corpus_gen[x].high;
+        size_t size = width * high * 3 + 4096;
+        uint8_t *rgb = (uint8_t *)malloc(width * high * 3);
+        uint8_t *jpeg = (uint8_t *)malloc(size);
+        make_scene(rgb, width, high);
+        int len = jpeg_enc_rgb(rgb, width, high, corpus_gen[x].quality, JPEG_ENC_422, jpeg, size);
+        if (corpus_path(path, dir, corpus_gen[x].name) != 0) {
+            return -1;
+        }
+        FILE *fp = len > 0 ? fopen(path, "wb") : NULL;
+        if (!fp || fwrite(jpeg, 1, len, fp) != len) {
+            fprintf(stderr, "%s: write failed\n", path);
+            return -1;
+        }
+        fclose(fp);
+        printf("%s: %d bytes\n", path, len);
+        free(jpeg);
+        free(rgb);
+    }
+    return 0;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// 文件名(不含.jpg)必须是C标识符, 用作嵌入文件的符号名
+static int valid_name(const char *name)
+{
+    for (int x = 0; name[x]; x++) {
+        if (!((name[x] >= 'a' && name[x] <= 'z') || (name[x] >= 'A' && name[x] <= 'Z') || name[x] == '_' || (x && name[x] >= '0' && name[x] <= '9'))) {
+            return 0;
+        }
+    }
+    return name[0] != '\0';
+}
+
+static int write_header(const char *dir)
+{
+    static char names[MAX_CORPUS][MAX_NAME];
+    char path[PATH_MAX], header[PATH_MAX];
+    int cnt = 0;
+
+    int ret = snprintf(path, sizeof(path), "%s/corpus", dir);
+    if (ret < 0 || ret >= PATH_MAX) {
+        fprintf(stderr, "%s/corpus: path too long\n", dir);
+        return -1;
+    }
+    DIR *d = opendir(path);
+    if (!d) {
+        perror(path);
+        return -1;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t n = strlen(e->d_name);
+        if (n > 4 && !strcmp(e->d_name + n - 4, ".jpg") && n - 4 < MAX_NAME && cnt < MAX_CORPUS) {
+            memcpy(names[cnt], e->d_name, n - 4);
+            names[cnt][n - 4] = '\0';
+            if (!valid_name(names[cnt])) {
+                fprintf(stderr, "%s: file name must be a C identifier\n", e->d_name);
+                closedir(d);
+                return -1;
+            }
+            cnt++;
+        }
+    }
+    closedir(d);
+    if (!cnt) {
+        fprintf(stderr, "%s: no .jpg files\n", path);
+        return -1;
+    }
+    qsort(names, cnt, MAX_NAME, name_cmp);
+
+    ret = snprintf(header, sizeof(header), "%s/include/jpeg_bench_corpus.h", dir);
+    if (ret < 0 || ret >= PATH_MAX) {
+        fprintf(stderr, "%s/include/jpeg_bench_corpus.h: path too long\n", dir);
+        return -1;
+    }
+    FILE *fp = fopen(header, "w");
+    if (!fp) {
+        perror(header);
+        return -1;
+    }
+    fprintf(fp, "#pragma once\n");
+    fprintf(fp, "//由host/jpeg_bench -g根据corpus/*.jpg生成, 不要手动修改\n");
+    fprintf(fp, "//golden: 各缩放比例解码输出(大端RGB565)的CRC32\n\n");
+    fprintf(fp, "#include <stddef.h>\n#include \"jpeg_bench.h\"\n\n");
+    fprintf(fp, "#ifdef ESP_PLATFORM\n");
+    for (int x = 0; x < cnt; x++) {
+        fprintf(fp, "extern const uint8_t %s_jpg_start[] asm(\"_binary_%s_jpg_start\");\n", names[x], names[x]);
+        fprintf(fp, "extern const uint8_t %s_jpg_end[] asm(\"_binary_%s_jpg_end\");\n", names[x], names[x]);
+    }
+    fprintf(fp, "#define JPEG_BENCH_FILE(name) name##_jpg_start, name##_jpg_end\n");
+    fprintf(fp, "#else\n#define JPEG_BENCH_FILE(name) NULL, NULL\n#endif\n\n");
+    fprintf(fp, "static const jpeg_bench_image_t jpeg_bench_corpus_table[] = {\n");
+    for (int x = 0; x < cnt; x++) {
+        size_t len;
+        jpeg_bench_result_t r;
+        uint32_t golden[JPEG_BENCH_SCALE_NUM];
+        if (corpus_path(path, dir, names[x]) != 0) {
+            fclose(fp);
+            return -1;
+        }
+        uint8_t *jpeg = load(path, &len);
+        for (int scale = 0; scale < JPEG_BENCH_SCALE_NUM; scale++) {
+            if (!jpeg || jpeg_bench_run(jpeg, len, scale, 1, &r) != 0) {
+                fprintf(stderr, "%s: decode failed\n", path);
+                fclose(fp);
+                return -1;
+            }
+            golden[scale] = r.crc;
+        }
+        fprintf(fp, "    {\"%s\", JPEG_BENCH_FILE(%s), %u, 0x%08x, {0x%08x, 0x%08x, 0x%08x, 0x%08x}},\n",
+                names[x], names[x], (uint32_t)len, jpeg_bench_crc32(0, jpeg, len), golden[0], golden[1], golden[2], golden[3]);
+        free(jpeg);
+    }
+    fprintf(fp, "};\n");
+    fclose(fp);
+    printf("%s: %d images\n", header, cnt);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = JPEG_BENCH_DIR;
+    int runs = 20, create = 0, gen = 0, first_file = argc;
+    int failed = 0;
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-n") && x + 1 < argc) {
+            runs = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-d") && x + 1 < argc) {
+            dir = argv[++x];
+        } else if (!strcmp(argv[x], "-c")) {
+            create = gen = 1;
+        } else if (!strcmp(argv[x], "-g")) {
+            gen = 1;
+        } else if (argv[x][0] != '-') {
+            first_file = x;
+            break;
+        } else {
+            fprintf(stderr, "usage: %s [-n runs] [-c] [-g] [-d components/jpeg_bench] [file.jpg ...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+    if (create && create_corpus(dir) != 0) {
+        return 1;
+    }
+    if (gen) {
+        return write_header(dir) == 0 ? 0 : 1;
+    }
+
+    jpeg_bench_print_header();
+    for (int x = 0; x < sizeof(jpeg_bench_corpus_table) / sizeof(jpeg_bench_corpus_table[0]); x++) {
+        const jpeg_bench_image_t *img = &jpeg_bench_corpus_table[x];
+        char path[PATH_MAX];
+        size_t len = 0;
+        uint8_t *jpeg = corpus_path(path, dir, img->name) == 0 ? load(path, &len) : NULL;
+        if (!jpeg || len != img->size || jpeg_bench_crc32(0, jpeg, len) != img->crc) {
+            printf("%-14s %s missing or changed, rerun jpeg_bench -g\n", img->name, path);
+            failed++;
+        } else {
+            failed += jpeg_bench_image(img->name, jpeg, len, img->golden, runs);
+        }
+        free(jpeg);
+    }
+    for (int x = first_file; x < argc; x++) {
+        size_t len = 0;
+        uint8_t *jpeg = load(argv[x], &len);
+        if (!jpeg) {
+            perror(argv[x]);
+            failed++;
+            continue;
+        }
+        const char *name = strrchr(argv[x], '/') ? strrchr(argv[x], '/') + 1 : argv[x];
+        failed += jpeg_bench_image(name, jpeg, len, NULL, runs);
+        free(jpeg);
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+#include <string.h>
+#include <math.h>
+#include "jpeg_enc.h"
+
+// 标准量化表(ITU T.81 附录K), 自然顺序
+static const uint8_t jpeg_enc_qt_lum[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+static const uint8_t jpeg_enc_qt_chr[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+// 之字形顺序的第i个系数在自然顺序中的位置
+static const uint8_t jpeg_enc_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// 标准Huffman表: 每种码长(1~16)的码字个数, 符号
+static const uint8_t jpeg_enc_dc_lum_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t jpeg_enc_dc_chr_bits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t jpeg_enc_dc_vals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t jpeg_enc_ac_lum_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t jpeg_enc_ac_lum_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+static const uint8_t jpeg_enc_ac_chr_bits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t jpeg_enc_ac_chr_vals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+typedef struct {
+    uint16_t code[256];
+    uint8_t len[256];
+} jpeg_enc_huff_t;
+
+typedef struct {
+    uint8_t *out;
+    size_t size;
+    size_t len;
+    uint32_t bit_buf;
+    int bit_cnt;
+    int err;
+} jpeg_enc_writer_t;
+
+static void put_byte(jpeg_enc_writer_t *w, uint8_t value)
+{
+    if (w->len >= w->size) {
+        w->err = 1;
+        return;
+    }
+    w->out[w->len++] = value;
+}
+
+static void put_be16(jpeg_enc_writer_t *w, uint16_t value)
+{
+    put_byte(w, value >> 8);
+    put_byte(w, value & 0xFF);
+}
+
+// 熵编码数据, 0xFF之后插入0x00
+static void put_bits(jpeg_enc_writer_t *w, uint32_t value, int bits)
+{
+    w->bit_buf = (w->bit_buf << bits) | (value & ((1u << bits) - 1));
+    w->bit_cnt += bits;
+    while (w->bit_cnt >= 8) {
+        uint8_t byte = (w->bit_buf >> (w->bit_cnt - 8)) & 0xFF;
+        put_byte(w, byte);
+        if (byte == 0xFF) {
+            put_byte(w, 0);
+        }
+        w->bit_cnt -= 8;
+    }
+}
+
+static void huff_build(jpeg_enc_huff_t *h, const uint8_t *bits, const uint8_t *vals)
+{
+    uint16_t code = 0;
+    int k = 0;
+    memset(h, 0, sizeof(jpeg_enc_huff_t));
+    for (int len = 1; len <= 16; len++) {
+        for (int x = 0; x < bits[len - 1]; x++) {
+            h->code[vals[k]] = code++;
+            h->len[vals[k]] = len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+static void put_dht(jpeg_enc_writer_t *w, uint8_t class_id, const uint8_t *bits, const uint8_t *vals)
+{
+    int cnt = 0;
+    for (int x = 0; x < 16; x++) {
+        cnt += bits[x];
+    }
+    put_be16(w, 0xFFC4);
+    put_be16(w, 2 + 1 + 16 + cnt);
+    put_byte(w, class_id);
+    for (int x = 0; x < 16; x++) {
+        put_byte(w, bits[x]);
+    }
+    for (int x = 0; x < cnt; x++) {
+        put_byte(w, vals[x]);
+    }
+}
+
+// 幅值的位数和编码(负数取反码)
+static int value_bits(int value, uint32_t *code)
+{
+    int mag = value < 0 ? -value : value;
+    int bits = 0;
+    while (mag) {
+        bits++;
+        mag >>= 1;
+    }
+    *code = value < 0 ? (uint32_t)(value - 1) : (uint32_t)value;
+    return bits;
+}
+
+// 8x8块: 正向DCT, 量化, Huffman编码; 返回本块的DC用于下一块的差分
+static int encode_block(jpeg_enc_writer_t *w, const float *block, const uint8_t *qt, int prev_dc,
+                        const jpeg_enc_huff_t *dc, const jpeg_enc_huff_t *ac)
+{
+    static float cos_table[8][8];
+    static int cos_init = 0;
+    float tmp[64];
+    int coef[64];
+    uint32_t code;
+    int bits;
+
+    if (!cos_init) {
+        for (int u = 0; u < 8; u++) {
+            for (int x = 0; x < 8; x++) {
+                cos_table[u][x] = (u ? 0.5f : 0.5f / sqrtf(2.0f)) * cosf((2 * x + 1) * u * (float)M_PI / 16);
+            }
+        }
+        cos_init = 1;
+    }
+    // 先对行, 再对列
+    for (int y = 0; y < 8; y++) {
+        for (int u = 0; u < 8; u++) {
+            float sum = 0;
+            for (int x = 0; x < 8; x++) {
+                sum += cos_table[u][x] * block[y * 8 + x];
+            }
+            tmp[y * 8 + u] = sum;
+        }
+    }
+    for (int u = 0; u < 8; u++) {
+        for (int v = 0; v < 8; v++) {
+            float sum = 0;
+            for (int y = 0; y < 8; y++) {
+                sum += cos_table[v][y] * tmp[y * 8 + u];
+            }
+            coef[v * 8 + u] = (int)lroundf(sum / qt[v * 8 + u]);
+        }
+    }
+
+    bits = value_bits(coef[0] - prev_dc, &code);
+    put_bits(w, dc->code[bits], dc->len[bits]);
+    put_bits(w, code, bits);
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int value = coef[jpeg_enc_zigzag[k]];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            put_bits(w, ac->code[0xF0], ac->len[0xF0]);
+            run -= 16;
+        }
+        bits = value_bits(value, &code);
+        put_bits(w, ac->code[(run << 4) | bits], ac->len[(run << 4) | bits]);
+        put_bits(w, code, bits);
+        run = 0;
+    }
+    if (run) {
+        put_bits(w, ac->code[0x00], ac->len[0x00]);
+    }
+    return coef[0];
+}
+
+int jpeg_enc_rgb(const uint8_t *rgb, int width, int high, int quality, int subsamp, uint8_t *out, size_t out_size)
+{
+    jpeg_enc_writer_t w = {.out = out, .size = out_size};
+    jpeg_enc_huff_t dc_lum, dc_chr, ac_lum, ac_chr;
+    uint8_t qt[2][64];
+    int hs = subsamp == JPEG_ENC_444 ? 1 : 2;
+    int vs = subsamp == JPEG_ENC_420 ? 2 : 1;
+    int scale, dc[3] = {0};
+
+    if (!rgb || width <= 0 || high <= 0 || width > 65535 || high > 65535 || quality < 1 || quality > 100 || subsamp < 0 || subsamp > 2) {
+        return -1;
+    }
+    // IJG的质量缩放
+    scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int x = 0; x < 64; x++) {
+        int lum = (jpeg_enc_qt_lum[x] * scale + 50) / 100;
+        int chr = (jpeg_enc_qt_chr[x] * scale + 50) / 100;
+        qt[0][x] = lum < 1 ? 1 : lum > 255 ? 255 : lum;
+        qt[1][x] = chr < 1 ? 1 : chr > 255 ? 255 : chr;
+    }
+    huff_build(&dc_lum, jpeg_enc_dc_lum_bits, jpeg_enc_dc_vals);
+    huff_build(&dc_chr, jpeg_enc_dc_chr_bits, jpeg_enc_dc_vals);
+    huff_build(&ac_lum, jpeg_enc_ac_lum_bits, jpeg_enc_ac_lum_vals);
+    huff_build(&ac_chr, jpeg_enc_ac_chr_bits, jpeg_enc_ac_chr_vals);
+
+    put_be16(&w, 0xFFD8);
+    for (int t = 0; t < 2; t++) {
+        put_be16(&w, 0xFFDB);
+        put_be16(&w, 2 + 1 + 64);
+        put_byte(&w, t);
+        for (int x = 0; x < 64; x++) {
+            put_byte(&w, qt[t][jpeg_enc_zigzag[x]]);
+        }
+    }
+    put_be16(&w, 0xFFC0);
+    put_be16(&w, 2 + 6 + 3 * 3);
+    put_byte(&w, 8);
+    put_be16(&w, high);
+    put_be16(&w, width);
+    put_byte(&w, 3);
+    put_byte(&w, 1);
+    put_byte(&w, (hs << 4) | vs);
+    put_byte(&w, 0);
+    for (int c = 2; c <= 3; c++) {
+        put_byte(&w, c);
+        put_byte(&w, 0x11);
+        put_byte(&w, 1);
+    }
+    put_dht(&w, 0x00, jpeg_enc_dc_lum_bits, jpeg_enc_dc_vals);
+    put_dht(&w, 0x10, jpeg_enc_ac_lum_bits, jpeg_enc_ac_lum_vals);
+    put_dht(&w, 0x01, jpeg_enc_dc_chr_bits, jpeg_enc_dc_vals);
+    put_dht(&w, 0x11, jpeg_enc_ac_chr_bits, jpeg_enc_ac_chr_vals);
+    put_be16(&w, 0xFFDA);
+    put_be16(&w, 2 + 1 + 3 * 2 + 3);
+    put_byte(&w, 3);
+    put_byte(&w, 1);
+    put_byte(&w, 0x00);
+    put_byte(&w, 2);
+    put_byte(&w, 0x11);
+    put_byte(&w, 3);
+    put_byte(&w, 0x11);
+    put_byte(&w, 0);
+    put_byte(&w, 63);
+    put_byte(&w, 0);
+
+    // 每个MCU: hs x vs个Y块, 一个Cb块, 一个Cr块; 超出图像的部分复制边缘像素
+    int mcu_w = 8 * hs, mcu_h = 8 * vs;
+    float ycc[3][16 * 16];
+    float block[64];
+    for (int my = 0; my < high; my += mcu_h) {
+        for (int mx = 0; mx < width; mx += mcu_w) {
+            for (int y = 0; y < mcu_h; y++) {
+                for (int x = 0; x < mcu_w; x++) {
+                    int px = mx + x < width ? mx + x : width - 1;
+                    int py = my + y < high ? my + y : high - 1;
+                    const uint8_t *p = &rgb[(py * width + px) * 3];
+                    float r = p[0], g = p[1], b = p[2];
+                    ycc[0][y * 16 + x] = 0.299f * r + 0.587f * g + 0.114f * b - 128;
+                    ycc[1][y * 16 + x] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    ycc[2][y * 16 + x] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+            for (int by = 0; by < vs; by++) {
+                for (int bx = 0; bx < hs; bx++) {
+                    for (int y = 0; y < 8; y++) {
+                        for (int x = 0; x < 8; x++) {
+                            block[y * 8 + x] = ycc[0][(by * 8 + y) * 16 + bx * 8 + x];
+                        }
+                    }
+                    dc[0] = encode_block(&w, block, qt[0], dc[0], &dc_lum, &ac_lum);
+                }
+            }
+            for (int c = 1; c <= 2; c++) {
+                for (int y = 0; y < 8; y++) {
+                    for (int x = 0; x < 8; x++) {
+                        float sum = 0;
+                        for (int sy = 0; sy < vs; sy++) {
+                            for (int sx = 0; sx < hs; sx++) {
+                                sum += ycc[c][(y * vs + sy) * 16 + x * hs + sx];
+                            }
+                        }
+                        block[y * 8 + x] = sum / (hs * vs);
+                    }
+                }
+                dc[c] = encode_block(&w, block, qt[1], dc[c], &dc_chr, &ac_chr);
+            }
+        }
+    }
+    // 剩余的位补1
+    if (w.bit_cnt) {
+        put_bits(&w, 0x7F, 8 - w.bit_cnt);
+    }
+    put_be16(&w, 0xFFD9);
+    return w.err ? -1 : (int)w.len;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 色度抽样
+#define JPEG_ENC_444    (0) // H1V1
+#define JPEG_ENC_422    (1) // H2V1, OV2640的JPEG输出
+#define JPEG_ENC_420    (2) // H2V2
+
+// 基线JPEG编码(标准量化表按quality缩放, 标准Huffman表), 用于生成解码器的测试图像
+// rgb每行width * 3字节, quality 1~100
+// 返回值:JPEG长度;-1,参数错误或out_size不够
+int jpeg_enc_rgb(const uint8_t *rgb, int width, int high, int quality, int subsamp, uint8_t *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "esp_heap_caps.h"
+#include "jpeg.h"
+#include "jpeg_enc.h"
+
+// JPEG解码(components/jpeg: tjpgd + jpeg.c)在主机上的单元测试
+// 用jpeg_enc生成不同尺寸, 质量和色度抽样的图像, 解码后与原图比较PSNR,
+// 检查jpeg_decode与jpeg_decode_to的结果相同, 输出buffer不够时不越界, 损坏或截断的输入返回错误且不读出输入的长度
+// (输入buffer与数据等长, 没有留出空间, 用-DHOST_ASAN=ON构建时越界读会被检测到)
+//
+//   jpeg_test [-v]
+
+#define GUARD_SIZE  (64)
+#define GUARD_BYTE  (0xA5)
+
+static int verbose = 0;
+static int failed = 0;
+
+// 平滑的测试图像: 渐变加低频的彩色波纹, 以及一个色块
+static void make_image(uint8_t *rgb, int width, int high, int seed)
+{
+    for (int y = 0; y < high; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *p = &rgb[(y * width + x) * 3];
+            float fx = (float)x / width, fy = (float)y / high;
+            p[0] = (uint8_t)(128 + 100 * sinf(6.0f * fx + seed) * cosf(3.0f * fy));
+            p[1] = (uint8_t)(255 * fy * 0.8f + 20);
+            p[2] = (uint8_t)(128 + 90 * cosf(5.0f * (fx + fy) + seed));
+            if (x > width / 4 && x < width / 2 && y > high / 4 && y < high / 2) {
+                p[0] = 200;
+                p[1] = 60;
+                p[2] = 40;
+            }
+        }
+    }
+}
+
+// 解码结果为大端RGB565, 展开为8位后与原图比较
+static double psnr_rgb565(const uint8_t *rgb, const uint8_t *img, int width, int high)
+{
+    double err = 0;
+    for (int x = 0; x < width * high; x++) {
+        uint16_t v = (img[x * 2] << 8) | img[x * 2 + 1];
+        int r = ((v >> 11) & 0x1F) * 255 / 31;
+        int g = ((v >> 5) & 0x3F) * 255 / 63;
+        int b = (v & 0x1F) * 255 / 31;
+        err += (r - rgb[x * 3]) * (r - rgb[x * 3]) + (g - rgb[x * 3 + 1]) * (g - rgb[x * 3 + 1]) + (b - rgb[x * 3 + 2]) * (b - rgb[x * 3 + 2]);
+    }
+    err /= width * high * 3;
+    return err == 0 ? 99 : 10 * log10(255.0 * 255.0 / err);
+}
+
+static void report(const char *name, int ok, const char *detail)
+{
+    if (!ok || verbose) {
+        printf("%-28s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    }
+    failed += !ok;
+}
+
+static uint8_t *encode(int width, int high, int quality, int subsamp, int seed, uint8_t **rgb_out, int *len)
+{
+    size_t size = width * high * 3 + 4096;
+    uint8_t *rgb = (uint8_t *)malloc(width * high * 3);
+    uint8_t *jpeg = (uint8_t *)calloc(1, size);
+    make_image(rgb, width, high, seed);
+    *len = jpeg_enc_rgb(rgb, width, high, quality, subsamp, jpeg, size);
+    *rgb_out = rgb;
+    return jpeg;
+}
+
+// 解码并与原图比较; jpeg_decode_to写入带保护字节的buffer, 结果必须与jpeg_decode相同
+static void test_decode(int width, int high, int quality, int subsamp, double min_psnr)
+{
+    static const char *sub_name[] = {"444", "422", "420"};
+    char name[64], detail[128];
+    uint8_t *rgb = NULL;
+    int len, w = 0, h = 0, w2 = 0, h2 = 0;
+    uint8_t *jpeg = encode(width, high, quality, subsamp, width + high, &rgb, &len);
+    size_t out_size = width * high * 2;
+    uint8_t *out = (uint8_t *)malloc(out_size + GUARD_SIZE);
+
+    sprintf(name, "%dx%d_q%d_%s", width, high, quality, sub_name[subsamp]);
+    memset(out, GUARD_BYTE, out_size + GUARD_SIZE);
+    uint8_t *img = len > 0 ? jpeg_decode(jpeg, len, &w, &h) : NULL;
+    int ret = len > 0 ? jpeg_decode_to(jpeg, len, out, out_size, &w2, &h2) : -1;
+    int ok = img && ret == 0 && w == width && h == high && w2 == width && h2 == high;
+    double psnr = ok ? psnr_rgb565(rgb, img, width, high) : 0;
+    ok = ok && psnr >= min_psnr && !memcmp(img, out, out_size);
+    for (int x = 0; x < GUARD_SIZE; x++) {
+        ok = ok && out[out_size + x] == GUARD_BYTE;
+    }
+    sprintf(detail, "%d bytes, %dx%d, PSNR %.1f dB (min %.1f)", len, w, h, psnr, min_psnr);
+    report(name, ok, detail);
+    jpeg_free(img);
+    free(out);
+    free(jpeg);
+    free(rgb);
+}
+
+// 输出buffer小于图像时jpeg_decode_to失败, 不写入buffer
+static void test_small_buffer(void)
+{
+    uint8_t *rgb = NULL;
+    int len, w = 0, h = 0;
+    uint8_t *jpeg = encode(64, 48, 80, JPEG_ENC_422, 1, &rgb, &len);
+    size_t out_size = 64 * 48 * 2 - 2;
+    uint8_t *out = (uint8_t *)malloc(out_size + GUARD_SIZE);
+    memset(out, GUARD_BYTE, out_size + GUARD_SIZE);
+    int ret = jpeg_decode_to(jpeg, len, out, out_size, &w, &h);
+    int ok = ret == -1 && w == 64 && h == 48;
+    for (size_t x = 0; x < out_size + GUARD_SIZE; x++) {
+        ok = ok && out[x] == GUARD_BYTE;
+    }
+    report("small_output_buffer", ok, "decode_to rejects, buffer untouched");
+    free(out);
+    free(jpeg);
+    free(rgb);
+}
+
+// 损坏的输入: 没有SOI, 不支持的SOF(渐进), 截断(在头部和熵编码数据中)
+static void test_corrupt(void)
+{
+    uint8_t *rgb = NULL;
+    int len, w = 0, h = 0;
+    uint8_t *jpeg = encode(64, 48, 80, JPEG_ENC_422, 2, &rgb, &len);
+    uint8_t *bad = (uint8_t *)malloc(len);
+    char detail[64];
+    int ok = 1;
+
+    memcpy(bad, jpeg, len);
+    bad[1] = 0x00;
+    ok = ok && jpeg_decode(bad, len, &w, &h) == NULL;
+
+    memcpy(bad, jpeg, len);
+    for (int x = 2; x + 1 < len; x++) {
+        if (bad[x] == 0xFF && bad[x + 1] == 0xC0) {
+            bad[x + 1] = 0xC2;
+            break;
+        }
+    }
+    ok = ok && jpeg_decode(bad, len, &w, &h) == NULL;
+
+    // 截断(头部中, 熵编码数据中): 复制到与截断长度相等的buffer, 读到输入末尾时失败, 不能读出buffer
+    for (int cut = 1; cut <= 2; cut++) {
+        int cut_len = cut == 1 ? 20 : len - 16;
+        uint8_t *part = (uint8_t *)malloc(cut_len);
+        uint8_t out[64 * 48 * 2];
+        memcpy(part, jpeg, cut_len);
+        ok = ok && jpeg_decode(part, cut_len, &w, &h) == NULL;
+        ok = ok && jpeg_decode_to(part, cut_len, out, sizeof(out), &w, &h) == -1;
+        free(part);
+    }
+
+    sprintf(detail, "no SOI, progressive, truncated at 20 and %d of %d", len - 16, len);
+    report("corrupt_input", ok, detail);
+    free(bad);
+    free(jpeg);
+    free(rgb);
+}
+
+int main(int argc, char **argv)
+{
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // OV2640的JPEG输出为4:2:2; 尺寸包括MCU的整数倍和非整数倍
+    static const struct {
+        int width, high, quality, subsamp;
+        double min_psnr;
+    } cases[] = {
+        {320, 240, 90, JPEG_ENC_422, 34},
+        {320, 240, 50, JPEG_ENC_422, 30},
+        {320, 240, 10, JPEG_ENC_422, 24},
+        {800, 600, 75, JPEG_ENC_422, 32},
+        {160, 120, 90, JPEG_ENC_444, 34},
+        {160, 120, 90, JPEG_ENC_420, 30},
+        {8, 8, 90, JPEG_ENC_444, 26},
+        {16, 8, 90, JPEG_ENC_422, 26},
+        {33, 17, 80, JPEG_ENC_444, 28},
+        {33, 17, 80, JPEG_ENC_422, 28},
+        {33, 17, 80, JPEG_ENC_420, 26},
+        {1, 1, 80, JPEG_ENC_422, 28},
+    };
+    for (int x = 0; x < sizeof(cases) / sizeof(cases[0]); x++) {
+        test_decode(cases[x].width, cases[x].high, cases[x].quality, cases[x].subsamp, cases[x].min_psnr);
+    }
+    test_small_buffer();
+    test_corrupt();
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "lcd_dirty.h"
+
+// 脏块检测基准测试
+// 输入为连续存放的big-endian RGB565原始帧序列; 不指定文件时生成一段合成序列:
+// 静态背景 + 移动的方块 + 可选的传感器噪声
+//
+//   lcd_dirty_bench [-w width] [-h high] [-t tile] [-g merge_gap] [-n noise_bits] [-f frames] [file.rgb565]
+
+#define SPI_CLK         (80 * 1000 * 1000)
+#define WINDOW_CMD_SIZE (14) // CASET + RASET + RAMWR 命令及参数字节数
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void put_pixel(uint8_t *frame, int width, int x, int y, uint16_t color)
+{
+    frame[(y * width + x) * 2] = color >> 8;
+    frame[(y * width + x) * 2 + 1] = color & 0xFF;
+}
+
+static void synth_frame(uint8_t *frame, int width, int high, int index, int noise)
+{
+    int box = 32;
+    int bx = (index * 3) % (width - box);
+    int by = high / 2 - box / 2 + (index % 20) - 10;
+    for (int y = 0; y < high; y++) {
+        for (int x = 0; x < width; x++) {
+            uint16_t color = ((x * 31 / width) << 11) | ((y * 63 / high) << 5) | 0x08;
+            if (x >= bx && x < bx + box && y >= by && y < by + box) {
+                color = 0xF800;
+            }
+            if (noise && (rand() % 8) == 0) {
+                color ^= 0x0821; // 各分量最低位翻转
+            }
+            put_pixel(frame, width, x, y, color);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    lcd_dirty_config_t config = {
+        .width = 320,
+        .high = 240,
+        .tile = 16,
+        .merge_gap = 1,
+    };
+    lcd_dirty_t dirty;
+    const char *path = NULL;
+    int frames = 300, noise = 0;
+    FILE *fp = NULL;
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-w") && x + 1 < argc) {
+            config.width = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-h") && x + 1 < argc) {
+            config.high = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-t") && x + 1 < argc) {
+            config.tile = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-g") && x + 1 < argc) {
+            config.merge_gap = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-n") && x + 1 < argc) {
+            config.noise_bits = atoi(argv[++x]);
+            noise = 1;
+        } else if (!strcmp(argv[x], "-f") && x + 1 < argc) {
+            frames = atoi(argv[++x]);
+        } else {
+            path = argv[x];
+        }
+    }
+
+    size_t frame_size = config.width * config.high * 2;
+    uint8_t *frame = (uint8_t *)malloc(frame_size);
+    lcd_rect_t *rect = (lcd_rect_t *)malloc(sizeof(lcd_rect_t) * 64);
+    config.max_rect = 64;
+    if (!frame || !rect || lcd_dirty_init(&dirty, &config) != 0) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+    if (path) {
+        fp = fopen(path, "rb");
+        if (!fp) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    double scan_us = 0;
+    uint64_t full_bytes = 0, sent_bytes = 0, rect_total = 0;
+    int count = 0;
+    for (count = 0; count < frames; count++) {
+        if (fp) {
+            if (fread(frame, 1, frame_size, fp) != frame_size) {
+                break;
+            }
+        } else {
+            synth_frame(frame, config.width, config.high, count, noise);
+        }
+        double start = now_us();
+        int rect_cnt = lcd_dirty_scan(&dirty, frame, rect);
+        scan_us += now_us() - start;
+        full_bytes += frame_size + WINDOW_CMD_SIZE;
+        for (int x = 0; x < rect_cnt; x++) {
+            sent_bytes += rect[x].w * rect[x].h * 2 + WINDOW_CMD_SIZE;
+        }
+        rect_total += rect_cnt;
+    }
+    if (count == 0) {
+        fprintf(stderr, "no frames\n");
+        return 1;
+    }
+
+    double full_ms = full_bytes * 8.0 / SPI_CLK * 1000 / count;
+    double sent_ms = sent_bytes * 8.0 / SPI_CLK * 1000 / count;
+    printf("frames:           %d (%dx%d, tile %d, merge_gap %d, noise_bits %d)\n", count, config.width, config.high, config.tile, config.merge_gap, config.noise_bits);
+    printf("scan time:        %.1f us/frame\n", scan_us / count);
+    printf("rects:            %.2f /frame\n", (double)rect_total / count);
+    printf("spi bytes:        %.0f /frame (full: %.0f, %.1f%%)\n", (double)sent_bytes / count, (double)full_bytes / count, 100.0 * sent_bytes / full_bytes);
+    printf("spi time @80MHz:  %.2f ms/frame (full: %.2f ms, max fps %.1f -> %.1f)\n", sent_ms, full_ms, 1000 / full_ms, sent_ms > 0 ? 1000 / sent_ms : 0);
+
+    lcd_dirty_deinit(&dirty);
+    free(frame);
+    free(rect);
+    if (fp) {
+        fclose(fp);
+    }
+    return 0;
+}
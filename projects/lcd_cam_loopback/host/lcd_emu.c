@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "host_sim.h"
+#include "host_spi_sim.h"
+#include "lcd.h"
+#include "lcd_dirty.h"
+#include "st7789_emu.h"
+
+// LCD驱动(lcd.c)在模拟GPSPI3 + ST7789上的验证和测量
+// 依次执行初始化, 同步/异步整帧, 零拷贝(DMA内存/PSRAM), 跨行窗口, 脏块刷新,
+// 每一步之后逐像素比较模拟面板的画面与期望画面, 并输出每帧的SPI字节数, 传输次数和总线时间
+// 不指定-f时依次运行RGB565, RGB444和RGB666(每种格式在单独的子进程中, 驱动不能重新初始化)
+//
+//   lcd_emu [-f 565|444|666] [-s dma_seg_cnt] [-b max_buffer_size] [-c clk_mhz] [-n dirty_frames] [-r] [-o png_dir]
+
+#define LCD_WIDTH   (320)
+#define LCD_HIGH    (240)
+
+#define LCD_CLK     (15)
+#define LCD_MOSI    (9)
+#define LCD_DC      (13)
+#define LCD_RST     (16)
+#define LCD_CS      (11)
+#define LCD_BK      (6)
+
+typedef struct {
+    lcd_pixel_format_t format;
+    uint32_t *expect;           // 期望的逻辑画面, 与st7789_emu_pixel格式相同
+    const char *png_dir;
+    int failed;
+    volatile int cb_cnt;
+} emu_test_t;
+
+static emu_test_t test;
+
+static uint32_t expand4(uint32_t value)
+{
+    return (value << 2) | (value >> 2);
+}
+
+static uint32_t expand5(uint32_t value)
+{
+    return (value << 1) | (value >> 4);
+}
+
+// 与驱动的打包方式无关的参考转换: RGB565 -> 面板按COLMOD存储的18位颜色
+static uint32_t ref_color(const uint8_t *src)
+{
+    uint32_t p = (src[0] << 8) | src[1];
+    uint32_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+    if (test.format == LCD_PIXEL_FORMAT_RGB444) {
+        return (expand4(r >> 1) << 12) | (expand4(g >> 2) << 6) | expand4(b >> 1);
+    }
+    return (expand5(r) << 12) | (g << 6) | expand5(b);
+}
+
+static void expect_window(const uint8_t *data, int x0, int y0, int w, int h, size_t stride)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            test.expect[(y0 + y) * LCD_WIDTH + x0 + x] = ref_color(data + y * stride + x * 2);
+        }
+    }
+}
+
+// 背景由bg决定, 方块位置由index决定
+static void synth_frame(uint8_t *frame, int bg, int index)
+{
+    int box = 40;
+    int bx = (index * 7) % (LCD_WIDTH - box);
+    int by = (index * 5) % (LCD_HIGH - box);
+    uint16_t color = 0;
+    for (int y = 0; y < LCD_HIGH; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            color = ((x * 31 / LCD_WIDTH) << 11) | (((y + bg) * 63 / LCD_HIGH % 64) << 5) | ((x ^ y) & 0x1F);
+            if (x >= bx && x < bx + box && y >= by && y < by + box) {
+                color = 0xFFFF - color;
+            }
+            frame[(y * LCD_WIDTH + x) * 2] = color >> 8;
+            frame[(y * LCD_WIDTH + x) * 2 + 1] = color & 0xFF;
+        }
+    }
+}
+
+static int verify(void)
+{
+    int width, high, bad = 0;
+    uint32_t got;
+    st7789_emu_view_size(&width, &high);
+    if (width != LCD_WIDTH || high != LCD_HIGH) {
+        printf("  view %dx%d, expected %dx%d\n", width, high, LCD_WIDTH, LCD_HIGH);
+        return -1;
+    }
+    for (int y = 0; y < LCD_HIGH; y++) {
+        for (int x = 0; x < LCD_WIDTH; x++) {
+            got = st7789_emu_pixel(x, y);
+            if (got != test.expect[y * LCD_WIDTH + x]) {
+                if (bad < 4) {
+                    printf("  mismatch at (%d, %d): got 0x%05x, expected 0x%05x\n", x, y, got, test.expect[y * LCD_WIDTH + x]);
+                }
+                bad++;
+            }
+        }
+    }
+    if (bad) {
+        printf("  %d pixels differ\n", bad);
+    }
+    return bad ? -1 : 0;
+}
+
+static void stats_begin(int64_t *start)
+{
+    host_spi_sim_stats_t spi;
+    st7789_emu_stats_t lcd;
+    host_spi_sim_stats(&spi, true);
+    st7789_emu_stats(&lcd, true);
+    *start = host_time_us();
+}
+
+// 输出一步的每帧统计并检查画面
+static void stats_end(const char *name, int64_t start, int frames)
+{
+    host_spi_sim_stats_t spi;
+    st7789_emu_stats_t lcd;
+    char path[256];
+    double wall_ms = (host_time_us() - start) / 1000.0;
+    int ok = verify() == 0;
+    host_spi_sim_stats(&spi, true);
+    st7789_emu_stats(&lcd, true);
+    ok = ok && spi.errors == 0 && lcd.violations == 0;
+    test.failed += !ok;
+    frames = frames ? frames : 1;
+    printf("%-22s %s  bytes %8.0f  trans %6.1f (dma %5.1f, desc %6.1f)  cmds %5.1f  win %4.1f  bus %6.3f ms  wall %7.3f ms  /frame x%d\n",
+           name, ok ? "PASS" : "FAIL",
+           (double)spi.bytes / frames, (double)spi.transactions / frames, (double)spi.dma_transactions / frames,
+           (double)spi.descriptors / frames, (double)lcd.cmds / frames, (double)lcd.ramwr / frames,
+           spi.bus_us / 1000 / frames, wall_ms / frames, frames);
+    if (test.png_dir) {
+        // 文件名带像素格式, 依次运行各格式时不会覆盖
+        snprintf(path, sizeof(path), "%s/%s_%s.png", test.png_dir, name,
+                 test.format == LCD_PIXEL_FORMAT_RGB444 ? "444" : test.format == LCD_PIXEL_FORMAT_RGB666 ? "666" : "565");
+        if (st7789_emu_dump_png(path) != 0) {
+            printf("  write %s failed\n", path);
+        }
+    }
+}
+
+static void trans_done_cb(void *arg)
+{
+    (void)arg;
+    test.cb_cnt++;
+}
+
+static void submit_full(uint8_t *frame)
+{
+    lcd_trans_t trans = {
+        .set_index = 1,
+        .x_end = LCD_WIDTH - 1,
+        .y_end = LCD_HIGH - 1,
+        .data = frame,
+        .len = LCD_WIDTH * LCD_HIGH * 2,
+        .cb = trans_done_cb,
+    };
+    lcd_trans_submit(&trans, NULL, portMAX_DELAY);
+}
+
+// 一种像素格式的所有步骤
+static int run(lcd_config_t *lcd_config, int dirty_frames)
+{
+    st7789_emu_config_t emu_config = {
+        .pin_dc = LCD_DC,
+        .pin_cs = LCD_CS,
+        .pin_rst = LCD_RST,
+    };
+    lcd_dirty_config_t dirty_config = {
+        .width = LCD_WIDTH,
+        .high = LCD_HIGH,
+        .tile = 16,
+        .merge_gap = 1,
+    };
+    size_t frame_size = LCD_WIDTH * LCD_HIGH * 2;
+    int64_t start = 0;
+
+    test.format = lcd_config->pixel_format;
+
+    // 源数据分别位于普通内存(中转), 内部DMA内存和PSRAM(零拷贝)
+    uint8_t *frame = (uint8_t *)malloc(frame_size);
+    uint8_t *dma_frame = (uint8_t *)heap_caps_malloc(frame_size, MALLOC_CAP_DMA);
+    uint8_t *psram_frame[2] = {
+        (uint8_t *)heap_caps_malloc(frame_size, MALLOC_CAP_SPIRAM),
+        (uint8_t *)heap_caps_malloc(frame_size, MALLOC_CAP_SPIRAM),
+    };
+    lcd_rect_t *rect = (lcd_rect_t *)malloc(sizeof(lcd_rect_t) * 16);
+    lcd_dirty_t dirty;
+    test.expect = (uint32_t *)calloc(LCD_WIDTH * LCD_HIGH, sizeof(uint32_t));
+    if (!frame || !dma_frame || !psram_frame[0] || !psram_frame[1] || !rect || !test.expect || lcd_dirty_init(&dirty, &dirty_config) != 0) {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+    if (st7789_emu_init(&emu_config) != 0) {
+        fprintf(stderr, "emulator init failed\n");
+        return 1;
+    }
+
+    stats_begin(&start);
+    if (lcd_init(lcd_config) != 0) {
+        fprintf(stderr, "lcd_init failed\n");
+        return 1;
+    }
+    // 上电后GRAM内容不确定, 模型中为0
+    stats_end("init", start, 1);
+    if (!st7789_emu_display_on()) {
+        printf("  display is not on after init\n");
+        test.failed++;
+    }
+    printf("spi clock: %u Hz, pixel format: %s\n", host_spi_sim_clk(),
+           test.format == LCD_PIXEL_FORMAT_RGB444 ? "RGB444" : test.format == LCD_PIXEL_FORMAT_RGB666 ? "RGB666" : "RGB565");
+
+    // 同步接口, 普通内存经过中转buffer
+    synth_frame(frame, 0, 0);
+    stats_begin(&start);
+    lcd_set_index(0, 0, LCD_WIDTH - 1, LCD_HIGH - 1);
+    lcd_write_data(frame, frame_size);
+    expect_window(frame, 0, 0, LCD_WIDTH, LCD_HIGH, LCD_WIDTH * 2);
+    stats_end("sync_full_bounce", start, 1);
+
+    // 异步整帧, 内部DMA内存
+    synth_frame(dma_frame, 1, 1);
+    stats_begin(&start);
+    submit_full(dma_frame);
+    lcd_fence(portMAX_DELAY);
+    expect_window(dma_frame, 0, 0, LCD_WIDTH, LCD_HIGH, LCD_WIDTH * 2);
+    stats_end("async_full_dma_mem", start, 1);
+
+    // 异步连续多帧, PSRAM, 两个buffer交替
+    synth_frame(psram_frame[0], 2, 2);
+    synth_frame(psram_frame[1], 3, 3);
+    test.cb_cnt = 0;
+    stats_begin(&start);
+    for (int x = 0; x < 10; x++) {
+        submit_full(psram_frame[x % 2]);
+    }
+    lcd_fence(portMAX_DELAY);
+    expect_window(psram_frame[1], 0, 0, LCD_WIDTH, LCD_HIGH, LCD_WIDTH * 2);
+    stats_end("async_full_psram", start, 10);
+    if (test.cb_cnt != 10) {
+        printf("  %d callbacks, expected 10\n", test.cb_cnt);
+        test.failed++;
+    }
+
+    // 帧中的一块区域, 按行跨stride发送; RGB444要求偶数宽度
+    {
+        int x0 = 37, y0 = 21, w = test.format == LCD_PIXEL_FORMAT_RGB444 ? 102 : 101, h = 77;
+        uint8_t *data = psram_frame[0] + (y0 * LCD_WIDTH + x0) * 2;
+        lcd_trans_t trans = {
+            .set_index = 1,
+            .x_start = x0,
+            .y_start = y0,
+            .x_end = x0 + w - 1,
+            .y_end = y0 + h - 1,
+            .data = data,
+            .len = w * h * 2,
+            .stride = LCD_WIDTH * 2,
+        };
+        stats_begin(&start);
+        lcd_trans_submit(&trans, NULL, portMAX_DELAY);
+        lcd_fence(portMAX_DELAY);
+        expect_window(data, x0, y0, w, h, LCD_WIDTH * 2);
+        stats_end("window_stride", start, 1);
+    }
+
+    // 脏块刷新: 每帧只发送变化的窗口
+    synth_frame(psram_frame[0], 0, 0);
+    lcd_dirty_scan(&dirty, psram_frame[0], rect);
+    submit_full(psram_frame[0]);
+    lcd_fence(portMAX_DELAY);
+    expect_window(psram_frame[0], 0, 0, LCD_WIDTH, LCD_HIGH, LCD_WIDTH * 2);
+    stats_begin(&start);
+    for (int n = 1; n <= dirty_frames; n++) {
+        uint8_t *buf = psram_frame[n % 2];
+        int rect_cnt = 0;
+        synth_frame(buf, 0, n);
+        rect_cnt = lcd_dirty_scan(&dirty, buf, rect);
+        for (int x = 0; x < rect_cnt; x++) {
+            lcd_trans_t trans = {
+                .set_index = 1,
+                .x_start = rect[x].x,
+                .y_start = rect[x].y,
+                .x_end = rect[x].x + rect[x].w - 1,
+                .y_end = rect[x].y + rect[x].h - 1,
+                .data = buf + (rect[x].y * LCD_WIDTH + rect[x].x) * 2,
+                .len = rect[x].w * rect[x].h * 2,
+                .stride = LCD_WIDTH * 2,
+            };
+            lcd_trans_submit(&trans, NULL, portMAX_DELAY);
+        }
+        // 下一帧要覆盖另一个buffer之前, 这一帧必须发送完成
+        lcd_fence(portMAX_DELAY);
+    }
+    expect_window(psram_frame[dirty_frames % 2], 0, 0, LCD_WIDTH, LCD_HIGH, LCD_WIDTH * 2);
+    stats_end("dirty_tiles", start, dirty_frames);
+
+    // 不是整数个像素的长度被拒绝: 不启动DMA, 不发送数据, 画面不变
+    {
+        host_spi_sim_stats_t spi;
+        stats_begin(&start);
+        lcd_write_data(frame, 1);
+        lcd_write_data(frame, 3);
+        host_spi_sim_stats(&spi, false);
+        if (spi.bytes != 0 || spi.dma_transactions != 0) {
+            printf("  %u bytes, %u dma transactions for partial pixels, expected none\n", (unsigned)spi.bytes, (unsigned)spi.dma_transactions);
+            test.failed++;
+        }
+        stats_end("partial_pixel", start, 1);
+    }
+
+    st7789_emu_deinit();
+    lcd_dirty_deinit(&dirty);
+    printf("%s\n", test.failed ? "FAILED" : "OK");
+    return test.failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    lcd_config_t lcd_config = {
+        .clk_fre = 80 * 1000 * 1000,
+        .pin_clk = LCD_CLK,
+        .pin_mosi = LCD_MOSI,
+        .pin_dc = LCD_DC,
+        .pin_cs = LCD_CS,
+        .pin_rst = LCD_RST,
+        .pin_bk = LCD_BK,
+        .max_buffer_size = 4 * 1024,
+        .dma_seg_cnt = 4,
+        .psram_dma = 1,
+        .horizontal = 2,
+        .trans_queue_size = 2,
+        .task_stack = 2048,
+        .task_pri = configMAX_PRIORITIES - 1,
+    };
+    static const lcd_pixel_format_t formats[] = {LCD_PIXEL_FORMAT_RGB565, LCD_PIXEL_FORMAT_RGB444, LCD_PIXEL_FORMAT_RGB666};
+    int dirty_frames = 30;
+    int all_formats = 1;
+    int status = 0, failed = 0;
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-f") && x + 1 < argc) {
+            x++;
+            lcd_config.pixel_format = !strcmp(argv[x], "444") ? LCD_PIXEL_FORMAT_RGB444 : !strcmp(argv[x], "666") ? LCD_PIXEL_FORMAT_RGB666 : LCD_PIXEL_FORMAT_RGB565;
+            all_formats = 0;
+        } else if (!strcmp(argv[x], "-s") && x + 1 < argc) {
+            lcd_config.dma_seg_cnt = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-b") && x + 1 < argc) {
+            lcd_config.max_buffer_size = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-c") && x + 1 < argc) {
+            lcd_config.clk_fre = atoi(argv[++x]) * 1000 * 1000;
+        } else if (!strcmp(argv[x], "-n") && x + 1 < argc) {
+            dirty_frames = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-r")) {
+            host_spi_sim_set_realtime(true);
+        } else if (!strcmp(argv[x], "-o") && x + 1 < argc) {
+            test.png_dir = argv[++x];
+        } else {
+            fprintf(stderr, "usage: %s [-f 565|444|666] [-s dma_seg_cnt] [-b max_buffer_size] [-c clk_mhz] [-n dirty_frames] [-r] [-o png_dir]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!all_formats) {
+        return run(&lcd_config, dirty_frames);
+    }
+    for (int x = 0; x < sizeof(formats) / sizeof(formats[0]); x++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            lcd_config.pixel_format = formats[x];
+            exit(run(&lcd_config, dirty_frames));
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
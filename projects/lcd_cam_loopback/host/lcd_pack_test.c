@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "lcd_pack.h"
+
+// LCD像素打包(components/lcd/lcd_pack.c)在主机上的单元测试
+// 检查RGB444/RGB666打包后的字节排列: 固定的已知向量, 以及0~33个像素(奇数和偶数)的随机像素与逐分量参考实现比较,
+// 返回的长度等于lcd_pack_size, 不写出返回长度之外的字节, 源和目标不对齐时结果相同
+//
+//   lcd_pack_test [-v]
+
+#define GUARD_SIZE  (16)
+#define GUARD_BYTE  (0xA5)
+#define MAX_PIXELS  (33)
+
+static int verbose = 0;
+static int failed = 0;
+
+static void report(const char *name, int ok, const char *detail)
+{
+    if (!ok || verbose) {
+        printf("%-28s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    }
+    failed += !ok;
+}
+
+// 参考实现: 每个像素的R, G, B按4位分量依次排列, 每字节高半字节在前, 奇数个像素时最后补半个字节0
+static size_t ref_rgb444(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    size_t nibbles = 0;
+    for (size_t x = 0; x < pixels; x++) {
+        uint32_t p = (src[x * 2] << 8) | src[x * 2 + 1];
+        uint8_t c[3] = {(p >> 12) & 0x0F, (p >> 7) & 0x0F, (p >> 1) & 0x0F};
+        for (int y = 0; y < 3; y++, nibbles++) {
+            if (nibbles % 2 == 0) {
+                dst[nibbles / 2] = c[y] << 4;
+            } else {
+                dst[nibbles / 2] |= c[y];
+            }
+        }
+    }
+    return (nibbles + 1) / 2;
+}
+
+// 参考实现: 每个分量一个字节, 6位值在高位; 5位的R/B扩展为6位时最低位复制最高位
+static size_t ref_rgb666(const uint8_t *src, uint8_t *dst, size_t pixels)
+{
+    for (size_t x = 0; x < pixels; x++) {
+        uint32_t p = (src[x * 2] << 8) | src[x * 2 + 1];
+        uint32_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+        dst[x * 3] = ((r << 1) | (r >> 4)) << 2;
+        dst[x * 3 + 1] = g << 2;
+        dst[x * 3 + 2] = ((b << 1) | (b >> 4)) << 2;
+    }
+    return pixels * 3;
+}
+
+static int guard_ok(const uint8_t *buf, size_t len)
+{
+    for (size_t x = 0; x < GUARD_SIZE; x++) {
+        if (buf[len + x] != GUARD_BYTE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void hex(char *out, const uint8_t *data, size_t len)
+{
+    out[0] = '\0';
+    for (size_t x = 0; x < len; x++) {
+        sprintf(out + x * 3, "%02x ", data[x]);
+    }
+}
+
+// 已知的输入和输出
+static void test_vector(const char *name, lcd_pixel_format_t format, const uint16_t *pixel, size_t pixels, const uint8_t *expect, size_t expect_len)
+{
+    uint8_t src[16], dst[48 + GUARD_SIZE];
+    char got_str[160], expect_str[160], detail[360];
+
+    for (size_t x = 0; x < pixels; x++) {
+        src[x * 2] = pixel[x] >> 8;
+        src[x * 2 + 1] = pixel[x] & 0xFF;
+    }
+    memset(dst, GUARD_BYTE, sizeof(dst));
+    size_t len = lcd_pack(format, src, dst, pixels);
+    int ok = len == expect_len && lcd_pack_size(format, pixels) == expect_len && memcmp(dst, expect, expect_len) == 0 && guard_ok(dst, expect_len);
+    hex(got_str, dst, len < 48 ? len : 48);
+    hex(expect_str, expect, expect_len);
+    snprintf(detail, sizeof(detail), "got [%s] expected [%s]", got_str, expect_str);
+    report(name, ok, detail);
+}
+
+static void test_vectors(void)
+{
+    static const uint16_t white[] = {0xFFFF};
+    static const uint16_t red_blue[] = {0xF800, 0x001F};
+    static const uint16_t rgb[] = {0xF800, 0x07E0, 0x001F};
+    static const uint16_t ramp[] = {0x1234, 0x5678, 0x9ABC, 0xDEF0};
+    static const uint16_t low[] = {0x0821, 0x0841};
+
+    // RGB444: {R0G0, B0R1, G1B1}, 奇数个像素时最后一个字节的低半字节为0
+    test_vector("444_1_white", LCD_PIXEL_FORMAT_RGB444, white, 1, (const uint8_t[]) {0xFF, 0xF0}, 2);
+    test_vector("444_2_red_blue", LCD_PIXEL_FORMAT_RGB444, red_blue, 2, (const uint8_t[]) {0xF0, 0x00, 0x0F}, 3);
+    test_vector("444_3_rgb", LCD_PIXEL_FORMAT_RGB444, rgb, 3, (const uint8_t[]) {0xF0, 0x00, 0xF0, 0x00, 0xF0}, 5);
+    // 0x1234: R 00010 G 010001 B 10100 -> 1 4 A; 0x5678: 01010 110011 11000 -> 5 C C
+    // 0x9ABC: 10011 010101 11100 -> 9 5 E; 0xDEF0: 11011 110111 10000 -> D D 8
+    test_vector("444_4_ramp", LCD_PIXEL_FORMAT_RGB444, ramp, 4, (const uint8_t[]) {0x14, 0xA5, 0xCC, 0x95, 0xED, 0xD8}, 6);
+    test_vector("444_0", LCD_PIXEL_FORMAT_RGB444, ramp, 0, (const uint8_t[]) {0}, 0);
+
+    // RGB666: {R<<2, G<<2, B<<2}, 5位分量的最低位复制最高位
+    test_vector("666_1_white", LCD_PIXEL_FORMAT_RGB666, white, 1, (const uint8_t[]) {0xFC, 0xFC, 0xFC}, 3);
+    test_vector("666_2_red_blue", LCD_PIXEL_FORMAT_RGB666, red_blue, 2, (const uint8_t[]) {0xFC, 0x00, 0x00, 0x00, 0x00, 0xFC}, 6);
+    test_vector("666_2_low", LCD_PIXEL_FORMAT_RGB666, low, 2, (const uint8_t[]) {0x08, 0x04, 0x08, 0x08, 0x08, 0x08}, 6);
+    test_vector("666_3_rgb", LCD_PIXEL_FORMAT_RGB666, rgb, 3, (const uint8_t[]) {0xFC, 0x00, 0x00, 0x00, 0xFC, 0x00, 0x00, 0x00, 0xFC}, 9);
+
+    // RGB565: 原样复制
+    test_vector("565_3_rgb", LCD_PIXEL_FORMAT_RGB565, rgb, 3, (const uint8_t[]) {0xF8, 0x00, 0x07, 0xE0, 0x00, 0x1F}, 6);
+}
+
+// 随机像素, 0~MAX_PIXELS个像素, 源和目标分别偏移0~3字节
+static void test_random(lcd_pixel_format_t format, const char *name, size_t (*ref)(const uint8_t *, uint8_t *, size_t))
+{
+    uint8_t src[MAX_PIXELS * 2 + 4];
+    uint8_t dst[MAX_PIXELS * 3 + 4 + GUARD_SIZE], expect[MAX_PIXELS * 3];
+    uint32_t seed = 12345;
+    char detail[128];
+    int bad = 0, cases = 0;
+
+    for (size_t pixels = 0; pixels <= MAX_PIXELS; pixels++) {
+        for (int offset = 0; offset < 4; offset++) {
+            for (size_t x = 0; x < sizeof(src); x++) {
+                seed = seed * 1103515245 + 12345;
+                src[x] = seed >> 16;
+            }
+            uint8_t *in = src + offset, *out = dst + (3 - offset);
+            size_t expect_len = ref(in, expect, pixels);
+            memset(dst, GUARD_BYTE, sizeof(dst));
+            size_t len = lcd_pack(format, in, out, pixels);
+            int ok = len == expect_len && lcd_pack_size(format, pixels) == expect_len && memcmp(out, expect, expect_len) == 0 && guard_ok(out, expect_len);
+            for (int x = 0; x < 3 - offset; x++) {
+                ok = ok && dst[x] == GUARD_BYTE;
+            }
+            if (!ok && bad++ == 0) {
+                snprintf(detail, sizeof(detail), "first failure: %zu pixels, offset %d, len %zu (expected %zu)", pixels, offset, len, expect_len);
+            }
+            cases++;
+        }
+    }
+    if (!bad) {
+        snprintf(detail, sizeof(detail), "%d cases, 0~%d pixels", cases, MAX_PIXELS);
+    }
+    report(name, bad == 0, detail);
+}
+
+int main(int argc, char **argv)
+{
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    test_vectors();
+    test_random(LCD_PIXEL_FORMAT_RGB444, "444_random", ref_rgb444);
+    test_random(LCD_PIXEL_FORMAT_RGB666, "666_random", ref_rgb666);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "host_sim.h"
+#include "mem_budget.h"
+#include "jpeg.h"
+#include "jpeg_enc.h"
+#include "pipeline.h"
+#include "cam_rec.h"
+
+// 内存预算统计(components/mem_budget, MEM_BUDGET_ENABLE=1)在主机上的单元测试
+// 按组件和内存类型的当前用量/峰值, 失败计数, 表满, 峰值清除, 任务栈高水位(主机替身按实际栈用量模拟),
+// 以及jpeg(并发的jpeg_init只留一份工作buffer, 之后不再分配), pipeline(PSRAM buffer池和阶段任务), cam_rec(任务退出后的栈用量)的实际统计
+//
+//   mem_budget_test [-v]
+
+static int verbose = 0;
+static int failed = 0;
+static mem_budget_stats_t stats;
+
+static void report(const char *name, int ok, const char *detail)
+{
+    if (!ok || verbose) {
+        printf("%-28s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    }
+    failed += !ok;
+}
+
+static const mem_budget_tag_stats_t *find_tag(const char *tag)
+{
+    for (int x = 0; x < stats.tag_cnt; x++) {
+        if (strcmp(stats.tag[x].tag, tag) == 0) {
+            return &stats.tag[x];
+        }
+    }
+    static const mem_budget_tag_stats_t none = {0};
+    return &none;
+}
+
+static const mem_budget_task_stats_t *find_task(const char *name)
+{
+    for (int x = 0; x < stats.task_cnt; x++) {
+        if (stats.task[x].tag && strcmp(stats.task[x].name, name) == 0) {
+            return &stats.task[x];
+        }
+    }
+    static const mem_budget_task_stats_t none = {0};
+    return &none;
+}
+
+static void test_usage(void)
+{
+    char detail[160];
+    void *internal = mem_budget_malloc("t_usage", 100, MALLOC_CAP_DEFAULT);
+    void *dma = mem_budget_calloc("t_usage", 2, 50, MALLOC_CAP_DMA);
+    void *psram = mem_budget_malloc("t_usage", 300, MALLOC_CAP_SPIRAM);
+    void *fail = mem_budget_malloc("t_usage", HOST_SPIRAM_MEM_SIZE + 1, MALLOC_CAP_SPIRAM);
+    mem_budget_get_stats(&stats);
+    const mem_budget_tag_stats_t *t = find_tag("t_usage");
+    int ok = internal && dma && psram && !fail;
+    ok = ok && t->usage[MEM_BUDGET_INTERNAL].cur == 100 && t->usage[MEM_BUDGET_DMA].cur == 100 && t->usage[MEM_BUDGET_PSRAM].cur == 300;
+    ok = ok && t->usage[MEM_BUDGET_PSRAM].count == 1 && t->usage[MEM_BUDGET_PSRAM].fails == 1 && t->usage[MEM_BUDGET_PSRAM].allocs == 1;
+    sprintf(detail, "internal %u, dma %u, psram %u, psram fails %u", t->usage[0].cur, t->usage[1].cur, t->usage[2].cur, t->usage[2].fails);
+    report("usage_by_type", ok, detail);
+
+    mem_budget_free(dma);
+    mem_budget_free(internal);
+    internal = mem_budget_malloc("t_usage", 40, MALLOC_CAP_DEFAULT);
+    mem_budget_get_stats(&stats);
+    ok = t->usage[MEM_BUDGET_DMA].cur == 0 && t->usage[MEM_BUDGET_DMA].peak == 100;
+    ok = ok && t->usage[MEM_BUDGET_INTERNAL].cur == 40 && t->usage[MEM_BUDGET_INTERNAL].peak == 100 && t->usage[MEM_BUDGET_INTERNAL].allocs == 2;
+    sprintf(detail, "dma %u/%u, internal %u/%u", t->usage[1].cur, t->usage[1].peak, t->usage[0].cur, t->usage[0].peak);
+    report("free_keeps_peak", ok, detail);
+
+    // 不是mem_budget分配的指针直接释放, 不影响统计
+    uint32_t total = stats.total[MEM_BUDGET_INTERNAL].cur;
+    mem_budget_free(heap_caps_malloc(64, MALLOC_CAP_DEFAULT));
+    mem_budget_free(NULL);
+    mem_budget_get_stats(&stats);
+    report("free_untracked", stats.total[MEM_BUDGET_INTERNAL].cur == total, "");
+
+    mem_budget_reset_peak();
+    mem_budget_get_stats(&stats);
+    ok = t->usage[MEM_BUDGET_INTERNAL].peak == 40 && t->usage[MEM_BUDGET_DMA].peak == 0 && t->usage[MEM_BUDGET_PSRAM].peak == 300;
+    ok = ok && t->usage[MEM_BUDGET_PSRAM].fails == 0 && t->usage[MEM_BUDGET_INTERNAL].allocs == 0;
+    report("reset_peak", ok, "peak set to current");
+    mem_budget_free(internal);
+    mem_budget_free(psram);
+    mem_budget_get_stats(&stats);
+    ok = t->usage[0].cur == 0 && t->usage[1].cur == 0 && t->usage[2].cur == 0 && t->usage[0].count == 0;
+    report("all_freed", ok, "");
+}
+
+// 表满时仍然分配, 计入untracked, 释放不出错
+static void test_table_full(void)
+{
+    enum { N = MEM_BUDGET_MAX_ALLOC + 4 };
+    void *ptr[N];
+    char detail[96];
+
+    mem_budget_get_stats(&stats);
+    uint32_t untracked = stats.untracked;
+    int ok = 1;
+    for (int x = 0; x < N; x++) {
+        ptr[x] = mem_budget_malloc("t_full", 16, MALLOC_CAP_DEFAULT);
+        ok = ok && ptr[x];
+    }
+    mem_budget_get_stats(&stats);
+    const mem_budget_tag_stats_t *t = find_tag("t_full");
+    uint32_t count = t->usage[MEM_BUDGET_INTERNAL].count;
+    ok = ok && count <= MEM_BUDGET_MAX_ALLOC && count + stats.untracked - untracked == N && t->usage[MEM_BUDGET_INTERNAL].cur == count * 16;
+    sprintf(detail, "%u tracked, %u untracked", count, stats.untracked - untracked);
+    for (int x = 0; x < N; x++) {
+        mem_budget_free(ptr[x]);
+    }
+    mem_budget_get_stats(&stats);
+    ok = ok && t->usage[MEM_BUDGET_INTERNAL].cur == 0 && t->usage[MEM_BUDGET_INTERNAL].count == 0;
+    report("table_full", ok, detail);
+}
+
+typedef struct {
+    int bytes;
+    SemaphoreHandle_t ready;
+    SemaphoreHandle_t go;
+} stack_arg_t;
+
+static int __attribute__((noinline)) use_stack(int bytes)
+{
+    volatile uint8_t buf[bytes];
+    for (int x = 0; x < bytes; x++) {
+        buf[x] = x;
+    }
+    return buf[bytes / 2];
+}
+
+static void stack_task(void *arg)
+{
+    stack_arg_t *a = (stack_arg_t *)arg;
+    if (a->bytes) {
+        use_stack(a->bytes);
+    }
+    xSemaphoreGive(a->ready);
+    xSemaphoreTake(a->go, portMAX_DELAY);
+    MEM_TASK_DELETE();
+}
+
+static void test_task_stack(void)
+{
+    static stack_arg_t arg[3] = {{.bytes = 0}, {.bytes = 4000}, {.bytes = 4000}};
+    static const char *name[3] = {"t_small", "t_big", "t_over"};
+    static const uint32_t size[3] = {8192, 8192, 2048};
+    char detail[160];
+
+    for (int x = 0; x < 3; x++) {
+        arg[x].ready = xSemaphoreCreateBinary();
+        arg[x].go = xSemaphoreCreateBinary();
+        MEM_TASK_CREATE("t_task", stack_task, name[x], size[x], &arg[x], 5, NULL);
+        xSemaphoreTake(arg[x].ready, portMAX_DELAY);
+    }
+    mem_budget_get_stats(&stats);
+    const mem_budget_task_stats_t *small = find_task("t_small"), *big = find_task("t_big"), *over = find_task("t_over");
+    int ok = small->running && big->running && over->running && small->stack_size == 8192;
+    // 主机上libc(信号量等待等)本身的栈用量比设备上大, 只比较相对大小
+    ok = ok && big->stack_peak >= 4000 && big->stack_peak < 8192 && small->stack_peak < big->stack_peak;
+    sprintf(detail, "small %u, big %u, over %u/%u bytes", small->stack_peak, big->stack_peak, over->stack_peak, over->stack_size);
+    report("stack_high_water", ok, detail);
+    // 超过栈大小(在设备上会溢出)时用量为栈大小
+    report("stack_over", over->stack_peak == 2048, detail);
+    report("stack_by_tag", find_tag("t_task")->stack == 8192 + 8192 + 2048, "");
+
+    uint32_t big_peak = big->stack_peak;
+    for (int x = 0; x < 3; x++) {
+        xSemaphoreGive(arg[x].go);
+    }
+    vTaskDelay(50);
+    mem_budget_get_stats(&stats);
+    ok = !small->running && !big->running && !over->running && big->stack_peak >= big_peak && find_tag("t_task")->stack == 0;
+    report("task_exit", ok, "peak kept after MEM_TASK_DELETE");
+}
+
+static int idle_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    vTaskDelay(10);
+    return PIPELINE_DROP;
+}
+
+static int pass_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    return PIPELINE_PASS;
+}
+
+typedef struct {
+    int ret;
+    SemaphoreHandle_t go;
+    SemaphoreHandle_t done;
+} jpeg_init_arg_t;
+
+static void jpeg_init_task(void *arg)
+{
+    jpeg_init_arg_t *a = (jpeg_init_arg_t *)arg;
+    xSemaphoreTake(a->go, portMAX_DELAY);
+    a->ret = jpeg_init();
+    xSemaphoreGive(a->done);
+    MEM_TASK_DELETE();
+}
+
+static void test_components(void)
+{
+    char detail[160];
+    int len, w, h;
+
+    // jpeg: 多个任务同时第一次调用jpeg_init, 只留下一份工作buffer(抢输的任务释放自己的那份)
+    static jpeg_init_arg_t init_arg[4];
+    int ok = 1;
+    for (int x = 0; x < 4; x++) {
+        init_arg[x].ret = -1;
+        init_arg[x].go = xSemaphoreCreateBinary();
+        init_arg[x].done = xSemaphoreCreateBinary();
+        MEM_TASK_CREATE("t_jinit", jpeg_init_task, "t_jinit", 4096, &init_arg[x], 5, NULL);
+    }
+    for (int x = 0; x < 4; x++) {
+        xSemaphoreGive(init_arg[x].go);
+    }
+    for (int x = 0; x < 4; x++) {
+        xSemaphoreTake(init_arg[x].done, portMAX_DELAY);
+        ok = ok && init_arg[x].ret == 0;
+    }
+    mem_budget_get_stats(&stats);
+    const mem_budget_usage_t *u = &find_tag("jpeg")->usage[MEM_BUDGET_PSRAM];
+    uint32_t allocs = u->allocs;
+    sprintf(detail, "%u allocs, cur %u, count %u", u->allocs, u->cur, u->count);
+    report("jpeg_init_race", ok && u->cur == JPEG_WORK_BUF_SIZE && u->count == 1, detail);
+
+    // jpeg: 工作buffer之后每帧复用, 不再分配
+    uint8_t *rgb = (uint8_t *)calloc(64 * 48, 3);
+    uint8_t *jpeg = (uint8_t *)calloc(1, 64 * 1024);
+    uint8_t *out = (uint8_t *)heap_caps_malloc(64 * 48 * 2, MALLOC_CAP_SPIRAM);
+    len = jpeg_enc_rgb(rgb, 64, 48, 50, JPEG_ENC_422, jpeg, 64 * 1024);
+    for (int x = 0; x < 3; x++) {
+        jpeg_decode_to(jpeg, len, out, 64 * 48 * 2, &w, &h);
+    }
+    mem_budget_get_stats(&stats);
+    sprintf(detail, "%u allocs, cur %u", u->allocs, u->cur);
+    report("jpeg_work_once", len > 0 && u->allocs == allocs && u->cur == JPEG_WORK_BUF_SIZE, detail);
+    // jpeg_decode的输出由调用者用jpeg_free释放, 释放之前计入jpeg
+    uint8_t *img = jpeg_decode(jpeg, len, &w, &h);
+    mem_budget_get_stats(&stats);
+    ok = img && u->cur == JPEG_WORK_BUF_SIZE + 64 * 48 * 2 && u->count == 2;
+    sprintf(detail, "cur %u while held", u->cur);
+    jpeg_free(img);
+    mem_budget_get_stats(&stats);
+    report("jpeg_output", ok && u->cur == JPEG_WORK_BUF_SIZE && u->count == 1, detail);
+    heap_caps_free(out);
+    free(jpeg);
+    free(rgb);
+
+    // pipeline: 描述符和对象在内部RAM, buffer池在PSRAM, 每个阶段一个任务
+    static const pipeline_stage_t stages[] = {
+        {.name = "t_src", .func = idle_stage, .pool_size = 2, .buf_size = 1000, .buf_caps = MALLOC_CAP_SPIRAM, .task_stack = 3072, .task_pri = 5},
+        {.name = "t_sink", .func = pass_stage, .task_stack = 2048, .task_pri = 5},
+    };
+    pipeline_handle_t pipeline = NULL;
+    ok = pipeline_create(stages, 2, &pipeline) == 0;
+    vTaskDelay(20);
+    mem_budget_get_stats(&stats);
+    const mem_budget_tag_stats_t *t = find_tag("pipeline");
+    ok = ok && t->usage[MEM_BUDGET_PSRAM].cur == 2000 && t->usage[MEM_BUDGET_PSRAM].count == 2 && t->usage[MEM_BUDGET_INTERNAL].cur > 0;
+    ok = ok && t->stack == 3072 + 2048 && find_task("t_src")->running && find_task("t_src")->stack_peak > 0;
+    sprintf(detail, "internal %u, psram %u, stack %u", t->usage[0].cur, t->usage[2].cur, t->stack);
+    report("pipeline", ok, detail);
+
+    // cam_rec: 停止后buffer释放, 写文件任务退出, 保留其栈用量
+    cam_rec_config_t config = {.fp = tmpfile(), .buf_cnt = 2, .buf_size = 4096, .task_pri = 1};
+    cam_rec_handle_t rec = NULL;
+    uint8_t frame[256] = {0};
+    ok = config.fp && cam_rec_start(&config, &rec) == 0 && cam_rec_add(rec, frame, sizeof(frame), 16, 8, CAM_REC_FORMAT_RGB565) == 0;
+    vTaskDelay(20);
+    mem_budget_get_stats(&stats);
+    t = find_tag("cam_rec");
+    ok = ok && t->usage[MEM_BUDGET_PSRAM].cur == 8192 && t->stack == 3072 && find_task("cam_rec")->running;
+    sprintf(detail, "psram %u, stack %u", t->usage[2].cur, t->stack);
+    report("cam_rec_running", ok, detail);
+    ok = rec && cam_rec_stop(rec, NULL) == 0;
+    vTaskDelay(20);
+    mem_budget_get_stats(&stats);
+    ok = ok && t->usage[MEM_BUDGET_PSRAM].cur == 0 && t->usage[MEM_BUDGET_INTERNAL].cur == 0 && t->stack == 0;
+    ok = ok && !find_task("cam_rec")->running && find_task("cam_rec")->stack_peak > 0;
+    sprintf(detail, "cam_rec task used %u of %u bytes", find_task("cam_rec")->stack_peak, find_task("cam_rec")->stack_size);
+    report("cam_rec_stopped", ok, detail);
+    if (config.fp) {
+        fclose(config.fp);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        }
+    }
+    test_usage();
+    test_table_full();
+    test_task_stack();
+    test_components();
+    if (verbose) {
+        mem_budget_print();
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
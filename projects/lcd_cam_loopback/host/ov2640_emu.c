@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <string.h>
+#include "host_i2c_sim.h"
+#include "esp_timer.h"
+#include "ov2640_emu.h"
+
+#define BANK_SEL        (0xFF)
+#define DSP_BPADDR      (0x7C)
+#define DSP_BPDATA      (0x7D)
+#define DSP_RESET       (0xE0)
+#define SENSOR_COM7     (0x12)
+
+typedef struct {
+    uint8_t reg[2][256];
+    uint8_t sde[256];
+    uint8_t bank;
+    uint8_t ptr;            // 两相写设置的读地址
+    uint32_t reset_us;      // 软复位后不响应的时间
+    int64_t busy_until;
+    ov2640_emu_stats_t stats;
+} ov2640_emu_t;
+
+static ov2640_emu_t emu;
+
+// 复位后的ID寄存器, 其他寄存器没有建模默认值
+static void ov2640_emu_reset(void)
+{
+    memset(emu.reg, 0, sizeof(emu.reg));
+    memset(emu.sde, 0, sizeof(emu.sde));
+    emu.reg[1][0x0A] = 0x26;
+    emu.reg[1][0x0B] = 0x42;
+    emu.reg[1][0x1C] = 0x7F;
+    emu.reg[1][0x1D] = 0xA2;
+}
+
+void ov2640_emu_power_on(void)
+{
+    ov2640_emu_reset();
+    emu.busy_until = 0;
+    emu.bank = 0;
+    emu.ptr = 0;
+}
+
+static void ov2640_emu_write_reg(uint8_t reg, uint8_t data)
+{
+    emu.stats.writes++;
+    if (reg == BANK_SEL) {
+        emu.stats.bank_writes++;
+        emu.stats.redundant += emu.bank == (data & 0x01);
+        emu.bank = data & 0x01;
+        emu.reg[0][BANK_SEL] = emu.reg[1][BANK_SEL] = data;
+        return;
+    }
+    if (emu.bank == 0 && reg == DSP_BPDATA) {
+        emu.sde[emu.reg[0][DSP_BPADDR]++] = data;
+        return;
+    }
+    if (emu.bank == 1 && reg == SENSOR_COM7 && (data & 0x80)) {
+        // 软复位不影响寄存器组选择
+        emu.stats.resets++;
+        ov2640_emu_reset();
+        emu.busy_until = esp_timer_get_time() + emu.reset_us;
+        return;
+    }
+    if (!(emu.bank == 0 && reg == DSP_RESET) && !(emu.bank == 1 && reg == SENSOR_COM7)) {
+        emu.stats.redundant += emu.reg[emu.bank][reg] == data;
+    }
+    emu.reg[emu.bank][reg] = data;
+}
+
+static bool ov2640_emu_write(void *arg, uint8_t addr, const uint8_t *data, size_t len)
+{
+    if (addr != OV2640_EMU_ADDR || len == 0 || esp_timer_get_time() < emu.busy_until) {
+        return false;
+    }
+    emu.ptr = data[0];
+    // SCCB每次只写一个寄存器, 多余的字节按同一地址处理
+    for (size_t x = 1; x < len; x++) {
+        ov2640_emu_write_reg(emu.ptr, data[x]);
+    }
+    return true;
+}
+
+static bool ov2640_emu_read(void *arg, uint8_t addr, uint8_t *data, size_t len)
+{
+    if (addr != OV2640_EMU_ADDR || esp_timer_get_time() < emu.busy_until) {
+        return false;
+    }
+    for (size_t x = 0; x < len; x++) {
+        emu.stats.reads++;
+        data[x] = emu.reg[emu.bank][emu.ptr];
+    }
+    return true;
+}
+
+int ov2640_emu_init(int i2c_port)
+{
+    host_i2c_dev_t dev = {
+        .write = ov2640_emu_write,
+        .read = ov2640_emu_read,
+    };
+    memset(&emu, 0, sizeof(emu));
+    ov2640_emu_power_on();
+    return host_i2c_sim_attach(i2c_port, &dev);
+}
+
+void ov2640_emu_reset_time(uint32_t us)
+{
+    emu.reset_us = us;
+}
+
+uint8_t ov2640_emu_reg(int bank, uint8_t reg)
+{
+    return emu.reg[bank & 0x01][reg];
+}
+
+uint8_t ov2640_emu_sde(uint8_t addr)
+{
+    return emu.sde[addr];
+}
+
+void ov2640_emu_geometry(ov2640_emu_geometry_t *geo)
+{
+    const uint8_t *dsp = emu.reg[0], *sensor = emu.reg[1];
+    uint16_t hsize = 0, vsize = 0, outw = 0, outh = 0;
+    memset(geo, 0, sizeof(ov2640_emu_geometry_t));
+
+    geo->href_start = (sensor[0x17] << 3) | (sensor[0x32] & 0x07);
+    geo->href_end = (sensor[0x18] << 3) | ((sensor[0x32] >> 3) & 0x07);
+    geo->vref_start = (sensor[0x19] << 2) | (sensor[0x03] & 0x03);
+    geo->vref_end = (sensor[0x1A] << 2) | ((sensor[0x03] >> 2) & 0x03);
+
+    geo->image_w = (dsp[0xC0] << 3) | ((dsp[0x8C] >> 3) & 0x07) | ((dsp[0x8C] & 0x80) << 4);
+    geo->image_h = (dsp[0xC1] << 3) | (dsp[0x8C] & 0x07);
+
+    // HSIZE/VSIZE/OFFX/OFFY的低8位和VHYX/TEST中的高位, HSIZE/VSIZE以4像素为单位
+    hsize = dsp[0x51] | ((dsp[0x55] & 0x08) << 5) | ((dsp[0x57] & 0x80) << 2);
+    vsize = dsp[0x52] | ((dsp[0x55] & 0x80) << 1);
+    geo->win_x = dsp[0x53] | ((dsp[0x55] & 0x07) << 8);
+    geo->win_y = dsp[0x54] | ((dsp[0x55] & 0x70) << 4);
+    geo->win_w = hsize * 4;
+    geo->win_h = vsize * 4;
+
+    outw = dsp[0x5A] | ((dsp[0x5C] & 0x03) << 8);
+    outh = dsp[0x5B] | ((dsp[0x5C] & 0x04) << 6);
+    geo->out_w = outw * 4;
+    geo->out_h = outh * 4;
+    geo->zoom_x = geo->out_w ? (float)geo->win_w / geo->out_w : 0;
+    geo->zoom_y = geo->out_h ? (float)geo->win_h / geo->out_h : 0;
+
+    geo->clkrc = sensor[0x11];
+    geo->jpeg = (dsp[0xDA] >> 4) & 0x01;
+    geo->dvp_format = (dsp[0xDA] >> 2) & 0x03;
+    geo->byte_swap = dsp[0xDA] & 0x01;
+}
+
+void ov2640_emu_stats(ov2640_emu_stats_t *stats, bool reset)
+{
+    *stats = emu.stats;
+    if (reset) {
+        memset(&emu.stats, 0, sizeof(emu.stats));
+    }
+}
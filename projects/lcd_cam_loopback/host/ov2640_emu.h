@@ -0,0 +1,69 @@
+#pragma once
+
+// OV2640模型: 挂在模拟I2C端口上, 维护DSP(0xFF=0)和sensor(0xFF=1)两组寄存器以及
+// BPADDR/BPDATA间接寄存器, 将写入的寄存器还原为实际生效的传感器窗口, DSP输入尺寸和开窗,
+// 输出尺寸和缩放比例, 并统计寄存器访问次数
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OV2640_EMU_ADDR     (0x30)      // 7位地址, 即SCCB_ID >> 1
+
+typedef struct {
+    uint32_t writes;        // 寄存器写次数(包括0xFF)
+    uint32_t reads;
+    uint32_t bank_writes;   // 0xFF写次数
+    uint32_t redundant;     // 写入值与当前值相同的次数, 不包括0x7D/0xE0/COM7
+    uint32_t resets;        // COM7软复位次数
+} ov2640_emu_stats_t;
+
+typedef struct {
+    // 传感器窗口, HREFST/HREFEND/REG32, VSTRT/VEND/COM1, 单位与OV2640_Window_Set相同
+    uint16_t href_start;
+    uint16_t href_end;
+    uint16_t vref_start;
+    uint16_t vref_end;
+    // DSP输入图像尺寸, HSIZE2/VSIZE2/SIZEL(OV2640_ImageSize_Set)
+    uint16_t image_w;
+    uint16_t image_h;
+    // DSP开窗, HSIZE1/VSIZE1/XOFFL/YOFFL/VHYX/TEST(OV2640_ImageWin_Set)
+    uint16_t win_x;
+    uint16_t win_y;
+    uint16_t win_w;
+    uint16_t win_h;
+    // 输出尺寸, ZMOW/ZMOH/ZMHH(OV2640_OutSize_Set)
+    uint16_t out_w;
+    uint16_t out_h;
+    float zoom_x;           // 开窗/输出, 大于1为缩小
+    float zoom_y;
+    uint8_t clkrc;
+    uint8_t jpeg;           // IMAGE_MODE bit4
+    uint8_t dvp_format;     // IMAGE_MODE bit3:2, 0: YUV422, 1: RAW10, 2: RGB565
+    uint8_t byte_swap;      // IMAGE_MODE bit0
+} ov2640_emu_geometry_t;
+
+// 挂到I2C端口上, 并进入上电状态
+int ov2640_emu_init(int i2c_port);
+
+// 上电状态: 寄存器为0(ID寄存器除外), 选择DSP组
+void ov2640_emu_power_on(void);
+
+// 软复位后us微秒内不响应(地址NACK), 模拟传感器复位时间; 默认0
+void ov2640_emu_reset_time(uint32_t us);
+
+uint8_t ov2640_emu_reg(int bank, uint8_t reg);
+
+// BPADDR/BPDATA间接寄存器
+uint8_t ov2640_emu_sde(uint8_t addr);
+
+void ov2640_emu_geometry(ov2640_emu_geometry_t *geo);
+
+void ov2640_emu_stats(ov2640_emu_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ov2640cfg.h"
+#include "ov2640_pack.h"
+#include "ov2640cfg_pack.h"
+
+// 由ov2640cfg.h中的寄存器表生成压缩表ov2640cfg_pack.h, 并验证:
+// 1. 新生成的文件与已有的ov2640cfg_pack.h相同(寄存器表修改后需要重新生成)
+// 2. ov2640cfg_pack.h中的压缩表按不同的分段长度流式解码, 写入序列与原表逐项相同
+//
+//   ov2640_table_gen <ov2640cfg_pack.h>       检查
+//   ov2640_table_gen -o <ov2640cfg_pack.h>    重新生成
+
+#define PACK_MAX_SIZE   (4096)
+
+typedef struct {
+    const char *name;
+    const uint8_t (*table)[2];
+    uint16_t len;
+    const uint8_t *pack;    // 已生成的压缩表
+} table_t;
+
+#define TABLE(tbl, pack) {#tbl, tbl, sizeof(tbl) / 2, pack}
+
+static const table_t tables[] = {
+    TABLE(ov2640_uxga_init_reg_tbl, ov2640_uxga_init_reg_pack),
+    TABLE(ov2640_svga_init_reg_tbl, ov2640_svga_init_reg_pack),
+    TABLE(ov2640_yuv422_reg_tbl, ov2640_yuv422_reg_pack),
+    TABLE(ov2640_jpeg_reg_tbl, ov2640_jpeg_reg_pack),
+    TABLE(ov2640_rgb565_reg_tbl, ov2640_rgb565_reg_pack),
+};
+
+#define TABLE_CNT (sizeof(tables) / sizeof(tables[0]))
+
+// xxx_reg_tbl -> xxx_reg_pack
+static void pack_name(const char *name, char *out, size_t size)
+{
+    size_t len = strlen(name) - strlen("tbl");
+    snprintf(out, size, "%.*spack", (int)len, name);
+}
+
+static char *generate(size_t *size)
+{
+    static uint8_t pack[PACK_MAX_SIZE];
+    char name[64];
+    char *text = NULL;
+    FILE *fp = open_memstream(&text, size);
+    uint32_t raw_total = 0, pack_total = 0;
+
+    fprintf(fp, "#pragma once\r\n");
+    fprintf(fp, "//由host/ov2640_table_gen根据ov2640cfg.h生成, 不要手动修改\r\n");
+    fprintf(fp, "//格式见ov2640_pack.h\r\n\r\n");
+    fprintf(fp, "#include <stdint.h>\r\n");
+    for (int x = 0; x < TABLE_CNT; x++) {
+        uint32_t len = ov2640_pack_encode(tables[x].table, tables[x].len, pack, sizeof(pack));
+        if (len == 0) {
+            fprintf(stderr, "%s: pack buffer too small\n", tables[x].name);
+            exit(1);
+        }
+        raw_total += tables[x].len * 2;
+        pack_total += len;
+        pack_name(tables[x].name, name, sizeof(name));
+        fprintf(fp, "\r\n//%s: %u个寄存器, %u字节 -> %u字节\r\n", tables[x].name, tables[x].len, tables[x].len * 2, len);
+        fprintf(fp, "static const uint8_t %s[] = {", name);
+        for (uint32_t i = 0; i < len; i++) {
+            fprintf(fp, "%s0x%02X,", i % 16 ? " " : "\r\n    ", pack[i]);
+        }
+        fprintf(fp, "\r\n};\r\n");
+    }
+    fprintf(fp, "\r\n//合计: %u字节 -> %u字节\r\n", raw_total, pack_total);
+    fclose(fp);
+    return text;
+}
+
+// 按每段max个寄存器流式解码, 与原表比较
+static int verify(const table_t *t, uint16_t max)
+{
+    uint8_t chunk[64][2];
+    ov2640_pack_iter_t it;
+    uint16_t pos = 0, n = 0;
+    ov2640_pack_begin(&it, t->pack);
+    while ((n = ov2640_pack_read(&it, chunk, max)) > 0) {
+        for (uint16_t i = 0; i < n; i++, pos++) {
+            if (pos >= t->len || chunk[i][0] != t->table[pos][0] || chunk[i][1] != t->table[pos][1]) {
+                printf("  %s: entry %u differs (chunk %u)\n", t->name, pos, max);
+                return -1;
+            }
+        }
+    }
+    if (pos != t->len) {
+        printf("  %s: %u entries decoded, expected %u (chunk %u)\n", t->name, pos, t->len, max);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16_t chunks[] = {1, 2, 7, 32, 64};
+    const char *path = NULL;
+    int write = 0, failed = 0;
+    size_t size = 0;
+    char *text = NULL;
+
+    if (argc == 3 && !strcmp(argv[1], "-o")) {
+        write = 1;
+        path = argv[2];
+    } else if (argc == 2) {
+        path = argv[1];
+    } else {
+        fprintf(stderr, "usage: %s [-o] <ov2640cfg_pack.h>\n", argv[0]);
+        return 2;
+    }
+
+    text = generate(&size);
+    if (write) {
+        FILE *fp = fopen(path, "wb");
+        if (!fp || fwrite(text, 1, size, fp) != size) {
+            fprintf(stderr, "%s: write failed\n", path);
+            return 1;
+        }
+        fclose(fp);
+        printf("%s written, rebuild to verify\n", path);
+        free(text);
+        return 0;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    char *old = (char *)calloc(1, size + 1);
+    size_t old_size = fp ? fread(old, 1, size + 1, fp) : 0;
+    if (fp) {
+        fclose(fp);
+    }
+    int same = old_size == size && !memcmp(old, text, size);
+    failed += !same;
+    printf("%-28s %s\n", "generated_up_to_date", same ? "PASS" : "FAIL (run with -o to regenerate)");
+    free(old);
+    free(text);
+
+    for (int x = 0; x < TABLE_CNT; x++) {
+        int ok = 1;
+        for (int c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+            ok &= verify(&tables[x], chunks[c]) == 0;
+        }
+        failed += !ok;
+        printf("%-28s %s\n", tables[x].name, ok ? "PASS" : "FAIL");
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "pipeline.h"
+#include "trace.h"
+
+// 流水线(components/pipeline)在主机上的验证: 用固定耗时的假阶段代替采集, 解码和显示
+// 采集阶段模拟等待下一帧, 解码阶段校验并改写数据, 可以按比例丢帧, 显示阶段提交给模拟的异步LCD
+// (队列深度1, 提交时阻塞, 与lcd_trans_submit相同), LCD传输完成后归还buffer
+// 检查: 输出帧率接近最慢阶段的帧率(而不是各阶段时间之和), 统计指出的瓶颈阶段正确,
+// 帧按顺序到达, 数据没有错乱, 丢帧不泄漏buffer
+//
+// -t: 每个场景结束时把追踪事件(trace_dump)追加到文件, trace2chrome转换最后一个场景, -s只运行一个场景
+//
+//   pipeline_bench [-v] [-s scenario] [-t trace.log]
+
+#define BUF_SIZE    (256)
+#define WARMUP_MS   (200)
+#define MEASURE_MS  (1000)
+
+typedef struct {
+    const char *name;
+    uint32_t capture_us;
+    uint32_t decode_us;
+    uint32_t display_us;
+    uint32_t drop_every;    // 解码阶段每隔多少帧丢一帧, 0: 不丢
+    uint8_t in_place;       // 在解码和显示之间插入一个原地处理的阶段
+    const char *bottleneck; // NULL: 不检查
+} scenario_t;
+
+typedef struct {
+    const scenario_t *s;
+    volatile int stop;
+    volatile int bad;           // 数据或顺序错误
+    volatile uint32_t shown;
+    volatile uint32_t last_seq;
+    QueueHandle_t lcd_queue;
+} bench_t;
+
+static int verbose = 0;
+static int failed = 0;
+static FILE *trace_fp = NULL;
+
+static void sleep_us(uint32_t us)
+{
+    if (us) {
+        usleep(us);
+    }
+}
+
+static int capture_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    bench_t *b = (bench_t *)arg;
+    if (b->stop) {
+        vTaskDelay(10);
+        return PIPELINE_DROP;
+    }
+    sleep_us(b->s->capture_us);
+    memset(out->data, (uint8_t)out->seq, BUF_SIZE);
+    out->len = BUF_SIZE;
+    return PIPELINE_PASS;
+}
+
+static int decode_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    bench_t *b = (bench_t *)arg;
+    sleep_us(b->s->decode_us);
+    for (int x = 0; x < in->len; x++) {
+        if (in->data[x] != (uint8_t)in->seq) {
+            b->bad = 1;
+            break;
+        }
+    }
+    if (b->s->drop_every && in->seq % b->s->drop_every == 0) {
+        return PIPELINE_DROP;
+    }
+    for (int x = 0; x < in->len; x++) {
+        out->data[x] = in->data[x] ^ 0x5A;
+    }
+    out->len = in->len;
+    return PIPELINE_PASS;
+}
+
+// 原地处理: 不分配新buffer, 把数据恢复为采集的内容
+static int in_place_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    for (int x = 0; x < in->len; x++) {
+        in->data[x] ^= 0x5A;
+    }
+    return PIPELINE_PASS;
+}
+
+static int display_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    bench_t *b = (bench_t *)arg;
+    uint8_t expect = (uint8_t)in->seq ^ (b->s->in_place ? 0 : 0x5A);
+    for (int x = 0; x < in->len; x++) {
+        if (in->data[x] != expect) {
+            b->bad = 1;
+            break;
+        }
+    }
+    if (b->shown && in->seq <= b->last_seq) {
+        b->bad = 1;
+    }
+    b->last_seq = in->seq;
+    b->shown++;
+    // 模拟lcd_trans_submit: 队列满时阻塞, 传输完成后在LCD任务中归还buffer
+    xQueueSend(b->lcd_queue, (void *)&in, portMAX_DELAY);
+    return PIPELINE_HOLD;
+}
+
+static void lcd_task(void *arg)
+{
+    bench_t *b = (bench_t *)arg;
+    pipeline_buf_t *buf = NULL;
+    while (1) {
+        xQueueReceive(b->lcd_queue, (void *)&buf, portMAX_DELAY);
+        TRACE_BEGIN(TRACE_ID_LCD_TRANS, buf->len);
+        sleep_us(b->s->display_us);
+        TRACE_END(TRACE_ID_LCD_TRANS, buf->len);
+        pipeline_buf_release(buf);
+    }
+}
+
+static void run(const scenario_t *s)
+{
+    bench_t *b = (bench_t *)calloc(1, sizeof(bench_t));
+    pipeline_stage_t *stages = (pipeline_stage_t *)calloc(4, sizeof(pipeline_stage_t));
+    pipeline_handle_t pipeline = NULL;
+    pipeline_stats_t stats;
+    int cnt = 0;
+
+    b->s = s;
+    b->lcd_queue = xQueueCreate(1, sizeof(pipeline_buf_t *));
+    xTaskCreate(lcd_task, "lcd", 2048, b, 5, NULL);
+    stages[cnt++] = (pipeline_stage_t) {.name = "capture", .func = capture_stage, .arg = b, .pool_size = 2, .buf_size = BUF_SIZE};
+    stages[cnt++] = (pipeline_stage_t) {.name = "decode", .func = decode_stage, .arg = b, .pool_size = 2, .buf_size = BUF_SIZE};
+    if (s->in_place) {
+        stages[cnt++] = (pipeline_stage_t) {.name = "convert", .func = in_place_stage, .arg = b};
+    }
+    stages[cnt++] = (pipeline_stage_t) {.name = "display", .func = display_stage, .arg = b};
+    if (pipeline_create(stages, cnt, &pipeline) != 0) {
+        printf("%-20s FAIL  create\n", s->name);
+        failed++;
+        return;
+    }
+    vTaskDelay(WARMUP_MS);
+    pipeline_get_stats(pipeline, &stats, true);
+    vTaskDelay(MEASURE_MS);
+    pipeline_get_stats(pipeline, &stats, false);
+    if (verbose) {
+        pipeline_print_stats(pipeline, false);
+    }
+    // 停止采集, 流水线中的帧处理完之后不再有新帧
+    b->stop = 1;
+    if (trace_fp) {
+        trace_enable(false);
+        trace_dump(trace_fp);
+        fflush(trace_fp);
+        trace_enable(true);
+    }
+
+    uint32_t slowest = s->capture_us;
+    slowest = s->decode_us > slowest ? s->decode_us : slowest;
+    slowest = s->display_us > slowest ? s->display_us : slowest;
+    double expect = 1e6 / slowest;
+    double serial = 1e6 / (s->capture_us + s->decode_us + s->display_us);
+    double fps = stats.frames * 1e6 / stats.elapsed_us;
+    if (s->drop_every) {
+        expect = expect * (s->drop_every - 1) / s->drop_every;
+    }
+    // 瓶颈: 执行时间(包括阻塞在提交上的时间)或异步传输占用时间最长的阶段, 同pipeline_print_stats
+    int bottleneck = 0;
+    uint64_t busy_max = 0;
+    for (int x = 0; x < stats.stage_cnt; x++) {
+        uint64_t busy = stats.stage[x].busy_us > stats.stage[x].hold_us ? stats.stage[x].busy_us : stats.stage[x].hold_us;
+        if (busy >= busy_max) {
+            busy_max = busy;
+            bottleneck = x;
+        }
+    }
+    int ok = !b->bad && fps > expect * 0.85 && fps < expect * 1.05 && (!s->bottleneck || !strcmp(stages[bottleneck].name, s->bottleneck));
+    failed += !ok;
+    printf("%-20s %s  %6.1f fps (slowest stage %6.1f, serial %6.1f)  latency avg %6.2f ms max %6.2f ms  bottleneck %-8s drops %u\n",
+           s->name, ok ? "PASS" : "FAIL", fps, expect, serial,
+           stats.frames ? stats.latency_us / 1000.0 / stats.frames : 0, stats.latency_max_us / 1000.0,
+           stages[bottleneck].name, stats.stage[1].drops);
+    // 流水线和bench对象不释放, 阶段任务仍在运行
+}
+
+int main(int argc, char **argv)
+{
+    static const scenario_t scenarios[] = {
+        {"balanced",        8000,  8000,  8000, 0, 0, NULL},
+        {"decode_bound",    4000, 16000,  6000, 0, 0, "decode"},
+        {"display_bound",   4000,  6000, 16000, 0, 0, "display"},
+        {"capture_bound",  16000,  4000,  6000, 0, 0, "capture"},
+        {"decode_drops",    5000, 12000,  5000, 4, 0, "decode"},
+        {"in_place_stage",  4000, 10000,  6000, 0, 1, "decode"},
+    };
+
+    const char *only = NULL;
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        } else if (!strcmp(argv[x], "-s") && x + 1 < argc) {
+            only = argv[++x];
+        } else if (!strcmp(argv[x], "-t") && x + 1 < argc) {
+            trace_fp = fopen(argv[++x], "w");
+            if (!trace_fp) {
+                perror(argv[x]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-v] [-s scenario] [-t trace.log]\n", argv[0]);
+            return 2;
+        }
+    }
+    for (int x = 0; x < sizeof(scenarios) / sizeof(scenarios[0]); x++) {
+        if (!only || !strcmp(only, scenarios[x].name)) {
+            run(&scenarios[x]);
+        }
+    }
+    if (trace_fp) {
+        fclose(trace_fp);
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
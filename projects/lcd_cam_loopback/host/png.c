@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "png.h"
+
+#define DEFLATE_BLOCK_MAX (65535)
+
+static uint32_t crc_table[256];
+
+static void crc_init(void)
+{
+    uint32_t c;
+    for (uint32_t n = 0; n < 256; n++) {
+        c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t x = 0; x < len; x++) {
+        crc = crc_table[(crc ^ data[x]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_be32(uint8_t *out, uint32_t value)
+{
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static int write_chunk(FILE *fp, const char *type, const uint8_t *data, size_t len)
+{
+    uint8_t head[8], tail[4];
+    uint32_t crc = 0xFFFFFFFFu;
+    put_be32(head, len);
+    memcpy(head + 4, type, 4);
+    crc = crc_update(crc, head + 4, 4);
+    crc = crc_update(crc, data, len);
+    put_be32(tail, crc ^ 0xFFFFFFFFu);
+    if (fwrite(head, 1, 8, fp) != 8 || (len && fwrite(data, 1, len, fp) != len) || fwrite(tail, 1, 4, fp) != 4) {
+        return -1;
+    }
+    return 0;
+}
+
+int png_write_rgb(const char *path, int width, int high, const uint8_t *rgb)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    size_t raw_len = (size_t)(width * 3 + 1) * high;
+    size_t blocks = (raw_len + DEFLATE_BLOCK_MAX - 1) / DEFLATE_BLOCK_MAX;
+    size_t zlen = 2 + raw_len + blocks * 5 + 4;
+    uint8_t ihdr[13] = {0};
+    uint8_t *raw = NULL, *z = NULL, *p = NULL;
+    uint32_t a = 1, b = 0;
+    size_t size = 0;
+    FILE *fp = NULL;
+    int ret = -1;
+
+    crc_init();
+    raw = (uint8_t *)malloc(raw_len);
+    z = (uint8_t *)malloc(zlen);
+    if (!raw || !z) {
+        goto exit;
+    }
+    // 每行前加过滤类型0
+    for (int y = 0; y < high; y++) {
+        raw[y * (width * 3 + 1)] = 0;
+        memcpy(&raw[y * (width * 3 + 1) + 1], &rgb[y * width * 3], width * 3);
+    }
+    // zlib头, 不压缩的deflate块, adler32
+    p = z;
+    *p++ = 0x78;
+    *p++ = 0x01;
+    for (size_t pos = 0; pos < raw_len; pos += size) {
+        size = raw_len - pos > DEFLATE_BLOCK_MAX ? DEFLATE_BLOCK_MAX : raw_len - pos;
+        *p++ = (pos + size == raw_len) ? 1 : 0;
+        *p++ = size & 0xFF;
+        *p++ = size >> 8;
+        *p++ = ~size & 0xFF;
+        *p++ = (~size >> 8) & 0xFF;
+        memcpy(p, raw + pos, size);
+        p += size;
+    }
+    for (size_t x = 0; x < raw_len; x++) {
+        a = (a + raw[x]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_be32(p, (b << 16) | a);
+
+    put_be32(ihdr, width);
+    put_be32(ihdr + 4, high);
+    ihdr[8] = 8;    // bit depth
+    ihdr[9] = 2;    // RGB
+
+    fp = fopen(path, "wb");
+    if (!fp) {
+        goto exit;
+    }
+    if (fwrite(signature, 1, sizeof(signature), fp) != sizeof(signature) ||
+        write_chunk(fp, "IHDR", ihdr, sizeof(ihdr)) != 0 ||
+        write_chunk(fp, "IDAT", z, zlen) != 0 ||
+        write_chunk(fp, "IEND", NULL, 0) != 0) {
+        goto exit;
+    }
+    ret = 0;
+exit:
+    if (fp) {
+        fclose(fp);
+    }
+    free(raw);
+    free(z);
+    return ret;
+}
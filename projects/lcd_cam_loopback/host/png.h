@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 写8位RGB的PNG文件(不压缩的deflate块), rgb每行width * 3字节
+// 返回值:0,成功;-1,文件写入失败
+int png_write_rgb(const char *path, int width, int high, const uint8_t *rgb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "cam.h"
+#include "cam_rec.h"
+#include "cam_replay.h"
+#include "jpeg.h"
+#include "jpeg_enc.h"
+#include "pipeline.h"
+#include "jpeg_stages.h"
+
+// 用录制的画面(components/cam_rec)运行main.c的JPEG_MODE流水线: 采集和解码阶段与main.c编译同一份main/jpeg_stages.c
+// (cam_take由cam_replay回放), 只有显示阶段不同: 代替LCD计算所有输出帧的CRC32(digest),
+// 同一个录制文件每次运行得到相同的digest, 可以比较不同的流水线配置或解码器修改
+// 只支持JPEG_MODE的录制, RGB565的帧解码失败, 计入decode errors
+// 默认尽快回放(不丢帧, 确定性), -r按录制的时间间隔回放(同摄像头, 处理不过来时丢帧)
+//
+// -g: 用cam_rec录制合成的JPEG帧(运动的物体, 细节和JPEG长度逐帧变化), 可以代替设备上录制的文件试用
+// -t: 自检: 录制(包括放不下而丢弃的帧), 读回比较, 回放两次digest相同且等于逐帧解码的结果, 实时回放的时间, 截断的文件
+//
+//   replay_bench [-v] [-r] [-l loops] [-d display_us] file.rec
+//   replay_bench -g file.rec [-n frames] [-w width] [-h high]
+//   replay_bench -t
+
+#define FRAME_INTERVAL_MS   (33)
+#define JPEG_QUALITY        (50)
+
+typedef struct {
+    jpeg_stages_t stages;
+    volatile uint32_t shown;
+    uint32_t digest;
+    uint32_t display_us;
+} bench_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t errors;
+    uint32_t dropped;               // 回放时丢弃的帧(-r)
+    uint32_t digest;
+    int64_t elapsed_us;
+    int64_t span_us;                // 录制的时间
+    pipeline_stats_t stats;
+    const char *bottleneck;
+} run_result_t;
+
+static int verbose = 0;
+static int failed = 0;
+
+// 代替lcd_trans_submit: 计算digest, -d模拟LCD的传输时间
+static int display_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    bench_t *b = (bench_t *)arg;
+    b->digest = cam_rec_crc32(b->digest, in->data, in->len);
+    if (b->display_us) {
+        usleep(b->display_us);
+    }
+    b->shown++;
+    return PIPELINE_PASS;
+}
+
+static int run(const char *path, int realtime, uint32_t loops, uint32_t display_us, run_result_t *r)
+{
+    cam_replay_config_t config = {.path = path, .realtime = realtime, .loops = loops, .task_pri = 5};
+    cam_replay_stats_t rs;
+    pipeline_handle_t pipeline = NULL;
+
+    memset(r, 0, sizeof(run_result_t));
+    if (cam_replay_init(&config) != 0) {
+        return -1;
+    }
+    cam_replay_get_stats(&rs);
+    // 录制中没有尺寸时按UXGA分配解码buffer
+    uint32_t pixels = rs.max_pixels ? rs.max_pixels : 1600 * 1200;
+    bench_t *b = (bench_t *)calloc(1, sizeof(bench_t));
+    pipeline_stage_t *stages = (pipeline_stage_t *)calloc(3, sizeof(pipeline_stage_t));
+    b->display_us = display_us;
+    stages[0] = (pipeline_stage_t) {.name = "capture", .func = jpeg_capture_stage, .arg = &b->stages, .pool_size = 2, .release = jpeg_cam_release, .task_pri = 5};
+    stages[1] = (pipeline_stage_t) {.name = "decode", .func = jpeg_decode_stage, .arg = &b->stages, .pool_size = 2, .buf_size = pixels * 2, .buf_caps = MALLOC_CAP_SPIRAM, .task_pri = 4};
+    stages[2] = (pipeline_stage_t) {.name = "display", .func = display_stage, .arg = b, .task_pri = 5};
+    int64_t start = esp_timer_get_time();
+    if (pipeline_create(stages, 3, &pipeline) != 0) {
+        cam_replay_deinit();
+        return -1;
+    }
+    do {
+        vTaskDelay(2);
+        cam_replay_get_stats(&rs);
+    } while (!rs.done || b->shown + b->stages.errors < rs.delivered);
+    r->elapsed_us = esp_timer_get_time() - start;
+    pipeline_get_stats(pipeline, &r->stats, false);
+    if (verbose) {
+        pipeline_print_stats(pipeline, false);
+    }
+    // 采集阶段在cam_take返回0之后不再调用cam_take, 之后才能释放回放
+    b->stages.stop = 1;
+    vTaskDelay(50);
+    cam_replay_deinit();
+
+    r->frames = b->shown;
+    r->errors = b->stages.errors;
+    r->dropped = rs.dropped;
+    r->digest = b->digest;
+    r->span_us = rs.span_us * (loops ? loops : 1);
+    uint64_t busy_max = 0;
+    r->bottleneck = stages[0].name;
+    for (int x = 0; x < r->stats.stage_cnt; x++) {
+        uint64_t busy = r->stats.stage[x].busy_us > r->stats.stage[x].hold_us ? r->stats.stage[x].busy_us : r->stats.stage[x].hold_us;
+        if (busy > busy_max) {
+            busy_max = busy;
+            r->bottleneck = stages[x].name;
+        }
+    }
+    // 流水线不释放, 阶段任务仍在运行(采集阶段只检查stop)
+    return 0;
+}
+
+static void print_result(const char *name, const run_result_t *r)
+{
+    printf("%-20s %u frames, %u decode errors, %u dropped, %.1f fps (recorded %.1f s), latency avg %.2f ms max %.2f ms, bottleneck %s, digest %08x\n",
+           name, r->frames, r->errors, r->dropped, r->elapsed_us ? r->frames * 1e6 / r->elapsed_us : 0, r->span_us / 1e6,
+           r->stats.frames ? r->stats.latency_us / 1000.0 / r->stats.frames : 0, r->stats.latency_max_us / 1000.0,
+           r->bottleneck, r->digest);
+}
+
+// 合成画面: 渐变背景上运动的色块, 噪声和纹理的强度逐帧变化, 使JPEG长度变化
+static int make_frame(uint8_t *jpeg, size_t size, int width, int high, int index)
+{
+    uint8_t *rgb = (uint8_t *)malloc(width * high * 3);
+    uint32_t seed = index * 2654435761u + 1;
+    int amp = 4 + (int)(12 * (1 + sinf(index * 0.3f)));
+    int bx = (int)((width - width / 4) * (0.5f + 0.5f * sinf(index * 0.15f)));
+    int by = (int)((high - high / 4) * (0.5f + 0.5f * cosf(index * 0.11f)));
+    for (int y = 0; y < high; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *p = &rgb[(y * width + x) * 3];
+            seed = seed * 1103515245 + 12345;
+            int n = (int)((seed >> 16) % (2 * amp + 1)) - amp;
+            int t = (x / 4 + y / 4 + index) % 2 ? amp : -amp;
+            int r = 60 + 150 * x / width + n + t, g = 80 + 120 * y / high + n, b = 150 + n - t;
+            if (x >= bx && x < bx + width / 4 && y >= by && y < by + high / 4) {
+                r = 230 + n, g = 60 + n, b = 40 + n;
+            }
+            p[0] = r < 0 ? 0 : (r > 255 ? 255 : r);
+            p[1] = g < 0 ? 0 : (g > 255 ? 255 : g);
+            p[2] = b < 0 ? 0 : (b > 255 ? 255 : b);
+        }
+    }
+    int len = jpeg_enc_rgb(rgb, width, high, JPEG_QUALITY, JPEG_ENC_422, jpeg, size);
+    free(rgb);
+    return len;
+}
+
+// 用cam_rec录制合成的帧, 间隔interval_ms; oversize_at: 这一帧之前插入一个超过buffer的帧(不录制)
+static int record(FILE *fp, int frames, int width, int high, int interval_ms, int oversize_at, cam_rec_stats_t *stats)
+{
+    size_t size = width * high * 3 + 4096;
+    uint8_t *jpeg = (uint8_t *)malloc(size);
+    cam_rec_config_t config = {.fp = fp, .buf_cnt = 3, .buf_size = size, .task_pri = 1};
+    cam_rec_handle_t rec = NULL;
+
+    if (cam_rec_start(&config, &rec) != 0) {
+        free(jpeg);
+        return -1;
+    }
+    for (int x = 0; x < frames; x++) {
+        if (x == oversize_at) {
+            cam_rec_add(rec, jpeg, size + 1, width, high, CAM_REC_FORMAT_JPEG);
+        }
+        int len = make_frame(jpeg, size, width, high, x);
+        cam_rec_add(rec, jpeg, len, width, high, CAM_REC_FORMAT_JPEG);
+        vTaskDelay(interval_ms);
+    }
+    free(jpeg);
+    return cam_rec_stop(rec, stats);
+}
+
+static void check(const char *name, int ok, const char *detail)
+{
+    printf("%-20s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    failed += !ok;
+}
+
+// 逐帧解码(不经过流水线)的digest
+static uint32_t reference_digest(int frames, int width, int high)
+{
+    size_t size = width * high * 3 + 4096;
+    uint8_t *jpeg = (uint8_t *)calloc(1, size);
+    uint8_t *out = (uint8_t *)heap_caps_malloc(width * high * 2, MALLOC_CAP_SPIRAM);
+    uint32_t digest = 0;
+    int w, h;
+    for (int x = 0; x < frames; x++) {
+        int len = make_frame(jpeg, size, width, high, x);
+        if (len > 0 && jpeg_decode_to(jpeg, len, out, width * high * 2, &w, &h) == 0) {
+            digest = cam_rec_crc32(digest, out, w * h * 2);
+        }
+    }
+    heap_caps_free(out);
+    free(jpeg);
+    return digest;
+}
+
+static int copy_truncated(const char *from, const char *to, long cut)
+{
+    FILE *in = fopen(from, "rb"), *out = fopen(to, "wb");
+    int ok = in && out;
+    if (ok) {
+        fseek(in, 0, SEEK_END);
+        long len = ftell(in) - cut;
+        fseek(in, 0, SEEK_SET);
+        for (long x = 0; x < len; x++) {
+            fputc(fgetc(in), out);
+        }
+    }
+    if (in) {
+        fclose(in);
+    }
+    if (out) {
+        fclose(out);
+    }
+    return ok ? 0 : -1;
+}
+
+static void self_test(void)
+{
+    enum { FRAMES = 20, WIDTH = 160, HIGH = 120, OVERSIZE_AT = 7, INTERVAL_MS = 10 };
+    char path[] = "/tmp/replay_bench_XXXXXX", cut_path[64], detail[160];
+    cam_rec_stats_t rs;
+    run_result_t r1, r2;
+    int fd = mkstemp(path);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w+b") : NULL;
+
+    // 录制
+    int ret = fp ? record(fp, FRAMES, WIDTH, HIGH, INTERVAL_MS, OVERSIZE_AT, &rs) : -1;
+    sprintf(detail, "%u frames, %u dropped, %llu bytes", rs.frames, rs.dropped, (unsigned long long)rs.bytes);
+    check("record", ret == 0 && rs.frames == FRAMES && rs.dropped == 1 && !rs.error, detail);
+
+    // 读回: 帧数, 内容, 序号(丢弃的帧留下空缺), 时间
+    cam_rec_header_t header;
+    cam_rec_frame_t frame;
+    size_t size = WIDTH * HIGH * 3 + 4096;
+    uint8_t *buf = (uint8_t *)malloc(size), *jpeg = (uint8_t *)malloc(size);
+    int ok = fp && fseek(fp, 0, SEEK_SET) == 0 && cam_rec_read_header(fp, &header) == 0 && header.frame_cnt == FRAMES;
+    int64_t last_time = 0;
+    for (int x = 0; ok && x < FRAMES; x++) {
+        int len = make_frame(jpeg, size, WIDTH, HIGH, x);
+        ok = cam_rec_read_frame(fp, &frame, buf, size) == 1 && frame.len == len && !memcmp(buf, jpeg, len);
+        ok = ok && frame.seq == x + (x >= OVERSIZE_AT) && frame.width == WIDTH && frame.high == HIGH && frame.format == CAM_REC_FORMAT_JPEG;
+        ok = ok && (x == 0 || frame.time >= last_time + INTERVAL_MS * 1000 * 9 / 10);
+        last_time = frame.time;
+    }
+    ok = ok && cam_rec_read_frame(fp, &frame, buf, size) == 0;
+    check("read_back", ok, "header, data, seq gap at dropped frame, timestamps");
+    if (fp) {
+        fclose(fp);
+    }
+
+    // 尽快回放两次, digest相同并且等于逐帧解码
+    uint32_t ref = reference_digest(FRAMES, WIDTH, HIGH);
+    ok = run(path, 0, 1, 0, &r1) == 0 && run(path, 0, 1, 0, &r2) == 0;
+    ok = ok && r1.frames == FRAMES && r2.frames == FRAMES && r1.digest == r2.digest && r1.digest == ref;
+    sprintf(detail, "digest %08x %08x, reference %08x", r1.digest, r2.digest, ref);
+    check("replay_identical", ok, detail);
+
+    // 回放3次
+    ok = run(path, 0, 3, 0, &r1) == 0 && r1.frames == FRAMES * 3 && r1.errors == 0;
+    sprintf(detail, "%u frames", r1.frames);
+    check("replay_loops", ok, detail);
+
+    // 按录制的时间间隔回放
+    ok = run(path, 1, 1, 0, &r1) == 0 && r1.frames == FRAMES && r1.dropped == 0;
+    ok = ok && r1.elapsed_us >= r1.span_us && r1.elapsed_us < r1.span_us + 100000;
+    sprintf(detail, "%.1f ms for %.1f ms recorded", r1.elapsed_us / 1000.0, r1.span_us / 1000.0);
+    check("replay_realtime", ok, detail);
+
+    // 显示比录制的帧间隔慢: 实时回放丢帧, 尽快回放不丢
+    ok = run(path, 1, 1, INTERVAL_MS * 2500, &r1) == 0 && r1.dropped > 0 && r1.frames + r1.dropped == FRAMES;
+    ok = ok && run(path, 0, 1, INTERVAL_MS * 2500, &r2) == 0 && r2.frames == FRAMES && r2.dropped == 0;
+    sprintf(detail, "realtime %u shown %u dropped, fast %u shown", r1.frames, r1.dropped, r2.frames);
+    check("replay_slow_display", ok, detail);
+
+    // 归还不是回放帧buffer的指针(例如cam_reconfig之前取走的帧)返回-1, NULL忽略
+    cam_replay_config_t give_config = {.path = path, .task_pri = 5};
+    uint8_t stale[16], *frame_buf = NULL;
+    ok = cam_replay_init(&give_config) == 0;
+    if (ok) {
+        ok = cam_take(&frame_buf) > 0 && cam_give(stale) == -1 && cam_give(NULL) == 0 && cam_give(frame_buf) == 0;
+        while (cam_take(&frame_buf) > 0) {
+            cam_give(frame_buf);
+        }
+        cam_replay_deinit();
+    }
+    check("give_unknown", ok, "rejected");
+
+    // 录制没有正常结束: 最后一帧不完整, 只回放完整的帧
+    sprintf(cut_path, "%s.cut", path);
+    ok = copy_truncated(path, cut_path, 10) == 0 && run(cut_path, 0, 1, 0, &r1) == 0 && r1.frames == FRAMES - 1;
+    sprintf(detail, "%u frames replayed", r1.frames);
+    check("truncated_file", ok, detail);
+
+    // 不是录制文件
+    ok = copy_truncated(path, cut_path, 0) == 0 && (fp = fopen(cut_path, "r+b")) != NULL;
+    if (ok) {
+        fputc('X', fp);
+        fclose(fp);
+    }
+    check("bad_magic", ok && run(cut_path, 0, 1, 0, &r1) != 0, "rejected");
+
+    free(buf);
+    free(jpeg);
+    remove(cut_path);
+    remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    const char *gen = NULL, *path = NULL;
+    int realtime = 0, test = 0, frames = 60, width = 320, high = 240;
+    uint32_t loops = 1, display_us = 0;
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        } else if (!strcmp(argv[x], "-r")) {
+            realtime = 1;
+        } else if (!strcmp(argv[x], "-t")) {
+            test = 1;
+        } else if (!strcmp(argv[x], "-l") && x + 1 < argc) {
+            loops = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-d") && x + 1 < argc) {
+            display_us = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-g") && x + 1 < argc) {
+            gen = argv[++x];
+        } else if (!strcmp(argv[x], "-n") && x + 1 < argc) {
+            frames = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-w") && x + 1 < argc) {
+            width = atoi(argv[++x]);
+        } else if (!strcmp(argv[x], "-h") && x + 1 < argc) {
+            high = atoi(argv[++x]);
+        } else if (argv[x][0] != '-' && !path) {
+            path = argv[x];
+        } else {
+            path = NULL;
+            test = 0;
+            gen = NULL;
+            break;
+        }
+    }
+    if (test) {
+        self_test();
+        printf("%s\n", failed ? "FAILED" : "OK");
+        return failed ? 1 : 0;
+    }
+    if (gen) {
+        cam_rec_stats_t stats;
+        FILE *fp = fopen(gen, "wb");
+        if (!fp || record(fp, frames, width, high, FRAME_INTERVAL_MS, -1, &stats) != 0) {
+            perror(gen);
+            return 1;
+        }
+        fclose(fp);
+        printf("%s: %u frames, %u dropped, %llu bytes\n", gen, stats.frames, stats.dropped, (unsigned long long)stats.bytes);
+        return 0;
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-v] [-r] [-l loops] [-d display_us] file.rec\n"
+                "       %s -g file.rec [-n frames] [-w width] [-h high]\n"
+                "       %s -t\n", argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    run_result_t r;
+    if (run(path, realtime, loops, display_us, &r) != 0) {
+        return 1;
+    }
+    print_result(path, &r);
+    return r.errors ? 1 : 0;
+}
@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "host_i2c_sim.h"
+#include "sccb.h"
+#include "ov2640.h"
+#include "ov2640_async.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "ov2640_emu.h"
+#include "esp_timer.h"
+
+// OV2640驱动(ov2640.c, sccb.c)在模拟I2C + OV2640寄存器模型上的验证和测量
+// 依次执行初始化, 尺寸/开窗/输出/传感器窗口设置, 模式切换, 错误注入和运行时调节,
+// 每一步之后将模型中的寄存器还原为实际的窗口和尺寸, 与请求的值或完整初始化的结果比较,
+// 并输出寄存器写/读次数, I2C命令链和传输个数, 总线时间
+//
+//   sensor_emu [-v]
+
+#define SCCB_PORT   (1)
+
+typedef struct {
+    uint8_t reg[2][256];
+    uint8_t sde[256];
+} regs_t;
+
+typedef struct {
+    const char *name;
+    uint16_t image_w, image_h;
+    uint16_t win_x, win_y, win_w, win_h;
+    uint16_t out_w, out_h;
+} geometry_case_t;
+
+typedef struct {
+    const char *name;
+    ov2640_mode_t mode;
+} mode_case_t;
+
+static int verbose = 0;
+static int failed = 0;
+
+static void stats_begin(void)
+{
+    host_i2c_sim_stats_t i2c;
+    ov2640_emu_stats_t emu;
+    host_i2c_sim_stats(&i2c, true);
+    ov2640_emu_stats(&emu, true);
+}
+
+static void stats_end(const char *name, int ok)
+{
+    host_i2c_sim_stats_t i2c;
+    ov2640_emu_stats_t emu;
+    host_i2c_sim_stats(&i2c, true);
+    ov2640_emu_stats(&emu, true);
+    ok = ok && i2c.nacks == 0;
+    failed += !ok;
+    printf("%-24s %s  writes %4u (bank %3u, redundant %3u)  reads %3u  links %4u  transfers %4u  bus %7.3f ms\n",
+           name, ok ? "PASS" : "FAIL", emu.writes, emu.bank_writes, emu.redundant, emu.reads,
+           i2c.links, i2c.transfers, i2c.bus_us / 1000);
+}
+
+static void snapshot(regs_t *regs)
+{
+    for (int bank = 0; bank < 2; bank++) {
+        for (int reg = 0; reg < 256; reg++) {
+            regs->reg[bank][reg] = ov2640_emu_reg(bank, reg);
+        }
+    }
+    for (int addr = 0; addr < 256; addr++) {
+        regs->sde[addr] = ov2640_emu_sde(addr);
+    }
+}
+
+// 不比较寄存器组选择和DSP复位寄存器, 两者都是过程状态
+static int compare(const regs_t *expect, const regs_t *got)
+{
+    int bad = 0;
+    for (int bank = 0; bank < 2; bank++) {
+        for (int reg = 0; reg < 255; reg++) {
+            if (bank == 0 && reg == 0xE0) {
+                continue;
+            }
+            if (expect->reg[bank][reg] != got->reg[bank][reg]) {
+                if (bad < 4) {
+                    printf("  bank %d reg 0x%02X: got 0x%02X, expected 0x%02X\n", bank, reg, got->reg[bank][reg], expect->reg[bank][reg]);
+                }
+                bad++;
+            }
+        }
+    }
+    if (memcmp(expect->sde, got->sde, sizeof(expect->sde))) {
+        printf("  BPADDR/BPDATA registers differ\n");
+        bad++;
+    }
+    return bad;
+}
+
+static void print_geometry(void)
+{
+    ov2640_emu_geometry_t geo;
+    ov2640_emu_geometry(&geo);
+    printf("  sensor href %u-%u vref %u-%u, image %ux%u, window %ux%u+%u+%u, out %ux%u, zoom %.3fx%.3f, clkrc 0x%02X, %s\n",
+           geo.href_start, geo.href_end, geo.vref_start, geo.vref_end, geo.image_w, geo.image_h,
+           geo.win_w, geo.win_h, geo.win_x, geo.win_y, geo.out_w, geo.out_h, geo.zoom_x, geo.zoom_y, geo.clkrc,
+           geo.jpeg ? "JPEG" : geo.dvp_format == 2 ? "RGB565" : geo.dvp_format == 1 ? "RAW10" : "YUV422");
+}
+
+static void format_set(const ov2640_mode_t *mode)
+{
+    if (mode->format == OV2640_FORMAT_JPEG) {
+        OV2640_JPEG_Mode();
+    } else if (mode->format == OV2640_FORMAT_RGB565) {
+        OV2640_RGB565_Mode(mode->byte_swap_en);
+    }
+}
+
+// 上电后完整初始化到mode
+static int bring_up(const ov2640_mode_t *mode)
+{
+    ov2640_emu_power_on();
+    if (OV2640_Init(mode->size, mode->fre_double_en) != 0) {
+        return -1;
+    }
+    if (mode->clk_div && OV2640_Clock_Set(mode->fre_double_en, mode->clk_div) != 0) {
+        return -1;
+    }
+    format_set(mode);
+    return 0;
+}
+
+static void test_geometry(const geometry_case_t *c)
+{
+    ov2640_emu_geometry_t geo;
+    int ok = 1;
+    stats_begin();
+    ok &= OV2640_ImageSize_Set(c->image_w, c->image_h) == 0;
+    ok &= OV2640_ImageWin_Set(c->win_x, c->win_y, c->win_w, c->win_h) == 0;
+    ok &= OV2640_OutSize_Set(c->out_w, c->out_h) == 0;
+    ov2640_emu_geometry(&geo);
+    if (geo.image_w != c->image_w || geo.image_h != c->image_h) {
+        printf("  image %ux%u, expected %ux%u\n", geo.image_w, geo.image_h, c->image_w, c->image_h);
+        ok = 0;
+    }
+    if (geo.win_x != c->win_x || geo.win_y != c->win_y || geo.win_w != c->win_w || geo.win_h != c->win_h) {
+        printf("  window %ux%u+%u+%u, expected %ux%u+%u+%u\n", geo.win_w, geo.win_h, geo.win_x, geo.win_y,
+               c->win_w, c->win_h, c->win_x, c->win_y);
+        ok = 0;
+    }
+    if (geo.out_w != c->out_w || geo.out_h != c->out_h) {
+        printf("  out %ux%u, expected %ux%u\n", geo.out_w, geo.out_h, c->out_w, c->out_h);
+        ok = 0;
+    }
+    if (verbose) {
+        print_geometry();
+    }
+    stats_end(c->name, ok);
+}
+
+static void test_window(uint16_t sx, uint16_t sy, uint16_t width, uint16_t height)
+{
+    ov2640_emu_geometry_t geo;
+    char name[32];
+    int ok = 1;
+    snprintf(name, sizeof(name), "window_%u_%u_%ux%u", sx, sy, width, height);
+    stats_begin();
+    OV2640_Window_Set(sx, sy, width, height);
+    ov2640_emu_geometry(&geo);
+    // OV2640_Window_Set的结束位置为起始位置加上一半的宽高
+    if (geo.href_start != sx || geo.href_end != sx + width / 2 || geo.vref_start != sy || geo.vref_end != sy + height / 2) {
+        printf("  href %u-%u vref %u-%u, expected %u-%u %u-%u\n", geo.href_start, geo.href_end, geo.vref_start, geo.vref_end,
+               sx, sx + width / 2, sy, sy + height / 2);
+        ok = 0;
+    }
+    if (verbose) {
+        print_geometry();
+    }
+    stats_end(name, ok);
+}
+
+static SemaphoreHandle_t async_gate_enter;
+static SemaphoreHandle_t async_gate;
+
+// 占住后台任务, 使之后提交的请求留在队列中
+static void async_gate_func(void *arg)
+{
+    xSemaphoreGive(async_gate_enter);
+    xSemaphoreTake(async_gate, portMAX_DELAY);
+}
+
+static void async_result_cb(uint8_t result, void *arg)
+{
+    *(int *)arg = result;
+}
+
+// 后台SCCB任务: 队列中的同一设置合并为最后的值, 队列满时立即返回, 写失败通过回调报告
+static void test_async(void)
+{
+    ov2640_async_config_t config = {
+        .queue_size = 4,
+        .task_pri = 5,
+    };
+    int result[4] = {-1, -1, -1, -1};
+    int ok = 1;
+    ov2640_emu_stats_t emu;
+    host_i2c_sim_stats_t i2c;
+
+    async_gate_enter = xSemaphoreCreateBinary();
+    async_gate = xSemaphoreCreateCounting(2, 0);
+    ok &= OV2640_Async_Init(&config) == 0;
+    stats_begin();
+    ok &= OV2640_Async_Call(async_gate_func, NULL, NULL, NULL, portMAX_DELAY) == 0;
+    xSemaphoreTake(async_gate_enter, portMAX_DELAY);
+    ok &= OV2640_Async_Set(OV2640_ASYNC_BRIGHTNESS, 1, async_result_cb, &result[0]) == 0;
+    ok &= OV2640_Async_Set(OV2640_ASYNC_BRIGHTNESS, 2, async_result_cb, &result[1]) == 0;
+    ok &= OV2640_Async_Set(OV2640_ASYNC_BRIGHTNESS, 4, async_result_cb, &result[2]) == 0;
+    ok &= result[0] == OV2640_ASYNC_REPLACED && result[1] == OV2640_ASYNC_REPLACED && result[2] == -1;
+    ok &= OV2640_Async_Set(OV2640_ASYNC_CONTRAST, 3, NULL, NULL) == 0;
+    ok &= OV2640_Async_Call(async_gate_func, NULL, NULL, NULL, 0) == 0;
+    ok &= OV2640_Async_Set(OV2640_ASYNC_LIGHT_MODE, 1, NULL, NULL) == 0;
+    ok &= OV2640_Async_Set(OV2640_ASYNC_SPECIAL_EFFECTS, 1, NULL, NULL) == 1;   // 队列已满
+    ok &= OV2640_Async_Set(OV2640_ASYNC_BRIGHTNESS, 3, async_result_cb, &result[3]) == 0; // 仍可合并
+    ok &= result[2] == OV2640_ASYNC_REPLACED;
+    ov2640_emu_stats(&emu, false);
+    ok &= emu.writes == 0;
+    xSemaphoreGive(async_gate);
+    xSemaphoreGive(async_gate);
+    ok &= OV2640_Async_Flush(1000) == 0;
+    ok &= result[3] == OV2640_ASYNC_OK;
+    stats_end("async_coalesce", ok);
+
+    // 下一次传输NACK
+    stats_begin();
+    result[0] = -1;
+    host_i2c_sim_fail_transfer(0);
+    ok = OV2640_Async_Set(OV2640_ASYNC_CONTRAST, 0, async_result_cb, &result[0]) == 0;
+    ok = ok && OV2640_Async_Flush(1000) == 0 && result[0] == OV2640_ASYNC_BUS_ERROR;
+    host_i2c_sim_fail_transfer(-1);
+    host_i2c_sim_stats(&i2c, true);
+    ov2640_emu_stats(&emu, true);
+    ok = ok && i2c.nacks == 1;
+    failed += !ok;
+    printf("%-24s %s  links %4u  transfers %4u\n", "async_bus_error", ok ? "PASS" : "FAIL", i2c.links, i2c.transfers);
+}
+
+int main(int argc, char **argv)
+{
+    static const geometry_case_t svga_cases[] = {
+        {"svga_out_320x240",   800, 600,   0,   0, 800, 600, 320, 240},
+        {"svga_out_800x600",   800, 600,   0,   0, 800, 600, 800, 600},
+        {"svga_out_160x120",   800, 600,   0,   0, 800, 600, 160, 120},
+        {"svga_zoom_center",   800, 600, 200, 152, 400, 296, 320, 240},
+        {"svga_pan_offset",    800, 600, 480, 300, 320, 240, 320, 240},
+    };
+    static const geometry_case_t uxga_cases[] = {
+        {"uxga_out_1600x1200", 1600, 1200,    0,   0, 1600, 1200, 1600, 1200},
+        {"uxga_out_320x240",   1600, 1200,    0,   0, 1600, 1200,  320,  240},
+        {"uxga_pan_high_bits", 1600, 1200, 1024, 768,  576,  432,  320,  240},
+        {"image_2048x1536",    2048, 1536,    0,   0, 2048, 1536, 1024,  768},
+    };
+    static const mode_case_t modes[] = {
+        {"svga_jpeg",      {0, 1, OV2640_FORMAT_JPEG,   0, 0}},
+        {"svga_rgb",       {0, 1, OV2640_FORMAT_RGB565, 0, 0}},
+        {"svga_rgb_swap",  {0, 1, OV2640_FORMAT_RGB565, 1, 0}},
+        {"uxga_jpeg",      {1, 1, OV2640_FORMAT_JPEG,   0, 0}},
+        {"uxga_rgb",       {1, 0, OV2640_FORMAT_RGB565, 0, 0}},
+        {"svga_rgb_div3",  {0, 1, OV2640_FORMAT_RGB565, 0, 2}},
+    };
+    const int mode_cnt = sizeof(modes) / sizeof(modes[0]);
+    regs_t *expect = (regs_t *)malloc(sizeof(regs_t));
+    regs_t *got = (regs_t *)malloc(sizeof(regs_t));
+    ov2640_emu_geometry_t geo;
+    host_i2c_sim_stats_t i2c;
+    ov2640_emu_stats_t emu;
+    uint32_t full_writes[sizeof(modes) / sizeof(modes[0])];
+    char name[64];
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-v")) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!expect || !got || ov2640_emu_init(SCCB_PORT) != 0) {
+        fprintf(stderr, "emulator init failed\n");
+        return 1;
+    }
+
+    // 完整初始化, 作为模式切换的参考
+    for (int x = 0; x < mode_cnt; x++) {
+        snprintf(name, sizeof(name), "init_%s", modes[x].name);
+        stats_begin();
+        int ok = bring_up(&modes[x].mode) == 0;
+        ov2640_emu_stats(&emu, false);
+        full_writes[x] = emu.writes;
+        ov2640_emu_geometry(&geo);
+        ok = ok && geo.clkrc == ((modes[x].mode.fre_double_en ? 0x80 : 0) | modes[x].mode.clk_div);
+        ok = ok && geo.jpeg == (modes[x].mode.format == OV2640_FORMAT_JPEG);
+        ok = ok && (modes[x].mode.format != OV2640_FORMAT_RGB565 || (geo.dvp_format == 2 && geo.byte_swap == modes[x].mode.byte_swap_en));
+        if (verbose) {
+            print_geometry();
+        }
+        stats_end(name, ok);
+    }
+
+    // 传感器复位期间NACK, 轮询ID直到响应, 复位到就绪的时间应接近模型的复位时间而不是固定延时
+    for (int x = 0; x < 2; x++) {
+        uint32_t reset_us = x == 0 ? 2000 : 200 * 1000;
+        snprintf(name, sizeof(name), "ready_poll_%uus", reset_us);
+        ov2640_emu_reset_time(reset_us);
+        ov2640_emu_power_on();
+        int64_t start = esp_timer_get_time();
+        uint8_t ret = OV2640_Init(0, 1);
+        uint32_t total_us = esp_timer_get_time() - start;
+        ov2640_emu_reset_time(0);
+        host_i2c_sim_stats(&i2c, true);
+        ov2640_emu_stats(&emu, true);
+        // 超过100ms的复位时间应超时失败
+        int ok = x == 0 ? ret == 0 && OV2640_Ready_Time() >= reset_us && OV2640_Ready_Time() < reset_us + 6000 : ret == 1;
+        failed += !ok;
+        printf("%-24s %s  ready %6u us  init %6u us  nacks %3u\n", name, ok ? "PASS" : "FAIL",
+               x == 0 ? OV2640_Ready_Time() : 0, total_us, i2c.nacks);
+    }
+
+    bring_up(&modes[0].mode);
+    for (int x = 0; x < sizeof(svga_cases) / sizeof(svga_cases[0]); x++) {
+        test_geometry(&svga_cases[x]);
+    }
+    test_window(0, 0, 800, 600);
+    test_window(137, 9, 1600, 1200);
+    test_window(250, 75, 402, 298);
+
+    // 不是4的倍数的尺寸应当被拒绝且不写寄存器
+    stats_begin();
+    {
+        int ok = OV2640_OutSize_Set(322, 240) == 1 && OV2640_ImageWin_Set(0, 0, 800, 598) == 2;
+        ov2640_emu_stats(&emu, false);
+        stats_end("reject_unaligned", ok && emu.writes == 0);
+    }
+
+    bring_up(&modes[3].mode);
+    for (int x = 0; x < sizeof(uxga_cases) / sizeof(uxga_cases[0]); x++) {
+        test_geometry(&uxga_cases[x]);
+    }
+
+    // 影子寄存器: 重复的运行时调节只写入自增的间接寄存器0x7C/0x7D, 已选择的寄存器组和不变的值不再写入
+    bring_up(&modes[0].mode);
+    OV2640_Brightness(3);
+    stats_begin();
+    OV2640_Brightness(3);
+    ov2640_emu_stats(&emu, false);
+    stats_end("brightness_repeat", emu.writes == 5);
+    OV2640_Auto_Exposure(2);
+    stats_begin();
+    OV2640_Auto_Exposure(2);
+    ov2640_emu_stats(&emu, false);
+    stats_end("auto_exposure_repeat", emu.writes == 0);
+
+    // 暂存的开窗设置不访问总线, 多次暂存只保留最后一次, 提交时在一条命令链中写入
+    bring_up(&modes[1].mode);
+    OV2640_ImageSize_Set(800, 600);
+    OV2640_ImageWin_Set(0, 0, 800, 600);
+    OV2640_OutSize_Set(320, 240);
+    stats_begin();
+    {
+        int ok = OV2640_ImageWin_Stage(0, 0, 800, 600) == 0 && OV2640_ImageWin_Stage(200, 152, 400, 296) == 0;
+        ok = ok && OV2640_ImageWin_Stage(0, 0, 802, 600) == 1;
+        ov2640_emu_stats(&emu, false);
+        ok = ok && emu.writes == 0;
+        ok = ok && OV2640_ImageWin_Commit() == 1 && OV2640_ImageWin_Commit() == 0;
+        host_i2c_sim_stats(&i2c, false);
+        ov2640_emu_geometry(&geo);
+        ok = ok && i2c.links == 1 && geo.win_x == 200 && geo.win_y == 152 && geo.win_w == 400 && geo.win_h == 296;
+        ok = ok && geo.out_w == 320 && geo.out_h == 240;
+        if (verbose) {
+            print_geometry();
+        }
+        stats_end("imagewin_stage_commit", ok);
+    }
+    // 平移只写入改变的偏移寄存器和DSP复位
+    stats_begin();
+    {
+        int ok = OV2640_ImageWin_Stage(204, 156, 400, 296) == 0 && OV2640_ImageWin_Commit() == 1;
+        ov2640_emu_stats(&emu, false);
+        ov2640_emu_geometry(&geo);
+        ok = ok && emu.writes == 4 && geo.win_x == 204 && geo.win_y == 156;
+        stats_end("imagewin_pan_commit", ok);
+    }
+
+    test_async();
+
+    // 模式切换的结果必须与上电后完整初始化到目标模式相同
+    for (int to = 0; to < mode_cnt; to++) {
+        bring_up(&modes[to].mode);
+        snapshot(expect);
+        for (int from = 0; from < mode_cnt; from++) {
+            if (from == to) {
+                continue;
+            }
+            bring_up(&modes[from].mode);
+            snprintf(name, sizeof(name), "%s>%s", modes[from].name, modes[to].name);
+            stats_begin();
+            int ok = OV2640_Mode_Switch(&modes[to].mode) == 0;
+            ov2640_emu_stats(&emu, false);
+            snapshot(got);
+            ok = compare(expect, got) == 0 && ok;
+            stats_end(name, ok);
+            if (verbose) {
+                printf("  %u writes, full init %u\n", emu.writes, full_writes[to]);
+            }
+        }
+    }
+
+    // 批量写入中途NACK, 失败的命令链逐个重写, 结果与正常初始化相同
+    bring_up(&modes[0].mode);
+    snapshot(expect);
+    for (int n = 8; n < 200; n += 48) {
+        snprintf(name, sizeof(name), "nack_transfer_%d", n);
+        host_i2c_sim_fail_transfer(n);
+        stats_begin();
+        int ok = bring_up(&modes[0].mode) == 0;
+        host_i2c_sim_stats(&i2c, false);
+        snapshot(got);
+        ok = compare(expect, got) == 0 && ok && i2c.nacks == 1;
+        host_i2c_sim_fail_transfer(-1);
+        // NACK是注入的, 不作为失败统计
+        host_i2c_sim_stats(&i2c, true);
+        ov2640_emu_stats(&emu, true);
+        failed += !ok;
+        printf("%-24s %s  links %4u  transfers %4u\n", name, ok ? "PASS" : "FAIL", i2c.links, i2c.transfers);
+    }
+
+    free(expect);
+    free(got);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
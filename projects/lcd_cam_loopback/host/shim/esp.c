@@ -0,0 +1,393 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_intr_alloc.h"
+#include "driver/gpio.h"
+#include "soc/soc_memory_layout.h"
+#include "esp32s2/rom/cache.h"
+#include "esp32s2/rom/ets_sys.h"
+#include "xtensa/hal.h"
+#include "host_sim.h"
+
+#define ARENA_ALIGN (16)
+
+// 模拟内存区域: 首次适配的空闲链表, 块头之后为用户数据
+typedef struct arena_block_s {
+    size_t size;            // 用户数据大小, 按ARENA_ALIGN对齐
+    size_t free;
+    struct arena_block_s *next;
+    size_t reserved;        // 使块头为16字节的整数倍
+} arena_block_t;
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t min_free;
+    arena_block_t *head;
+} arena_t;
+
+typedef struct host_intr_s {
+    intr_handler_t handler;
+    void *arg;
+} host_intr_t;
+
+static arena_t dma_arena = {.size = HOST_DMA_MEM_SIZE};
+static arena_t spiram_arena = {.size = HOST_SPIRAM_MEM_SIZE};
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t gpio_level[GPIO_NUM_MAX];
+static host_gpio_hook_t gpio_hook = NULL;
+static void *gpio_hook_arg = NULL;
+
+static host_intr_t intr_table[ETS_MAX_INTR_SOURCE];
+
+uint32_t GPIO_PIN_MUX_REG[GPIO_NUM_MAX];
+
+int64_t host_time_us(void)
+{
+    static struct timespec start = {0};
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (start.tv_sec == 0 && start.tv_nsec == 0) {
+        start = ts;
+    }
+    return (int64_t)(ts.tv_sec - start.tv_sec) * 1000000 + (ts.tv_nsec - start.tv_nsec) / 1000;
+}
+
+unsigned xthal_get_ccount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us();
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(host_time_us() / 1000);
+}
+
+int ets_printf(const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+    va_start(ap, fmt);
+    ret = vprintf(fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    int64_t end = host_time_us() + us;
+    while (host_time_us() < end);
+}
+
+static int arena_init(arena_t *arena)
+{
+    if (arena->base) {
+        return 0;
+    }
+    // DMA区域按自身大小对齐, 使低20位地址唯一对应一个位置
+    arena->base = (uint8_t *)aligned_alloc(arena->size, arena->size);
+    if (!arena->base) {
+        return -1;
+    }
+    arena->head = (arena_block_t *)arena->base;
+    arena->head->size = arena->size - sizeof(arena_block_t);
+    arena->head->free = 1;
+    arena->head->next = NULL;
+    arena->min_free = arena->head->size;
+    return 0;
+}
+
+static bool arena_contains(const arena_t *arena, const void *p)
+{
+    return arena->base && (const uint8_t *)p >= arena->base && (const uint8_t *)p < arena->base + arena->size;
+}
+
+static void *arena_alloc(arena_t *arena, size_t size)
+{
+    arena_block_t *block = NULL, *rest = NULL;
+    void *ptr = NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    pthread_mutex_lock(&arena_lock);
+    if (arena_init(arena) == 0) {
+        for (block = arena->head; block; block = block->next) {
+            if (!block->free || block->size < size) {
+                continue;
+            }
+            if (block->size >= size + sizeof(arena_block_t) + ARENA_ALIGN) {
+                rest = (arena_block_t *)((uint8_t *)(block + 1) + size);
+                rest->size = block->size - size - sizeof(arena_block_t);
+                rest->free = 1;
+                rest->next = block->next;
+                block->next = rest;
+                block->size = size;
+            }
+            block->free = 0;
+            arena->used += block->size + sizeof(arena_block_t);
+            if (arena->size - arena->used < arena->min_free) {
+                arena->min_free = arena->size - arena->used;
+            }
+            ptr = block + 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&arena_lock);
+    return ptr;
+}
+
+static void arena_free(arena_t *arena, void *ptr)
+{
+    arena_block_t *block = (arena_block_t *)ptr - 1;
+    pthread_mutex_lock(&arena_lock);
+    block->free = 1;
+    arena->used -= block->size + sizeof(arena_block_t);
+    // 与后面相邻的空闲块合并; 前面的空闲块在下一次遍历时合并
+    for (block = arena->head; block; block = block->next) {
+        while (block->free && block->next && block->next->free) {
+            block->size += block->next->size + sizeof(arena_block_t);
+            block->next = block->next->next;
+        }
+    }
+    pthread_mutex_unlock(&arena_lock);
+}
+
+static size_t arena_block_size(void *ptr)
+{
+    return ((arena_block_t *)ptr - 1)->size;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return arena_alloc(&spiram_arena, size);
+    }
+    if (caps & MALLOC_CAP_DMA) {
+        return arena_alloc(&dma_arena, size);
+    }
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    void *ptr = heap_caps_malloc(n * size, caps);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void heap_caps_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (arena_contains(&dma_arena, ptr)) {
+        arena_free(&dma_arena, ptr);
+    } else if (arena_contains(&spiram_arena, ptr)) {
+        arena_free(&spiram_arena, ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    void *new_ptr = NULL;
+    size_t old_size = 0;
+    if (ptr == NULL) {
+        return heap_caps_malloc(size, caps);
+    }
+    if (!arena_contains(&dma_arena, ptr) && !arena_contains(&spiram_arena, ptr) && !(caps & (MALLOC_CAP_DMA | MALLOC_CAP_SPIRAM))) {
+        return realloc(ptr, size);
+    }
+    new_ptr = heap_caps_malloc(size, caps);
+    if (new_ptr) {
+        old_size = (arena_contains(&dma_arena, ptr) || arena_contains(&spiram_arena, ptr)) ? arena_block_size(ptr) : size;
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        heap_caps_free(ptr);
+    }
+    return new_ptr;
+}
+
+// 只统计模拟区域; 普通内存视为无限
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    const arena_t *arena = (caps & MALLOC_CAP_SPIRAM) ? &spiram_arena : &dma_arena;
+    return arena->size - arena->used;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    const arena_t *arena = (caps & MALLOC_CAP_SPIRAM) ? &spiram_arena : &dma_arena;
+    return arena->base ? arena->min_free : arena->size;
+}
+
+void *host_dma_addr(uint32_t addr)
+{
+    if (!dma_arena.base || addr >= dma_arena.size) {
+        return NULL;
+    }
+    return dma_arena.base + addr;
+}
+
+bool host_ptr_dma_mem(const void *p)
+{
+    return arena_contains(&dma_arena, p);
+}
+
+bool host_ptr_spiram(const void *p)
+{
+    return arena_contains(&spiram_arena, p);
+}
+
+bool esp_ptr_dma_capable(const void *p)
+{
+    return arena_contains(&dma_arena, p);
+}
+
+bool esp_ptr_external_ram(const void *p)
+{
+    return arena_contains(&spiram_arena, p);
+}
+
+bool esp_ptr_internal(const void *p)
+{
+    return !arena_contains(&spiram_arena, p);
+}
+
+int Cache_WriteBack_Addr(uint32_t addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+    return 0;
+}
+
+int Cache_Invalidate_Addr(uint32_t addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+    return 0;
+}
+
+void Cache_WriteBack_All(void)
+{
+}
+
+void host_gpio_set_hook(host_gpio_hook_t hook, void *arg)
+{
+    gpio_hook_arg = arg;
+    gpio_hook = hook;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    level = level ? 1 : 0;
+    if (gpio_level[gpio_num] != level) {
+        gpio_level[gpio_num] = level;
+        if (gpio_hook) {
+            gpio_hook(gpio_hook_arg, gpio_num, level);
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+        return 0;
+    }
+    return gpio_level[gpio_num];
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, int mode)
+{
+    (void)gpio_num;
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, int pull)
+{
+    (void)gpio_num;
+    (void)pull;
+    return ESP_OK;
+}
+
+void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv)
+{
+    (void)gpio;
+    (void)signal_idx;
+    (void)out_inv;
+    (void)oen_inv;
+}
+
+void gpio_matrix_in(uint32_t gpio, uint32_t signal_idx, bool inv)
+{
+    (void)gpio;
+    (void)signal_idx;
+    (void)inv;
+}
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void *arg, intr_handle_t *ret_handle)
+{
+    (void)flags;
+    if (source < 0 || source >= ETS_MAX_INTR_SOURCE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_critical_enter();
+    intr_table[source].handler = handler;
+    intr_table[source].arg = arg;
+    host_critical_exit();
+    if (ret_handle) {
+        *ret_handle = &intr_table[source];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_free(intr_handle_t handle)
+{
+    host_critical_enter();
+    handle->handler = NULL;
+    host_critical_exit();
+    return ESP_OK;
+}
+
+void host_intr_raise(int source)
+{
+    host_critical_enter();
+    if (intr_table[source].handler) {
+        intr_table[source].handler(intr_table[source].arg);
+    }
+    host_critical_exit();
+}
@@ -0,0 +1,378 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_sim.h"
+
+#define HOST_STACK_FILL (0xA5)
+#define HOST_STACK_GAP  (512) // task_entry自己的栈帧
+
+struct host_queue_s {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *buf;
+    UBaseType_t item_size;
+    UBaseType_t length;
+    UBaseType_t count;
+    UBaseType_t head;
+};
+
+struct host_task_s {
+    pthread_t thread;
+    TaskFunction_t func;
+    void *arg;
+    char name[16];
+    UBaseType_t priority;
+    uint32_t stack_depth;
+    volatile uint8_t *stack_low;    // 涂上HOST_STACK_FILL的区域, 见task_entry
+    volatile uint8_t *stack_high;
+};
+
+static pthread_mutex_t critical_lock;
+static pthread_mutex_t suspend_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+static __thread TaskHandle_t current_task = NULL;
+
+static void critical_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutex_init(&suspend_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void host_critical_enter(void)
+{
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&critical_lock);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&critical_lock);
+}
+
+// 等待条件变量, ticks为portMAX_DELAY时一直等待; 超时返回ETIMEDOUT
+static int queue_wait(pthread_cond_t *cond, pthread_mutex_t *lock, const struct timespec *deadline)
+{
+    if (deadline == NULL) {
+        return pthread_cond_wait(cond, lock);
+    }
+    return pthread_cond_timedwait(cond, lock, deadline);
+}
+
+static struct timespec *queue_deadline(struct timespec *ts, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ticks / 1000;
+    ts->tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = (QueueHandle_t)calloc(1, sizeof(struct host_queue_s));
+    if (!queue) {
+        return NULL;
+    }
+    queue->buf = (uint8_t *)calloc(length, item_size ? item_size : 1);
+    if (!queue->buf) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (!queue) {
+        return;
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->buf);
+    free(queue);
+}
+
+static BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait, int front, int overwrite)
+{
+    struct timespec ts;
+    const struct timespec *deadline = ticks_to_wait ? queue_deadline(&ts, ticks_to_wait) : NULL;
+    UBaseType_t pos = 0;
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length && !overwrite) {
+        if (ticks_to_wait == 0 || queue_wait(&queue->not_full, &queue->lock, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&queue->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    if (overwrite && queue->count == queue->length) {
+        queue->count = 0;
+    }
+    if (front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        pos = queue->head;
+    } else {
+        pos = (queue->head + queue->count) % queue->length;
+    }
+    if (queue->item_size) {
+        memcpy(queue->buf + pos * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+static BaseType_t queue_receive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait, int peek)
+{
+    struct timespec ts;
+    const struct timespec *deadline = ticks_to_wait ? queue_deadline(&ts, ticks_to_wait) : NULL;
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks_to_wait == 0 || queue_wait(&queue->not_empty, &queue->lock, deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if (queue->item_size) {
+        memcpy(item, queue->buf + queue->head * queue->item_size, queue->item_size);
+    }
+    if (!peek) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+    return queue_send(queue, item, ticks_to_wait, 0, 0);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+    return queue_send(queue, item, ticks_to_wait, 1, 0);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return queue_send(queue, item, 0, 0, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    return queue_send(queue, item, 0, 0, 1);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait)
+{
+    return queue_receive(queue, item, ticks_to_wait, 0);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+{
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return queue_receive(queue, item, 0, 0);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks_to_wait)
+{
+    return queue_receive(queue, item, ticks_to_wait, 1);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->count = 0;
+    queue->head = 0;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    UBaseType_t count;
+    pthread_mutex_lock(&queue->lock);
+    count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    return queue->length - uxQueueMessagesWaiting(queue);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    SemaphoreHandle_t sem = xQueueCreate(max_count, 0);
+    if (sem) {
+        sem->count = initial_count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+// pthread的栈比任务的栈大得多: 在任务函数开始前把当前栈帧之下stack_depth字节涂上标记(不调用其他函数, 不会覆盖自己的栈帧),
+// 高水位为其中从低地址起未被改写的字节数, 即按主机上的实际用量模拟一个stack_depth大小的栈
+// 线程退出后栈被释放: 等待vTaskSuspendAll的一方查询完成后清除栈的范围, 之后查询高水位返回0
+static void task_exit(TaskHandle_t task)
+{
+    if (task) {
+        vTaskSuspendAll();
+        task->stack_high = NULL;
+        xTaskResumeAll();
+    }
+}
+
+static void *task_entry(void *arg)
+{
+    TaskHandle_t task = (TaskHandle_t)arg;
+    volatile uint8_t *top = (volatile uint8_t *)__builtin_frame_address(0) - HOST_STACK_GAP;
+    current_task = task;
+    if (task->stack_depth > HOST_STACK_GAP) {
+        task->stack_low = top - (task->stack_depth - HOST_STACK_GAP);
+        for (volatile uint8_t *p = task->stack_low; p < top; p++) {
+            *p = HOST_STACK_FILL;
+        }
+        task->stack_high = top;
+    }
+    task->func(task->arg);
+    task_exit(task);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t func, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id)
+{
+    TaskHandle_t task = (TaskHandle_t)calloc(1, sizeof(struct host_task_s));
+    (void)core_id;
+    if (!task) {
+        return pdFAIL;
+    }
+    task->func = func;
+    task->arg = arg;
+    task->priority = priority;
+    task->stack_depth = stack_depth;
+    snprintf(task->name, sizeof(task->name), "%s", name ? name : "");
+    if (handle) {
+        *handle = task;
+    }
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+        free(task);
+        if (handle) {
+            *handle = NULL;
+        }
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(func, name, stack_depth, arg, priority, handle, 0);
+}
+
+void vTaskSuspendAll(void)
+{
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&suspend_lock);
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    pthread_mutex_unlock(&suspend_lock);
+    return pdFALSE;
+}
+
+// 只支持删除自身; 任务对象不回收, 其他任务可能还持有handle
+void vTaskDelete(TaskHandle_t handle)
+{
+    if (handle == NULL || handle == current_task) {
+        task_exit(current_task);
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {
+        .tv_sec = ticks / 1000,
+        .tv_nsec = (long)(ticks % 1000) * 1000000,
+    };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_time_us() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+const char *pcTaskGetTaskName(TaskHandle_t handle)
+{
+    handle = handle ? handle : current_task;
+    return handle ? handle->name : "main";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle)
+{
+    volatile uint8_t *p = NULL;
+    handle = handle ? handle : current_task;
+    if (!handle || !handle->stack_high) {
+        return 0;
+    }
+    for (p = handle->stack_low; p < handle->stack_high && *p == HOST_STACK_FILL; p++);
+    return p - handle->stack_low;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t handle)
+{
+    handle = handle ? handle : current_task;
+    return handle ? handle->priority : 0;
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "driver/i2c.h"
+#include "host_i2c_sim.h"
+
+#define I2C_LINK_GROW       (64)
+#define I2C_XFER_MAX        (256)
+
+typedef enum {
+    I2C_OP_START = 0,
+    I2C_OP_STOP,
+    I2C_OP_WRITE,
+    I2C_OP_READ,
+} i2c_op_type_t;
+
+typedef struct {
+    i2c_op_type_t type;
+    uint8_t data;
+    uint8_t *read;
+} i2c_op_t;
+
+typedef struct {
+    i2c_op_t *op;
+    int cnt;
+    int size;
+} i2c_link_t;
+
+typedef struct {
+    uint8_t installed;
+    uint32_t clk_speed;
+    host_i2c_dev_t dev;
+} i2c_port_sim_t;
+
+typedef struct {
+    i2c_port_sim_t port[I2C_NUM_MAX];
+    int fail_transfer;
+    host_i2c_sim_stats_t stats;
+    pthread_mutex_t lock;
+} host_i2c_sim_t;
+
+static host_i2c_sim_t i2c_sim = {
+    .fail_transfer = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+int host_i2c_sim_attach(i2c_port_t port, const host_i2c_dev_t *dev)
+{
+    if (port < 0 || port >= I2C_NUM_MAX) {
+        return -1;
+    }
+    pthread_mutex_lock(&i2c_sim.lock);
+    i2c_sim.port[port].dev = *dev;
+    pthread_mutex_unlock(&i2c_sim.lock);
+    return 0;
+}
+
+void host_i2c_sim_fail_transfer(int n)
+{
+    pthread_mutex_lock(&i2c_sim.lock);
+    i2c_sim.fail_transfer = n;
+    pthread_mutex_unlock(&i2c_sim.lock);
+}
+
+void host_i2c_sim_stats(host_i2c_sim_stats_t *stats, bool reset)
+{
+    pthread_mutex_lock(&i2c_sim.lock);
+    *stats = i2c_sim.stats;
+    if (reset) {
+        memset(&i2c_sim.stats, 0, sizeof(i2c_sim.stats));
+    }
+    pthread_mutex_unlock(&i2c_sim.lock);
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || i2c_conf->mode != I2C_MODE_MASTER || i2c_conf->master.clk_speed == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_sim.port[i2c_num].clk_speed = i2c_conf->master.clk_speed;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, int mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (i2c_sim.port[i2c_num].installed) {
+        return ESP_FAIL;
+    }
+    i2c_sim.port[i2c_num].installed = 1;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_sim.port[i2c_num].installed = 0;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    return calloc(1, sizeof(i2c_link_t));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_link_t *link = (i2c_link_t *)cmd_handle;
+    if (link) {
+        free(link->op);
+        free(link);
+    }
+}
+
+static esp_err_t i2c_link_add(i2c_cmd_handle_t cmd_handle, i2c_op_type_t type, uint8_t data, uint8_t *read)
+{
+    i2c_link_t *link = (i2c_link_t *)cmd_handle;
+    if (link->cnt == link->size) {
+        i2c_op_t *op = (i2c_op_t *)realloc(link->op, (link->size + I2C_LINK_GROW) * sizeof(i2c_op_t));
+        if (!op) {
+            return ESP_ERR_NO_MEM;
+        }
+        link->op = op;
+        link->size += I2C_LINK_GROW;
+    }
+    link->op[link->cnt].type = type;
+    link->op[link->cnt].data = data;
+    link->op[link->cnt].read = read;
+    link->cnt++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_link_add(cmd_handle, I2C_OP_START, 0, NULL);
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_link_add(cmd_handle, I2C_OP_STOP, 0, NULL);
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    return i2c_link_add(cmd_handle, I2C_OP_WRITE, data, NULL);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+    esp_err_t ret = ESP_OK;
+    for (size_t x = 0; x < data_len && ret == ESP_OK; x++) {
+        ret = i2c_link_add(cmd_handle, I2C_OP_WRITE, data[x], NULL);
+    }
+    return ret;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, int ack)
+{
+    return i2c_link_add(cmd_handle, I2C_OP_READ, 0, data);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, int ack)
+{
+    esp_err_t ret = ESP_OK;
+    for (size_t x = 0; x < data_len && ret == ESP_OK; x++) {
+        ret = i2c_link_add(cmd_handle, I2C_OP_READ, 0, &data[x]);
+    }
+    return ret;
+}
+
+// 执行op[start, end)之间的一个传输, 第一个字节为地址
+static bool i2c_sim_transfer(i2c_port_sim_t *port, const i2c_op_t *op, int cnt, uint32_t *clocks)
+{
+    uint8_t buf[I2C_XFER_MAX];
+    int len = 0;
+    bool ack = false;
+    if (cnt == 0 || op[0].type != I2C_OP_WRITE) {
+        return false;
+    }
+    uint8_t addr = op[0].data >> 1;
+    bool read = op[0].data & 0x01;
+    i2c_sim.stats.transfers++;
+    i2c_sim.stats.bytes += cnt;
+    *clocks += 9 * cnt;
+    if (i2c_sim.fail_transfer == 0) {
+        i2c_sim.fail_transfer = -1;
+        return false;
+    }
+    if (i2c_sim.fail_transfer > 0) {
+        i2c_sim.fail_transfer--;
+    }
+    for (int x = 1; x < cnt && len < I2C_XFER_MAX; x++) {
+        if ((op[x].type == I2C_OP_READ) != read) {
+            fprintf(stderr, "i2c_sim: mixed read/write in one transfer\n");
+            return false;
+        }
+        buf[len++] = op[x].data;
+    }
+    if (read) {
+        i2c_sim.stats.read_transfers++;
+        ack = port->dev.read && port->dev.read(port->dev.arg, addr, buf, len);
+        for (int x = 0; ack && x < len; x++) {
+            *op[x + 1].read = buf[x];
+        }
+    } else {
+        i2c_sim.stats.write_transfers++;
+        ack = port->dev.write && port->dev.write(port->dev.arg, addr, buf, len);
+    }
+    return ack;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, uint32_t ticks_to_wait)
+{
+    i2c_link_t *link = (i2c_link_t *)cmd_handle;
+    i2c_port_sim_t *port = NULL;
+    esp_err_t ret = ESP_OK;
+    uint32_t clocks = 0;
+    int start = -1;
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !i2c_sim.port[i2c_num].installed) {
+        return ESP_FAIL;
+    }
+    port = &i2c_sim.port[i2c_num];
+    pthread_mutex_lock(&i2c_sim.lock);
+    i2c_sim.stats.links++;
+    for (int x = 0; x <= link->cnt; x++) {
+        i2c_op_type_t type = x < link->cnt ? link->op[x].type : I2C_OP_STOP;
+        if (type != I2C_OP_START && type != I2C_OP_STOP) {
+            continue;
+        }
+        clocks++;
+        if (start >= 0 && !i2c_sim_transfer(port, &link->op[start], x - start, &clocks)) {
+            i2c_sim.stats.nacks++;
+            ret = ESP_FAIL;
+            break;
+        }
+        if (type == I2C_OP_STOP) {
+            break;
+        }
+        start = x + 1;
+    }
+    i2c_sim.stats.bus_us += clocks * 1000000.0 / port->clk_speed;
+    pthread_mutex_unlock(&i2c_sim.lock);
+    return ret;
+}
@@ -0,0 +1,215 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_intr_alloc.h"
+#include "soc/spi_struct.h"
+#include "esp32s2/rom/lldesc.h"
+#include "host_sim.h"
+#include "host_spi_sim.h"
+
+#define SPI_APB_CLK         (80 * 1000 * 1000)
+#define SPI_DATA_BUF_SIZE   (72)        // W0~W17
+#define SPI_MAX_LEN         (1 << 20)   // usr_mosi_bit_len为23位
+#define SPI_EXT_MEM_ALIGN   (16)
+#define SPI_SPIN_CNT        (1000)      // 多核时空闲后先忙等, 之后每次休眠SPI_IDLE_NS
+#define SPI_IDLE_NS         (20000)
+
+spi_dev_t GPSPI3;
+
+typedef struct {
+    pthread_t thread;
+    volatile bool run;
+    bool realtime;
+    host_spi_sink_t sink;
+    void *arg;
+    uint8_t *buf;
+    host_spi_sim_stats_t stats;
+    pthread_mutex_t stats_lock;
+} host_spi_sim_t;
+
+static host_spi_sim_t spi_sim = {
+    .stats_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+#define SIM_ERROR(format, ...) do { \
+    fprintf(stderr, "spi_sim: " format "\n", ##__VA_ARGS__); \
+    spi_sim.stats.errors++; \
+} while (0)
+
+uint32_t host_spi_sim_clk(void)
+{
+    if (GPSPI3.clock.clk_equ_sysclk) {
+        return SPI_APB_CLK;
+    }
+    return SPI_APB_CLK / ((GPSPI3.clock.clkdiv_pre + 1) * (GPSPI3.clock.clkcnt_n + 1));
+}
+
+// 按链表读取len字节, 检查每个节点的buf是否能被DMA访问
+static size_t spi_sim_dma_read(uint8_t *out, size_t len, uint32_t *nodes)
+{
+    lldesc_t *dma = (lldesc_t *)host_dma_addr(GPSPI3.dma_out_link.addr);
+    size_t total = 0, size = 0;
+    *nodes = 0;
+    if (dma == NULL || !host_ptr_dma_mem(dma)) {
+        SIM_ERROR("out_link addr 0x%05x is not in DMA memory", GPSPI3.dma_out_link.addr);
+        return 0;
+    }
+    while (dma) {
+        if (!host_ptr_dma_mem(dma)) {
+            SIM_ERROR("descriptor %p is not in DMA memory", (void *)dma);
+            break;
+        }
+        (*nodes)++;
+        if (host_ptr_spiram((const void *)dma->buf)) {
+            if (((uintptr_t)dma->buf % SPI_EXT_MEM_ALIGN) || (dma->length % SPI_EXT_MEM_ALIGN)) {
+                SIM_ERROR("PSRAM buffer %p length %u is not %d byte aligned", (void *)dma->buf, dma->length, SPI_EXT_MEM_ALIGN);
+            }
+        } else if (!host_ptr_dma_mem((const void *)dma->buf)) {
+            SIM_ERROR("buffer %p is not DMA capable", (void *)dma->buf);
+            break;
+        }
+        size = dma->length;
+        if (total + size > len) {
+            size = len - total;
+        }
+        memcpy(out + total, (const void *)dma->buf, size);
+        total += size;
+        if (dma->eof || total == len) {
+            break;
+        }
+        dma = dma->empty;
+    }
+    if (total < len) {
+        SIM_ERROR("DMA underflow: %zu of %zu bytes", total, len);
+    }
+    return total;
+}
+
+static void spi_sim_wait_until(int64_t end_us)
+{
+    while (host_time_us() < end_us) {
+        sched_yield();
+    }
+}
+
+static void spi_sim_trans(void)
+{
+    size_t len = (GPSPI3.mosi_dlen.usr_mosi_bit_len + 1 + 7) / 8;
+    size_t sent = 0;
+    uint32_t nodes = 0;
+    bool dma = GPSPI3.dma_out_link.dma_tx_ena;
+    int64_t start = host_time_us();
+    double bus_us = 0;
+
+    pthread_mutex_lock(&spi_sim.stats_lock);
+    if (dma) {
+        if (!GPSPI3.dma_out_link.start) {
+            SIM_ERROR("transfer started without dma_out_link.start");
+        }
+        GPSPI3.dma_out_link.start = 0;
+        sent = spi_sim_dma_read(spi_sim.buf, len, &nodes);
+    } else if (len > SPI_DATA_BUF_SIZE) {
+        SIM_ERROR("CPU transfer of %zu bytes exceeds data_buf", len);
+    } else {
+        memcpy(spi_sim.buf, (const void *)GPSPI3.data_buf, len);
+        sent = len;
+    }
+    bus_us = (len * 8.0 + GPSPI3.user.cs_setup + GPSPI3.user.cs_hold) * 1e6 / host_spi_sim_clk();
+    spi_sim.stats.transactions++;
+    spi_sim.stats.dma_transactions += dma;
+    spi_sim.stats.descriptors += nodes;
+    spi_sim.stats.bytes += sent;
+    spi_sim.stats.bus_us += bus_us;
+    pthread_mutex_unlock(&spi_sim.stats_lock);
+
+    if (spi_sim.sink && sent) {
+        spi_sim.sink(spi_sim.arg, spi_sim.buf, sent, dma);
+    }
+    if (spi_sim.realtime) {
+        spi_sim_wait_until(start + (int64_t)bus_us);
+    }
+
+    GPSPI3.cmd.usr = 0;
+    if (dma) {
+        GPSPI3.dma_int_raw.out_eof = 1;
+        GPSPI3.dma_int_st.val = GPSPI3.dma_int_raw.val & GPSPI3.dma_int_ena.val;
+        if (GPSPI3.dma_int_st.val) {
+            host_intr_raise(ETS_SPI3_DMA_INTR_SOURCE);
+        }
+        // 中断处理函数写dma_int_clr清除中断状态
+        GPSPI3.dma_int_raw.val &= ~GPSPI3.dma_int_clr.val;
+        GPSPI3.dma_int_st.val &= ~GPSPI3.dma_int_clr.val;
+        GPSPI3.dma_int_clr.val = 0;
+    }
+}
+
+static void *spi_sim_thread(void *arg)
+{
+    struct timespec idle = {.tv_sec = 0, .tv_nsec = SPI_IDLE_NS};
+    // 单核时驱动轮询cmd.usr会占满时间片, 模拟线程只能靠休眠唤醒抢占
+    int spin_cnt = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPI_SPIN_CNT : 0;
+    int spin = 0;
+    (void)arg;
+    while (spi_sim.run) {
+        if (GPSPI3.cmd.usr) {
+            __sync_synchronize();
+            spi_sim_trans();
+            spin = 0;
+        } else if (++spin < spin_cnt) {
+            sched_yield();
+        } else {
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+int host_spi_sim_start(host_spi_sink_t sink, void *arg)
+{
+    spi_sim.sink = sink;
+    spi_sim.arg = arg;
+    spi_sim.buf = (uint8_t *)malloc(SPI_MAX_LEN);
+    if (!spi_sim.buf) {
+        return -1;
+    }
+    spi_sim.run = true;
+    if (pthread_create(&spi_sim.thread, NULL, spi_sim_thread, NULL) != 0) {
+        spi_sim.run = false;
+        free(spi_sim.buf);
+        spi_sim.buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void host_spi_sim_stop(void)
+{
+    if (!spi_sim.run) {
+        return;
+    }
+    spi_sim.run = false;
+    pthread_join(spi_sim.thread, NULL);
+    free(spi_sim.buf);
+    spi_sim.buf = NULL;
+}
+
+void host_spi_sim_set_realtime(bool realtime)
+{
+    spi_sim.realtime = realtime;
+}
+
+void host_spi_sim_stats(host_spi_sim_stats_t *stats, bool reset)
+{
+    pthread_mutex_lock(&spi_sim.stats_lock);
+    *stats = spi_sim.stats;
+    if (reset) {
+        memset(&spi_sim.stats, 0, sizeof(spi_sim.stats));
+    }
+    pthread_mutex_unlock(&spi_sim.stats_lock);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_intr_alloc.h"
+#include "esp32s2/rom/ets_sys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 只记录输出电平, 模拟的外设通过host_gpio_get_level/host_gpio_set_hook读取
+typedef int gpio_num_t;
+
+#define GPIO_NUM_MAX            (48)
+#define GPIO_MODE_DISABLE       (0)
+#define GPIO_MODE_INPUT         (1)
+#define GPIO_MODE_OUTPUT        (2)
+#define GPIO_FLOATING           (3)
+#define GPIO_PULLUP_DISABLE     (0)
+#define GPIO_PULLUP_ENABLE      (1)
+#define GPIO_NUM_7              (7)
+#define GPIO_NUM_8              (8)
+#define GPIO_PIN_INTR_DISABLE   (0)
+#define GPIO_PIN_INTR_NEGEDGE   (2)
+#define PIN_FUNC_GPIO           (1)
+#define PIN_FUNC_SELECT(reg, func) ((void)(reg), (void)(func))
+
+#define SPI3_CLK_OUT_MUX_IDX    (66)
+#define SPI3_D_OUT_IDX          (68)
+
+extern uint32_t GPIO_PIN_MUX_REG[GPIO_NUM_MAX];
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    int mode;
+    int pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, int mode);
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, int pull);
+void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv);
+void gpio_matrix_in(uint32_t gpio, uint32_t signal_idx, bool inv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// I2C主机命令链, 由host_i2c_sim在i2c_master_cmd_begin时按顺序执行
+typedef int i2c_port_t;
+typedef void *i2c_cmd_handle_t;
+
+#define I2C_NUM_0               (0)
+#define I2C_NUM_1               (1)
+#define I2C_NUM_MAX             (2)
+
+typedef enum {
+    I2C_MODE_SLAVE = 0,
+    I2C_MODE_MASTER,
+} i2c_mode_t;
+
+typedef enum {
+    I2C_MASTER_WRITE = 0,
+    I2C_MASTER_READ,
+} i2c_rw_t;
+
+typedef enum {
+    I2C_MASTER_ACK = 0,
+    I2C_MASTER_NACK,
+    I2C_MASTER_LAST_NACK,
+} i2c_ack_type_t;
+
+typedef struct {
+    int mode;
+    int sda_io_num;
+    int scl_io_num;
+    int sda_pullup_en;
+    int scl_pullup_en;
+    struct {
+        uint32_t clk_speed;
+    } master;
+} i2c_config_t;
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf);
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, int mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, int intr_alloc_flags);
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num);
+
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, int ack);
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, int ack);
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, uint32_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
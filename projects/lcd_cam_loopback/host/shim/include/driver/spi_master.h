@@ -0,0 +1,5 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_intr_alloc.h"
+#include "soc/spi_struct.h"
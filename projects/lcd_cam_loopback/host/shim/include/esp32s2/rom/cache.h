@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 主机上没有cache, 写回/失效为空操作
+int Cache_WriteBack_Addr(uint32_t addr, uint32_t size);
+int Cache_Invalidate_Addr(uint32_t addr, uint32_t size);
+void Cache_WriteBack_All(void);
+
+#ifdef __cplusplus
+}
+#endif
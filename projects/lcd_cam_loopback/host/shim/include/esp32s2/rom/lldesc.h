@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// 与ROM中的定义相同; buf和empty在主机上为64位指针, 模拟的DMA按指针访问
+typedef struct lldesc_s {
+    volatile uint32_t size   : 12,
+                      length : 12,
+                      offset : 5,
+                      sosf   : 1,
+                      eof    : 1,
+                      owner  : 1;
+    volatile uint8_t *buf;
+    struct lldesc_s *empty;
+} lldesc_t;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETS_I2S0_INTR_SOURCE        (35)
+#define ETS_SPI3_DMA_INTR_SOURCE    (42)
+#define ETS_MAX_INTR_SOURCE         (96)
+
+typedef void (*intr_handler_t)(void *arg);
+typedef struct host_intr_s *intr_handle_t;
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void *arg, intr_handle_t *ret_handle);
+esp_err_t esp_intr_free(intr_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 与IDF相同的"级别 (毫秒时间戳) TAG: "前缀, 输出到stdout
+uint32_t esp_log_timestamp(void);
+int ets_printf(const char *fmt, ...);
+
+#define HOST_LOG(level, tag, format, ...) printf(level " (%u) %s: " format, esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do {} while (0)
+#define ESP_LOGV(tag, format, ...) do {} while (0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+// 主机(Linux)构建用的FreeRTOS替身: 任务为pthread, 队列/信号量为互斥锁+条件变量
+// 1 tick = 1 ms; 临界区为一把全局递归锁, 模拟的中断处理函数也在该锁内执行
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE                      (1)
+#define pdFALSE                     (0)
+#define pdPASS                      (1)
+#define pdFAIL                      (0)
+#define errQUEUE_FULL               (0)
+#define portMAX_DELAY               ((TickType_t)0xffffffffUL)
+#define portTICK_RATE_MS            ((TickType_t)1)
+#define portTICK_PERIOD_MS          ((TickType_t)1)
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(ms))
+#define configMAX_PRIORITIES        (25)
+#define configTICK_RATE_HZ          (1000)
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED (0)
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define portENTER_CRITICAL(mux)     ((void)(mux), host_critical_enter())
+#define portEXIT_CRITICAL(mux)      ((void)(mux), host_critical_exit())
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux), host_critical_enter())
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux), host_critical_exit())
+#define portYIELD_FROM_ISR()
+
+typedef struct host_queue_s *QueueHandle_t;
+typedef struct host_queue_s *SemaphoreHandle_t;
+typedef struct host_task_s *TaskHandle_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 信号量是元素大小为0的队列, 与FreeRTOS的实现方式相同
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+#define xSemaphoreTake(sem, ticks)          xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)                 xQueueSend(sem, NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken)   xQueueSendFromISR(sem, NULL, woken)
+#define xSemaphoreTakeFromISR(sem, woken)   xQueueReceiveFromISR(sem, NULL, woken)
+#define uxSemaphoreGetCount(sem)            uxQueueMessagesWaiting(sem)
+#define vSemaphoreDelete(sem)               vQueueDelete(sem)
+
+#ifdef __cplusplus
+}
+#endif
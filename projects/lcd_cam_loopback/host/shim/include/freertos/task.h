@@ -0,0 +1,28 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*TaskFunction_t)(void *arg);
+
+// 优先级和栈大小只记录, 不影响pthread调度
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t func, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core_id);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char *pcTaskGetTaskName(TaskHandle_t handle);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t handle);
+// 其他pthread不会暂停; 只保证暂停期间任务不会被删除(vTaskDelete等待xTaskResumeAll), 可以安全地查询其他任务
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+// 同ESP-IDF, 单位为字节; 按任务在主机上的实际栈用量计算, 超过stack_depth时为0(主机上不会溢出)
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
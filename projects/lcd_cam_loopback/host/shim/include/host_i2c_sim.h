@@ -0,0 +1,42 @@
+#pragma once
+
+// I2C主机的模拟: i2c_master_cmd_begin按顺序执行命令链, 每个传输(起始位到下一个起始位或停止位)
+// 交给挂在该端口上的设备模型(例如OV2640模型), 设备或故障注入返回NACK时命令链中止并返回ESP_FAIL,
+// 与IDF驱动相同, 命令链遇到停止位即结束
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "driver/i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// addr为7位地址, 返回false表示NACK
+typedef struct {
+    bool (*write)(void *arg, uint8_t addr, const uint8_t *data, size_t len);
+    bool (*read)(void *arg, uint8_t addr, uint8_t *data, size_t len);
+    void *arg;
+} host_i2c_dev_t;
+
+typedef struct {
+    uint32_t links;         // i2c_master_cmd_begin次数
+    uint32_t transfers;     // 起始位个数
+    uint32_t write_transfers;
+    uint32_t read_transfers;
+    uint64_t bytes;         // 包括地址字节
+    double bus_us;          // 按i2c_param_config的时钟计算的总线占用时间
+    uint32_t nacks;
+} host_i2c_sim_stats_t;
+
+int host_i2c_sim_attach(i2c_port_t port, const host_i2c_dev_t *dev);
+
+// 从现在起第n个传输(从0开始)地址NACK, 用于验证错误处理; -1: 取消
+void host_i2c_sim_fail_transfer(int n);
+
+void host_i2c_sim_stats(host_i2c_sim_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
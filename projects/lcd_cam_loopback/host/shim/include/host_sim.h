@@ -0,0 +1,39 @@
+#pragma once
+
+// 主机模拟环境: 内存区域, GPIO电平, 中断分发
+// 供模拟外设(host_spi_sim.c等)使用, 组件代码不应包含本文件
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 内部DMA内存(MALLOC_CAP_DMA): 按1MB对齐, 外设只保存地址的低20位, 由host_dma_addr还原
+#define HOST_DMA_MEM_SIZE       (1 << 20)
+// PSRAM(MALLOC_CAP_SPIRAM)
+#define HOST_SPIRAM_MEM_SIZE    (8 << 20)
+
+typedef void (*host_gpio_hook_t)(void *arg, int gpio, int level);
+
+// 低20位地址(如dma_out_link.addr)对应的内部DMA内存地址, 越界返回NULL
+void *host_dma_addr(uint32_t addr);
+
+bool host_ptr_dma_mem(const void *p);
+
+bool host_ptr_spiram(const void *p);
+
+// GPIO电平变化时调用(例如LCD复位引脚), 只支持一个回调
+void host_gpio_set_hook(host_gpio_hook_t hook, void *arg);
+
+// 在模拟线程中触发中断: 在临界区锁内调用esp_intr_alloc注册的处理函数
+void host_intr_raise(int source);
+
+// 单调时钟, 微秒
+int64_t host_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+// GPSPI3及其DMA的模拟: 模拟线程监视GPSPI3.cmd.usr, 按寄存器配置取得要发送的数据
+// (DMA链表或W0~W15), 交给sink(例如LCD模型), 结束时清除usr并产生out_eof中断
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 一次SPI传输的全部数据, dma: 1: 由DMA发送, 0: 由数据寄存器发送
+typedef void (*host_spi_sink_t)(void *arg, const uint8_t *data, size_t len, bool dma);
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t dma_transactions;
+    uint32_t descriptors;   // DMA读取的链表节点个数
+    uint64_t bytes;
+    double bus_us;          // 按SPI时钟计算的总线占用时间
+    uint32_t errors;        // 非DMA内存, PSRAM未对齐, 长度不符等
+} host_spi_sim_stats_t;
+
+int host_spi_sim_start(host_spi_sink_t sink, void *arg);
+
+void host_spi_sim_stop(void);
+
+// 1: 每次传输按计算出的总线时间延迟完成, 用于观察流水线的实际效果; 0: 立即完成
+void host_spi_sim_set_realtime(bool realtime);
+
+// 当前寄存器配置的SPI时钟, Hz
+uint32_t host_spi_sim_clk(void);
+
+void host_spi_sim_stats(host_spi_sim_stats_t *stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
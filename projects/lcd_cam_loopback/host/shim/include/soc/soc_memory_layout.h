@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 按模拟的内存区域判断, 见host_sim.h
+bool esp_ptr_dma_capable(const void *p);
+bool esp_ptr_external_ram(const void *p);
+bool esp_ptr_internal(const void *p);
+
+#ifdef __cplusplus
+}
+#endif
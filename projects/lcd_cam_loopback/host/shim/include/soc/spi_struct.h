@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ESP32-S2 GPSPI寄存器中lcd.c用到的部分, 字段名与IDF的soc/spi_struct.h一致
+// 主机上没有硬件, GPSPI3由host_spi_sim.c中的模拟线程监视和响应
+typedef volatile struct {
+    union {
+        struct {
+            uint32_t conf_bitlen : 23;
+            uint32_t reserved23  : 1;
+            uint32_t usr         : 1;
+            uint32_t reserved25  : 7;
+        };
+        uint32_t val;
+    } cmd;
+    union {
+        struct {
+            uint32_t reserved0    : 25;
+            uint32_t wr_bit_order : 1;
+            uint32_t rd_bit_order : 1;
+            uint32_t reserved27   : 5;
+        };
+        uint32_t val;
+    } ctrl;
+    union {
+        struct {
+            uint32_t clk_mode   : 2;
+            uint32_t reserved2  : 30;
+        };
+        uint32_t val;
+    } ctrl1;
+    union {
+        struct {
+            uint32_t clkcnt_l       : 6;
+            uint32_t clkcnt_h       : 6;
+            uint32_t clkcnt_n       : 6;
+            uint32_t clkdiv_pre     : 13;
+            uint32_t clk_equ_sysclk : 1;
+        };
+        uint32_t val;
+    } clock;
+    union {
+        struct {
+            uint32_t reserved0         : 6;
+            uint32_t cs_hold           : 1;
+            uint32_t cs_setup          : 1;
+            uint32_t reserved8         : 1;
+            uint32_t ck_out_edge       : 1;
+            uint32_t reserved10        : 15;
+            uint32_t usr_mosi_highpart : 1;
+            uint32_t reserved26        : 1;
+            uint32_t usr_mosi          : 1;
+            uint32_t reserved28        : 4;
+        };
+        uint32_t val;
+    } user;
+    union {
+        uint32_t val;
+    } user1;
+    union {
+        struct {
+            uint32_t usr_mosi_bit_len : 23;
+            uint32_t reserved23       : 9;
+        };
+        uint32_t val;
+    } mosi_dlen;
+    union {
+        struct {
+            uint32_t ck_dis       : 1;
+            uint32_t reserved1    : 28;
+            uint32_t ck_idle_edge : 1;
+            uint32_t reserved30   : 2;
+        };
+        uint32_t val;
+    } misc;
+    union {
+        uint32_t val;
+    } slave;
+    union {
+        struct {
+            uint32_t reserved0     : 2;
+            uint32_t in_rst        : 1;
+            uint32_t out_rst       : 1;
+            uint32_t ahbm_fifo_rst : 1;
+            uint32_t ahbm_rst      : 1;
+            uint32_t reserved6     : 3;
+            uint32_t out_eof_mode  : 1;
+            uint32_t reserved10    : 22;
+        };
+        uint32_t val;
+    } dma_conf;
+    union {
+        struct {
+            uint32_t addr       : 20;
+            uint32_t reserved20 : 8;
+            uint32_t stop       : 1;
+            uint32_t start      : 1;
+            uint32_t restart    : 1;
+            uint32_t dma_tx_ena : 1;
+        };
+        uint32_t val;
+    } dma_out_link;
+    union {
+        struct {
+            uint32_t reserved0  : 7;
+            uint32_t out_done   : 1;
+            uint32_t out_eof    : 1;
+            uint32_t out_total_eof : 1;
+            uint32_t reserved10 : 22;
+        };
+        uint32_t val;
+    } dma_int_ena, dma_int_raw, dma_int_st, dma_int_clr;
+    uint32_t data_buf[18];
+} spi_dev_t;
+
+extern spi_dev_t GPSPI3;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+// 外设时钟和复位在主机上没有意义, 寄存器位操作为空
+#define DPORT_PERIP_CLK_EN0_REG     (0)
+#define DPORT_PERIP_RST_EN0_REG     (0)
+#define DPORT_SPI3_CLK_EN           (1 << 16)
+#define DPORT_SPI3_RST              (1 << 16)
+#define DPORT_SPI3_DMA_CLK_EN       (1 << 22)
+#define DPORT_SPI3_DMA_RST          (1 << 22)
+#define DPORT_I2S0_CLK_EN           (1 << 4)
+#define DPORT_I2S0_RST              (1 << 4)
+
+#define REG_SET_BIT(reg, bit)       ((void)(reg), (void)(bit))
+#define REG_CLR_BIT(reg, bit)       ((void)(reg), (void)(bit))
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CPU周期计数器, 主机上为单调时钟的纳秒数(低32位)
+unsigned xthal_get_ccount(void);
+
+#ifdef __cplusplus
+}
+#endif
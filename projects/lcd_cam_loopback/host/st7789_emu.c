@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "driver/gpio.h"
+#include "host_sim.h"
+#include "host_spi_sim.h"
+#include "png.h"
+#include "st7789_emu.h"
+
+#define ST7789_MAX_PARAM        (16)
+#define ST7789_CMD_WAIT_US      (5000)      // 复位(休眠状态下)/SWRESET/SLPOUT之后5ms才能发送命令
+#define ST7789_RESET_AWAKE_US   (120000)    // 退出休眠后硬件复位, 120ms才能发送命令
+#define ST7789_RESET_SLPOUT_US  (120000)    // 复位(RESX或SWRESET)之后120ms才能SLPOUT
+#define ST7789_SLEEP_WAIT_US    (120000)    // SLPIN与SLPOUT之间至少间隔120ms
+#define ST7789_RST_PULSE_US     (10)        // RESX低电平最短10us
+
+#define MADCTL_MY   (0x80)
+#define MADCTL_MX   (0x40)
+#define MADCTL_MV   (0x20)
+
+typedef struct {
+    st7789_emu_config_t config;
+    pthread_mutex_t lock;
+    uint32_t *gram;
+    uint8_t cmd;
+    uint8_t param[ST7789_MAX_PARAM];
+    uint32_t param_cnt;
+    uint8_t ramwr;          // 正在接收像素数据
+    uint8_t pix[3];
+    uint32_t pix_cnt;
+    uint16_t xs, xe, ys, ye;
+    uint16_t x, y;
+    uint8_t madctl;
+    uint8_t colmod;
+    uint8_t sleep;
+    uint8_t display_on;
+    uint8_t invert;
+    int64_t rst_low_time;
+    int64_t cmd_ready;      // 此时间之前不能发送任何命令
+    int64_t slpout_ready;   // 此时间之前不能发送SLPOUT
+    int64_t slpin_ready;    // 此时间之前不能发送SLPIN
+    st7789_emu_stats_t stats;
+} st7789_emu_t;
+
+static st7789_emu_t *emu = NULL;
+
+#define EMU_VIOLATION(format, ...) do { \
+    fprintf(stderr, "st7789: " format "\n", ##__VA_ARGS__); \
+    emu->stats.violations++; \
+} while (0)
+
+// hw: 1: RESX复位, 0: SWRESET
+static void emu_reset(int64_t now, int hw)
+{
+    int awake = !emu->sleep;
+    emu->ramwr = 0;
+    emu->param_cnt = 0;
+    emu->pix_cnt = 0;
+    emu->cmd = 0;
+    emu->madctl = 0;
+    emu->colmod = 0x66;
+    emu->sleep = 1;
+    emu->display_on = 0;
+    emu->invert = 0;
+    emu->xs = 0;
+    emu->xe = ST7789_GRAM_WIDTH - 1;
+    emu->ys = 0;
+    emu->ye = ST7789_GRAM_HIGH - 1;
+    emu->cmd_ready = now + (hw && awake ? ST7789_RESET_AWAKE_US : ST7789_CMD_WAIT_US);
+    emu->slpout_ready = now + ST7789_RESET_SLPOUT_US;
+    emu->slpin_ready = now;
+}
+
+static void emu_view(int *width, int *high)
+{
+    *width = (emu->madctl & MADCTL_MV) ? ST7789_GRAM_HIGH : ST7789_GRAM_WIDTH;
+    *high = (emu->madctl & MADCTL_MV) ? ST7789_GRAM_WIDTH : ST7789_GRAM_HIGH;
+}
+
+// 逻辑坐标到GRAM下标, 超出范围返回-1
+static int emu_index(int x, int y)
+{
+    int width, high, px, py;
+    emu_view(&width, &high);
+    if (x < 0 || y < 0 || x >= width || y >= high) {
+        return -1;
+    }
+    px = (emu->madctl & MADCTL_MV) ? y : x;
+    py = (emu->madctl & MADCTL_MV) ? x : y;
+    if (emu->madctl & MADCTL_MX) {
+        px = ST7789_GRAM_WIDTH - 1 - px;
+    }
+    if (emu->madctl & MADCTL_MY) {
+        py = ST7789_GRAM_HIGH - 1 - py;
+    }
+    return py * ST7789_GRAM_WIDTH + px;
+}
+
+static void emu_write_pixel(uint32_t rgb)
+{
+    int index = emu_index(emu->x, emu->y);
+    if (index < 0) {
+        emu->stats.clipped++;
+    } else {
+        emu->gram[index] = rgb;
+        emu->stats.pixels++;
+    }
+    // 写到窗口右边界后换行, 写到窗口末尾后回到窗口起点
+    if (emu->x >= emu->xe) {
+        emu->x = emu->xs;
+        emu->y = emu->y >= emu->ye ? emu->ys : emu->y + 1;
+    } else {
+        emu->x++;
+    }
+}
+
+static uint32_t expand4(uint32_t value)
+{
+    return (value << 2) | (value >> 2);
+}
+
+static uint32_t expand5(uint32_t value)
+{
+    return (value << 1) | (value >> 4);
+}
+
+static void emu_pixel_byte(uint8_t data)
+{
+    uint32_t p = 0;
+    emu->stats.pixel_bytes++;
+    emu->pix[emu->pix_cnt++] = data;
+    switch (emu->colmod & 0x07) {
+        case 0x03: // 12位: R0G0 B0R1 G1B1, 第二个字节收到后第一个像素完整
+            if (emu->pix_cnt == 2) {
+                emu_write_pixel((expand4(emu->pix[0] >> 4) << 12) | (expand4(emu->pix[0] & 0x0F) << 6) | expand4(emu->pix[1] >> 4));
+            } else if (emu->pix_cnt == 3) {
+                emu_write_pixel((expand4(emu->pix[1] & 0x0F) << 12) | (expand4(emu->pix[2] >> 4) << 6) | expand4(emu->pix[2] & 0x0F));
+                emu->pix_cnt = 0;
+            }
+            break;
+
+        case 0x05: // 16位: RRRRRGGG GGGBBBBB
+            if (emu->pix_cnt == 2) {
+                p = (emu->pix[0] << 8) | emu->pix[1];
+                emu_write_pixel((expand5(p >> 11) << 12) | (((p >> 5) & 0x3F) << 6) | expand5(p & 0x1F));
+                emu->pix_cnt = 0;
+            }
+            break;
+
+        default: // 18位: 每个分量一个字节, 高6位有效
+            if (emu->pix_cnt == 3) {
+                emu_write_pixel(((emu->pix[0] >> 2) << 12) | ((emu->pix[1] >> 2) << 6) | (emu->pix[2] >> 2));
+                emu->pix_cnt = 0;
+            }
+            break;
+    }
+}
+
+static void emu_param(uint8_t data)
+{
+    if (emu->ramwr) {
+        emu_pixel_byte(data);
+        return;
+    }
+    if (emu->param_cnt >= ST7789_MAX_PARAM) {
+        return;
+    }
+    emu->param[emu->param_cnt++] = data;
+    switch (emu->cmd) {
+        case 0x2A: // CASET
+            if (emu->param_cnt == 4) {
+                emu->xs = (emu->param[0] << 8) | emu->param[1];
+                emu->xe = (emu->param[2] << 8) | emu->param[3];
+                if (emu->xs > emu->xe) {
+                    EMU_VIOLATION("CASET start %d > end %d", emu->xs, emu->xe);
+                }
+            }
+            break;
+
+        case 0x2B: // RASET
+            if (emu->param_cnt == 4) {
+                emu->ys = (emu->param[0] << 8) | emu->param[1];
+                emu->ye = (emu->param[2] << 8) | emu->param[3];
+                if (emu->ys > emu->ye) {
+                    EMU_VIOLATION("RASET start %d > end %d", emu->ys, emu->ye);
+                }
+            }
+            break;
+
+        case 0x36: // MADCTL
+            emu->madctl = data;
+            break;
+
+        case 0x3A: // COLMOD
+            emu->colmod = data;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void emu_cmd(uint8_t cmd, int64_t now)
+{
+    // 上一个带参数的命令参数不足
+    if ((emu->cmd == 0x2A || emu->cmd == 0x2B) && emu->param_cnt != 4) {
+        EMU_VIOLATION("cmd 0x%02x expects 4 params, got %u", emu->cmd, emu->param_cnt);
+    }
+    if (emu->ramwr && emu->pix_cnt) {
+        // 像素数据被新的命令打断, 不完整的像素丢弃(RGB444奇数像素结尾除外)
+        if (!((emu->colmod & 0x07) == 0x03 && emu->pix_cnt == 2)) {
+            EMU_VIOLATION("RAMWR ended with %u stray bytes", emu->pix_cnt);
+        }
+    }
+    if (now < emu->cmd_ready) {
+        EMU_VIOLATION("cmd 0x%02x sent %lld us too early after reset/SLPOUT", cmd, (long long)(emu->cmd_ready - now));
+    }
+    emu->stats.cmds++;
+    emu->cmd = cmd;
+    emu->param_cnt = 0;
+    emu->pix_cnt = 0;
+    emu->ramwr = 0;
+    switch (cmd) {
+        case 0x01: // SWRESET
+            emu_reset(now, 0);
+            break;
+
+        case 0x10: // SLPIN
+            if (now < emu->slpin_ready) {
+                EMU_VIOLATION("SLPIN %lld us too early after SLPOUT", (long long)(emu->slpin_ready - now));
+            }
+            emu->sleep = 1;
+            emu->slpout_ready = now + ST7789_SLEEP_WAIT_US;
+            break;
+
+        case 0x11: // SLPOUT
+            if (now < emu->slpout_ready) {
+                EMU_VIOLATION("SLPOUT %lld us too early after reset/SLPIN", (long long)(emu->slpout_ready - now));
+            }
+            emu->sleep = 0;
+            emu->cmd_ready = now + ST7789_CMD_WAIT_US;
+            emu->slpin_ready = now + ST7789_SLEEP_WAIT_US;
+            break;
+
+        case 0x20: // INVOFF
+            emu->invert = 0;
+            break;
+
+        case 0x21: // INVON
+            emu->invert = 1;
+            break;
+
+        case 0x28: // DISPOFF
+            emu->display_on = 0;
+            break;
+
+        case 0x29: // DISPON
+            emu->display_on = 1;
+            break;
+
+        case 0x2C: // RAMWR
+            emu->x = emu->xs;
+            emu->y = emu->ys;
+            emu->ramwr = 1;
+            emu->stats.ramwr++;
+            break;
+
+        case 0x3C: // RAMWRC, 从上一次写入的位置继续
+            emu->ramwr = 1;
+            emu->stats.ramwr++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void emu_spi_sink(void *arg, const uint8_t *data, size_t len, bool dma)
+{
+    int64_t now = host_time_us();
+    (void)arg;
+    (void)dma;
+    pthread_mutex_lock(&emu->lock);
+    if (gpio_get_level(emu->config.pin_cs)) {
+        EMU_VIOLATION("%zu bytes sent with CS high", len);
+    } else if (!gpio_get_level(emu->config.pin_rst)) {
+        EMU_VIOLATION("%zu bytes sent during reset", len);
+    } else if (gpio_get_level(emu->config.pin_dc)) {
+        for (size_t x = 0; x < len; x++) {
+            emu_param(data[x]);
+        }
+    } else {
+        for (size_t x = 0; x < len; x++) {
+            emu_cmd(data[x], now);
+        }
+    }
+    pthread_mutex_unlock(&emu->lock);
+}
+
+static void emu_gpio_hook(void *arg, int gpio, int level)
+{
+    int64_t now = host_time_us();
+    (void)arg;
+    if (gpio != emu->config.pin_rst) {
+        return;
+    }
+    pthread_mutex_lock(&emu->lock);
+    if (level == 0) {
+        emu->rst_low_time = now;
+    } else {
+        if (now - emu->rst_low_time < ST7789_RST_PULSE_US) {
+            EMU_VIOLATION("RESX pulse %lld us (min %d us)", (long long)(now - emu->rst_low_time), ST7789_RST_PULSE_US);
+        }
+        emu_reset(now, 1);
+    }
+    pthread_mutex_unlock(&emu->lock);
+}
+
+int st7789_emu_init(const st7789_emu_config_t *config)
+{
+    emu = (st7789_emu_t *)calloc(1, sizeof(st7789_emu_t));
+    if (!emu) {
+        return -1;
+    }
+    emu->config = *config;
+    emu->gram = (uint32_t *)calloc(ST7789_GRAM_WIDTH * ST7789_GRAM_HIGH, sizeof(uint32_t));
+    if (!emu->gram) {
+        free(emu);
+        emu = NULL;
+        return -1;
+    }
+    pthread_mutex_init(&emu->lock, NULL);
+    // 上电后处于休眠状态
+    emu->sleep = 1;
+    emu_reset(host_time_us(), 1);
+    host_gpio_set_hook(emu_gpio_hook, NULL);
+    return host_spi_sim_start(emu_spi_sink, NULL);
+}
+
+void st7789_emu_deinit(void)
+{
+    host_spi_sim_stop();
+    host_gpio_set_hook(NULL, NULL);
+    pthread_mutex_destroy(&emu->lock);
+    free(emu->gram);
+    free(emu);
+    emu = NULL;
+}
+
+void st7789_emu_stats(st7789_emu_stats_t *stats, bool reset)
+{
+    pthread_mutex_lock(&emu->lock);
+    *stats = emu->stats;
+    if (reset) {
+        memset(&emu->stats, 0, sizeof(emu->stats));
+    }
+    pthread_mutex_unlock(&emu->lock);
+}
+
+void st7789_emu_view_size(int *width, int *high)
+{
+    pthread_mutex_lock(&emu->lock);
+    emu_view(width, high);
+    pthread_mutex_unlock(&emu->lock);
+}
+
+uint32_t st7789_emu_pixel(int x, int y)
+{
+    uint32_t rgb = 0;
+    int index = 0;
+    pthread_mutex_lock(&emu->lock);
+    index = emu_index(x, y);
+    rgb = index < 0 ? 0 : emu->gram[index];
+    pthread_mutex_unlock(&emu->lock);
+    return rgb;
+}
+
+bool st7789_emu_display_on(void)
+{
+    return emu->display_on && !emu->sleep;
+}
+
+// 18位颜色扩展到8位; 反色时按面板实际显示输出
+int st7789_emu_dump_png(const char *path)
+{
+    int width, high, ret;
+    uint32_t rgb;
+    uint8_t *out = NULL;
+    st7789_emu_view_size(&width, &high);
+    out = (uint8_t *)malloc(width * high * 3);
+    if (!out) {
+        return -1;
+    }
+    for (int y = 0; y < high; y++) {
+        for (int x = 0; x < width; x++) {
+            rgb = st7789_emu_pixel(x, y);
+            if (emu->invert) {
+                rgb ^= 0x3FFFF;
+            }
+            out[(y * width + x) * 3 + 0] = ((rgb >> 12) & 0x3F) << 2 | ((rgb >> 16) & 0x03);
+            out[(y * width + x) * 3 + 1] = ((rgb >> 6) & 0x3F) << 2 | ((rgb >> 10) & 0x03);
+            out[(y * width + x) * 3 + 2] = (rgb & 0x3F) << 2 | ((rgb >> 4) & 0x03);
+        }
+    }
+    ret = png_write_rgb(path, width, high, out);
+    free(out);
+    return ret;
+}
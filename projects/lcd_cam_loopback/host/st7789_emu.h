@@ -0,0 +1,52 @@
+#pragma once
+
+// ST7789模型: 接收模拟GPSPI3发出的字节流, 按D/C引脚区分命令和参数,
+// 解释CASET/RASET/RAMWR/RAMWRC/MADCTL/COLMOD等命令, 维护240x320的18位GRAM,
+// 并按数据手册检查复位/休眠退出后的最小等待时间
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ST7789_GRAM_WIDTH   (240)
+#define ST7789_GRAM_HIGH    (320)
+
+typedef struct {
+    uint8_t pin_dc;
+    uint8_t pin_cs;
+    uint8_t pin_rst;
+} st7789_emu_config_t;
+
+typedef struct {
+    uint32_t cmds;          // 命令个数
+    uint32_t ramwr;         // RAMWR/RAMWRC个数, 即窗口个数
+    uint64_t pixel_bytes;   // RAMWR之后的数据字节
+    uint64_t pixels;        // 写入GRAM的像素个数
+    uint32_t clipped;       // 落在GRAM之外被丢弃的像素
+    uint32_t violations;    // 时序或协议错误
+} st7789_emu_stats_t;
+
+// 同时启动GPSPI3模拟, 字节流直接送入模型
+int st7789_emu_init(const st7789_emu_config_t *config);
+
+void st7789_emu_deinit(void);
+
+void st7789_emu_stats(st7789_emu_stats_t *stats, bool reset);
+
+// 当前MADCTL下的逻辑画面尺寸
+void st7789_emu_view_size(int *width, int *high);
+
+// 逻辑坐标(与CASET/RASET相同)处的像素, 0x3FFFF格式: R[17:12] G[11:6] B[5:0]
+uint32_t st7789_emu_pixel(int x, int y);
+
+bool st7789_emu_display_on(void);
+
+// 将逻辑画面保存为PNG
+int st7789_emu_dump_png(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
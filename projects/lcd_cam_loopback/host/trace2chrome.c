@@ -0,0 +1,516 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "trace.h"
+
+// 把trace_dump的输出(串口日志中以"trace: "开头的行)转换为Chrome trace JSON, 用chrome://tracing或Perfetto打开
+// 每个事件id一条时间线: 区间(BEGIN/END)为一段, 瞬时事件为一个点, 计数器为曲线
+// 日志中有多次输出时使用最后一次完整的输出; 时间戳为32位us, 按相邻事件的差值展开回绕
+// 同时在stderr打印每个事件的统计, -l from,to 统计from到to的延迟(区间取from的开始和to的结束),
+// 按arg(帧序号)配对, -L 不按arg, 取to之前最近的from
+//
+//   trace2chrome [-o out.json] [-l from,to] [-L] <log|->
+//   trace2chrome -t     自检: 多个任务同时写入环形缓冲, 检查读取的事件完整, trace_dump输出能还原, 时间回绕和延迟配对
+
+typedef struct {
+    int64_t ts;             // 展开后的时间(us)
+    uint32_t time;
+    uint16_t id;
+    uint8_t type;
+    uint32_t arg;
+    uint32_t order;         // 输出中的顺序, 排序时保持同一时间的先后
+} t2c_event_t;
+
+typedef struct {
+    char *names[TRACE_MAX_NAME];
+    t2c_event_t *events;
+    uint32_t cnt;
+    uint32_t cap;
+    uint32_t lost;
+} t2c_dump_t;
+
+typedef struct {
+    uint32_t cnt;
+    int64_t sum;
+    int64_t max;
+} t2c_latency_t;
+
+static void dump_clear(t2c_dump_t *d)
+{
+    for (int x = 0; x < TRACE_MAX_NAME; x++) {
+        free(d->names[x]);
+    }
+    free(d->events);
+    memset(d, 0, sizeof(t2c_dump_t));
+}
+
+static void dump_add(t2c_dump_t *d, const t2c_event_t *e)
+{
+    if (d->cnt == d->cap) {
+        d->cap = d->cap ? d->cap * 2 : 1024;
+        d->events = (t2c_event_t *)realloc(d->events, d->cap * sizeof(t2c_event_t));
+    }
+    d->events[d->cnt] = *e;
+    d->events[d->cnt].order = d->cnt;
+    d->cnt++;
+}
+
+static const char *dump_name(const t2c_dump_t *d, uint16_t id, char *buf)
+{
+    if (id < TRACE_MAX_NAME && d->names[id]) {
+        return d->names[id];
+    }
+    sprintf(buf, "id%u", id);
+    return buf;
+}
+
+static int event_cmp(const void *a, const void *b)
+{
+    const t2c_event_t *x = (const t2c_event_t *)a, *y = (const t2c_event_t *)b;
+    if (x->ts != y->ts) {
+        return x->ts < y->ts ? -1 : 1;
+    }
+    return x->order < y->order ? -1 : 1;
+}
+
+// 按相邻事件的差值展开32位时间戳, 再按时间排序(中断可能在取时间戳和取槽位之间插入, 顺序有微小的颠倒)
+static void dump_finish(t2c_dump_t *d)
+{
+    for (uint32_t x = 0; x < d->cnt; x++) {
+        t2c_event_t *e = &d->events[x];
+        e->ts = x ? d->events[x - 1].ts + (int32_t)(e->time - d->events[x - 1].time) : e->time;
+    }
+    qsort(d->events, d->cnt, sizeof(t2c_event_t), event_cmp);
+}
+
+// 读取最后一次完整的输出
+// 返回值:0,成功;-1,没有完整的输出
+static int dump_parse(FILE *fp, t2c_dump_t *out)
+{
+    t2c_dump_t cur = {0};
+    char line[512];
+    int found = 0, in = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = strstr(line, "trace: ");
+        unsigned a, b, c;
+        char type, name[128];
+        if (!p) {
+            continue;
+        }
+        p += strlen("trace: ");
+        if (!strncmp(p, "begin", 5)) {
+            dump_clear(&cur);
+            in = 1;
+        } else if (!in) {
+            continue;
+        } else if (sscanf(p, "ev %u %u %c %u", &a, &b, &type, &c) == 4) {
+            t2c_event_t e = {.time = a, .id = b, .type = type, .arg = c};
+            dump_add(&cur, &e);
+        } else if (sscanf(p, "name %u %127s", &a, name) == 2 && a < TRACE_MAX_NAME) {
+            free(cur.names[a]);
+            cur.names[a] = strdup(name);
+        } else if (sscanf(p, "end %u %u", &a, &b) == 2) {
+            cur.lost = b;
+            dump_clear(out);
+            *out = cur;
+            memset(&cur, 0, sizeof(cur));
+            found = 1;
+            in = 0;
+        }
+    }
+    dump_clear(&cur);
+    if (found) {
+        dump_finish(out);
+    }
+    return found ? 0 : -1;
+}
+
+// 输出JSON, 开头没有BEGIN的END(BEGIN已被覆盖)和最后没有END的BEGIN都不输出
+// 返回值:输出的事件个数
+static uint32_t dump_json(const t2c_dump_t *d, FILE *fp)
+{
+    int32_t top[TRACE_MAX_NAME + 1];
+    int32_t *below = (int32_t *)malloc((d->cnt + 1) * sizeof(int32_t)); // 同一id的BEGIN栈, 下一层的下标
+    uint8_t *keep = (uint8_t *)calloc(d->cnt + 1, 1);
+    int64_t base = d->cnt ? d->events[0].ts : 0;
+    uint32_t out = 0;
+    char buf[16];
+
+    // BEGIN和END按id配对, 同一id的区间可以嵌套
+    for (int x = 0; x <= TRACE_MAX_NAME; x++) {
+        top[x] = -1;
+    }
+    for (uint32_t x = 0; x < d->cnt; x++) {
+        const t2c_event_t *e = &d->events[x];
+        int i = e->id < TRACE_MAX_NAME ? e->id : TRACE_MAX_NAME;
+        if (e->type == TRACE_TYPE_BEGIN) {
+            below[x] = top[i];
+            top[i] = x;
+        } else if (e->type == TRACE_TYPE_END) {
+            if (top[i] >= 0) {
+                keep[top[i]] = 1;
+                keep[x] = 1;
+                top[i] = below[top[i]];
+            }
+        } else {
+            keep[x] = 1;
+        }
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"lost\":%u,\"base_us\":%lld},\"traceEvents\":[\n", d->lost, (long long)base);
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"lcd_cam_loopback\"}}");
+    for (int x = 1; x < TRACE_MAX_NAME; x++) {
+        if (d->names[x]) {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", x, d->names[x]);
+            fprintf(fp, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}", x, x);
+        }
+    }
+    for (uint32_t x = 0; x < d->cnt; x++) {
+        const t2c_event_t *e = &d->events[x];
+        const char *name = dump_name(d, e->id, buf);
+        long long ts = (long long)(e->ts - base);
+        if (!keep[x]) {
+            continue;
+        }
+        switch (e->type) {
+            case TRACE_TYPE_BEGIN:
+            case TRACE_TYPE_END:
+                fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}", name, e->type, ts, e->id, e->arg);
+                break;
+            case TRACE_TYPE_COUNTER:
+                fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%lld,\"pid\":1,\"args\":{\"value\":%u}}", name, ts, e->arg);
+                break;
+            default:
+                fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}", name, ts, e->id, e->arg);
+                break;
+        }
+        out++;
+    }
+    fprintf(fp, "\n]}\n");
+    free(below);
+    free(keep);
+    return out;
+}
+
+// 每个id: 区间的个数, 平均和最长时间; 瞬时事件的个数和平均间隔; 计数器的最小和最大值
+static void dump_summary(const t2c_dump_t *d, FILE *fp)
+{
+    char buf[16];
+    int64_t span = d->cnt ? d->events[d->cnt - 1].ts - d->events[0].ts : 0;
+    int max_id = 0;
+    fprintf(fp, "%u events, %u lost, %.3f ms\n", d->cnt, d->lost, span / 1000.0);
+    for (uint32_t x = 0; x < d->cnt; x++) {
+        max_id = d->events[x].id > max_id ? d->events[x].id : max_id;
+    }
+    for (int id = 0; id <= max_id; id++) {
+        uint32_t n = 0, spans = 0;
+        int64_t begin = 0, sum = 0, max = 0, first = 0, last = 0;
+        int open = 0;
+        uint32_t vmin = UINT32_MAX, vmax = 0;
+        uint8_t type = 0;
+        for (uint32_t x = 0; x < d->cnt; x++) {
+            const t2c_event_t *e = &d->events[x];
+            if (e->id != id) {
+                continue;
+            }
+            first = n ? first : e->ts;
+            last = e->ts;
+            n++;
+            type = e->type == TRACE_TYPE_END ? TRACE_TYPE_BEGIN : e->type;
+            if (e->type == TRACE_TYPE_BEGIN) {
+                begin = e->ts;
+                open = 1;
+            } else if (e->type == TRACE_TYPE_END && open) {
+                spans++;
+                sum += e->ts - begin;
+                max = e->ts - begin > max ? e->ts - begin : max;
+                open = 0;
+            }
+            vmin = e->arg < vmin ? e->arg : vmin;
+            vmax = e->arg > vmax ? e->arg : vmax;
+        }
+        if (n == 0) {
+            continue;
+        }
+        if (type == TRACE_TYPE_BEGIN) {
+            fprintf(fp, "  %-12s %6u spans    avg %9.1f us  max %9lld us\n", dump_name(d, id, buf), spans,
+                    spans ? (double)sum / spans : 0, (long long)max);
+        } else if (type == TRACE_TYPE_COUNTER) {
+            fprintf(fp, "  %-12s %6u samples  min %9u     max %9u\n", dump_name(d, id, buf), n, vmin, vmax);
+        } else {
+            fprintf(fp, "  %-12s %6u events   avg interval %9.1f us\n", dump_name(d, id, buf), n,
+                    n > 1 ? (double)(last - first) / (n - 1) : 0);
+        }
+    }
+}
+
+static int dump_find(const t2c_dump_t *d, const char *name)
+{
+    for (int x = 0; x < TRACE_MAX_NAME; x++) {
+        if (d->names[x] && !strcmp(d->names[x], name)) {
+            return x;
+        }
+    }
+    return -1;
+}
+
+// from到to的延迟: from取瞬时事件或区间的开始, to取瞬时事件或区间的结束
+// by_arg: to与arg相同的最近一个from配对, 否则与最近一个from配对
+static void dump_latency(const t2c_dump_t *d, int from, int to, int by_arg, t2c_latency_t *lat)
+{
+    memset(lat, 0, sizeof(t2c_latency_t));
+    for (uint32_t x = 0; x < d->cnt; x++) {
+        const t2c_event_t *e = &d->events[x];
+        if (e->id != to || e->type == TRACE_TYPE_BEGIN) {
+            continue;
+        }
+        for (int32_t y = x; y >= 0; y--) {
+            const t2c_event_t *f = &d->events[y];
+            if (f->id == from && f->type != TRACE_TYPE_END && (!by_arg || f->arg == e->arg)) {
+                lat->cnt++;
+                lat->sum += e->ts - f->ts;
+                lat->max = e->ts - f->ts > lat->max ? e->ts - f->ts : lat->max;
+                break;
+            }
+        }
+    }
+}
+
+/* ---------------- 自检 ---------------- */
+
+#define TEST_WRITERS    (4)
+#define TEST_EVENTS     (200000)
+
+static uint16_t test_ids[TEST_WRITERS];
+static volatile int test_running = 0;
+static volatile int test_bad = 0;
+static volatile uint32_t test_reads = 0;
+
+// arg: 写入者编号(高8位)和计数, 偶数为BEGIN, 奇数为END
+static void test_writer(void *arg)
+{
+    int w = (int)(intptr_t)arg;
+    for (uint32_t x = 0; x < TEST_EVENTS; x++) {
+        trace_record(test_ids[w], (x & 1) ? TRACE_TYPE_END : TRACE_TYPE_BEGIN, ((uint32_t)w << 24) | x);
+    }
+    __atomic_fetch_sub(&test_running, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+// 检查事件没有混合不同写入的内容, 序号递增, 同一写入者的计数递增
+static int test_check(const trace_event_t *events, int cnt)
+{
+    int64_t last[TEST_WRITERS];
+    for (int w = 0; w < TEST_WRITERS; w++) {
+        last[w] = -1;
+    }
+    for (int x = 0; x < cnt; x++) {
+        const trace_event_t *e = &events[x];
+        uint32_t w = e->arg >> 24, n = e->arg & 0xFFFFFF;
+        if (w >= TEST_WRITERS || e->id != test_ids[w] || e->type != ((n & 1) ? TRACE_TYPE_END : TRACE_TYPE_BEGIN)
+                || (x && e->seq <= events[x - 1].seq) || (int64_t)n <= last[w]) {
+            return -1;
+        }
+        last[w] = n;
+    }
+    return 0;
+}
+
+static void test_reader(void *arg)
+{
+    trace_event_t *events = (trace_event_t *)malloc(TRACE_RING_SIZE * sizeof(trace_event_t));
+    while (test_running) {
+        int cnt = trace_read(events, TRACE_RING_SIZE, NULL);
+        if (test_check(events, cnt) != 0) {
+            test_bad = 1;
+        }
+        test_reads++;
+    }
+    free(events);
+    __atomic_fetch_sub(&test_running, 1, __ATOMIC_SEQ_CST);
+    vTaskDelete(NULL);
+}
+
+static int test_report(const char *name, int ok, const char *detail)
+{
+    printf("%-20s %s  %s\n", name, ok ? "PASS" : "FAIL", detail);
+    return ok ? 0 : 1;
+}
+
+static int self_test(void)
+{
+    int failed = 0;
+    char detail[256];
+    trace_event_t *events = (trace_event_t *)malloc(TRACE_RING_SIZE * sizeof(trace_event_t));
+    uint32_t lost = 0;
+
+    // 多个写入者和一个读取者同时运行
+    for (int w = 0; w < TEST_WRITERS; w++) {
+        char name[8];
+        sprintf(name, "w%d", w);
+        test_ids[w] = trace_register(strdup(name));
+    }
+    test_running = TEST_WRITERS + 1;
+    xTaskCreate(test_reader, "reader", 4096, NULL, 5, NULL);
+    for (int w = 0; w < TEST_WRITERS; w++) {
+        xTaskCreate(test_writer, "writer", 4096, (void *)(intptr_t)w, 5, NULL);
+    }
+    // 读取者在写入者全部结束后退出
+    while (test_running > 1) {
+        vTaskDelay(1);
+    }
+    test_running = 0;
+    vTaskDelay(10);
+    int cnt = trace_read(events, TRACE_RING_SIZE, &lost);
+    int ok = !test_bad && test_check(events, cnt) == 0 && cnt + lost == TEST_WRITERS * TEST_EVENTS && cnt > TRACE_RING_SIZE * 9 / 10;
+    sprintf(detail, "%d writers x %d events, %u concurrent reads, final %d events, %u lost", TEST_WRITERS, TEST_EVENTS, test_reads, cnt, lost);
+    failed += test_report("concurrent_writers", ok, detail);
+
+    // trace_dump的输出还原为相同的事件
+    t2c_dump_t d = {0};
+    FILE *fp = tmpfile();
+    trace_dump(fp);
+    rewind(fp);
+    ok = dump_parse(fp, &d) == 0 && d.cnt == cnt && d.lost == lost && dump_find(&d, "w3") == test_ids[3] && dump_find(&d, "lcd_eof") == TRACE_ID_LCD_EOF;
+    for (uint32_t x = 0; ok && x < d.cnt; x++) {
+        const trace_event_t *e = &events[x];
+        const t2c_event_t *p = NULL;
+        // 排序后顺序可能不同, 按arg查找
+        for (uint32_t y = 0; y < d.cnt && !p; y++) {
+            p = d.events[(x + y) % d.cnt].arg == e->arg ? &d.events[(x + y) % d.cnt] : NULL;
+        }
+        ok = p && p->time == e->time && p->id == e->id && p->type == e->type;
+    }
+    fclose(fp);
+    sprintf(detail, "%u events", d.cnt);
+    failed += test_report("dump_roundtrip", ok, detail);
+
+    // JSON中每个区间的BEGIN和END成对
+    char *json = NULL;
+    size_t json_len = 0;
+    fp = open_memstream(&json, &json_len);
+    uint32_t out = dump_json(&d, fp);
+    fclose(fp);
+    uint32_t b = 0, e = 0;
+    for (char *p = json; (p = strstr(p, "\"ph\":\"")); p += 6) {
+        b += p[6] == 'B';
+        e += p[6] == 'E';
+    }
+    ok = b == e && b > 0 && out == b + e;
+    sprintf(detail, "%u begin, %u end, %zu bytes", b, e, json_len);
+    failed += test_report("json_pairs", ok, detail);
+    free(json);
+    dump_clear(&d);
+
+    // 32位时间戳回绕, 乱序的中断事件按时间排序; 按帧序号统计延迟
+    const char *log =
+        "I (100) main: unrelated line\n"
+        "trace: begin 0\n"
+        "trace: name 8 capture\n"
+        "trace: name 9 display\n"
+        "trace: ev 4294966296 8 B 1\n"      // -1000
+        "trace: ev 4294966796 8 E 1\n"      // -500
+        "trace: ev 4294966896 9 B 0\n"      // 上一帧
+        "trace: ev 4294967196 8 B 2\n"      // -100
+        "trace: ev 4294967190 1 I 0\n"      // 中断, 时间戳早于上一个事件
+        "trace: ev 200 9 E 0\n"
+        "trace: ev 300 9 B 1\n"
+        "trace: ev 400 8 E 2\n"
+        "trace: ev 1300 9 E 1\n"
+        "trace: ev 1400 9 B 2\n"
+        "trace: ev 2900 9 E 2\n"
+        "trace: end 11 0\n"
+        "trace: begin 0\n";                 // 不完整的输出被忽略
+    fp = fmemopen((void *)log, strlen(log), "r");
+    ok = dump_parse(fp, &d) == 0 && d.cnt == 11;
+    fclose(fp);
+    for (uint32_t x = 1; ok && x < d.cnt; x++) {
+        ok = d.events[x].ts > d.events[x - 1].ts;
+    }
+    ok = ok && d.events[d.cnt - 1].ts - d.events[0].ts == 3900 && d.events[4].id == 8;
+    t2c_latency_t lat, lat_last;
+    dump_latency(&d, 8, 9, 1, &lat);
+    dump_latency(&d, 8, 9, 0, &lat_last);
+    // 帧1: -1000 -> 1300, 帧2: -100 -> 2900; 不按帧号时display 0也和最近的capture配对
+    ok = ok && lat.cnt == 2 && lat.sum == 2300 + 3000 && lat.max == 3000 && lat_last.cnt == 3;
+    sprintf(detail, "span %lld us, latency %u frames avg %lld us", d.cnt ? (long long)(d.events[d.cnt - 1].ts - d.events[0].ts) : 0LL,
+            lat.cnt, lat.cnt ? (long long)(lat.sum / lat.cnt) : 0LL);
+    failed += test_report("wrap_and_latency", ok, detail);
+    dump_clear(&d);
+
+    free(events);
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL, *output = NULL, *latency = NULL;
+    int by_arg = 1;
+    t2c_dump_t d = {0};
+
+    for (int x = 1; x < argc; x++) {
+        if (!strcmp(argv[x], "-t")) {
+            return self_test();
+        } else if (!strcmp(argv[x], "-o") && x + 1 < argc) {
+            output = argv[++x];
+        } else if (!strcmp(argv[x], "-l") && x + 1 < argc) {
+            latency = argv[++x];
+        } else if (!strcmp(argv[x], "-L")) {
+            by_arg = 0;
+        } else if (argv[x][0] != '-' || !strcmp(argv[x], "-")) {
+            input = argv[x];
+        } else {
+            input = NULL;
+            break;
+        }
+    }
+    if (!input) {
+        fprintf(stderr, "usage: %s [-o out.json] [-l from,to] [-L] <log|->\n       %s -t\n", argv[0], argv[0]);
+        return 2;
+    }
+    FILE *in = strcmp(input, "-") ? fopen(input, "r") : stdin;
+    if (!in) {
+        perror(input);
+        return 1;
+    }
+    if (dump_parse(in, &d) != 0) {
+        fprintf(stderr, "%s: no complete trace dump\n", input);
+        return 1;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        perror(output);
+        return 1;
+    }
+    dump_json(&d, out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    dump_summary(&d, stderr);
+    if (latency) {
+        char from[64] = {0}, *to = strchr(latency, ',');
+        t2c_latency_t lat;
+        if (!to || to - latency >= sizeof(from)) {
+            fprintf(stderr, "-l from,to\n");
+            return 2;
+        }
+        memcpy(from, latency, to - latency);
+        int from_id = dump_find(&d, from), to_id = dump_find(&d, to + 1);
+        if (from_id < 0 || to_id < 0) {
+            fprintf(stderr, "unknown event %s\n", from_id < 0 ? from : to + 1);
+            return 1;
+        }
+        dump_latency(&d, from_id, to_id, by_arg, &lat);
+        fprintf(stderr, "latency %s -> %s: %u, avg %.1f us, max %lld us\n", from, to + 1, lat.cnt,
+                lat.cnt ? (double)lat.sum / lat.cnt : 0, (long long)lat.max);
+    }
+    dump_clear(&d);
+    return 0;
+}
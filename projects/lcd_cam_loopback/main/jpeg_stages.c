@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cam.h"
+#include "jpeg.h"
+#include "jpeg_stages.h"
+
+void jpeg_cam_release(pipeline_buf_t *buf, void *arg)
+{
+    cam_give(buf->data);
+}
+
+int jpeg_capture_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    jpeg_stages_t *stages = (jpeg_stages_t *)arg;
+    out->data = NULL;
+    if (stages->stop) {
+        vTaskDelay(10);
+        return PIPELINE_DROP;
+    }
+    out->len = cam_take(&out->data);
+    if (out->len == 0) {
+        vTaskDelay(10);
+        return PIPELINE_DROP;
+    }
+    if (stages->frame_cb) {
+        stages->frame_cb(out->data, out->len);
+    }
+    return PIPELINE_PASS;
+}
+
+int jpeg_decode_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    jpeg_stages_t *stages = (jpeg_stages_t *)arg;
+    int w, h;
+    if (jpeg_decode_to(in->data, in->len, out->data, out->size, &w, &h) != 0) {
+        stages->errors++;
+        return PIPELINE_DROP;
+    }
+    out->width = w;
+    out->high = h;
+    out->len = w * h * sizeof(uint16_t);
+    return PIPELINE_PASS;
+}
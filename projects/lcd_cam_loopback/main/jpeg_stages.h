@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// JPEG_MODE流水线的采集和解码阶段, main.c与host/replay_bench编译同一份代码(主机上cam_take/cam_give由host/cam_replay.c实现)
+// 显示阶段不共用: 设备上异步发送到LCD, 主机上计算输出帧的digest
+
+typedef struct {
+    void (*frame_cb)(uint8_t *buf, size_t len); // cam_take之后调用(例如录制), 可以为NULL
+    volatile int stop;          // 不为0时采集阶段不再调用cam_take(主机上回放结束后释放cam_replay之前)
+    volatile uint32_t errors;   // 解码失败丢弃的帧数
+} jpeg_stages_t;
+
+// 采集阶段pipeline_stage_t的release, 归还cam_take得到的帧buffer
+void jpeg_cam_release(pipeline_buf_t *buf, void *arg);
+
+// arg为jpeg_stages_t; cam_take返回长度0(回放结束)时丢弃
+int jpeg_capture_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg);
+
+// arg为jpeg_stages_t; 用jpeg_decode_to解码到out(大端RGB565), 失败时丢弃
+int jpeg_decode_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
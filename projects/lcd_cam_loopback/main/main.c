@@ -12,16 +12,45 @@
 #include "esp_log.h"
 #include "cam.h"
 #include "ov2640.h"
+#include "ov2640_async.h"
 #include "lcd.h"
+#include "lcd_dirty.h"
 #include "jpeg.h"
+#include "startup.h"
+#include "fps_plan.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "jpeg_bench.h"
+#include "cam_rec.h"
+#include "mem_budget.h"
+#include "esp_timer.h"
+#include "jpeg_stages.h"
 
 static const char *TAG = "main";
 
 #define JPEG_MODE 0
+#define DIRTY_MODE 0 // 只刷新变化的区域, 仅RGB565模式有效
 #define DEBUG 0
+#define ZOOM_MODE 0 // 在VSYNC之后写入开窗寄存器, 演示逐帧的数字变焦
+#define SNAPSHOT_INTERVAL 0 // 每隔多少帧切换到JPEG拍一张高分辨率照片, 0: 关闭, 仅RGB565模式有效
+#define JPEG_BENCH 0 // 启动摄像头之前运行JPEG解码基准(components/jpeg_bench), 每个语料解码的次数, 0: 关闭
+#define CAM_REC_FRAMES 0 // 录制cam_take得到的帧到CAM_REC_PATH(components/cam_rec), 用host/replay_bench回放, 录制的cam_take次数(包括丢弃的帧), 0: 关闭
 
 #define CAM_WIDTH   (320)
 #define CAM_HIGH    (240)
+#define TARGET_FPS  (30) // 由fps_plan计算XCLK, CLKRC和LCD SPI时钟, 达不到时打印限制帧率的环节
+#define JPEG_DECODE_US (40000) // JPEG模式每帧解码时间的保守估计, 只在无法用语料测量时使用
+
+#define SNAPSHOT_WIDTH  (1600)
+#define SNAPSHOT_HIGH   (1200)
+#define SNAPSHOT_BUFFER_SIZE (256 * 1024) // JPEG照片的最大长度
+
+// 帧buffer按实时预览和拍照中较大的一个分配, 切换时不需要重新分配
+#if SNAPSHOT_INTERVAL && (SNAPSHOT_BUFFER_SIZE > CAM_WIDTH * CAM_HIGH * 2)
+#define FRAME_BUFFER_SIZE SNAPSHOT_BUFFER_SIZE
+#else
+#define FRAME_BUFFER_SIZE (CAM_WIDTH * CAM_HIGH * 2)
+#endif
 
 #define LCD_CLK   GPIO_NUM_15
 #define LCD_MOSI  GPIO_NUM_9
@@ -44,26 +73,367 @@ static const char *TAG = "main";
 #define CAM_D6    GPIO_NUM_21
 #define CAM_D7    GPIO_NUM_38
 
+static fps_plan_t frame_plan;
+
+// 一帧发送完成
+static void lcd_trans_done_cb(void *arg)
+{
+    static bool first_frame = true;
+    if (first_frame) {
+        first_frame = false;
+        ESP_LOGI(TAG, "first frame: %lld ms after boot\n", esp_timer_get_time() / 1000);
+    }
+#if JPEG_MODE
+    pipeline_buf_release((pipeline_buf_t *)arg);
+#else
+    cam_give((uint8_t *)arg);
+#endif
+    // 使用逻辑分析仪观察帧率
+    gpio_set_level(LCD_BK, 1);
+    gpio_set_level(LCD_BK, 0);
+}
+
+static int lcd_stage(void *arg)
+{
+    return lcd_init((lcd_config_t *)arg);
+}
+
+static int xclk_stage(void *arg)
+{
+    return cam_xclk_init((cam_config_t *)arg);
+}
+
+static int cam_stage(void *arg)
+{
+    return cam_init((cam_config_t *)arg);
+}
+
+static int sensor_stage(void *arg)
+{
+    cam_config_t *cam_config = (cam_config_t *)arg;
+    if (OV2640_Init(0, frame_plan.clkrc_double) != 0) {
+        return -1;
+    }
+    if (frame_plan.clkrc_div && OV2640_Clock_Set(frame_plan.clkrc_double, frame_plan.clkrc_div) != 0) {
+        return -1;
+    }
+    ESP_LOGI(TAG, "sensor ready %d us after reset\n", OV2640_Ready_Time());
+    if (cam_config->mode.jpeg) {
+        OV2640_JPEG_Mode();
+    } else {
+        OV2640_RGB565_Mode(false);	//RGB565模式
+    }
+
+    OV2640_ImageSize_Set(800, 600);
+    OV2640_ImageWin_Set(0, 0, 800, 600);
+    OV2640_OutSize_Set(CAM_WIDTH, CAM_HIGH);
+    return 0;
+}
+
+typedef struct {
+    ov2640_mode_t mode;
+    uint16_t image_width;
+    uint16_t image_high;
+    uint16_t out_width;
+    uint16_t out_high;
+} sensor_mode_t;
+
+// 只写入与当前模式不同的寄存器
+static int sensor_mode_set(const sensor_mode_t *sensor_mode)
+{
+    if (OV2640_Mode_Switch(&sensor_mode->mode) != 0) {
+        return -1;
+    }
+    if (OV2640_ImageSize_Set(sensor_mode->image_width, sensor_mode->image_high) != 0 ||
+        OV2640_ImageWin_Set(0, 0, sensor_mode->image_width, sensor_mode->image_high) != 0 ||
+        OV2640_OutSize_Set(sensor_mode->out_width, sensor_mode->out_high) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+#if ZOOM_MODE
+#define ZOOM_STEPS  (60) // 从全视场到最大放大的帧数
+
+// 缩放期间SCCB总线和影子寄存器由后台SCCB任务独占, 其他任务访问传感器都经过OV2640_Async_Call
+typedef struct {
+    const sensor_mode_t *sensor_mode;
+    int ret;
+} sensor_mode_call_t;
+
+static void sensor_mode_call(void *arg)
+{
+    sensor_mode_call_t *call = (sensor_mode_call_t *)arg;
+    call->ret = sensor_mode_set(call->sensor_mode);
+}
+
+static TaskHandle_t zoom_task_handle = NULL;
+
+static int zoom_vsync_cb(void *arg)
+{
+    BaseType_t HPTaskAwoken = pdFALSE;
+    vTaskNotifyGiveFromISR(zoom_task_handle, &HPTaskAwoken);
+    return HPTaskAwoken == pdTRUE;
+}
+
+static void zoom_commit(void *arg)
+{
+    OV2640_ImageWin_Commit();
+}
+
+static void zoom_commit_cb(uint8_t result, void *arg)
+{
+    if (result == OV2640_ASYNC_BUS_ERROR) {
+        ESP_LOGE(TAG, "zoom commit error\n");
+    }
+}
+
+// 每个VSYNC暂存下一帧的窗口, 由后台SCCB任务在帧间隔中写入, 在800x600与CAM_WIDTHxCAM_HIGH之间往复缩放
+// 队列满时不等待, 暂存的窗口在下一个VSYNC写入
+static void zoom_task(void *arg)
+{
+    int step = 0, dir = 1;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint16_t width = (800 - step * (800 - CAM_WIDTH) / ZOOM_STEPS) & ~3;
+        uint16_t high = (width * 3 / 4) & ~3;
+        OV2640_ImageWin_Stage((800 - width) / 2, (600 - high) / 2, width, high);
+        OV2640_Async_Call(zoom_commit, NULL, zoom_commit_cb, NULL, 0);
+        if (step + dir < 0 || step + dir > ZOOM_STEPS) {
+            dir = -dir;
+        }
+        step += dir;
+    }
+}
+#endif
+
+// cam_reconfig停止采集期间调用; 缩放期间在后台SCCB任务中执行并等待完成
+static int sensor_reconfig(void *arg)
+{
+#if ZOOM_MODE
+    sensor_mode_call_t call = {.sensor_mode = (const sensor_mode_t *)arg, .ret = -1};
+    if (OV2640_Async_Call(sensor_mode_call, &call, NULL, NULL, portMAX_DELAY) != 0 || OV2640_Async_Flush(portMAX_DELAY) != 0) {
+        return -1;
+    }
+    return call.ret;
+#else
+    return sensor_mode_set((const sensor_mode_t *)arg);
+#endif
+}
+
+#if TRACE_ENABLE
+#define TRACE_DUMP_INTERVAL (10000) // 输出追踪事件的间隔(ms), 用host/trace2chrome转换串口日志
+
+// 暂停记录后输出环形缓冲, 输出期间的事件不记录, 避免覆盖正在输出的事件
+static void trace_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(TRACE_DUMP_INTERVAL / portTICK_PERIOD_MS);
+        trace_enable(false);
+        trace_dump(stdout);
+        trace_enable(true);
+    }
+}
+#endif
+
+#if MEM_BUDGET_ENABLE
+#define MEM_BUDGET_INTERVAL (10000) // 输出各组件内存和各任务栈用量的间隔(ms), 峰值包括初始化阶段
+
+static void mem_budget_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(MEM_BUDGET_INTERVAL / portTICK_PERIOD_MS);
+        mem_budget_print();
+    }
+}
+#endif
+
+#if SNAPSHOT_INTERVAL && !JPEG_MODE
+// 切换到UXGA JPEG拍一张照片后回到实时预览, 摄像头任务和帧buffer保持不变
+static void snapshot(void)
+{
+    static const sensor_mode_t snapshot_mode = {
+        .mode = {.size = 1, .fre_double_en = 1, .format = OV2640_FORMAT_JPEG},
+        .image_width = 1600,
+        .image_high = 1200,
+        .out_width = SNAPSHOT_WIDTH,
+        .out_high = SNAPSHOT_HIGH,
+    };
+    // 与sensor_stage的时钟配置相同, 切换回来时不需要完整初始化
+    sensor_mode_t preview_mode = {
+        .mode = {.size = 0, .fre_double_en = frame_plan.clkrc_double, .format = OV2640_FORMAT_RGB565, .clk_div = frame_plan.clkrc_div},
+        .image_width = 800,
+        .image_high = 600,
+        .out_width = CAM_WIDTH,
+        .out_high = CAM_HIGH,
+    };
+    cam_reconfig_t snapshot_config = {
+        .width = SNAPSHOT_WIDTH,
+        .high = SNAPSHOT_HIGH,
+        .jpeg = 1,
+        .sensor_cb = sensor_reconfig,
+        .sensor_arg = (void *)&snapshot_mode,
+    };
+    cam_reconfig_t preview_config = {
+        .width = CAM_WIDTH,
+        .high = CAM_HIGH,
+        .jpeg = 0,
+        .sensor_cb = sensor_reconfig,
+        .sensor_arg = (void *)&preview_mode,
+    };
+    int64_t start = esp_timer_get_time();
+    if (cam_reconfig(&snapshot_config) != 0) {
+        ESP_LOGE(TAG, "snapshot reconfig error\n");
+        return;
+    }
+    uint8_t *jpeg_buf = NULL;
+    size_t jpeg_len = cam_take(&jpeg_buf);
+    ESP_LOGI(TAG, "snapshot: %d bytes, %lld ms\n", jpeg_len, (esp_timer_get_time() - start) / 1000);
+    cam_give(jpeg_buf);
+    if (cam_reconfig(&preview_config) != 0) {
+        ESP_LOGE(TAG, "preview reconfig error\n");
+    }
+}
+#endif
+
+#if CAM_REC_FRAMES
+#define CAM_REC_PATH "/sdcard/cam.rec" // 需要先挂载SD卡或FAT分区
+
+static cam_rec_handle_t cam_rec = NULL;
+static FILE *cam_rec_fp = NULL;
+static uint32_t cam_rec_cnt = 0;
+
+static void cam_rec_open(void)
+{
+    cam_rec_config_t config = {
+        .buf_size = FRAME_BUFFER_SIZE,
+        .task_pri = 1, // 写文件慢时丢帧, 不影响采集和显示
+    };
+    cam_rec_fp = fopen(CAM_REC_PATH, "wb");
+    config.fp = cam_rec_fp;
+    if (!cam_rec_fp || cam_rec_start(&config, &cam_rec) != 0) {
+        ESP_LOGE(TAG, "%s open error, not recording\n", CAM_REC_PATH);
+        if (cam_rec_fp) {
+            fclose(cam_rec_fp);
+        }
+        cam_rec = NULL;
+    }
+}
+
+// 在cam_take之后调用, CAM_REC_FRAMES帧之后写完并关闭文件(这一帧会等待写文件)
+// 按调用次数计数: 丢弃的帧和写文件失败之后的帧也计入, 保证一定会停止, 释放buffer和任务并回写帧数
+static void cam_rec_frame(uint8_t *buf, size_t len)
+{
+    cam_rec_stats_t stats;
+    if (!cam_rec) {
+        return;
+    }
+    cam_rec_add(cam_rec, buf, len, CAM_WIDTH, CAM_HIGH, JPEG_MODE ? CAM_REC_FORMAT_JPEG : CAM_REC_FORMAT_RGB565);
+    if (++cam_rec_cnt == CAM_REC_FRAMES) {
+        cam_rec_stop(cam_rec, &stats);
+        fclose(cam_rec_fp);
+        cam_rec = NULL;
+        ESP_LOGI(TAG, "%s: %d frames, %d dropped, %d bytes%s\n", CAM_REC_PATH, stats.frames, stats.dropped, (uint32_t)stats.bytes, stats.error ? ", write error" : "");
+    }
+}
+#endif
+
+#if JPEG_MODE
+// JPEG模式分为采集, 解码, 显示三个阶段的流水线, 显示第N帧的同时解码第N+1帧, 采集第N+2帧
+#define PIPELINE_STATS_INTERVAL (5000) // 打印各阶段统计的间隔(ms)
+
+// cam_take之后调用
+static void capture_frame_cb(uint8_t *buf, size_t len)
+{
+#if CAM_REC_FRAMES
+    cam_rec_frame(buf, len);
+#endif
+#if DEBUG
+    printf("total_len: %d\n", len);
+    for (int x = 0; x < 10; x++) {
+        ets_printf("%d ", buf[x]);
+    }
+    ets_printf("\n");
+#endif
+}
+
+// 采集和解码阶段在jpeg_stages.c中, 与host/replay_bench共用
+static jpeg_stages_t jpeg_stages_arg = {.frame_cb = capture_frame_cb};
+
+static int display_stage(pipeline_buf_t *in, pipeline_buf_t *out, void *arg)
+{
+    lcd_trans_t trans = {
+        .set_index = 1,
+        .x_end = in->width - 1,
+        .y_end = in->high - 1,
+        .data = in->data,
+        .len = in->len,
+        .cb = lcd_trans_done_cb,
+        .arg = in,
+    };
+    // 异步发送, 发送完成后在回调中归还buffer
+    lcd_trans_submit(&trans, NULL, portMAX_DELAY);
+    return PIPELINE_HOLD;
+}
+
+// 采集阶段的buffer只有描述符, 数据为cam_take得到的帧buffer, 个数与摄像头的帧buffer相同
+static const pipeline_stage_t jpeg_stages[] = {
+    {.name = "capture", .func = jpeg_capture_stage, .arg = &jpeg_stages_arg, .pool_size = 2, .release = jpeg_cam_release, .task_stack = 2048, .task_pri = configMAX_PRIORITIES - 2},
+    {.name = "decode",  .func = jpeg_decode_stage,  .arg = &jpeg_stages_arg, .pool_size = 2, .buf_size = CAM_WIDTH * CAM_HIGH * 2, .buf_caps = MALLOC_CAP_SPIRAM, .task_stack = 4096, .task_pri = configMAX_PRIORITIES - 3},
+    {.name = "display", .func = display_stage, .task_stack = 2048, .task_pri = configMAX_PRIORITIES - 2},
+};
+#endif
+
 static void cam_task(void *arg)
 {
+    fps_plan_config_t plan_config = {
+        .sensor_size = 0,
+        .width = CAM_WIDTH,
+        .high = CAM_HIGH,
+        .jpeg = JPEG_MODE,
+        .lcd_psram = 1, // 帧buffer和JPEG解码结果都在PSRAM中
+        .fps = TARGET_FPS,
+    };
+#if JPEG_MODE
+    // 解码阶段与采集和显示并行, 每帧的解码时间是帧率的上限; 启动时用嵌入的语料测量
+    plan_config.frame_cost_us = jpeg_bench_frame_us(CAM_WIDTH, CAM_HIGH, 1);
+    if (plan_config.frame_cost_us == 0) {
+        plan_config.frame_cost_us = JPEG_DECODE_US;
+    }
+    ESP_LOGI(TAG, "jpeg decode estimate: %d us/frame\n", plan_config.frame_cost_us);
+#endif
+    if (fps_plan(&plan_config, &frame_plan) < 0) {
+        ESP_LOGE(TAG, "fps plan error\n");
+        MEM_TASK_DELETE();
+        return;
+    }
+    ESP_LOGI(TAG, "fps plan: %d.%02d fps, limit: %s, xclk %d Hz, clkrc x%d /%d, sensor %d.%02d fps, cam %d B/s, lcd %d Hz %d us\n",
+             frame_plan.fps_x100 / 100, frame_plan.fps_x100 % 100, fps_plan_limit_name(frame_plan.limit),
+             frame_plan.xclk_fre, frame_plan.clkrc_double + 1, frame_plan.clkrc_div + 1,
+             frame_plan.sensor_fps_x100 / 100, frame_plan.sensor_fps_x100 % 100, frame_plan.cam_bw,
+             frame_plan.lcd_clk_fre, frame_plan.lcd_frame_us);
+
     lcd_config_t lcd_config = {
-        .clk_fre = 80 * 1000 * 1000,
+        .clk_fre = frame_plan.lcd_clk_fre,
         .pin_clk = LCD_CLK,
         .pin_mosi = LCD_MOSI,
         .pin_dc = LCD_DC,
         .pin_cs = LCD_CS,
         .pin_rst = LCD_RST,
         .pin_bk = LCD_BK,
-        .max_buffer_size = 2 * 1024,
-        .horizontal = 2 // 2: UP, 3： DOWN
+        .max_buffer_size = 4 * 1024,
+        .dma_seg_cnt = 4,
+        .psram_dma = 1, // 帧数据在PSRAM中, 直接DMA发送
+        .horizontal = 2, // 2: UP, 3： DOWN
+        .trans_queue_size = 2,
+        .task_stack = 2048,
+        .task_pri = configMAX_PRIORITIES - 1
     };
 
-    lcd_init(&lcd_config);
-
     cam_config_t cam_config = {
         .bit_width = 8,
         .mode.jpeg = JPEG_MODE,
-        .xclk_fre = 16 * 1000 * 1000,
+        .xclk_fre = frame_plan.xclk_fre,
         .pin = {
             .xclk  = CAM_XCLK,
             .pclk  = CAM_PCLK,
@@ -77,61 +447,144 @@ static void cam_task(void *arg)
         },
         .max_buffer_size = 8 * 1024,
         .task_stack = 1024,
-        .task_pri = configMAX_PRIORITIES
+        .task_pri = configMAX_PRIORITIES,
+        .frame_buffer_size = FRAME_BUFFER_SIZE,
     };
 
     // 使用PingPang buffer，帧率更高， 也可以单独使用一个buffer节省内存
-    cam_config.frame1_buffer = (uint8_t *)heap_caps_malloc(CAM_WIDTH * CAM_HIGH * 2 * sizeof(uint8_t), MALLOC_CAP_SPIRAM);
-    cam_config.frame2_buffer = (uint8_t *)heap_caps_malloc(CAM_WIDTH * CAM_HIGH * 2 * sizeof(uint8_t), MALLOC_CAP_SPIRAM);
+    cam_config.frame1_buffer = (uint8_t *)MEM_MALLOC("main", FRAME_BUFFER_SIZE * sizeof(uint8_t), MALLOC_CAP_SPIRAM);
+    cam_config.frame2_buffer = (uint8_t *)MEM_MALLOC("main", FRAME_BUFFER_SIZE * sizeof(uint8_t), MALLOC_CAP_SPIRAM);
 
-    cam_init(&cam_config);
-    if (OV2640_Init(0, 1) == 1) {
-        vTaskDelete(NULL);
+    // LCD, 摄像头DMA, 传感器配置并行初始化; 传感器需要XCLK才能响应SCCB, cam_init也会配置XCLK, 因此都依赖xclk阶段
+    startup_stage_t stages[] = {
+        {.name = "lcd",    .func = lcd_stage,    .arg = &lcd_config, .task_pri = configMAX_PRIORITIES - 2},
+        {.name = "xclk",   .func = xclk_stage,   .arg = &cam_config, .task_pri = configMAX_PRIORITIES - 2},
+        {.name = "cam",    .func = cam_stage,    .arg = &cam_config, .depends = STARTUP_DEP(1), .task_pri = configMAX_PRIORITIES - 2},
+        {.name = "sensor", .func = sensor_stage, .arg = &cam_config, .depends = STARTUP_DEP(1), .task_stack = 3072, .task_pri = configMAX_PRIORITIES - 2},
+    };
+    if (startup_run(stages, sizeof(stages) / sizeof(stages[0]), portMAX_DELAY) != 0) {
+        MEM_TASK_DELETE();
         return;
     }
-    if (cam_config.mode.jpeg) {
-        OV2640_JPEG_Mode();
-    } else {
-        OV2640_RGB565_Mode(false);	//RGB565模式
-    }
-    
-    OV2640_ImageSize_Set(800, 600);
-    OV2640_ImageWin_Set(0, 0, 800, 600);
-  	OV2640_OutSize_Set(CAM_WIDTH, CAM_HIGH); 
     ESP_LOGI(TAG, "camera init done\n");
+#if MEM_BUDGET_ENABLE
+    MEM_TASK_CREATE("main", mem_budget_task, "mem_budget", 2048, NULL, 1, NULL);
+#endif
+#if TRACE_ENABLE
+    MEM_TASK_CREATE("main", trace_task, "trace_task", 2048, NULL, 1, NULL);
+#endif
+#if ZOOM_MODE
+    // 回调先于cam_task的VSYNC事件唤醒zoom_task, 后台SCCB任务与zoom_task同为最高优先级, 在帧间隔内完成寄存器写入
+    ov2640_async_config_t async_config = {
+        .task_pri = configMAX_PRIORITIES - 1,
+    };
+    if (OV2640_Async_Init(&async_config) != 0) {
+        MEM_TASK_DELETE();
+        return;
+    }
+    MEM_TASK_CREATE("main", zoom_task, "zoom_task", 2048, NULL, configMAX_PRIORITIES - 1, &zoom_task_handle);
+    cam_set_vsync_cb(zoom_vsync_cb, NULL);
+#endif
+#if DIRTY_MODE
+    lcd_dirty_t dirty;
+    lcd_rect_t rect[16];
+    lcd_dirty_config_t dirty_config = {
+        .width = CAM_WIDTH,
+        .high = CAM_HIGH,
+        .tile = 16,
+        .max_rect = 16,
+        .merge_gap = 1,
+        .noise_bits = 1,
+        .full_refresh = 30
+    };
+    lcd_dirty_init(&dirty, &dirty_config);
+#endif
+#if SNAPSHOT_INTERVAL && !JPEG_MODE
+    uint32_t frame_cnt = 0;
+#endif
+#if CAM_REC_FRAMES
+    cam_rec_open();
+#endif
+#if JPEG_MODE
+    pipeline_handle_t pipeline = NULL;
+    if (jpeg_init() != 0 || pipeline_create(jpeg_stages, sizeof(jpeg_stages) / sizeof(jpeg_stages[0]), &pipeline) != 0) {
+        MEM_TASK_DELETE();
+        return;
+    }
+    while (1) {
+        vTaskDelay(PIPELINE_STATS_INTERVAL / portTICK_PERIOD_MS);
+        pipeline_print_stats(pipeline, true);
+        if (jpeg_stages_arg.errors) {
+            ESP_LOGI(TAG, "jpeg decode errors: %d\n", jpeg_stages_arg.errors);
+        }
+    }
+#else
     while (1) {
         uint8_t *cam_buf = NULL;
         size_t recv_len = cam_take(&cam_buf);
-#if JPEG_MODE
-#if DEBUG
-        printf("total_len: %d\n", recv_len);
-        for (int x = 0; x < 10; x++) {
-            ets_printf("%d ", cam_buf[x]);
-        }
-        ets_printf("\n");
+#if CAM_REC_FRAMES
+        cam_rec_frame(cam_buf, recv_len);
 #endif
-
-        int w, h;
-        uint8_t *img = jpeg_decode(cam_buf, &w, &h);
-        if (img) {
-            ESP_LOGI(TAG, "jpeg: w: %d, h: %d\n", w, h);
-            lcd_set_index(0, 0, w - 1, h - 1);
-            lcd_write_data(img, w * h * sizeof(uint16_t));
-            free(img);
+#if DIRTY_MODE
+        int rect_cnt = lcd_dirty_scan(&dirty, cam_buf, rect);
+        if (rect_cnt == 0) {
+            cam_give(cam_buf);
+            continue;
+        }
+        for (int x = 0; x < rect_cnt; x++) {
+            lcd_trans_t trans = {
+                .set_index = 1,
+                .x_start = rect[x].x,
+                .y_start = rect[x].y,
+                .x_end = rect[x].x + rect[x].w - 1,
+                .y_end = rect[x].y + rect[x].h - 1,
+                .data = cam_buf + (rect[x].y * CAM_WIDTH + rect[x].x) * 2,
+                .len = rect[x].w * rect[x].h * 2,
+                .stride = CAM_WIDTH * 2,
+                // 传输按顺序完成, 最后一个窗口完成时归还buffer
+                .cb = (x == rect_cnt - 1) ? lcd_trans_done_cb : NULL,
+                .arg = cam_buf,
+            };
+            lcd_trans_submit(&trans, NULL, portMAX_DELAY);
         }
 #else
-        lcd_set_index(0, 0, CAM_WIDTH - 1, CAM_HIGH - 1);
-        lcd_write_data(cam_buf, CAM_WIDTH * CAM_HIGH * 2);
+        lcd_trans_t trans = {
+            .set_index = 1,
+            .x_end = CAM_WIDTH - 1,
+            .y_end = CAM_HIGH - 1,
+            .data = cam_buf,
+            .len = CAM_WIDTH * CAM_HIGH * 2,
+            .cb = lcd_trans_done_cb,
+            .arg = cam_buf,
+        };
+        // 异步发送, 发送完成后在回调中归还buffer, 发送的同时采集下一帧
+        lcd_trans_submit(&trans, NULL, portMAX_DELAY);
+#endif
+#if SNAPSHOT_INTERVAL && !JPEG_MODE
+        if (++frame_cnt % SNAPSHOT_INTERVAL == 0) {
+            snapshot();
+        }
 #endif
-        cam_give(cam_buf);   
-        // 使用逻辑分析仪观察帧率
-        gpio_set_level(LCD_BK, 1);
-        gpio_set_level(LCD_BK, 0);  
     }
-    vTaskDelete(NULL);
+#endif
+    MEM_TASK_DELETE();
+}
+
+#if JPEG_BENCH
+// 输出与host/jpeg_bench相同的表格, 各阶段的时间比例需要把tjpgd.h中的JD_PROFILE设为1
+static void jpeg_bench_task(void *arg)
+{
+    jpeg_bench_corpus(JPEG_BENCH);
+    MEM_TASK_CREATE("main", cam_task, "cam_task", 2048, NULL, configMAX_PRIORITIES, NULL);
+    MEM_TASK_DELETE();
 }
+#endif
 
 void app_main() 
 {
-    xTaskCreate(cam_task, "cam_task", 2048, NULL, configMAX_PRIORITIES, NULL);
+#if JPEG_BENCH
+    MEM_TASK_CREATE("main", jpeg_bench_task, "jpeg_bench", 4096, NULL, configMAX_PRIORITIES - 3, NULL);
+#else
+    MEM_TASK_CREATE("main", cam_task, "cam_task", 2048, NULL, configMAX_PRIORITIES, NULL);
+#endif
 }
\ No newline at end of file